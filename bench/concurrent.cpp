@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "concurrent_red_black_tree.h"
+#include "red_black_tree.h"
+
+namespace
+{
+
+constexpr int tree_size = 1000000;
+constexpr int key_range = 2 * tree_size;
+constexpr int operation_count = 4000000;
+
+/// <summary>
+/// RedBlackTree behind one std::mutex, the baseline every other mode has to beat.
+/// </summary>
+class MutexTree
+{
+public:
+    bool Insert(const int key, const int value)
+    {
+        std::lock_guard lock(mutex_);
+        return tree_.Insert(key, value);
+    }
+
+    bool Erase(const int key)
+    {
+        std::lock_guard lock(mutex_);
+        return tree_.Erase(key);
+    }
+
+    std::optional<int> GetValue(const int key)
+    {
+        std::lock_guard lock(mutex_);
+        return tree_.GetValue(key);
+    }
+
+private:
+    std::mutex mutex_;
+    rbt::RedBlackTree<int, int> tree_;
+};
+
+/// <summary>
+/// Run a mix of lookups, inserts and erases of random keys on all threads and print the throughput.
+/// Inserts and erases are equally frequent, so the tree size stays around tree_size.
+/// </summary>
+/// <param name="name">The name of the tree.</param>
+/// <param name="thread_count">The number of threads.</param>
+/// <param name="read_percent">The percentage of lookups.</param>
+template <typename Tree> void Run(const std::string_view name, const int thread_count, const int read_percent)
+{
+    Tree tree;
+    rbt::IntRandomNumberGenerator gen(0, key_range);
+    for (int i = 0; i < tree_size; ++i) {
+        const int random_number = gen();
+        tree.Insert(random_number, random_number);
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic<size_t> total_found = 0;
+    const auto start_point = std::chrono::steady_clock::now();
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&] {
+            rbt::IntRandomNumberGenerator rng(0, key_range);
+            size_t found = 0;
+            for (int i = 0; i < operation_count / thread_count; ++i) {
+                const int key = rng();
+                const int op = rng() % 100;
+                if (op < read_percent) {
+                    found += tree.GetValue(key).has_value();
+                } else if (op % 2) {
+                    tree.Insert(key, key);
+                } else {
+                    tree.Erase(key);
+                }
+            }
+            total_found += found;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto end_point = std::chrono::steady_clock::now();
+    const double time = std::chrono::duration<double>(end_point - start_point).count();
+    std::cout << std::format("{:<14} threads {:>3}, reads {:>3}%: {:.2f} M ops/s, found {}.\n", name, thread_count, read_percent, operation_count / time / 1e6,
+                             total_found.load());
+}
+
+} // namespace
+
+int main()
+{
+#ifndef NDEBUG
+    std::cerr << "Running benchmark in debug mode is not recommended.\n";
+#endif
+
+    const int max_threads = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+    std::vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    for (const int read_percent : {50, 90, 99}) {
+        for (const int thread_count : thread_counts) {
+            Run<MutexTree>("std::mutex", thread_count, read_percent);
+            Run<rbt::ConcurrentRedBlackTree<int, int, rbt::LockMode::SharedMutex>>("SharedMutex", thread_count, read_percent);
+            Run<rbt::ConcurrentRedBlackTree<int, int, rbt::LockMode::LockCoupling>>("LockCoupling", thread_count, read_percent);
+            Run<rbt::ConcurrentRedBlackTree<int, int, rbt::LockMode::Optimistic>>("Optimistic", thread_count, read_percent);
+        }
+    }
+}
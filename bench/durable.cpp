@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "durable_red_black_tree.h"
+#include "red_black_tree.h"
+
+namespace
+{
+
+constexpr int operation_count = 20000;
+
+using DurableTree = rbt::DurableRedBlackTree<int, int>;
+
+/// <summary>
+/// Insert count random keys from all threads, without checkpoints, so every update waits for a log sync.
+/// </summary>
+/// <returns>The number of syncs.</returns>
+auto Fill(DurableTree& tree, const int thread_count, const int count) -> size_t
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            rbt::IntRandomNumberGenerator rng(0, std::numeric_limits<int>::max());
+            for (int i = t; i < count; i += thread_count) {
+                tree.InsertOrAssign(rng(), i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return tree.SyncCount();
+}
+
+/// <summary>
+/// Print the update throughput and the number of updates sharing a sync, for a number of threads.
+/// </summary>
+void RunGroupCommit(const std::filesystem::path& directory, const int thread_count)
+{
+    std::filesystem::remove_all(directory);
+    DurableTree tree(directory, std::numeric_limits<size_t>::max());
+    const auto start_point = std::chrono::steady_clock::now();
+    const size_t syncs = Fill(tree, thread_count, operation_count);
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_point).count();
+    std::cout << std::format("Group commit threads {:>3}: {:>10.0f} ops/s, {:>6} syncs, {:>6.1f} updates per sync.\n", thread_count, operation_count / time, syncs,
+                             static_cast<double>(operation_count) / static_cast<double>(syncs));
+}
+
+/// <summary>
+/// Print the time to open a tree from a log of the given length, and from a snapshot of the same tree.
+/// </summary>
+void RunRecovery(const std::filesystem::path& directory, const int log_length)
+{
+    std::filesystem::remove_all(directory);
+    {
+        DurableTree tree(directory, std::numeric_limits<size_t>::max());
+        Fill(tree, 64, log_length);
+    }
+    const size_t log_bytes = std::filesystem::file_size(directory / "log");
+
+    auto start_point = std::chrono::steady_clock::now();
+    {
+        DurableTree tree(directory, std::numeric_limits<size_t>::max());
+        const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_point).count();
+        std::cout << std::format("Recovery from log of {:>8} records ({:>6.1f} MiB): {:>8.2f} ms, {:.1f} M records/s.\n", log_length, log_bytes / 1048576.0,
+                                 time * 1e3, log_length / time / 1e6);
+        tree.Checkpoint();
+    }
+    start_point = std::chrono::steady_clock::now();
+    const DurableTree tree(directory);
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_point).count();
+    std::cout << std::format("Recovery from snapshot of {:>8} elements:           {:>8.2f} ms.\n", tree.Size(), time * 1e3);
+}
+
+} // namespace
+
+/// <summary>
+/// The syncs go to the file system of the directory given as the first argument, the temporary directory by default.
+/// </summary>
+int main(const int argc, char** argv)
+{
+#ifndef NDEBUG
+    std::cerr << "Running benchmark in debug mode is not recommended.\n";
+#endif
+
+    const std::filesystem::path directory = (argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::temp_directory_path()) / "rbt-bench-durable";
+    for (int thread_count = 1; thread_count <= 64; thread_count *= 2) {
+        RunGroupCommit(directory, thread_count);
+    }
+    for (const int log_length : {10000, 100000, 1000000}) {
+        RunRecovery(directory, log_length);
+    }
+    std::filesystem::remove_all(directory);
+}
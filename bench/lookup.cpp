@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+
+namespace
+{
+
+constexpr int tree_size = 10000000;
+constexpr int lookup_count = 10000000;
+constexpr size_t batch_size = 4096;
+
+using Tree = rbt::PooledRedBlackTree<int, int>;
+
+/// <summary>
+/// Look up all keys with GetValues in batches and print the throughput.
+/// </summary>
+/// <typeparam name="GroupSize">The number of descents in flight.</typeparam>
+/// <param name="tree">The tree.</param>
+/// <param name="keys">The keys.</param>
+template <size_t GroupSize> void RunGroup(const Tree& tree, const std::vector<int>& keys)
+{
+    std::vector<std::optional<int>> values(batch_size);
+    size_t found = 0;
+    const auto start_point = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i += batch_size) {
+        const auto batch = std::span(keys).subspan(i, std::min(batch_size, keys.size() - i));
+        tree.GetValues<GroupSize>(batch, values);
+        found += std::ranges::count_if(values.begin(), values.begin() + batch.size(), [](const auto& value) { return value.has_value(); });
+    }
+    const auto end_point = std::chrono::steady_clock::now();
+    const double time = std::chrono::duration<double>(end_point - start_point).count();
+    std::cout << std::format("GetValues<{:>2}>: {:.2f} M lookups/s, found {}.\n", GroupSize, keys.size() / time / 1e6, found);
+}
+
+} // namespace
+
+int main()
+{
+#ifndef NDEBUG
+    std::cerr << "Running benchmark in debug mode is not recommended.\n";
+#endif
+
+    // Random keys spread over a large range, so that nearly every level of a descent misses the cache.
+    rbt::IntRandomNumberGenerator gen(0, tree_size * 4);
+    Tree tree;
+    for (int i = 0; i < tree_size; ++i) {
+        const int random_number = gen();
+        tree.Insert(random_number, random_number);
+    }
+    std::vector<int> keys;
+    keys.reserve(lookup_count);
+    for (int i = 0; i < lookup_count; ++i) {
+        keys.push_back(gen());
+    }
+    std::cout << std::format("{} random lookups in a tree of {} elements.\n", keys.size(), tree.Size());
+
+    // Baseline: one dependent pointer chase at a time.
+    size_t found = 0;
+    const auto start_point = std::chrono::steady_clock::now();
+    for (const int key : keys) {
+        found += tree.GetValue(key).has_value();
+    }
+    const auto end_point = std::chrono::steady_clock::now();
+    const double time = std::chrono::duration<double>(end_point - start_point).count();
+    std::cout << std::format("GetValue:      {:.2f} M lookups/s, found {}.\n", keys.size() / time / 1e6, found);
+
+    [&]<size_t... GroupSizes>(std::index_sequence<GroupSizes...>) {
+        (RunGroup<GroupSizes>(tree, keys), ...);
+    }(std::index_sequence<1, 2, 4, 6, 8, 12, 16, 24, 32>{});
+}
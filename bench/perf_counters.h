@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench
+{
+
+/**
+ * Hardware cache miss counter of the calling thread, user space only, through perf_event_open.
+ * Opening fails without a PMU or with kernel.perf_event_paranoid > 2, the counter then reads as absent.
+ */
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+#if defined(__linux__)
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+
+    auto operator=(const CacheMissCounter&) -> CacheMissCounter& = delete;
+
+    ~CacheMissCounter() noexcept
+    {
+#if defined(__linux__)
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+#endif
+    }
+
+    [[nodiscard]] bool IsAvailable() const { return fd_ >= 0; }
+
+    void Start() const
+    {
+#if defined(__linux__)
+        if (fd_ >= 0) {
+            ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /// <summary>
+    /// Stop counting.
+    /// </summary>
+    /// <returns>The misses since Start, if the counter is available.</returns>
+    auto Stop() const -> std::optional<std::uint64_t>
+    {
+#if defined(__linux__)
+        if (fd_ >= 0) {
+            ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t count = 0;
+            if (::read(fd_, &count, sizeof(count)) == sizeof(count)) {
+                return count;
+            }
+        }
+#endif
+        return std::nullopt;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+/// <summary>
+/// Reset the peak resident set size of the process to the current one, so that PeakRssBytes measures from here.
+/// Needs Linux 4.0, without it the peak covers the whole process.
+/// </summary>
+inline void ResetPeakRss()
+{
+#if defined(__GLIBC__)
+    // Hand the memory freed by earlier benchmarks back first, it would count as resident otherwise.
+    ::malloc_trim(0);
+#endif
+#if defined(__linux__)
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+/// <summary>
+/// Get the peak resident set size of the process.
+/// </summary>
+/// <returns>The bytes, 0 if unknown.</returns>
+inline auto PeakRssBytes() -> size_t
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.starts_with("VmHWM:")) {
+            return static_cast<size_t>(std::stoull(line.substr(6))) * 1024;
+        }
+    }
+    return 0;
+}
+
+} // namespace bench
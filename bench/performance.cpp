@@ -1,102 +1,439 @@
-#include <spdlog/spdlog.h>
-
+#include <algorithm>
 #include <chrono>
+#include <filesystem>
+#include <format>
 #include <iostream>
 #include <map>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <thread>
+#include <vector>
 
+#include "mapped_red_black_tree.h"
 #include "red_black_tree.h"
+#include "sharded_red_black_tree.h"
+#include "wide_tree.h"
 
 int main()
 {
 #ifndef NDEBUG
-    spdlog::warn("Running benchmark in debug mode is not recommended.");
+    std::cerr << "Running benchmark in debug mode is not recommended.\n";
 #endif
 
     constexpr int iterate_time = 10000000;
     rbt::IntRandomNumberGenerator gen(0, 999999);
+    // Per-operation timings of the tree against std::map, std::set, absl::btree_map and a sorted vector are in bench/suite.cpp.
+    std::chrono::steady_clock::time_point start_point;
+    std::chrono::steady_clock::time_point end_point;
+    double map_time = 0;
+    double tree_time = 0;
+    double pooled_tree_time = 0;
+    double wide_tree_time = 0;
+
     // *********************************************
-    // Ordered elements read store test.
+    // Read-heavy random lookup test.
     // *********************************************
-    // std::map.
-    auto start_point = std::chrono::steady_clock::now();
     {
         std::map<int, int> m;
+        rbt::RedBlackTree<int, int> t;
+        rbt::WideTree<int, int> w;
+        // std::ranges::less is not a SIMD comparator, so this one keeps the binary search in its nodes.
+        rbt::WideTree<int, int, rbt::kWideTreeFanout<int>, std::ranges::less> b;
+        std::vector<int> keys;
+        keys.reserve(iterate_time);
         for (int i = 0; i < iterate_time; ++i) {
-            m.emplace(i, i);
+            const int random_number = gen();
+            m.emplace(random_number, random_number);
+            t.Insert(random_number, random_number);
+            w.Insert(random_number, random_number);
+            b.Insert(random_number, random_number);
+            keys.push_back(gen());
         }
-        for (int i = 0; i < iterate_time; ++i) {
-            const auto it = m.find(i);
+
+        // std::map.
+        size_t map_found = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const int key : keys) {
+            map_found += m.contains(key);
         }
-        for (int i = 0; i < iterate_time; ++i) {
-            const auto flag = m.erase(i);
+        end_point = std::chrono::steady_clock::now();
+        map_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // red-black-tree.
+        size_t tree_found = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const int key : keys) {
+            tree_found += t.Contains(key);
         }
+        end_point = std::chrono::steady_clock::now();
+        tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // wide tree.
+        size_t wide_tree_found = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const int key : keys) {
+            wide_tree_found += w.Contains(key);
+        }
+        end_point = std::chrono::steady_clock::now();
+        wide_tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // wide tree with binary search.
+        size_t binary_found = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const int key : keys) {
+            binary_found += b.Contains(key);
+        }
+        end_point = std::chrono::steady_clock::now();
+        const double binary_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        std::cout << std::format("Lookup {} random keys in {} elements: Map time is {} second(s), found {}.\n", keys.size(), m.size(), map_time, map_found);
+        std::cout << std::format("Lookup {} random keys in {} elements: Tree time is {} second(s), found {}.\n", keys.size(), t.Size(), tree_time, tree_found);
+        std::cout << std::format("Lookup {} random keys in {} elements: Wide tree time is {} second(s), found {}.\n", keys.size(), w.Size(), wide_tree_time,
+                                 wide_tree_found);
+        std::cout << std::format("Lookup {} random keys in {} elements: Wide tree (binary search) time is {} second(s), found {}.\n", keys.size(), b.Size(),
+                                 binary_time, binary_found);
     }
-    auto end_point = std::chrono::steady_clock::now();
-    auto map_time = std::chrono::duration<double>(end_point - start_point).count();
 
-    // red-black-tree.
-    start_point = std::chrono::steady_clock::now();
+    // *********************************************
+    // Full in-order traversal test.
+    // *********************************************
     {
-        rbt::RedBlackTree<int, int> t;
+        std::map<int, int> m;
+        rbt::PooledRedBlackTree<int, int> t;
         for (int i = 0; i < iterate_time; ++i) {
-            t.Insert(i, i);
+            const int random_number = gen();
+            m.emplace(random_number, random_number);
+            t.Insert(random_number, random_number);
         }
-        for (int i = 0; i < iterate_time; ++i) {
-            const auto value = t.GetValue(i);
+
+        // std::map.
+        long long map_sum = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const auto& [key, value] : m) {
+            map_sum += value;
         }
-        for (int i = 0; i < iterate_time; ++i) {
-            const auto flag = t.Erase(i);
+        end_point = std::chrono::steady_clock::now();
+        map_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // red-black-tree.
+        long long tree_sum = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const auto [key, value] : t) {
+            tree_sum += value;
+        }
+        end_point = std::chrono::steady_clock::now();
+        tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // std::map, in reverse.
+        long long map_reverse_sum = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const auto& [key, value] : m | std::views::reverse) {
+            map_reverse_sum += value;
         }
+        end_point = std::chrono::steady_clock::now();
+        const double map_reverse_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // red-black-tree, in reverse. std::reverse_iterator copies the whole iterator, path included, on every dereference.
+        long long tree_reverse_sum = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const auto [key, value] : t | std::views::reverse) {
+            tree_reverse_sum += value;
+        }
+        end_point = std::chrono::steady_clock::now();
+        const double tree_reverse_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        std::cout << std::format("Traverse {} elements: Map time is {} second(s), sum {}.\n", m.size(), map_time, map_sum);
+        std::cout << std::format("Traverse {} elements: Tree time is {} second(s), sum {}.\n", t.Size(), tree_time, tree_sum);
+        std::cout << std::format("Traverse {} elements in reverse: Map time is {} second(s), sum {}.\n", m.size(), map_reverse_time, map_reverse_sum);
+        std::cout << std::format("Traverse {} elements in reverse: Tree time is {} second(s), sum {}, {} byte iterator.\n", t.Size(), tree_reverse_time,
+                                 tree_reverse_sum, sizeof(rbt::PooledRedBlackTree<int, int>::const_iterator));
     }
-    end_point = std::chrono::steady_clock::now();
-    auto tree_time = std::chrono::duration<double>(end_point - start_point).count();
 
-    std::cout << std::format("Ordered insert-delete {} elements: Map time is {} second(s).\n", iterate_time, map_time);
-    std::cout << std::format("Ordered insert-delete {} elements: Tree time is {} second(s).\n", iterate_time, tree_time);
+    // *********************************************
+    // Bulk load test.
+    // *********************************************
+    {
+        std::vector<std::pair<int, int>> pairs;
+        pairs.reserve(iterate_time);
+        for (int i = 0; i < iterate_time; ++i) {
+            pairs.emplace_back(i, i);
+        }
+
+        // insert one by one.
+        start_point = std::chrono::steady_clock::now();
+        {
+            rbt::PooledRedBlackTree<int, int> t;
+            for (const auto& [key, value] : pairs) {
+                t.Insert(key, value);
+            }
+        }
+        end_point = std::chrono::steady_clock::now();
+        tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // bulk load.
+        start_point = std::chrono::steady_clock::now();
+        {
+            rbt::PooledRedBlackTree<int, int> t;
+            t.BuildFromSorted(pairs.begin(), pairs.end());
+        }
+        end_point = std::chrono::steady_clock::now();
+        pooled_tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        std::cout << std::format("Load {} sorted elements: Insert time is {} second(s).\n", iterate_time, tree_time);
+        std::cout << std::format("Load {} sorted elements: BuildFromSorted time is {} second(s).\n", iterate_time, pooled_tree_time);
+    }
 
     // *********************************************
-    // Random elements read store test.
+    // Batched random lookup test.
     // *********************************************
-    // std::map.
-    start_point = std::chrono::steady_clock::now();
     {
-        std::map<int, int> m;
+        constexpr size_t batch_size = 4096;
+        rbt::PooledRedBlackTree<int, int> t;
+        std::vector<int> keys;
+        keys.reserve(iterate_time);
         for (int i = 0; i < iterate_time; ++i) {
             const int random_number = gen();
-            m.emplace(random_number, random_number);
+            t.Insert(random_number, random_number);
+            keys.push_back(gen());
+        }
+
+        // one by one.
+        size_t found = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const int key : keys) {
+            found += t.GetValue(key).has_value();
+        }
+        end_point = std::chrono::steady_clock::now();
+        tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // batched.
+        size_t batch_found = 0;
+        std::vector<std::optional<int>> values(batch_size);
+        start_point = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < keys.size(); i += batch_size) {
+            const auto batch = std::span(keys).subspan(i, std::min(batch_size, keys.size() - i));
+            t.GetValues(batch, values);
+            batch_found += std::ranges::count_if(values.begin(), values.begin() + batch.size(), [](const auto& value) { return value.has_value(); });
         }
+        end_point = std::chrono::steady_clock::now();
+        pooled_tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        std::cout << std::format("Lookup {} random keys: GetValue time is {} second(s), found {}.\n", keys.size(), tree_time, found);
+        std::cout << std::format("Lookup {} random keys: GetValues time is {} second(s), found {}.\n", keys.size(), pooled_tree_time, batch_found);
+    }
+
+    // *********************************************
+    // Node layout test.
+    // *********************************************
+    {
+        std::vector<int> keys;
+        keys.reserve(iterate_time);
         for (int i = 0; i < iterate_time; ++i) {
-            const int random_number = gen();
-            const auto it = m.find(random_number);
+            keys.push_back(gen());
         }
+
+        const auto run = [&]<rbt::NodeLayout Layout>(const char* name) {
+            size_t found = 0;
+            start_point = std::chrono::steady_clock::now();
+            {
+                rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, rbt::LayoutPolicy<Layout>> t;
+                for (const int key : keys) {
+                    t.Insert(key, key);
+                }
+                for (const int key : keys) {
+                    found += t.GetValue(key ^ 1).has_value();
+                }
+                for (const int key : keys) {
+                    const auto flag = t.Erase(key);
+                }
+            }
+            end_point = std::chrono::steady_clock::now();
+            tree_time = std::chrono::duration<double>(end_point - start_point).count();
+            std::cout << std::format("Random insert-lookup-delete {} elements: {} layout time is {} second(s), found {}.\n", keys.size(), name, tree_time, found);
+        };
+        run.template operator()<rbt::NodeLayout::Pointer>("Pointer");
+        run.template operator()<rbt::NodeLayout::PackedColor>("PackedColor");
+        run.template operator()<rbt::NodeLayout::Index32>("Index32");
+    }
+
+    // *********************************************
+    // Sharded batch ingest test.
+    // *********************************************
+    {
+        const size_t thread_count = std::max(1U, std::thread::hardware_concurrency());
+        std::vector<std::pair<int, int>> entries;
+        std::vector<int> keys;
+        entries.reserve(iterate_time);
+        keys.reserve(iterate_time);
         for (int i = 0; i < iterate_time; ++i) {
             const int random_number = gen();
-            const auto flag = m.erase(random_number);
+            entries.emplace_back(random_number, i);
+            keys.push_back(random_number);
         }
+
+        // one by one.
+        start_point = std::chrono::steady_clock::now();
+        {
+            rbt::RedBlackTree<int, int> t;
+            for (const auto& [key, value] : entries) {
+                t.Insert(key, value);
+            }
+        }
+        end_point = std::chrono::steady_clock::now();
+        tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // sharded, one shard per thread.
+        size_t found = 0;
+        double lookup_time = 0;
+        start_point = std::chrono::steady_clock::now();
+        {
+            rbt::ShardedRedBlackTree<int, int> t(rbt::ShardedRedBlackTree<int, int>::SampleBoundaries(std::span(keys).first(4096), thread_count), thread_count);
+            t.InsertBatch(entries);
+            end_point = std::chrono::steady_clock::now();
+            pooled_tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+            std::vector<std::optional<int>> values(keys.size());
+            const auto lookup_point = std::chrono::steady_clock::now();
+            t.GetValues(keys, values);
+            lookup_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - lookup_point).count();
+            found = std::ranges::count_if(values, [](const auto& value) { return value.has_value(); });
+        }
+
+        std::cout << std::format("Ingest {} random elements: Insert time is {} second(s).\n", entries.size(), tree_time);
+        std::cout << std::format("Ingest {} random elements: {} shards InsertBatch time is {} second(s).\n", entries.size(), thread_count, pooled_tree_time);
+        std::cout << std::format("Lookup {} random keys: {} shards GetValues time is {} second(s), found {}.\n", keys.size(), thread_count, lookup_time, found);
     }
-    end_point = std::chrono::steady_clock::now();
-    map_time = std::chrono::duration<double>(end_point - start_point).count();
 
-    // red-black-tree.
-    start_point = std::chrono::steady_clock::now();
+    // *********************************************
+    // Set operation test.
+    // *********************************************
     {
+        const size_t thread_count = std::max(1U, std::thread::hardware_concurrency());
+        rbt::ThreadPool pool(thread_count);
+        const auto make_tree = [&gen] {
+            rbt::RedBlackTree<int, int> t;
+            for (int i = 0; i < iterate_time; ++i) {
+                t.Insert(gen(), i);
+            }
+            return t;
+        };
+
+        // insert one tree into the other.
+        rbt::RedBlackTree<int, int> lhs = make_tree();
+        rbt::RedBlackTree<int, int> rhs = make_tree();
+        start_point = std::chrono::steady_clock::now();
+        for (const auto& [key, value] : rhs) {
+            lhs.Insert(key, value);
+        }
+        end_point = std::chrono::steady_clock::now();
+        tree_time = std::chrono::duration<double>(end_point - start_point).count();
+        const size_t size = lhs.Size();
+
+        // join-based union, sequential and on the pool.
+        lhs = make_tree();
+        rhs = make_tree();
+        start_point = std::chrono::steady_clock::now();
+        lhs = rbt::RedBlackTree<int, int>::Union(std::move(lhs), std::move(rhs));
+        end_point = std::chrono::steady_clock::now();
+        pooled_tree_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        lhs = make_tree();
+        rhs = make_tree();
+        start_point = std::chrono::steady_clock::now();
+        lhs = rbt::RedBlackTree<int, int>::Union(std::move(lhs), std::move(rhs), &pool);
+        end_point = std::chrono::steady_clock::now();
+        const double parallel_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        // split in half and join again.
+        start_point = std::chrono::steady_clock::now();
+        auto [left, right] = lhs.Split(500000);
+        lhs = rbt::RedBlackTree<int, int>::Join(std::move(left), std::move(right));
+        end_point = std::chrono::steady_clock::now();
+        const double split_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        std::cout << std::format("Union of two {} element trees: Insert time is {} second(s), size {}.\n", iterate_time, tree_time, size);
+        std::cout << std::format("Union of two {} element trees: Union time is {} second(s), size {}.\n", iterate_time, pooled_tree_time, lhs.Size());
+        std::cout << std::format("Union of two {} element trees: {} threads Union time is {} second(s).\n", iterate_time, thread_count, parallel_time);
+        std::cout << std::format("Split and Join of {} elements: time is {} second(s).\n", lhs.Size(), split_time);
+    }
+
+    // *********************************************
+    // Snapshot test.
+    // *********************************************
+    {
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / "rbt-bench.snapshot";
+        std::vector<int> keys;
+        keys.reserve(iterate_time);
         rbt::RedBlackTree<int, int> t;
         for (int i = 0; i < iterate_time; ++i) {
-            const int random_number = gen();
-            t.Insert(random_number, random_number);
+            keys.push_back(gen());
+            t.Insert(keys.back(), i);
         }
-        for (int i = 0; i < iterate_time; ++i) {
-            const int random_number = gen();
-            const auto value = t.GetValue(random_number);
+
+        start_point = std::chrono::steady_clock::now();
+        rbt::SaveSnapshot(t, path);
+        end_point = std::chrono::steady_clock::now();
+        const double save_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        start_point = std::chrono::steady_clock::now();
+        rbt::RedBlackTree<int, int> loaded;
+        rbt::LoadSnapshot(path, loaded);
+        end_point = std::chrono::steady_clock::now();
+        const double load_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        start_point = std::chrono::steady_clock::now();
+        const rbt::MappedRedBlackTree<int, int> mapped(path);
+        end_point = std::chrono::steady_clock::now();
+        const double map_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        size_t found = 0;
+        start_point = std::chrono::steady_clock::now();
+        for (const int key : keys) {
+            found += mapped.Contains(key) ? 1 : 0;
         }
+        end_point = std::chrono::steady_clock::now();
+        const double lookup_time = std::chrono::duration<double>(end_point - start_point).count();
+
+        std::cout << std::format("Snapshot of {} elements: SaveSnapshot time is {} second(s).\n", t.Size(), save_time);
+        std::cout << std::format("Snapshot of {} elements: LoadSnapshot time is {} second(s).\n", loaded.Size(), load_time);
+        std::cout << std::format("Snapshot of {} elements: MappedRedBlackTree open time is {} second(s).\n", mapped.Size(), map_time);
+        std::cout << std::format("Lookup {} random keys: MappedRedBlackTree time is {} second(s), found {}.\n", keys.size(), lookup_time, found);
+        std::filesystem::remove(path);
+    }
+
+    // *********************************************
+    // Statistics test.
+    // *********************************************
+    {
+        std::vector<int> keys;
+        keys.reserve(iterate_time);
         for (int i = 0; i < iterate_time; ++i) {
-            const int random_number = gen();
-            const auto flag = t.Erase(random_number);
+            keys.push_back(gen());
         }
-    }
-    end_point = std::chrono::steady_clock::now();
-    tree_time = std::chrono::duration<double>(end_point - start_point).count();
 
-    std::cout << std::format("Random insert-delete {} elements: Map time is {} second(s).\n", iterate_time, map_time);
-    std::cout << std::format("Random insert-delete {} elements: Tree time is {} second(s).\n", iterate_time, tree_time);
+        const auto run = [&]<class Policy>(const char* name) {
+            size_t found = 0;
+            rbt::TreeStats stats;
+            start_point = std::chrono::steady_clock::now();
+            {
+                rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, Policy> t;
+                for (const int key : keys) {
+                    t.Insert(key, key);
+                }
+                for (const int key : keys) {
+                    found += t.GetValue(key ^ 1).has_value();
+                }
+                end_point = std::chrono::steady_clock::now();
+                stats = t.Stats();
+            }
+            tree_time = std::chrono::duration<double>(end_point - start_point).count();
+            std::cout << std::format("Random insert-lookup {} elements: {} time is {} second(s), found {}.\n", keys.size(), name, tree_time, found);
+            std::cout << std::format("    height {}, black height {}, average depth {:.2f}, {} bytes, {:.2f} comparisons per operation, {} rotations.\n",
+                                     stats.Height, stats.BlackHeight, stats.AverageDepth, stats.MemoryBytes, stats.Counts.ComparisonsPerOperation(),
+                                     stats.Counts[rbt::Counter::Rotations]);
+        };
+        run.template operator()<rbt::DefaultTreePolicy>("no statistics");
+        run.template operator()<rbt::StatisticsPolicy<>>("StatisticsPolicy");
+    }
 }
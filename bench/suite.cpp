@@ -0,0 +1,349 @@
+#include <absl/container/btree_map.h>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perf_counters.h"
+#include "red_black_tree.h"
+#include "workload.h"
+
+/**
+ * Google Benchmark suite comparing RedBlackTree with std::map, std::set, absl::btree_map and a sorted vector.
+ * Every benchmark is one operation on one container, key type, key distribution and size, named
+ * operation/container/key/distribution/size, e.g. "LookupHit/absl::btree_map/int/zipfian/16384".
+ * Keys and operation sequences are generated before timing starts, and every result feeds benchmark::DoNotOptimize.
+ * Reported counters: ns/op, cache-misses/op (if perf_event_open is permitted) and peak RSS during the benchmark.
+ *
+ * Sizes go from 512 elements, which fit into L1, up to 4M by default. Pass --rbt_max_size=100000000 to add 16M and 100M,
+ * and --benchmark_filter to pick a subset, e.g. --benchmark_filter='^LookupHit/.*int/random'.
+ * The target is bench-suite, configured with "xmake f --bench=y" so that other builds do not fetch its dependencies.
+ */
+
+namespace
+{
+
+enum class Operation
+{
+    Insert,
+    LookupHit,
+    LookupMiss,
+    Erase,
+    Mixed
+};
+
+constexpr std::string_view kOperationNames[] = {"Insert", "LookupHit", "LookupMiss", "Erase", "Mixed"};
+
+constexpr size_t kSizes[] = {size_t{1} << 9, size_t{1} << 14, size_t{1} << 18, size_t{1} << 22, size_t{1} << 24, 100'000'000};
+
+// Inserts and erases into a sorted vector move O(n) elements, they run up to this size only.
+constexpr size_t kMaxSortedVectorUpdateSize = size_t{1} << 16;
+
+template <typename KeyType> struct RedBlackTreeContainer
+{
+    static constexpr std::string_view kName = "rbt::RedBlackTree";
+    static constexpr bool kFastUpdate = true;
+
+    rbt::RedBlackTree<KeyType, int> tree;
+
+    bool Insert(const KeyType& key) { return tree.Insert(key, 0); }
+
+    bool Find(const KeyType& key) const { return tree.Contains(key); }
+
+    bool Erase(const KeyType& key) { return tree.Erase(key); }
+};
+
+template <typename KeyType> struct StdMapContainer
+{
+    static constexpr std::string_view kName = "std::map";
+    static constexpr bool kFastUpdate = true;
+
+    std::map<KeyType, int> map;
+
+    bool Insert(const KeyType& key) { return map.emplace(key, 0).second; }
+
+    bool Find(const KeyType& key) const { return map.find(key) != map.end(); }
+
+    bool Erase(const KeyType& key) { return map.erase(key) != 0; }
+};
+
+template <typename KeyType> struct StdSetContainer
+{
+    static constexpr std::string_view kName = "std::set";
+    static constexpr bool kFastUpdate = true;
+
+    std::set<KeyType> set;
+
+    bool Insert(const KeyType& key) { return set.insert(key).second; }
+
+    bool Find(const KeyType& key) const { return set.find(key) != set.end(); }
+
+    bool Erase(const KeyType& key) { return set.erase(key) != 0; }
+};
+
+template <typename KeyType> struct BtreeMapContainer
+{
+    static constexpr std::string_view kName = "absl::btree_map";
+    static constexpr bool kFastUpdate = true;
+
+    absl::btree_map<KeyType, int> map;
+
+    bool Insert(const KeyType& key) { return map.emplace(key, 0).second; }
+
+    bool Find(const KeyType& key) const { return map.find(key) != map.end(); }
+
+    bool Erase(const KeyType& key) { return map.erase(key) != 0; }
+};
+
+template <typename KeyType> struct SortedVectorContainer
+{
+    static constexpr std::string_view kName = "sorted_vector";
+    static constexpr bool kFastUpdate = false;
+
+    std::vector<KeyType> keys;
+
+    bool Insert(const KeyType& key)
+    {
+        const auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        if (it != keys.end() && *it == key) {
+            return false;
+        }
+        keys.insert(it, key);
+        return true;
+    }
+
+    bool Find(const KeyType& key) const { return std::binary_search(keys.begin(), keys.end(), key); }
+
+    bool Erase(const KeyType& key)
+    {
+        const auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        if (it == keys.end() || *it != key) {
+            return false;
+        }
+        keys.erase(it);
+        return true;
+    }
+
+    void Build(std::vector<KeyType> entries)
+    {
+        std::sort(entries.begin(), entries.end());
+        entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+        keys = std::move(entries);
+    }
+};
+
+/// <summary>
+/// Fill a container with keys in the given order. The sorted vector sorts them at once.
+/// </summary>
+template <class Container, typename KeyType> void Build(Container& container, const std::vector<KeyType>& keys)
+{
+    if constexpr (requires { container.Build(keys); }) {
+        container.Build(keys);
+    } else {
+        for (const KeyType& key : keys) {
+            container.Insert(key);
+        }
+    }
+}
+
+/**
+ * Timer of the operations of a benchmark, with their cache misses.
+ */
+class OperationTimer
+{
+public:
+    void Start()
+    {
+        cache_misses_.Start();
+        start_point_ = std::chrono::steady_clock::now();
+    }
+
+    /// <summary>
+    /// Stop the timer and hand the elapsed time to the manual time of the iteration.
+    /// </summary>
+    void Stop(benchmark::State& state, const size_t operations)
+    {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_point_).count();
+        if (const auto misses = cache_misses_.Stop()) {
+            misses_ += *misses;
+        }
+        state.SetIterationTime(seconds);
+        seconds_ += seconds;
+        operations_ += operations;
+    }
+
+    void Report(benchmark::State& state) const
+    {
+        if (operations_ == 0) {
+            return;
+        }
+        state.counters["ns/op"] = seconds_ * 1e9 / static_cast<double>(operations_);
+        if (cache_misses_.IsAvailable()) {
+            state.counters["cache-misses/op"] = static_cast<double>(misses_) / static_cast<double>(operations_);
+        }
+        state.counters["peak-rss"] = benchmark::Counter(static_cast<double>(bench::PeakRssBytes()), benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+    }
+
+private:
+    bench::CacheMissCounter cache_misses_;
+    std::chrono::steady_clock::time_point start_point_;
+    double seconds_ = 0;
+    std::uint64_t misses_ = 0;
+    size_t operations_ = 0;
+};
+
+template <class Container, typename KeyType> void Run(benchmark::State& state, const Operation operation, const bench::Distribution distribution, const size_t size)
+{
+    bench::ResetPeakRss();
+    OperationTimer timer;
+    // Lookups and mixed operations repeat their sequence on a tree of the given size, so small trees get enough of them.
+    const size_t sequence_length = std::clamp<size_t>(size, size_t{1} << 16, size_t{1} << 20);
+    // Containers of lookups are built in random order whatever the distribution of the lookups, so their shapes match.
+    const auto build_keys = [&] { return bench::MakeKeys<KeyType>(bench::MakeIndices(bench::Distribution::Random, size, size)); };
+
+    switch (operation) {
+    case Operation::Insert: {
+        const std::vector<KeyType> keys = bench::MakeKeys<KeyType>(bench::MakeIndices(distribution, size, size));
+        for (auto _ : state) {
+            Container container;
+            timer.Start();
+            for (const KeyType& key : keys) {
+                benchmark::DoNotOptimize(container.Insert(key));
+            }
+            timer.Stop(state, keys.size());
+        }
+        break;
+    }
+    case Operation::LookupHit:
+    case Operation::LookupMiss: {
+        Container container;
+        Build(container, build_keys());
+        const std::vector<KeyType> keys = bench::MakeKeys<KeyType>(bench::MakeIndices(distribution, size, sequence_length), operation == Operation::LookupMiss);
+        for (auto _ : state) {
+            size_t found = 0;
+            timer.Start();
+            for (const KeyType& key : keys) {
+                found += container.Find(key) ? 1 : 0;
+            }
+            benchmark::DoNotOptimize(found);
+            timer.Stop(state, keys.size());
+        }
+        break;
+    }
+    case Operation::Erase: {
+        // Zipfian erases repeat the hot keys, which miss after the first time.
+        const std::vector<KeyType> all_keys = build_keys();
+        const std::vector<KeyType> keys = bench::MakeKeys<KeyType>(bench::MakeIndices(distribution, size, size));
+        for (auto _ : state) {
+            Container container;
+            Build(container, all_keys);
+            timer.Start();
+            for (const KeyType& key : keys) {
+                benchmark::DoNotOptimize(container.Erase(key));
+            }
+            timer.Stop(state, keys.size());
+        }
+        break;
+    }
+    case Operation::Mixed: {
+        // 80% lookups, 10% erases and 10% inserts of the same keys, so the size stays near the given one.
+        Container container;
+        Build(container, build_keys());
+        const std::vector<KeyType> keys = bench::MakeKeys<KeyType>(bench::MakeIndices(distribution, size, sequence_length));
+        std::vector<std::uint8_t> kinds(keys.size());
+        std::mt19937_64 engine(7);
+        std::uniform_int_distribution<int> percent(0, 99);
+        for (std::uint8_t& kind : kinds) {
+            const int p = percent(engine);
+            kind = p < 80 ? 0 : (p < 90 ? 1 : 2);
+        }
+        for (auto _ : state) {
+            size_t hits = 0;
+            timer.Start();
+            for (size_t i = 0; i < keys.size(); i++) {
+                switch (kinds[i]) {
+                case 0:
+                    hits += container.Find(keys[i]) ? 1 : 0;
+                    break;
+                case 1:
+                    hits += container.Erase(keys[i]) ? 1 : 0;
+                    break;
+                default:
+                    hits += container.Insert(keys[i]) ? 1 : 0;
+                    break;
+                }
+            }
+            benchmark::DoNotOptimize(hits);
+            timer.Stop(state, keys.size());
+        }
+        break;
+    }
+    }
+    timer.Report(state);
+}
+
+template <template <typename> class Container, typename KeyType> void Register(const std::string_view key_name, const size_t max_size)
+{
+    for (size_t o = 0; o < std::size(kOperationNames); o++) {
+        const auto operation = static_cast<Operation>(o);
+        for (const auto distribution :
+             {bench::Distribution::Sequential, bench::Distribution::Reverse, bench::Distribution::Random, bench::Distribution::Zipfian}) {
+            for (const size_t size : kSizes) {
+                if (size > max_size || (!Container<KeyType>::kFastUpdate && operation != Operation::LookupHit && operation != Operation::LookupMiss
+                                        && size > kMaxSortedVectorUpdateSize)) {
+                    continue;
+                }
+                const std::string name = std::string(kOperationNames[o]) + '/' + std::string(Container<KeyType>::kName) + '/' + std::string(key_name) + '/'
+                                         + std::string(bench::DistributionName(distribution)) + '/' + std::to_string(size);
+                benchmark::RegisterBenchmark(name.c_str(),
+                                             [=](benchmark::State& state) { Run<Container<KeyType>, KeyType>(state, operation, distribution, size); })
+                    ->UseManualTime()
+                    ->Unit(benchmark::kMillisecond);
+            }
+        }
+    }
+}
+
+template <template <typename> class Container> void RegisterKeyTypes(const size_t max_size)
+{
+    Register<Container, int>("int", max_size);
+    Register<Container, std::string>("string", max_size);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t max_size = size_t{1} << 22;
+    constexpr std::string_view max_size_flag = "--rbt_max_size=";
+    for (int i = 1; i < argc; i++) {
+        const std::string_view argument = argv[i];
+        if (argument.starts_with(max_size_flag)) {
+            max_size = std::strtoull(argument.substr(max_size_flag.size()).data(), nullptr, 10);
+            std::copy(argv + i + 1, argv + argc, argv + i);
+            --argc;
+            break;
+        }
+    }
+
+    RegisterKeyTypes<RedBlackTreeContainer>(max_size);
+    RegisterKeyTypes<StdMapContainer>(max_size);
+    RegisterKeyTypes<StdSetContainer>(max_size);
+    RegisterKeyTypes<BtreeMapContainer>(max_size);
+    RegisterKeyTypes<SortedVectorContainer>(max_size);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bench
+{
+
+/**
+ * Order in which a workload touches the keys.
+ */
+enum class Distribution
+{
+    Sequential,
+    Reverse,
+    Random,
+    /**
+     * Zipfian ranks with theta 0.99, scrambled over the key space, so the hot keys are spread over the tree.
+     */
+    Zipfian
+};
+
+inline auto DistributionName(const Distribution distribution) -> std::string_view
+{
+    switch (distribution) {
+    case Distribution::Sequential:
+        return "sequential";
+    case Distribution::Reverse:
+        return "reverse";
+    case Distribution::Random:
+        return "random";
+    case Distribution::Zipfian:
+        return "zipfian";
+    }
+    return "";
+}
+
+/**
+ * Zipfian ranks in [0, n), rank 0 being the most frequent, as in YCSB (Gray et al., Quickly Generating
+ * Billion-Record Synthetic Databases).
+ */
+class ZipfianGenerator
+{
+public:
+    ZipfianGenerator(const std::uint64_t n, const double theta = 0.99) : n_(n), theta_(theta)
+    {
+        double zeta_n = 0;
+        for (std::uint64_t i = 1; i <= n; i++) {
+            zeta_n += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        const double zeta_2 = 1.0 + 1.0 / std::pow(2.0, theta);
+        alpha_ = 1.0 / (1.0 - theta);
+        zeta_n_ = zeta_n;
+        eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - zeta_2 / zeta_n);
+    }
+
+    template <class Engine> auto operator()(Engine& engine) -> std::uint64_t
+    {
+        const double u = std::uniform_real_distribution<double>(0.0, 1.0)(engine);
+        const double uz = u * zeta_n_;
+        if (uz < 1.0) {
+            return 0;
+        }
+        if (uz < 1.0 + std::pow(0.5, theta_)) {
+            return 1;
+        }
+        return std::min(n_ - 1, static_cast<std::uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_)));
+    }
+
+private:
+    std::uint64_t n_;
+    double theta_;
+    double alpha_ = 0;
+    double zeta_n_ = 0;
+    double eta_ = 0;
+};
+
+/// <summary>
+/// Shuffle the indices in [0, n).
+/// </summary>
+inline auto MakePermutation(const size_t n, std::mt19937_64& engine) -> std::vector<std::uint64_t>
+{
+    std::vector<std::uint64_t> permutation(n);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::shuffle(permutation.begin(), permutation.end(), engine);
+    return permutation;
+}
+
+/// <summary>
+/// Generate the indices in [0, n) a workload touches, count of them, before the timed region starts.
+/// Sequential and reverse wrap around, random is a shuffled permutation repeated as needed, Zipfian draws ranks of a shuffled permutation.
+/// </summary>
+/// <param name="distribution">The order.</param>
+/// <param name="n">The number of keys.</param>
+/// <param name="count">The number of indices.</param>
+/// <param name="seed">The seed of random and Zipfian orders.</param>
+/// <returns>The indices.</returns>
+inline auto MakeIndices(const Distribution distribution, const size_t n, const size_t count, const std::uint64_t seed = 42) -> std::vector<std::uint64_t>
+{
+    std::vector<std::uint64_t> indices(count);
+    std::mt19937_64 engine(seed);
+    switch (distribution) {
+    case Distribution::Sequential:
+        for (size_t i = 0; i < count; i++) {
+            indices[i] = i % n;
+        }
+        break;
+    case Distribution::Reverse:
+        for (size_t i = 0; i < count; i++) {
+            indices[i] = n - 1 - i % n;
+        }
+        break;
+    case Distribution::Random: {
+        const std::vector<std::uint64_t> permutation = MakePermutation(n, engine);
+        for (size_t i = 0; i < count; i++) {
+            indices[i] = permutation[i % n];
+        }
+        break;
+    }
+    case Distribution::Zipfian: {
+        // The permutation scatters the hot ranks over the key space and maps distinct ranks to distinct keys, keeping the skew.
+        const std::vector<std::uint64_t> permutation = MakePermutation(n, engine);
+        ZipfianGenerator zipf(n);
+        for (size_t i = 0; i < count; i++) {
+            indices[i] = permutation[zipf(engine)];
+        }
+        break;
+    }
+    }
+    return indices;
+}
+
+/**
+ * Key of index i: 2 * i, so that the odd keys 2 * i + 1 are misses between the hits.
+ * String keys are 24 characters, longer than the small string buffer, and ordered as their integers.
+ */
+template <typename KeyType> auto MakeKey(std::uint64_t index, bool miss = false) -> KeyType;
+
+template <> inline auto MakeKey<int>(const std::uint64_t index, const bool miss) -> int { return static_cast<int>(2 * index + (miss ? 1 : 0)); }
+
+template <> inline auto MakeKey<std::string>(const std::uint64_t index, const bool miss) -> std::string
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "key-%020llu", static_cast<unsigned long long>(2 * index + (miss ? 1 : 0)));
+    return buffer;
+}
+
+template <typename KeyType> auto MakeKeys(const std::vector<std::uint64_t>& indices, const bool miss = false) -> std::vector<KeyType>
+{
+    std::vector<KeyType> keys;
+    keys.reserve(indices.size());
+    for (const std::uint64_t index : indices) {
+        keys.push_back(MakeKey<KeyType>(index, miss));
+    }
+    return keys;
+}
+
+} // namespace bench
@@ -0,0 +1,356 @@
+#pragma once
+
+/**
+ * Thread-safe RedBlackTree, see LockMode.
+ * Definitions live in concurrent_red_black_tree.inl, which is included at the end of this file.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <compare>
+#include <concepts>
+#include <initializer_list>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "epoch.h"
+#include "red_black_tree.h"
+#include "shared_latch.h"
+#include "tree_policy.h"
+
+namespace rbt
+{
+
+#define CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT                                                                                                            \
+    template <typename KeyType, typename ValueType, LockMode Mode, class KeyComparator, class Allocator, class Policy>
+#define CONCURRENT_RED_BLACK_TREE_TYPE ConcurrentRedBlackTree<KeyType, ValueType, Mode, KeyComparator, Allocator, Policy>
+
+/**
+ * RedBlackTree that may be used from many threads at once.
+ * LockMode::SharedMutex accepts any tree. LockMode::LockCoupling and LockMode::Optimistic rely on the single top-down pass of Insert and Erase:
+ * an update holds the latches of the few levels it may restructure and lets go of everything above, so updates and
+ * lookups in different subtrees proceed in parallel. It rules out policies with subtree metadata, which would need
+ * to be refreshed up to the root, and the Index32 layout, whose chunk table grows under the readers.
+ * Allocators other than std::allocator are serialized by a mutex in the lock coupling mode.
+ */
+template <typename KeyType, typename ValueType, LockMode Mode = LockMode::SharedMutex, class KeyComparator = std::less<KeyType>,
+          class Allocator = std::allocator<std::pair<const KeyType, ValueType>>, class Policy = DefaultTreePolicy>
+class ConcurrentRedBlackTree
+{
+    // Updates of both modes without a global lock take the same path, only lookups differ.
+    static constexpr bool kLockCoupling = Mode != LockMode::SharedMutex;
+    static constexpr bool kOptimistic = Mode == LockMode::Optimistic;
+
+    using LatchType = std::conditional_t<kOptimistic, VersionLatch, SharedLatch>;
+    using TreeType = RedBlackTree<KeyType, ValueType, KeyComparator, Allocator, std::conditional_t<kLockCoupling, LatchPolicy<Policy, LatchType, kOptimistic>, Policy>>;
+    using Node = typename TreeType::RedBlackTreeNode;
+    using ColorType = typename TreeType::ColorType;
+
+    static_assert(!kLockCoupling || !TreeType::kAugmented, "Lock coupling cannot refresh subtree metadata above the latched levels.");
+    static_assert(!kLockCoupling || Policy::kNodeLayout != NodeLayout::Index32, "Lock coupling needs nodes that are reachable without the chunk table.");
+    static_assert(!kOptimistic || (std::is_trivially_copyable_v<KeyType> && std::is_trivially_copyable_v<ValueType>),
+                  "Optimistic lookups copy keys and values that may be written meanwhile.");
+
+    struct NoMutex
+    {
+        void lock() {}
+        void unlock() {}
+    };
+
+    static constexpr bool kThreadSafeAllocator = std::is_same_v<Allocator, std::allocator<std::pair<const KeyType, ValueType>>>;
+
+    /**
+     * Upper bound of the nodes an update latches at once: three levels of the search path, the children of the current
+     * node, the sibling with its children and grandchildren, and the node whose entry Erase replaces.
+     */
+    static constexpr size_t kMaxWindow = 16;
+
+    /**
+     * Number of retired nodes that triggers a new epoch and frees what no lookup can reach anymore.
+     */
+    static constexpr size_t kRetireBatch = 256;
+
+    struct RetiredNode
+    {
+        // Epoch in which the node was unlinked.
+        std::uint64_t Epoch;
+        Node* Pointer;
+    };
+
+    /**
+     * State of the optimistic lookups: the epochs they pin, the nodes waiting to be freed, and the number of entries
+     * Erase has moved up the tree so far.
+     */
+    struct Reclamation
+    {
+        EpochDomain Epochs;
+        std::mutex Mutex;
+        std::vector<RetiredNode> Retired;
+        std::atomic<std::uint64_t> Moves = 0;
+    };
+
+    struct NoReclamation
+    {
+    };
+
+    /**
+     * Nodes latched exclusively by one update. Whatever is still held is released on destruction.
+     */
+    struct WriteWindow
+    {
+        explicit WriteWindow(LatchType& root_latch) : RootLatch(&root_latch) { root_latch.lock(); }
+
+        WriteWindow(const WriteWindow&) = delete;
+
+        auto operator=(const WriteWindow&) -> WriteWindow& = delete;
+
+        ~WriteWindow() noexcept
+        {
+            for (size_t i = 0; i < Count; i++) {
+                Nodes[i]->Latch.unlock();
+            }
+            UnlockRoot();
+        }
+
+        /// <summary>
+        /// Check whether the root pointer is still latched, i.e. no other update has entered the tree yet.
+        /// </summary>
+        [[nodiscard]] bool HoldsRoot() const { return RootLatch; }
+
+        void UnlockRoot()
+        {
+            if (RootLatch) {
+                std::exchange(RootLatch, nullptr)->unlock();
+            }
+        }
+
+        [[nodiscard]] bool Holds(const Node* node) const { return std::find(Nodes.begin(), Nodes.begin() + Count, node) != Nodes.begin() + Count; }
+
+        // Latch of the root pointer, nullptr once released.
+        LatchType* RootLatch;
+        std::array<Node*, kMaxWindow> Nodes{};
+        size_t Count = 0;
+    };
+
+public:
+    ConcurrentRedBlackTree() = default;
+
+    explicit ConcurrentRedBlackTree(const Allocator& allocator) : tree_(allocator) {}
+
+    explicit ConcurrentRedBlackTree(const KeyComparator& key_comparator, const Allocator& allocator = Allocator()) : tree_(key_comparator, allocator) {}
+
+    ConcurrentRedBlackTree(const ConcurrentRedBlackTree&) = delete;
+
+    auto operator=(const ConcurrentRedBlackTree&) -> ConcurrentRedBlackTree& = delete;
+
+    ~ConcurrentRedBlackTree() noexcept
+    {
+        if constexpr (kOptimistic) {
+            for (const RetiredNode& retired : reclamation_.Retired) {
+                tree_.DestroyNode(retired.Pointer);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Insert a key-value pair, unless the key is present.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <returns>True for the pair is inserted.</returns>
+    bool Insert(const KeyType& key, const ValueType& value);
+
+    /// <summary>
+    /// Insert a key-value pair, or assign the value if the key is present.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <returns>True for the pair is inserted, false for the value is assigned.</returns>
+    bool InsertOrAssign(const KeyType& key, const ValueType& value);
+
+    /// <summary>
+    /// Erase a key-value pair.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>True for erase successfully.</returns>
+    bool Erase(const KeyType& key);
+
+    /// <summary>
+    /// Get a copy of the value of a key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The optional value.</returns>
+    std::optional<ValueType> GetValue(const KeyType& key) const
+    {
+        std::optional<ValueType> result;
+        Visit(key, [&](const KeyType&, const ValueType& value) { result.emplace(value); });
+        return result;
+    }
+
+    bool Contains(const KeyType& key) const { return Visit(key, [](const KeyType&, const ValueType&) {}); }
+
+    /// <summary>
+    /// Call the visitor with (key, value) of the element with the given key, while the element is locked for reading.
+    /// In the optimistic mode the visitor gets copies instead, taken while no update changed the element.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="visitor">The visitor.</param>
+    /// <returns>True for the key is found.</returns>
+    template <typename Visitor>
+        requires std::invocable<Visitor&, const KeyType&, const ValueType&>
+    bool Visit(const KeyType& key, Visitor&& visitor) const;
+
+    /// <summary>
+    /// Get the number of elements, which may be outdated as soon as it is returned.
+    /// </summary>
+    [[nodiscard]] auto Size() const -> size_t
+    {
+        if constexpr (kLockCoupling) {
+            return AtomicSize().load(std::memory_order_relaxed);
+        } else {
+            std::shared_lock lock(mutex_);
+            return tree_.Size();
+        }
+    }
+
+    [[nodiscard]] bool IsEmpty() const { return Size() == 0; }
+
+    /// <summary>
+    /// Erase all elements. Updates running concurrently may or may not take effect.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Check the red-black tree rules, see RedBlackTree::RedBlackTreeRulesCheck.
+    /// Not thread-safe, call it while no other thread uses the tree.
+    /// </summary>
+    /// <returns>True for check success.</returns>
+    bool RedBlackTreeRulesCheck() { return tree_.RedBlackTreeRulesCheck(); }
+
+private:
+    // The whole tree in the shared mutex mode, the root pointer in the other modes.
+    mutable std::conditional_t<kLockCoupling, LatchType, std::shared_mutex> mutex_;
+    [[no_unique_address]] std::conditional_t<kLockCoupling && !kThreadSafeAllocator, std::mutex, NoMutex> allocator_mutex_;
+    [[no_unique_address]] mutable std::conditional_t<kOptimistic, Reclamation, NoReclamation> reclamation_;
+    TreeType tree_;
+
+    /// <summary>
+    /// One attempt of an optimistic lookup, the caller has pinned the epoch.
+    /// Every node is validated after its child is read, so the lookup never follows a link that was being changed.
+    /// </summary>
+    /// <returns>Whether the key is found, or nullopt if an update got in the way and the lookup must start over.</returns>
+    template <typename Visitor> auto TryVisit(const KeyType& key, Visitor& visitor) const -> std::optional<bool>;
+
+    /// <summary>
+    /// Insert with lock coupling, the same top-down pass as RedBlackTree::InsertNode.
+    /// </summary>
+    template <bool Assign> bool InsertCoupled(const KeyType& key, const ValueType& value);
+
+    /// <summary>
+    /// Erase with lock coupling, the same top-down pass as RedBlackTree::Erase.
+    /// The entry of a node with two children is replaced by its predecessor only once the predecessor is unlinked,
+    /// so that the path down to it needs no second search.
+    /// </summary>
+    bool EraseCoupled(const KeyType& key);
+
+    /// <summary>
+    /// Destroy a detached subtree. The caller holds the latch of the root, every node is latched before it is freed,
+    /// so updates still working inside the subtree finish first.
+    /// </summary>
+    /// <returns>The number of destroyed nodes.</returns>
+    auto DestroyCoupled(Node* node) -> size_t;
+
+    /// <summary>
+    /// Free an unlinked node. In the optimistic mode the node is retired instead, and freed once every lookup
+    /// that may still read it has finished.
+    /// </summary>
+    void Dispose(Node* node);
+
+    /// <summary>
+    /// Latch a node exclusively unless the window holds it already.
+    /// The parent of the node must be held, so that latches are always taken top-down.
+    /// </summary>
+    /// <param name="window">The window.</param>
+    /// <param name="node">The node or nullptr.</param>
+    /// <returns>The node.</returns>
+    auto Latch(WriteWindow& window, Node* node) -> Node*;
+
+    /// <summary>
+    /// Release the latches of all nodes but the given ones.
+    /// While the root pointer is held, a released root is recolored black, which Erase otherwise does at the end.
+    /// </summary>
+    /// <param name="window">The window.</param>
+    /// <param name="keep">The nodes to keep, nullptr is ignored.</param>
+    void Retain(WriteWindow& window, std::initializer_list<Node*> keep);
+
+    /// <summary>
+    /// Copy a key or value that an update may assign meanwhile, see StoreEntry.
+    /// Keys and values that fit an atomic are loaded at once, others byte by byte, the copy is validated afterwards.
+    /// </summary>
+    /// <param name="source">The key or value in a node.</param>
+    /// <returns>The copy.</returns>
+    template <typename T> static auto LoadEntry(const T& source) -> T
+    {
+        if constexpr (kAtomicEntry<T>) {
+            return std::atomic_ref<T>(const_cast<T&>(source)).load(std::memory_order_relaxed); // NOLINT
+        } else {
+            std::array<unsigned char, sizeof(T)> bytes;
+            auto* source_bytes = reinterpret_cast<unsigned char*>(const_cast<T*>(&source)); // NOLINT
+            for (size_t i = 0; i < sizeof(T); i++) {
+                bytes[i] = std::atomic_ref<unsigned char>(source_bytes[i]).load(std::memory_order_relaxed);
+            }
+            return std::bit_cast<T>(bytes);
+        }
+    }
+
+    /// <summary>
+    /// Assign a key or value of a latched node, which optimistic lookups may be copying meanwhile.
+    /// </summary>
+    /// <param name="target">The key or value in the node.</param>
+    /// <param name="value">The new key or value.</param>
+    template <typename T> static void StoreEntry(T& target, std::type_identity_t<T> value)
+    {
+        if constexpr (!kOptimistic) {
+            target = std::move(value);
+        } else if constexpr (kAtomicEntry<T>) {
+            std::atomic_ref<T>(target).store(value, std::memory_order_relaxed);
+        } else {
+            const auto bytes = std::bit_cast<std::array<unsigned char, sizeof(T)>>(value);
+            auto* target_bytes = reinterpret_cast<unsigned char*>(&target); // NOLINT
+            for (size_t i = 0; i < sizeof(T); i++) {
+                std::atomic_ref<unsigned char>(target_bytes[i]).store(bytes[i], std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template <typename T>
+    static constexpr bool kAtomicEntry = std::atomic_ref<T>::is_always_lock_free && alignof(T) >= std::atomic_ref<T>::required_alignment;
+
+    /// <summary>
+    /// Get the element count of the tree, which updates change concurrently in the lock coupling mode.
+    /// </summary>
+    auto AtomicSize() const -> std::atomic_ref<size_t> { return std::atomic_ref<size_t>(const_cast<size_t&>(tree_.size_)); } // NOLINT
+};
+
+/**
+ * ConcurrentRedBlackTree with lock coupling.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>>
+using LockCouplingRedBlackTree = ConcurrentRedBlackTree<KeyType, ValueType, LockMode::LockCoupling, KeyComparator>;
+
+/**
+ * ConcurrentRedBlackTree with latch-free lookups.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>>
+using OptimisticRedBlackTree = ConcurrentRedBlackTree<KeyType, ValueType, LockMode::Optimistic, KeyComparator>;
+
+} // namespace rbt
+
+#include "concurrent_red_black_tree.inl"
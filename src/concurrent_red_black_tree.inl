@@ -0,0 +1,432 @@
+#pragma once
+
+namespace rbt
+{
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+bool CONCURRENT_RED_BLACK_TREE_TYPE::Insert(const KeyType& key, const ValueType& value)
+{
+    if constexpr (kLockCoupling) {
+        return InsertCoupled<false>(key, value);
+    } else {
+        std::unique_lock lock(mutex_);
+        return tree_.Insert(key, value);
+    }
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+bool CONCURRENT_RED_BLACK_TREE_TYPE::InsertOrAssign(const KeyType& key, const ValueType& value)
+{
+    if constexpr (kLockCoupling) {
+        return InsertCoupled<true>(key, value);
+    } else {
+        std::unique_lock lock(mutex_);
+        return tree_.InsertOrAssign(key, value);
+    }
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+bool CONCURRENT_RED_BLACK_TREE_TYPE::Erase(const KeyType& key)
+{
+    if constexpr (kLockCoupling) {
+        return EraseCoupled(key);
+    } else {
+        std::unique_lock lock(mutex_);
+        return tree_.Erase(key);
+    }
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+template <typename Visitor>
+    requires std::invocable<Visitor&, const KeyType&, const ValueType&>
+bool CONCURRENT_RED_BLACK_TREE_TYPE::Visit(const KeyType& key, Visitor&& visitor) const
+{
+    if constexpr (!kLockCoupling) {
+        std::shared_lock lock(mutex_);
+        return tree_.Visit(key, visitor);
+    } else if constexpr (kOptimistic) {
+        // Nodes unlinked from here on stay allocated until the guard is gone.
+        const EpochDomain::Guard guard = reclamation_.Epochs.Pin();
+        for (size_t spin = 0;; spin++) {
+            if (const std::optional<bool> found = TryVisit(key, visitor)) {
+                return *found;
+            }
+            SpinPause(spin);
+        }
+    } else {
+        std::shared_lock root_lock(mutex_);
+        Node* node = tree_.root_;
+        if (!node) {
+            return false;
+        }
+        std::shared_lock lock(node->Latch);
+        root_lock.unlock();
+
+        // Hand over hand: the child is latched before the parent is released.
+        while (true) {
+            const std::weak_ordering order = tree_.Compare(key, node->Key);
+            if (order == 0) {
+                visitor(std::as_const(node->Key), std::as_const(node->Value));
+                return true;
+            }
+            node = order < 0 ? tree_.Left(node) : tree_.Right(node);
+            if (!node) {
+                return false;
+            }
+            lock = std::shared_lock(node->Latch);
+        }
+    }
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+template <typename Visitor>
+auto CONCURRENT_RED_BLACK_TREE_TYPE::TryVisit(const KeyType& key, Visitor& visitor) const -> std::optional<bool>
+{
+    // Keys, values and links are read while updates may write them, through relaxed atomics, and validated before use.
+    const std::uint64_t moves = reclamation_.Moves.load(std::memory_order_acquire);
+    const std::uint64_t root_version = mutex_.ReadVersion();
+    Node* node = TreeType::LoadLink(tree_.root_);
+    if (!mutex_.Validate(root_version)) {
+        return std::nullopt;
+    }
+    if (!node) {
+        return false;
+    }
+    std::uint64_t version = node->Latch.ReadVersion();
+    if (!mutex_.Validate(root_version)) {
+        return std::nullopt;
+    }
+
+    while (true) {
+        const KeyType node_key = LoadEntry(node->Key);
+        const std::weak_ordering order = tree_.Compare(key, node_key);
+        if (order == 0) {
+            const ValueType value = LoadEntry(node->Value);
+            if (!node->Latch.Validate(version)) {
+                return std::nullopt;
+            }
+            visitor(node_key, value);
+            return true;
+        }
+
+        Node* child_node = order < 0 ? tree_.Left(node) : tree_.Right(node);
+        if (!node->Latch.Validate(version)) {
+            return std::nullopt;
+        }
+        if (!child_node) {
+            // Erase moves the predecessor of an erased entry up, possibly past this lookup, which then misses it.
+            if (reclamation_.Moves.load(std::memory_order_relaxed) != moves) {
+                return std::nullopt;
+            }
+            return false;
+        }
+
+        // The child is read only once its parent is known to be consistent, and still its parent afterwards.
+        const std::uint64_t child_version = child_node->Latch.ReadVersion();
+        if (!node->Latch.Validate(version)) {
+            return std::nullopt;
+        }
+        node = child_node;
+        version = child_version;
+    }
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+void CONCURRENT_RED_BLACK_TREE_TYPE::Clear()
+{
+    if constexpr (!kLockCoupling) {
+        std::unique_lock lock(mutex_);
+        tree_.Clear();
+    } else {
+        // Detach the nodes under the root latch, new operations see an empty tree from here on.
+        Node* root = nullptr;
+        {
+            std::unique_lock root_lock(mutex_);
+            root = tree_.root_;
+            TreeType::StoreLink(tree_.root_, nullptr);
+            if (!root) {
+                return;
+            }
+            root->Latch.lock();
+        }
+        AtomicSize().fetch_sub(DestroyCoupled(root), std::memory_order_relaxed);
+    }
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+template <bool Assign>
+bool CONCURRENT_RED_BLACK_TREE_TYPE::InsertCoupled(const KeyType& key, const ValueType& value)
+{
+    WriteWindow window(mutex_);
+    Node* node = Latch(window, tree_.root_);
+    Node* parent_node = nullptr;
+    Node* grand_parent_node = nullptr;
+    Node* grand_grand_parent_node = nullptr;
+    bool is_left = false;
+    while (node) {
+        const std::weak_ordering order = tree_.Compare(key, node->Key);
+        if (order == 0) {
+            if constexpr (Assign) {
+                StoreEntry(node->Value, value);
+            }
+            return false;
+        }
+        is_left = order < 0;
+
+        // The children are latched before their colors are read, a reorient recolors them.
+        Node* left_node = Latch(window, tree_.Left(node));
+        Node* right_node = Latch(window, tree_.Right(node));
+        if (left_node && right_node && TreeType::GetColor(left_node) == ColorType::Red && TreeType::GetColor(right_node) == ColorType::Red) {
+            TreeType::Count(Counter::Reorients);
+            tree_.HandleReorient(grand_grand_parent_node, grand_parent_node, parent_node, node);
+        }
+
+        grand_grand_parent_node = grand_parent_node;
+        grand_parent_node = parent_node;
+        parent_node = node;
+        node = is_left ? tree_.Left(node) : tree_.Right(node);
+
+        // A rotation reconnects to the grand grand parent, or to the root pointer while there is none.
+        Retain(window, {grand_grand_parent_node, grand_parent_node, parent_node, node});
+        if (grand_grand_parent_node) {
+            window.UnlockRoot();
+        }
+    }
+
+    // The new node is reachable only through latched nodes until the window is released.
+    {
+        std::lock_guard lock(allocator_mutex_);
+        node = tree_.CreateNode(key, value);
+    }
+    AtomicSize().fetch_add(1, std::memory_order_relaxed);
+    if (!parent_node) {
+        TreeType::SetColor(node, ColorType::Black);
+        TreeType::StoreLink(tree_.root_, node);
+        return true;
+    }
+
+    is_left ? tree_.SetLeft(parent_node, node) : tree_.SetRight(parent_node, node);
+    tree_.HandleReorient(grand_grand_parent_node, grand_parent_node, parent_node, node);
+    return true;
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+bool CONCURRENT_RED_BLACK_TREE_TYPE::EraseCoupled(const KeyType& key)
+{
+    const auto is_red_node = [](Node* n) { return n && TreeType::GetColor(n) == ColorType::Red; };
+
+    const auto get_sibling_node = [this](Node* parent_node, Node* node) {
+        return parent_node ? (tree_.Left(parent_node) == node ? tree_.Right(parent_node) : tree_.Left(parent_node)) : nullptr;
+    };
+
+    WriteWindow window(mutex_);
+    Node* node = Latch(window, tree_.root_);
+    if (!node) {
+        return false;
+    }
+    if (tree_.IsBlackNode(Latch(window, tree_.Left(node))) && tree_.IsBlackNode(Latch(window, tree_.Right(node)))) {
+        TreeType::SetColor(node, ColorType::Red);
+    }
+
+    Node* parent_node = nullptr;
+    Node* grand_parent_node = nullptr;
+    // Node with two children whose entry is replaced by its predecessor, which is erased instead.
+    Node* replaced_node = nullptr;
+
+    while (node) {
+        Latch(window, tree_.Left(node));
+        Latch(window, tree_.Right(node));
+
+        /*
+         * Recolor current node to red first, see RedBlackTree::Erase.
+         */
+        if (TreeType::GetColor(node) == ColorType::Black) {
+            Node* sibling_node = Latch(window, get_sibling_node(parent_node, node));
+            if (sibling_node) {
+                Latch(window, tree_.Left(sibling_node));
+                Latch(window, tree_.Right(sibling_node));
+            }
+
+            if (tree_.IsBlackNode(parent_node) && is_red_node(sibling_node)) {
+                tree_.HandleRotation(parent_node, sibling_node);
+                tree_.HandleReconnection(grand_parent_node, sibling_node);
+                TreeType::SetColor(parent_node, ColorType::Red);
+                TreeType::SetColor(sibling_node, ColorType::Black);
+
+                // The new sibling was a child of the old one.
+                grand_parent_node = sibling_node;
+                sibling_node = get_sibling_node(parent_node, node);
+                if (sibling_node) {
+                    Latch(window, tree_.Left(sibling_node));
+                    Latch(window, tree_.Right(sibling_node));
+                }
+            }
+
+            if (tree_.IsBlackNode(tree_.Left(node)) && tree_.IsBlackNode(tree_.Right(node))) {
+                if (sibling_node && (is_red_node(tree_.Left(sibling_node)) || is_red_node(tree_.Right(sibling_node)))) {
+                    Node* sibling_node_red_child = tree_.IsBlackNode(tree_.Left(sibling_node)) ? tree_.Right(sibling_node) : tree_.Left(sibling_node);
+                    bool is_unique_rotate = true;
+
+                    // First rotation.
+                    if (!tree_.Less(parent_node->Key, node->Key) == !tree_.Less(sibling_node->Key, sibling_node_red_child->Key)) {
+                        tree_.HandleRotation(sibling_node, sibling_node_red_child);
+                        tree_.HandleReconnection(parent_node, sibling_node_red_child); // NOLINT
+                        is_unique_rotate = false;
+                    }
+
+                    // Second rotation.
+                    is_unique_rotate ? tree_.HandleRotation(parent_node, sibling_node) : tree_.HandleRotation(parent_node, sibling_node_red_child);
+                    is_unique_rotate ? tree_.HandleReconnection(grand_parent_node, sibling_node)
+                                     : tree_.HandleReconnection(grand_parent_node, sibling_node_red_child);
+
+                    // Recolor.
+                    TreeType::SetColor(node, ColorType::Red);
+                    TreeType::SetColor(parent_node, ColorType::Black);
+                    if (is_unique_rotate) {
+                        TreeType::SetColor(sibling_node, ColorType::Red);
+                        TreeType::SetColor(sibling_node_red_child, ColorType::Black);
+                    }
+                } else {
+                    TreeType::SetColor(parent_node, ColorType::Black);
+                    TreeType::SetColor(node, ColorType::Red);
+                    if (sibling_node) {
+                        TreeType::SetColor(sibling_node, ColorType::Red);
+                    }
+                }
+            }
+        }
+
+        /*
+         * Handle delete, node is red. Below a replaced node the predecessor is the rightmost node.
+         */
+        const std::weak_ordering order =
+            replaced_node ? (tree_.Right(node) ? std::weak_ordering::greater : std::weak_ordering::equivalent) : tree_.Compare(key, node->Key);
+        if (order == 0) {
+            if (tree_.Left(node) && tree_.Right(node)) {
+                replaced_node = node;
+                grand_parent_node = parent_node;
+                parent_node = node;
+                node = tree_.Left(node);
+                Retain(window, {grand_parent_node, parent_node, node, replaced_node});
+                continue;
+            }
+
+            Node* child_node = tree_.Left(node) ? tree_.Left(node) : tree_.Right(node);
+            if constexpr (kOptimistic) {
+                // Published by the unlatching of the parent, before any lookup can see the predecessor gone.
+                if (replaced_node) {
+                    reclamation_.Moves.fetch_add(1, std::memory_order_release);
+                }
+            }
+            if (child_node) {
+                TreeType::SetColor(child_node, ColorType::Black);
+            }
+            if (!parent_node) [[unlikely]] {
+                TreeType::StoreLink(tree_.root_, child_node);
+            } else if (!tree_.Less(parent_node->Key, node->Key)) {
+                tree_.SetLeft(parent_node, child_node);
+            } else {
+                tree_.SetRight(parent_node, child_node);
+            }
+            if (replaced_node) {
+                StoreEntry(replaced_node->Key, std::move(node->Key));
+                StoreEntry(replaced_node->Value, std::move(node->Value));
+            }
+            AtomicSize().fetch_sub(1, std::memory_order_relaxed);
+
+            // The node is unlinked and its parent latched, so nobody else can be waiting for it.
+            Retain(window, {grand_parent_node, parent_node, child_node, replaced_node});
+            Dispose(node);
+            Retain(window, {});
+            return true;
+        }
+
+        grand_parent_node = parent_node;
+        parent_node = node;
+        node = order < 0 ? tree_.Left(node) : tree_.Right(node);
+        Retain(window, {grand_parent_node, parent_node, node, replaced_node});
+
+        // Until the root is released and black, later updates must not enter.
+        if (grand_parent_node && window.HoldsRoot() && !window.Holds(tree_.root_)) {
+            window.UnlockRoot();
+        }
+    }
+
+    Retain(window, {});
+    return false;
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+auto CONCURRENT_RED_BLACK_TREE_TYPE::DestroyCoupled(Node* node) -> size_t
+{
+    Node* left_node = tree_.Left(node);
+    Node* right_node = tree_.Right(node);
+    if (left_node) {
+        left_node->Latch.lock();
+    }
+    if (right_node) {
+        right_node->Latch.lock();
+    }
+    node->Latch.unlock();
+    Dispose(node);
+    return 1 + (left_node ? DestroyCoupled(left_node) : 0) + (right_node ? DestroyCoupled(right_node) : 0);
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+void CONCURRENT_RED_BLACK_TREE_TYPE::Dispose(Node* node)
+{
+    if constexpr (!kOptimistic) {
+        std::lock_guard lock(allocator_mutex_);
+        tree_.DestroyNode(node);
+    } else {
+        std::vector<RetiredNode> reclaimable;
+        {
+            std::lock_guard lock(reclamation_.Mutex);
+            std::vector<RetiredNode>& retired = reclamation_.Retired;
+            retired.push_back({reclamation_.Epochs.Current(), node});
+            if (retired.size() < kRetireBatch) {
+                return;
+            }
+            const std::uint64_t oldest = reclamation_.Epochs.Advance();
+            // Nodes retired before the oldest pinned epoch are unreachable for every reader, partition moves them to the back.
+            const auto reclaimable_range = std::ranges::partition(retired, [oldest](const RetiredNode& r) { return r.Epoch >= oldest; });
+            reclaimable.assign(reclaimable_range.begin(), reclaimable_range.end());
+            retired.erase(reclaimable_range.begin(), reclaimable_range.end());
+        }
+        std::lock_guard lock(allocator_mutex_);
+        for (const RetiredNode& r : reclaimable) {
+            tree_.DestroyNode(r.Pointer);
+        }
+    }
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+auto CONCURRENT_RED_BLACK_TREE_TYPE::Latch(WriteWindow& window, Node* node) -> Node*
+{
+    if (node && !window.Holds(node)) {
+        assert(window.Count < kMaxWindow);
+        node->Latch.lock();
+        window.Nodes[window.Count++] = node;
+    }
+    return node;
+}
+
+CONCURRENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+void CONCURRENT_RED_BLACK_TREE_TYPE::Retain(WriteWindow& window, const std::initializer_list<Node*> keep)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < window.Count; i++) {
+        Node* node = window.Nodes[i];
+        if (std::ranges::find(keep, node) != keep.end()) {
+            window.Nodes[kept++] = node;
+            continue;
+        }
+        if (window.HoldsRoot() && node == tree_.root_) {
+            TreeType::SetColor(node, ColorType::Black);
+        }
+        node->Latch.unlock();
+    }
+    window.Count = kept;
+}
+
+} // namespace rbt
@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+ * Diagnostics of the rules checks. They go through spdlog if RBT_USE_SPDLOG is defined and to stderr otherwise,
+ * so the trees themselves do not depend on spdlog.
+ */
+
+#include <string_view>
+
+#ifdef RBT_USE_SPDLOG
+#include <spdlog/spdlog.h>
+#else
+#include <cstdio>
+#endif
+
+namespace rbt
+{
+
+/// <summary>
+/// Report a broken invariant found by a rules check.
+/// </summary>
+/// <param name="message">The description of the violation.</param>
+inline void ReportViolation(const std::string_view message)
+{
+#ifdef RBT_USE_SPDLOG
+    spdlog::error("{}", message);
+#else
+    std::fprintf(stderr, "%.*s\n", static_cast<int>(message.size()), message.data());
+#endif
+}
+
+} // namespace rbt
@@ -0,0 +1,206 @@
+#pragma once
+
+/**
+ * RedBlackTree kept in a directory, see DurableRedBlackTree.
+ * Definitions live in durable_red_black_tree.inl, which is included at the end of this file.
+ */
+
+#include <array>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <utility>
+
+#include "mapped_red_black_tree.h"
+#include "red_black_tree.h"
+#include "tree_policy.h"
+#include "write_ahead_log.h"
+
+namespace rbt
+{
+
+#define DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT template <typename KeyType, typename ValueType, class KeyComparator, class Allocator, class Policy>
+#define DURABLE_RED_BLACK_TREE_TYPE DurableRedBlackTree<KeyType, ValueType, KeyComparator, Allocator, Policy>
+#define DURABLE_RED_BLACK_TREE_REQUIRES requires IsSnapshotEntry<KeyType, ValueType> && IsComparator<KeyType, KeyComparator>
+
+/**
+ * Thread-safe RedBlackTree whose updates survive a crash once they return.
+ * The directory holds a snapshot, see SaveSnapshot, and a WriteAheadLog of the updates made since. Every update is
+ * applied in memory under an exclusive lock, appended to the log as "put key value" or "delete key", and committed
+ * after the lock is released, so concurrent updates share their syncs. Opening the directory loads the snapshot and
+ * replays the log on top of it. Log records are idempotent, so a crash between writing a snapshot and cutting the
+ * log replays records the snapshot already contains, without harm.
+ * Once the log outgrows the checkpoint size, the update that crossed it writes a new snapshot and empties the log.
+ * Checkpoints hold the lock shared, so reads go on while the snapshot is written and only updates wait.
+ * Reads are uncommitted: an update is visible to other threads once it is applied, before its commit returns. A crash
+ * before the sync loses an update that readers may have seen. An update whose commit throws is undone in memory, and
+ * once the log failed, every update throws before changing the tree, until a checkpoint succeeds.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>,
+          class Allocator = std::allocator<std::pair<const KeyType, ValueType>>, class Policy = DefaultTreePolicy>
+DURABLE_RED_BLACK_TREE_REQUIRES class DurableRedBlackTree
+{
+public:
+    using TreeType = RedBlackTree<KeyType, ValueType, KeyComparator, Allocator, Policy>;
+
+    static constexpr size_t kDefaultCheckpointBytes = size_t{64} << 20;
+
+    /// <summary>
+    /// Open the tree kept in a directory, which is created if it is missing.
+    /// </summary>
+    /// <param name="directory">The directory.</param>
+    /// <param name="checkpoint_bytes">The log size that triggers a checkpoint.</param>
+    /// <param name="key_comparator">The key comparator.</param>
+    /// <param name="allocator">The allocator.</param>
+    explicit DurableRedBlackTree(const std::filesystem::path& directory, size_t checkpoint_bytes = kDefaultCheckpointBytes,
+                                 const KeyComparator& key_comparator = KeyComparator(), const Allocator& allocator = Allocator());
+
+    DurableRedBlackTree(const DurableRedBlackTree&) = delete;
+
+    auto operator=(const DurableRedBlackTree&) -> DurableRedBlackTree& = delete;
+
+    /// <summary>
+    /// Insert a key-value pair durably, unless the key is present.
+    /// Readers see the pair before it is durable, it is erased again if the commit throws.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <returns>True for the pair is inserted.</returns>
+    bool Insert(const KeyType& key, const ValueType& value);
+
+    /// <summary>
+    /// Insert a key-value pair durably, or assign the value if the key is present.
+    /// Readers see the value before it is durable, the old state is restored if the commit throws.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <returns>True for the pair is inserted, false for the value is assigned.</returns>
+    bool InsertOrAssign(const KeyType& key, const ValueType& value);
+
+    /// <summary>
+    /// Erase a key-value pair durably.
+    /// Readers miss the pair before the erase is durable, it is inserted again if the commit throws.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>True for erase successfully.</returns>
+    bool Erase(const KeyType& key);
+
+    /// <summary>
+    /// Get a copy of the value of a key. Updates are visible before they are durable.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The optional value.</returns>
+    std::optional<ValueType> GetValue(const KeyType& key) const
+    {
+        std::shared_lock lock(mutex_);
+        return tree_.GetValue(key);
+    }
+
+    bool Contains(const KeyType& key) const
+    {
+        std::shared_lock lock(mutex_);
+        return tree_.Contains(key);
+    }
+
+    [[nodiscard]] auto Size() const -> size_t
+    {
+        std::shared_lock lock(mutex_);
+        return tree_.Size();
+    }
+
+    [[nodiscard]] bool IsEmpty() const { return Size() == 0; }
+
+    /// <summary>
+    /// Call the reader with the tree while no update runs, for iteration and range queries.
+    /// </summary>
+    /// <param name="reader">The reader.</param>
+    /// <returns>What the reader returns.</returns>
+    template <typename Reader>
+        requires std::invocable<Reader&, const TreeType&>
+    decltype(auto) Read(Reader&& reader) const
+    {
+        std::shared_lock lock(mutex_);
+        return std::invoke(reader, tree_);
+    }
+
+    /// <summary>
+    /// Write a snapshot of the tree and empty the log.
+    /// </summary>
+    void Checkpoint() { CheckpointAbove(0); }
+
+    /// <summary>
+    /// Get the size of the log.
+    /// </summary>
+    [[nodiscard]] auto LogBytes() const -> size_t { return log_.Bytes(); }
+
+    /// <summary>
+    /// Get the number of log syncs since the tree was opened, at most one per update.
+    /// </summary>
+    [[nodiscard]] auto SyncCount() const -> size_t { return log_.SyncCount(); }
+
+private:
+    enum class LogOperation : std::uint8_t
+    {
+        Put = 1,
+        Delete = 2,
+    };
+
+    static constexpr size_t kDeleteRecordSize = 1 + sizeof(KeyType);
+    static constexpr size_t kPutRecordSize = kDeleteRecordSize + sizeof(ValueType);
+
+    using LogRecord = std::array<std::byte, kPutRecordSize>;
+
+    std::filesystem::path directory_;
+    size_t checkpoint_bytes_;
+    mutable std::shared_mutex mutex_;
+    // Serializes checkpoints, which hold mutex_ shared only.
+    std::mutex checkpoint_mutex_;
+    // Signals an update rolled back or made durable by a checkpoint, for the older failed updates waiting their turn.
+    std::condition_variable_any rolled_back_;
+    TreeType tree_;
+    WriteAheadLog log_;
+    // The sequence number of the newest update logged and not rolled back.
+    std::uint64_t last_lsn_ = 0;
+
+    [[nodiscard]] auto SnapshotPath() const -> std::filesystem::path { return directory_ / "snapshot"; }
+
+    /// <summary>
+    /// Create the directory if it is missing, durably.
+    /// </summary>
+    static auto CreateDirectory(const std::filesystem::path& directory) -> std::filesystem::path;
+
+    static auto Encode(LogOperation operation, const KeyType& key, const ValueType* value) -> LogRecord;
+
+    /// <summary>
+    /// Replay one log record on the tree.
+    /// </summary>
+    void Apply(std::span<const std::byte> record);
+
+    /// <summary>
+    /// Append an update already applied to the tree, the caller holds the exclusive lock.
+    /// </summary>
+    auto Log(LogOperation operation, const KeyType& key, const ValueType* value) -> std::uint64_t;
+
+    /// <summary>
+    /// Wait for a logged update to be durable, then checkpoint if the log is full.
+    /// If the commit fails, roll the update back in memory with undo, after every newer update, and rethrow.
+    /// </summary>
+    template <typename Undo> void Commit(std::uint64_t lsn, std::uint64_t previous_lsn, Undo&& undo);
+
+    /// <summary>
+    /// Checkpoint, unless an update checkpointed meanwhile and the log is smaller than the given size.
+    /// </summary>
+    void CheckpointAbove(size_t log_bytes);
+};
+
+} // namespace rbt
+
+#include "durable_red_black_tree.inl"
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace rbt
+{
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+DURABLE_RED_BLACK_TREE_TYPE::DurableRedBlackTree(const std::filesystem::path& directory, const size_t checkpoint_bytes, const KeyComparator& key_comparator,
+                                                 const Allocator& allocator)
+    : directory_(CreateDirectory(directory)), checkpoint_bytes_(checkpoint_bytes), tree_(key_comparator, allocator),
+      log_(directory_ / "log")
+{
+    if (std::filesystem::exists(SnapshotPath())) {
+        LoadSnapshot(SnapshotPath(), tree_);
+    }
+    log_.Replay([this](const std::span<const std::byte> record) { Apply(record); });
+}
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+auto DURABLE_RED_BLACK_TREE_TYPE::CreateDirectory(const std::filesystem::path& directory) -> std::filesystem::path
+{
+    // The log syncs the directory itself, the entry of every directory created lives in its parent.
+    std::filesystem::path path = std::filesystem::absolute(directory).lexically_normal();
+    if (!path.has_filename()) {
+        path = path.parent_path();
+    }
+    std::vector<std::filesystem::path> created;
+    for (; !std::filesystem::exists(path); path = path.parent_path()) {
+        created.push_back(path);
+    }
+    std::filesystem::create_directories(directory);
+    for (const std::filesystem::path& created_path : created) {
+        SyncParentDirectory(created_path);
+    }
+    return directory;
+}
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+bool DURABLE_RED_BLACK_TREE_TYPE::Insert(const KeyType& key, const ValueType& value)
+{
+    std::uint64_t lsn = 0;
+    std::uint64_t previous_lsn = 0;
+    {
+        std::lock_guard lock(mutex_);
+        log_.ThrowIfFailed();
+        // A failed insert changes nothing and is not logged, even if the present key is not durable yet.
+        if (!tree_.Insert(key, value)) {
+            return false;
+        }
+        previous_lsn = last_lsn_;
+        lsn = Log(LogOperation::Put, key, &value);
+    }
+    Commit(lsn, previous_lsn, [&] { tree_.Erase(key); });
+    return true;
+}
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+bool DURABLE_RED_BLACK_TREE_TYPE::InsertOrAssign(const KeyType& key, const ValueType& value)
+{
+    std::uint64_t lsn = 0;
+    std::uint64_t previous_lsn = 0;
+    std::optional<ValueType> old_value;
+    {
+        std::lock_guard lock(mutex_);
+        log_.ThrowIfFailed();
+        old_value = tree_.GetValue(key);
+        tree_.InsertOrAssign(key, value);
+        previous_lsn = last_lsn_;
+        lsn = Log(LogOperation::Put, key, &value);
+    }
+    Commit(lsn, previous_lsn, [&] {
+        if (old_value) {
+            tree_.InsertOrAssign(key, *old_value);
+        } else {
+            tree_.Erase(key);
+        }
+    });
+    return !old_value;
+}
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+bool DURABLE_RED_BLACK_TREE_TYPE::Erase(const KeyType& key)
+{
+    std::uint64_t lsn = 0;
+    std::uint64_t previous_lsn = 0;
+    std::optional<ValueType> old_value;
+    {
+        std::lock_guard lock(mutex_);
+        log_.ThrowIfFailed();
+        old_value = tree_.GetValue(key);
+        if (!old_value) {
+            return false;
+        }
+        tree_.Erase(key);
+        previous_lsn = last_lsn_;
+        lsn = Log(LogOperation::Delete, key, nullptr);
+    }
+    Commit(lsn, previous_lsn, [&] { tree_.Insert(key, *old_value); });
+    return true;
+}
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+auto DURABLE_RED_BLACK_TREE_TYPE::Encode(const LogOperation operation, const KeyType& key, const ValueType* value) -> LogRecord
+{
+    LogRecord record{};
+    record[0] = static_cast<std::byte>(operation);
+    std::memcpy(record.data() + 1, &key, sizeof(KeyType));
+    if (value) {
+        std::memcpy(record.data() + kDeleteRecordSize, value, sizeof(ValueType));
+    }
+    return record;
+}
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+void DURABLE_RED_BLACK_TREE_TYPE::Apply(const std::span<const std::byte> record)
+{
+    KeyType key;
+    if (record.size() == kPutRecordSize && record[0] == static_cast<std::byte>(LogOperation::Put)) {
+        ValueType value;
+        std::memcpy(&key, record.data() + 1, sizeof(KeyType));
+        std::memcpy(&value, record.data() + kDeleteRecordSize, sizeof(ValueType));
+        tree_.InsertOrAssign(key, value);
+    } else if (record.size() == kDeleteRecordSize && record[0] == static_cast<std::byte>(LogOperation::Delete)) {
+        std::memcpy(&key, record.data() + 1, sizeof(KeyType));
+        tree_.Erase(key);
+    } else {
+        throw std::runtime_error("Log record of other key or value types: " + (directory_ / "log").string());
+    }
+}
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+auto DURABLE_RED_BLACK_TREE_TYPE::Log(const LogOperation operation, const KeyType& key, const ValueType* value) -> std::uint64_t
+{
+    const LogRecord record = Encode(operation, key, value);
+    last_lsn_ = log_.Append(std::span(record.data(), value ? kPutRecordSize : kDeleteRecordSize));
+    return last_lsn_;
+}
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+template <typename Undo>
+void DURABLE_RED_BLACK_TREE_TYPE::Commit(const std::uint64_t lsn, const std::uint64_t previous_lsn, Undo&& undo)
+{
+    try {
+        log_.Commit(lsn);
+    } catch (...) {
+        std::unique_lock lock(mutex_);
+        // Every update logged after this one failed too. Undoing them newest first restores the state each one found,
+        // even when they changed the same key. A checkpoint taken meanwhile made the update durable, then it stays.
+        rolled_back_.wait(lock, [&] { return last_lsn_ == lsn || log_.IsDurable(lsn); });
+        if (!log_.IsDurable(lsn)) {
+            std::invoke(undo);
+            last_lsn_ = previous_lsn;
+            rolled_back_.notify_all();
+            throw;
+        }
+    }
+    if (log_.Bytes() >= checkpoint_bytes_) {
+        CheckpointAbove(checkpoint_bytes_);
+    }
+}
+
+DURABLE_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+DURABLE_RED_BLACK_TREE_REQUIRES
+void DURABLE_RED_BLACK_TREE_TYPE::CheckpointAbove(const size_t log_bytes)
+{
+    std::lock_guard checkpoint_lock(checkpoint_mutex_);
+    // Updates append to the log under the exclusive lock, so none can slip in between the snapshot and the reset.
+    std::shared_lock lock(mutex_);
+    if (log_.Bytes() < log_bytes) {
+        return;
+    }
+    // The snapshot holds every update appended so far, durable or not, so the log may go as a whole.
+    SaveSnapshot(tree_, SnapshotPath());
+    log_.Reset();
+    // Updates waiting to roll back are durable now.
+    rolled_back_.notify_all();
+}
+
+} // namespace rbt
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include "shared_latch.h"
+
+namespace rbt
+{
+
+/**
+ * Epoch-based reclamation for readers that walk nodes without a latch.
+ * A reader pins the current epoch for the duration of a lookup. A writer tags every unlinked node with the epoch
+ * of its unlinking and frees it once every pinned reader has entered a later epoch, so no lookup that could still
+ * hold a pointer to the node is running. Readers of the same domain share a fixed table of slots.
+ */
+class EpochDomain
+{
+public:
+    static constexpr size_t kSlots = 128;
+
+    /**
+     * Pinned epoch of one reader, unpinned on destruction.
+     */
+    class Guard
+    {
+    public:
+        explicit Guard(std::atomic<std::uint64_t>& slot) : slot_(&slot) {}
+
+        Guard(Guard&& other) noexcept : slot_(std::exchange(other.slot_, nullptr)) {}
+
+        Guard(const Guard&) = delete;
+
+        auto operator=(const Guard&) -> Guard& = delete;
+
+        auto operator=(Guard&&) -> Guard& = delete;
+
+        ~Guard() noexcept
+        {
+            if (slot_) {
+                slot_->store(0, std::memory_order_release);
+            }
+        }
+
+    private:
+        std::atomic<std::uint64_t>* slot_;
+    };
+
+    EpochDomain() = default;
+
+    EpochDomain(const EpochDomain&) = delete;
+
+    auto operator=(const EpochDomain&) -> EpochDomain& = delete;
+
+    /// <summary>
+    /// Pin the current epoch in a free slot. The fence orders the pin before every read of the lookup, pairing with the fence in Advance.
+    /// While every slot is taken, back off and yield until a reader unpins.
+    /// </summary>
+    /// <returns>The guard.</returns>
+    [[nodiscard]] auto Pin() -> Guard
+    {
+        // Threads start at different slots, so they rarely collide.
+        static std::atomic<size_t> next_hint = 0;
+        thread_local const size_t hint = next_hint.fetch_add(1, std::memory_order_relaxed);
+
+        const std::uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+        for (size_t i = hint, spin = 0;; i++) {
+            std::atomic<std::uint64_t>& slot = slots_[i % kSlots].Epoch;
+            std::uint64_t idle = 0;
+            if (slot.load(std::memory_order_relaxed) == 0 && slot.compare_exchange_strong(idle, epoch, std::memory_order_seq_cst)) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return Guard(slot);
+            }
+            // Every slot is taken, back off so that the readers holding them can finish.
+            if ((i + 1 - hint) % kSlots == 0) {
+                SpinPause(spin++);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Get the epoch to tag a node with, after the node has been unlinked.
+    /// </summary>
+    [[nodiscard]] auto Current() const -> std::uint64_t { return epoch_.load(std::memory_order_seq_cst); }
+
+    /// <summary>
+    /// Start a new epoch and get the oldest epoch still pinned.
+    /// Nodes tagged with an older epoch than the returned one are unreachable by every reader.
+    /// </summary>
+    /// <returns>The oldest pinned epoch, or the max value if no reader is pinned.</returns>
+    auto Advance() -> std::uint64_t
+    {
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        // Either a reader pinned too late to be seen here sees every unlink before this point, or it is seen.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+        for (const Slot& slot : slots_) {
+            const std::uint64_t epoch = slot.Epoch.load(std::memory_order_seq_cst);
+            if (epoch) {
+                oldest = std::min(oldest, epoch);
+            }
+        }
+        return oldest;
+    }
+
+private:
+    struct alignas(64) Slot
+    {
+        // 0 for idle.
+        std::atomic<std::uint64_t> Epoch = 0;
+    };
+
+    alignas(64) std::atomic<std::uint64_t> epoch_ = 1;
+    std::array<Slot, kSlots> slots_{};
+};
+
+} // namespace rbt
@@ -0,0 +1,199 @@
+#pragma once
+
+/**
+ * Branch-free search in small sorted blocks of integer keys, e.g. the key block of a WideTree node.
+ * Every key is compared against the probe with SIMD and the matches are counted, so the result does not
+ * depend on a chain of predicted branches. The instruction set is picked once at runtime, builds that
+ * already target AVX2 skip the check.
+ */
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RBT_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace rbt
+{
+
+/**
+ * Integer key type the SIMD search supports.
+ */
+template <typename KeyType>
+concept IsSimdKey = std::integral<KeyType> && !std::same_as<KeyType, bool> && (sizeof(KeyType) == 4 || sizeof(KeyType) == 8);
+
+/**
+ * Instruction set of the key search.
+ */
+enum class SimdLevel
+{
+    Scalar,
+    Sse42,
+    Avx2
+};
+
+/// <summary>
+/// Get the best instruction set of this CPU, detected once.
+/// </summary>
+/// <returns>The instruction set.</returns>
+inline auto DetectSimdLevel() -> SimdLevel
+{
+#if defined(RBT_SIMD_X86)
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::Avx2;
+        }
+        if (__builtin_cpu_supports("sse4.2")) {
+            return SimdLevel::Sse42;
+        }
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+namespace simd
+{
+
+/// <summary>
+/// Count the keys less than (or greater than) the probe one by one, without branches.
+/// </summary>
+template <bool Greater, typename KeyType> auto CountScalar(const KeyType* keys, const size_t count, const KeyType key) -> size_t
+{
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        n += Greater ? key < keys[i] : keys[i] < key;
+    }
+    return n;
+}
+
+#if defined(RBT_SIMD_X86)
+
+/// <summary>
+/// Flip the sign bit of unsigned keys, so that the signed compare instructions order them correctly.
+/// </summary>
+template <typename KeyType> constexpr auto SignBias() -> long long
+{
+    if constexpr (std::is_unsigned_v<KeyType>) {
+        return sizeof(KeyType) == 4 ? static_cast<long long>(INT32_MIN) : static_cast<long long>(INT64_MIN);
+    } else {
+        return 0;
+    }
+}
+
+template <bool Greater, typename KeyType>
+__attribute__((target("avx2"))) auto CountAvx2(const KeyType* keys, const size_t count, const KeyType key) -> size_t
+{
+    constexpr size_t lanes = 32 / sizeof(KeyType);
+    const __m256i bias = sizeof(KeyType) == 4 ? _mm256_set1_epi32(static_cast<int>(SignBias<KeyType>())) : _mm256_set1_epi64x(SignBias<KeyType>());
+    const __m256i probe = _mm256_xor_si256(sizeof(KeyType) == 4 ? _mm256_set1_epi32(static_cast<int>(key)) : _mm256_set1_epi64x(static_cast<long long>(key)), bias);
+
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        const __m256i block = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias); // NOLINT
+        __m256i match;
+        if constexpr (sizeof(KeyType) == 4) {
+            match = Greater ? _mm256_cmpgt_epi32(block, probe) : _mm256_cmpgt_epi32(probe, block);
+        } else {
+            match = Greater ? _mm256_cmpgt_epi64(block, probe) : _mm256_cmpgt_epi64(probe, block);
+        }
+        // One mask bit per byte, so divide the bit count by the key width.
+        n += static_cast<size_t>(std::popcount(static_cast<std::uint32_t>(_mm256_movemask_epi8(match)))) / sizeof(KeyType);
+    }
+    return n + CountScalar<Greater>(keys + i, count - i, key);
+}
+
+template <bool Greater, typename KeyType>
+__attribute__((target("sse4.2"))) auto CountSse42(const KeyType* keys, const size_t count, const KeyType key) -> size_t
+{
+    constexpr size_t lanes = 16 / sizeof(KeyType);
+    const __m128i bias = sizeof(KeyType) == 4 ? _mm_set1_epi32(static_cast<int>(SignBias<KeyType>())) : _mm_set1_epi64x(SignBias<KeyType>());
+    const __m128i probe = _mm_xor_si128(sizeof(KeyType) == 4 ? _mm_set1_epi32(static_cast<int>(key)) : _mm_set1_epi64x(static_cast<long long>(key)), bias);
+
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        const __m128i block = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias); // NOLINT
+        __m128i match;
+        if constexpr (sizeof(KeyType) == 4) {
+            match = Greater ? _mm_cmpgt_epi32(block, probe) : _mm_cmpgt_epi32(probe, block);
+        } else {
+            match = Greater ? _mm_cmpgt_epi64(block, probe) : _mm_cmpgt_epi64(probe, block);
+        }
+        n += static_cast<size_t>(std::popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(match)))) / sizeof(KeyType);
+    }
+    return n + CountScalar<Greater>(keys + i, count - i, key);
+}
+
+#endif
+
+/// <summary>
+/// Count the keys less than (or greater than) the probe with the given instruction set, which the CPU must support.
+/// </summary>
+template <SimdLevel Level, bool Greater, typename KeyType> auto CountWith(const KeyType* keys, const size_t count, const KeyType key) -> size_t
+{
+#if defined(RBT_SIMD_X86)
+    if constexpr (Level == SimdLevel::Avx2) {
+        return CountAvx2<Greater>(keys, count, key);
+    } else if constexpr (Level == SimdLevel::Sse42) {
+        return CountSse42<Greater>(keys, count, key);
+    }
+#endif
+    return CountScalar<Greater>(keys, count, key);
+}
+
+/// <summary>
+/// Count the keys less than (or greater than) the probe with the best instruction set of this CPU.
+/// </summary>
+template <bool Greater, typename KeyType> auto Count(const KeyType* keys, const size_t count, const KeyType key) -> size_t
+{
+#if defined(__AVX2__)
+    return CountWith<SimdLevel::Avx2, Greater>(keys, count, key);
+#else
+    switch (DetectSimdLevel()) {
+    case SimdLevel::Avx2:
+        return CountWith<SimdLevel::Avx2, Greater>(keys, count, key);
+    case SimdLevel::Sse42:
+        return CountWith<SimdLevel::Sse42, Greater>(keys, count, key);
+    default:
+        return CountWith<SimdLevel::Scalar, Greater>(keys, count, key);
+    }
+#endif
+}
+
+} // namespace simd
+
+/// <summary>
+/// Get the lower bound of a key in a sorted block, i.e. the number of keys less than it.
+/// </summary>
+/// <param name="keys">The sorted keys.</param>
+/// <param name="count">The number of keys.</param>
+/// <param name="key">The probe key.</param>
+/// <returns>The slot of the first key not less than the probe.</returns>
+template <IsSimdKey KeyType> auto SimdLowerBound(const KeyType* keys, const size_t count, const KeyType key) -> size_t
+{
+    return simd::Count<false>(keys, count, key);
+}
+
+/// <summary>
+/// Get the upper bound of a key in a sorted block, i.e. the number of keys not greater than it.
+/// </summary>
+/// <param name="keys">The sorted keys.</param>
+/// <param name="count">The number of keys.</param>
+/// <param name="key">The probe key.</param>
+/// <returns>The slot of the first key greater than the probe.</returns>
+template <IsSimdKey KeyType> auto SimdUpperBound(const KeyType* keys, const size_t count, const KeyType key) -> size_t
+{
+    return count - simd::Count<true>(keys, count, key);
+}
+
+} // namespace rbt
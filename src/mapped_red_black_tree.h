@@ -0,0 +1,360 @@
+#pragma once
+
+/**
+ * Binary snapshots of key-ordered maps, and a read-only tree served straight from a memory-mapped snapshot.
+ * Definitions live in mapped_red_black_tree.inl, which is included at the end of this file.
+ */
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "red_black_tree.h"
+
+namespace rbt
+{
+
+#define MAPPED_RED_BLACK_TREE_TEMPLATE_ARGUMENT template <typename KeyType, typename ValueType, class KeyComparator>
+#define MAPPED_RED_BLACK_TREE_TYPE MappedRedBlackTree<KeyType, ValueType, KeyComparator>
+#define MAPPED_RED_BLACK_TREE_REQUIRES requires IsSnapshotEntry<KeyType, ValueType> && IsComparator<KeyType, KeyComparator>
+
+/**
+ * Keys and values a snapshot stores as raw bytes.
+ */
+template <typename KeyType, typename ValueType>
+concept IsSnapshotEntry = std::is_trivially_copyable_v<KeyType> && std::is_trivially_copyable_v<ValueType> && std::default_initializable<KeyType>
+                          && std::default_initializable<ValueType>;
+
+/**
+ * Fixed 64-byte header of a snapshot file, followed by Count records in strictly increasing key order.
+ * A record holds the key bytes at offset 0 and the value bytes at ValueOffset, padding is zero.
+ * Records are aligned to their own alignment inside the file, so a page-aligned mapping serves them in place.
+ */
+struct SnapshotHeader
+{
+    static constexpr std::array<char, 8> kMagic{'R', 'B', 'T', 'S', 'N', 'A', 'P', '\0'};
+    static constexpr std::uint32_t kVersion = 1;
+    // Written in native byte order, so a snapshot from a machine of the other byte order is rejected.
+    static constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+    std::array<char, 8> Magic = kMagic;
+    std::uint32_t Version = kVersion;
+    std::uint32_t ByteOrder = kByteOrderMark;
+    std::uint32_t KeySize = 0;
+    std::uint32_t ValueSize = 0;
+    std::uint32_t RecordSize = 0;
+    std::uint32_t ValueOffset = 0;
+    std::uint64_t Count = 0;
+    // SnapshotChecksum of all records.
+    std::uint64_t Checksum = 0;
+    std::array<std::uint8_t, 16> Reserved{};
+};
+
+static_assert(sizeof(SnapshotHeader) == 64 && std::is_trivially_copyable_v<SnapshotHeader>);
+
+/**
+ * Record layout of a key-value type pair.
+ */
+template <typename KeyType, typename ValueType> struct SnapshotLayout
+{
+    static constexpr size_t kAlignment = std::max(alignof(KeyType), alignof(ValueType));
+    static constexpr size_t kValueOffset = (sizeof(KeyType) + alignof(ValueType) - 1) / alignof(ValueType) * alignof(ValueType);
+    static constexpr size_t kRecordSize = (kValueOffset + sizeof(ValueType) + kAlignment - 1) / kAlignment * kAlignment;
+
+    static_assert(kAlignment <= sizeof(SnapshotHeader), "Records must stay aligned behind the header.");
+
+    /// <summary>
+    /// Get the header a snapshot of count records must carry, with the checksum left zero.
+    /// </summary>
+    static auto Header(const std::uint64_t count) -> SnapshotHeader
+    {
+        SnapshotHeader header;
+        header.KeySize = sizeof(KeyType);
+        header.ValueSize = sizeof(ValueType);
+        header.RecordSize = kRecordSize;
+        header.ValueOffset = kValueOffset;
+        header.Count = count;
+        return header;
+    }
+};
+
+/**
+ * 64-bit FNV-1a over 8-byte words, which keeps up with sequential reads of the page cache.
+ * Feed the bytes in any split, the result only depends on the whole sequence as long as every part but the last
+ * is a multiple of 8 bytes long.
+ */
+class SnapshotChecksum
+{
+public:
+    void Update(std::span<const std::byte> bytes)
+    {
+        size_t i = 0;
+        for (; i + sizeof(std::uint64_t) <= bytes.size(); i += sizeof(std::uint64_t)) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, bytes.data() + i, sizeof(word));
+            Mix(word);
+        }
+        if (i < bytes.size()) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, bytes.data() + i, bytes.size() - i);
+            Mix(word);
+        }
+    }
+
+    [[nodiscard]] auto Value() const -> std::uint64_t { return hash_; }
+
+private:
+    static constexpr std::uint64_t kOffsetBasis = 0xcbf29ce484222325ULL;
+    static constexpr std::uint64_t kPrime = 0x100000001b3ULL;
+
+    std::uint64_t hash_ = kOffsetBasis;
+
+    void Mix(const std::uint64_t word) { hash_ = (hash_ ^ word) * kPrime; }
+};
+
+/// <summary>
+/// Write all elements of a tree to a snapshot file in one sequential pass.
+/// The file is written next to its final path and renamed over it once complete and synced, so readers and a crash
+/// see either the old or the new snapshot.
+/// </summary>
+/// <param name="tree">The tree, e.g. a RedBlackTree, WideTree or MappedRedBlackTree with trivially copyable entries.</param>
+/// <param name="path">The snapshot path.</param>
+template <class Tree> void SaveSnapshot(const Tree& tree, const std::filesystem::path& path);
+
+/// <summary>
+/// Replace all elements of a tree with the elements of a snapshot file.
+/// The file is mapped and streamed through once to verify its checksum and once into Tree::BuildFromSorted,
+/// so a RedBlackTree is linked in O(n) with its nodes allocated in key order.
+/// </summary>
+/// <param name="path">The snapshot path.</param>
+/// <param name="tree">The tree.</param>
+template <class Tree> void LoadSnapshot(const std::filesystem::path& path, Tree& tree);
+
+/**
+ * Read-only key-ordered map served from a memory-mapped snapshot file, see SaveSnapshot.
+ * Opening a snapshot maps it and checks its header in O(1), no record is read or copied. Lookups descend the
+ * implicit balanced tree over the records in key order, whose child positions are computed from the parent's, so
+ * the file holds no pointers and the mapping may sit at any address. The pages are shared through the page cache
+ * with every process mapping the same file.
+ * All members are const and may be called from any number of threads at once.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>>
+MAPPED_RED_BLACK_TREE_REQUIRES class MappedRedBlackTree
+{
+    using Layout = SnapshotLayout<KeyType, ValueType>;
+
+public:
+    /**
+     * Random access iterator in key order, yields key-value pairs by value.
+     */
+    class ConstIterator
+    {
+        friend class MappedRedBlackTree;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using iterator_concept = std::random_access_iterator_tag;
+        using value_type = std::pair<KeyType, ValueType>;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        /**
+         * Entries are returned by value, operator-> keeps the pair alive.
+         */
+        struct pointer
+        {
+            value_type Entry;
+
+            auto operator->() const -> const value_type* { return &Entry; }
+        };
+
+        ConstIterator() = default;
+
+        auto operator*() const -> reference { return {KeyAt(record_), ValueAt(record_)}; }
+
+        auto operator->() const -> pointer { return {**this}; }
+
+        auto operator[](const difference_type n) const -> reference { return *(*this + n); }
+
+        auto operator++() -> ConstIterator&
+        {
+            record_ += Layout::kRecordSize;
+            return *this;
+        }
+
+        auto operator++(int) -> ConstIterator
+        {
+            ConstIterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        auto operator--() -> ConstIterator&
+        {
+            record_ -= Layout::kRecordSize;
+            return *this;
+        }
+
+        auto operator--(int) -> ConstIterator
+        {
+            ConstIterator it = *this;
+            --*this;
+            return it;
+        }
+
+        auto operator+=(const difference_type n) -> ConstIterator&
+        {
+            record_ += n * static_cast<difference_type>(Layout::kRecordSize);
+            return *this;
+        }
+
+        auto operator-=(const difference_type n) -> ConstIterator& { return *this += -n; }
+
+        friend auto operator+(ConstIterator it, const difference_type n) -> ConstIterator { return it += n; }
+
+        friend auto operator+(const difference_type n, ConstIterator it) -> ConstIterator { return it += n; }
+
+        friend auto operator-(ConstIterator it, const difference_type n) -> ConstIterator { return it -= n; }
+
+        friend auto operator-(const ConstIterator& lhs, const ConstIterator& rhs) -> difference_type
+        {
+            return (lhs.record_ - rhs.record_) / static_cast<difference_type>(Layout::kRecordSize);
+        }
+
+        friend bool operator==(const ConstIterator& lhs, const ConstIterator& rhs) { return lhs.record_ == rhs.record_; }
+
+        friend auto operator<=>(const ConstIterator& lhs, const ConstIterator& rhs) { return lhs.record_ <=> rhs.record_; }
+
+    private:
+        const std::byte* record_ = nullptr;
+
+        explicit ConstIterator(const std::byte* record) : record_(record) {}
+    };
+
+    using const_iterator = ConstIterator;
+
+    /// <summary>
+    /// Map a snapshot file and check its header.
+    /// Throws std::system_error if the file can not be mapped, std::runtime_error if it is no snapshot of this type.
+    /// </summary>
+    /// <param name="path">The snapshot path.</param>
+    /// <param name="key_comparator">The key comparator, must order like the one of the saved tree.</param>
+    explicit MappedRedBlackTree(const std::filesystem::path& path, const KeyComparator& key_comparator = KeyComparator());
+
+    MappedRedBlackTree(const MappedRedBlackTree&) = delete;
+
+    MappedRedBlackTree(MappedRedBlackTree&& other) noexcept
+        : mapping_(std::exchange(other.mapping_, nullptr)), mapping_size_(std::exchange(other.mapping_size_, 0)),
+          records_(std::exchange(other.records_, nullptr)), size_(std::exchange(other.size_, 0)), key_comparator_(std::move(other.key_comparator_))
+    {
+    }
+
+    auto operator=(const MappedRedBlackTree&) -> MappedRedBlackTree& = delete;
+
+    auto operator=(MappedRedBlackTree&& other) noexcept -> MappedRedBlackTree&;
+
+    ~MappedRedBlackTree() noexcept { Unmap(); }
+
+    std::optional<ValueType> GetValue(const KeyType& key) const
+    {
+        const std::byte* record = FindRecord(key);
+        return record ? std::make_optional(ValueAt(record)) : std::nullopt;
+    }
+
+    [[nodiscard]] bool Contains(const KeyType& key) const { return FindRecord(key) != nullptr; }
+
+    /// <summary>
+    /// Get the first element whose key is not less than the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The iterator, or end() if there is no such element.</returns>
+    auto LowerBound(const KeyType& key) const -> const_iterator { return const_iterator(RecordAt(LowerBoundIndex(key))); }
+
+    /// <summary>
+    /// Visit every element with key in [lo, hi) in key order, see RedBlackTree::RangeScan.
+    /// </summary>
+    /// <param name="lo">The inclusive lower key.</param>
+    /// <param name="hi">The exclusive upper key.</param>
+    /// <param name="visitor">The visitor.</param>
+    /// <returns>The number of visited elements.</returns>
+    template <typename Visitor>
+        requires std::invocable<Visitor&, const KeyType&, const ValueType&>
+    auto RangeScan(const KeyType& lo, const KeyType& hi, Visitor&& visitor) const -> size_t;
+
+    [[nodiscard]] auto Size() const -> size_t { return size_; }
+
+    [[nodiscard]] bool IsEmpty() const { return size_ == 0; }
+
+    /// <summary>
+    /// Read all records and compare their checksum with the one in the header, which opening skips.
+    /// </summary>
+    /// <returns>True for the records are intact.</returns>
+    [[nodiscard]] bool VerifyChecksum() const;
+
+    /**
+     * Iteration in key order.
+     */
+
+    auto begin() const -> const_iterator { return const_iterator(records_); }
+
+    auto end() const -> const_iterator { return const_iterator(RecordAt(size_)); }
+
+private:
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    const std::byte* records_ = nullptr;
+    size_t size_ = 0;
+    [[no_unique_address]] KeyComparator key_comparator_;
+
+    void Unmap() noexcept;
+
+    [[nodiscard]] auto RecordAt(const size_t index) const -> const std::byte* { return records_ + index * Layout::kRecordSize; }
+
+    /// <summary>
+    /// Get the number of records whose key is less than the given key.
+    /// </summary>
+    auto LowerBoundIndex(const KeyType& key) const -> size_t;
+
+    auto FindRecord(const KeyType& key) const -> const std::byte*;
+
+    /**
+     * Records are read through memcpy, which compiles to plain loads, as no object lives in the mapping.
+     */
+
+    static auto KeyAt(const std::byte* record) -> KeyType
+    {
+        KeyType key;
+        std::memcpy(&key, record, sizeof(KeyType));
+        return key;
+    }
+
+    static auto ValueAt(const std::byte* record) -> ValueType
+    {
+        ValueType value;
+        std::memcpy(&value, record + Layout::kValueOffset, sizeof(ValueType));
+        return value;
+    }
+
+    template <typename L, typename R> bool Less(const L& lhs, const R& rhs) const
+    {
+        if constexpr (IsThreeWayComparator<KeyType, KeyComparator>) {
+            return key_comparator_(lhs, rhs) < 0;
+        } else {
+            return key_comparator_(lhs, rhs);
+        }
+    }
+};
+
+} // namespace rbt
+
+#include "mapped_red_black_tree.inl"
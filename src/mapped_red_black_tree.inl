@@ -0,0 +1,338 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace rbt
+{
+
+/**
+ * File descriptor closed on scope exit, for the POSIX calls behind snapshots and the write-ahead log.
+ */
+class SnapshotFile
+{
+public:
+    SnapshotFile(const std::filesystem::path& path, const int flags) : path_(path), fd_(::open(path.c_str(), flags | O_CLOEXEC, 0644))
+    {
+        if (fd_ < 0) {
+            Fail("open");
+        }
+    }
+
+    SnapshotFile(const SnapshotFile&) = delete;
+
+    auto operator=(const SnapshotFile&) -> SnapshotFile& = delete;
+
+    ~SnapshotFile() noexcept { ::close(fd_); }
+
+    [[nodiscard]] auto Descriptor() const -> int { return fd_; }
+
+    /// <summary>
+    /// Write all bytes at the given offset.
+    /// </summary>
+    void WriteAt(std::span<const std::byte> bytes, off_t offset) const
+    {
+        while (!bytes.empty()) {
+            const ssize_t written = ::pwrite(fd_, bytes.data(), bytes.size(), offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                Fail("write");
+            }
+            bytes = bytes.subspan(static_cast<size_t>(written));
+            offset += written;
+        }
+    }
+
+    void Sync() const
+    {
+        if (::fsync(fd_) != 0) {
+            Fail("fsync");
+        }
+    }
+
+    /// <summary>
+    /// Flush the written bytes and the file size, but not the other metadata.
+    /// </summary>
+    void SyncData() const
+    {
+#if defined(__linux__)
+        if (::fdatasync(fd_) != 0) {
+            Fail("fdatasync");
+        }
+#else
+        Sync();
+#endif
+    }
+
+    [[nodiscard]] auto Size() const -> size_t
+    {
+        struct stat status{};
+        if (::fstat(fd_, &status) != 0) {
+            Fail("stat");
+        }
+        return static_cast<size_t>(status.st_size);
+    }
+
+    void Truncate(const off_t size) const
+    {
+        if (::ftruncate(fd_, size) != 0) {
+            Fail("truncate");
+        }
+    }
+
+    [[noreturn]] void Fail(const char* operation) const { throw std::system_error(errno, std::generic_category(), std::string(operation) + ' ' + path_.string()); }
+
+private:
+    std::filesystem::path path_;
+    int fd_;
+};
+
+/// <summary>
+/// Sync the directory holding a path, which makes a new or renamed entry for it durable.
+/// </summary>
+inline void SyncParentDirectory(const std::filesystem::path& path)
+{
+    // A trailing separator names the directory itself.
+    const std::filesystem::path entry = path.has_filename() ? path : path.parent_path();
+    const SnapshotFile directory(entry.has_parent_path() ? entry.parent_path() : std::filesystem::path("."), O_RDONLY | O_DIRECTORY);
+    directory.Sync();
+}
+
+template <class Tree> void SaveSnapshot(const Tree& tree, const std::filesystem::path& path)
+{
+    using KeyType = std::remove_cvref_t<decltype((*tree.begin()).first)>;
+    using ValueType = std::remove_cvref_t<decltype((*tree.begin()).second)>;
+    using Layout = SnapshotLayout<KeyType, ValueType>;
+    static_assert(IsSnapshotEntry<KeyType, ValueType>, "Snapshots store trivially copyable keys and values only.");
+
+    const std::filesystem::path temporary_path = path.string() + ".tmp";
+    // Removes the temporary file unless it was renamed, so a failed save leaves nothing behind.
+    struct TemporaryFile
+    {
+        const std::filesystem::path& Path;
+        bool Renamed = false;
+
+        ~TemporaryFile() noexcept
+        {
+            if (!Renamed) {
+                std::error_code ignored;
+                std::filesystem::remove(Path, ignored);
+            }
+        }
+    };
+    TemporaryFile temporary{temporary_path};
+    {
+        const SnapshotFile file(temporary_path, O_WRONLY | O_CREAT | O_TRUNC);
+        SnapshotHeader header = Layout::Header(tree.Size());
+
+        // A multiple of 8 records is a multiple of 8 bytes, as the checksum wants from every chunk but the last.
+        const size_t chunk_records = 8 * std::max<size_t>(1, (size_t{1} << 13) / Layout::kRecordSize);
+        std::vector<std::byte> chunk(chunk_records * Layout::kRecordSize);
+        SnapshotChecksum checksum;
+        auto offset = static_cast<off_t>(sizeof(SnapshotHeader));
+        size_t count = 0;
+        size_t filled = 0;
+        const auto flush = [&] {
+            const std::span<const std::byte> bytes(chunk.data(), filled * Layout::kRecordSize);
+            checksum.Update(bytes);
+            file.WriteAt(bytes, offset);
+            offset += static_cast<off_t>(bytes.size());
+            filled = 0;
+        };
+
+        for (const auto& [key, value] : tree) {
+            std::byte* record = chunk.data() + filled * Layout::kRecordSize;
+            std::fill_n(record, Layout::kRecordSize, std::byte{0});
+            std::memcpy(record, &key, sizeof(KeyType));
+            std::memcpy(record + Layout::kValueOffset, &value, sizeof(ValueType));
+            count++;
+            if (++filled == chunk_records) {
+                flush();
+            }
+        }
+        flush();
+        if (count != header.Count) {
+            throw std::logic_error("Tree size does not match its elements.");
+        }
+
+        header.Checksum = checksum.Value();
+        file.WriteAt(std::as_bytes(std::span(&header, 1)), 0);
+        file.Sync();
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        throw std::system_error(error, "rename " + temporary_path.string());
+    }
+    temporary.Renamed = true;
+    // Make the rename itself durable.
+    SyncParentDirectory(path);
+}
+
+template <class Tree> void LoadSnapshot(const std::filesystem::path& path, Tree& tree)
+{
+    using KeyType = std::remove_cvref_t<decltype((*tree.begin()).first)>;
+    using ValueType = std::remove_cvref_t<decltype((*tree.begin()).second)>;
+
+    // The mapped tree only hands out its records in file order, its comparator is never called.
+    const MappedRedBlackTree<KeyType, ValueType> snapshot(path);
+    if (!snapshot.VerifyChecksum()) {
+        throw std::runtime_error("Snapshot checksum mismatch: " + path.string());
+    }
+    tree.BuildFromSorted(snapshot.begin(), snapshot.end());
+}
+
+MAPPED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+MAPPED_RED_BLACK_TREE_REQUIRES
+MAPPED_RED_BLACK_TREE_TYPE::MappedRedBlackTree(const std::filesystem::path& path, const KeyComparator& key_comparator) : key_comparator_(key_comparator)
+{
+    const SnapshotFile file(path, O_RDONLY);
+    SnapshotHeader header;
+    const size_t file_size = file.Size();
+    if (file_size < sizeof(SnapshotHeader)) {
+        throw std::runtime_error("Snapshot is truncated: " + path.string());
+    }
+
+    // The mapping outlives the descriptor.
+    mapping_ = ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, file.Descriptor(), 0);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        file.Fail("mmap");
+    }
+    mapping_size_ = file_size;
+    std::memcpy(&header, mapping_, sizeof(header));
+
+    const SnapshotHeader expected = Layout::Header(header.Count);
+    const char* error = nullptr;
+    if (header.Magic != SnapshotHeader::kMagic) {
+        error = "Not a snapshot: ";
+    } else if (header.Version != SnapshotHeader::kVersion || header.ByteOrder != SnapshotHeader::kByteOrderMark) {
+        error = "Unsupported snapshot version or byte order: ";
+    } else if (header.KeySize != expected.KeySize || header.ValueSize != expected.ValueSize || header.RecordSize != expected.RecordSize
+               || header.ValueOffset != expected.ValueOffset) {
+        error = "Snapshot of other key or value types: ";
+    } else if (header.Count > (file_size - sizeof(SnapshotHeader)) / Layout::kRecordSize
+               || sizeof(SnapshotHeader) + header.Count * Layout::kRecordSize != file_size) {
+        error = "Snapshot is truncated: ";
+    }
+    if (error) {
+        Unmap();
+        throw std::runtime_error(error + path.string());
+    }
+
+    records_ = static_cast<const std::byte*>(mapping_) + sizeof(SnapshotHeader);
+    size_ = header.Count;
+}
+
+MAPPED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+MAPPED_RED_BLACK_TREE_REQUIRES
+auto MAPPED_RED_BLACK_TREE_TYPE::operator=(MappedRedBlackTree&& other) noexcept -> MappedRedBlackTree&
+{
+    if (this != &other) {
+        Unmap();
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        mapping_size_ = std::exchange(other.mapping_size_, 0);
+        records_ = std::exchange(other.records_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        key_comparator_ = std::move(other.key_comparator_);
+    }
+    return *this;
+}
+
+MAPPED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+MAPPED_RED_BLACK_TREE_REQUIRES
+template <typename Visitor>
+    requires std::invocable<Visitor&, const KeyType&, const ValueType&>
+auto MAPPED_RED_BLACK_TREE_TYPE::RangeScan(const KeyType& lo, const KeyType& hi, Visitor&& visitor) const -> size_t
+{
+    size_t visited = 0;
+    for (size_t index = LowerBoundIndex(lo); index < size_; index++) {
+        const KeyType key = KeyAt(RecordAt(index));
+        if (!Less(key, hi)) {
+            break;
+        }
+        visited++;
+        if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, const KeyType&, const ValueType&>, bool>) {
+            if (!std::invoke(visitor, key, ValueAt(RecordAt(index)))) {
+                break;
+            }
+        } else {
+            std::invoke(visitor, key, ValueAt(RecordAt(index)));
+        }
+    }
+    return visited;
+}
+
+MAPPED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+MAPPED_RED_BLACK_TREE_REQUIRES
+bool MAPPED_RED_BLACK_TREE_TYPE::VerifyChecksum() const
+{
+    if (!mapping_) {
+        return true;
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, mapping_, sizeof(header));
+    SnapshotChecksum checksum;
+    checksum.Update(std::span(records_, size_ * Layout::kRecordSize));
+    return checksum.Value() == header.Checksum;
+}
+
+MAPPED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+MAPPED_RED_BLACK_TREE_REQUIRES
+void MAPPED_RED_BLACK_TREE_TYPE::Unmap() noexcept
+{
+    if (mapping_) {
+        ::munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+    }
+}
+
+MAPPED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+MAPPED_RED_BLACK_TREE_REQUIRES
+auto MAPPED_RED_BLACK_TREE_TYPE::LowerBoundIndex(const KeyType& key) const -> size_t
+{
+    // The middle record of a range is the root of its implicit subtree, the halves are its children.
+    size_t low = 0;
+    size_t length = size_;
+    while (length > 0) {
+        const size_t half = length / 2;
+#if defined(__GNUC__) || defined(__clang__)
+        // Both grandchildren, so the load of the next level overlaps this comparison.
+        __builtin_prefetch(RecordAt(low + half / 2));
+        __builtin_prefetch(RecordAt(low + half + 1 + (length - half - 1) / 2));
+#endif
+        if (Less(KeyAt(RecordAt(low + half)), key)) {
+            low += half + 1;
+            length -= half + 1;
+        } else {
+            length = half;
+        }
+    }
+    return low;
+}
+
+MAPPED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+MAPPED_RED_BLACK_TREE_REQUIRES
+auto MAPPED_RED_BLACK_TREE_TYPE::FindRecord(const KeyType& key) const -> const std::byte*
+{
+    const size_t index = LowerBoundIndex(key);
+    if (index == size_) {
+        return nullptr;
+    }
+    const std::byte* record = RecordAt(index);
+    return Less(key, KeyAt(record)) ? nullptr : record;
+}
+
+} // namespace rbt
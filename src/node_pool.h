@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace rbt
+{
+
+/**
+ * Fixed-size block pool.
+ * Blocks are carved out of geometrically growing slabs and freed blocks are kept in an intrusive free list,
+ * so consecutive allocations are adjacent in memory and Release() frees everything in O(number of slabs).
+ * The block size is fixed by the first allocation. Not thread-safe.
+ */
+class NodePool
+{
+    struct Slab
+    {
+        Slab* Next = nullptr;
+        size_t Bytes = 0;
+    };
+
+    struct FreeBlock
+    {
+        FreeBlock* Next = nullptr;
+    };
+
+public:
+    static constexpr size_t kFirstSlabBlocks = 64;
+    static constexpr size_t kMaxSlabBytes = size_t{1} << 20;
+
+    NodePool() = default;
+
+    NodePool(const NodePool&) = delete;
+
+    NodePool(NodePool&&) noexcept = delete;
+
+    auto operator=(const NodePool&) -> NodePool& = delete;
+
+    auto operator=(NodePool&&) noexcept -> NodePool& = delete;
+
+    ~NodePool() noexcept { Release(); }
+
+    /// <summary>
+    /// Check whether the pool can serve blocks of the given size and alignment.
+    /// </summary>
+    /// <param name="bytes">The block size.</param>
+    /// <param name="alignment">The block alignment.</param>
+    /// <returns>True for the pool serves this block layout.</returns>
+    [[nodiscard]] bool CanServe(const size_t bytes, const size_t alignment) const
+    {
+        return block_size_ == 0 ? alignment <= kSlabAlignment : bytes == requested_size_ && alignment <= block_alignment_;
+    }
+
+    /// <summary>
+    /// Allocate one block. The first call fixes the block layout of the pool.
+    /// </summary>
+    /// <param name="bytes">The block size.</param>
+    /// <param name="alignment">The block alignment.</param>
+    /// <returns>The block.</returns>
+    void* Allocate(const size_t bytes, const size_t alignment)
+    {
+        if (block_size_ == 0) [[unlikely]] {
+            requested_size_ = bytes;
+            block_alignment_ = std::max(alignment, alignof(FreeBlock));
+            block_size_ = RoundUp(std::max(bytes, sizeof(FreeBlock)), block_alignment_);
+        }
+
+        if (free_list_) {
+            FreeBlock* block = free_list_;
+            free_list_ = block->Next;
+            return block;
+        }
+
+        if (static_cast<size_t>(slab_end_ - cursor_) < block_size_) [[unlikely]] {
+            AllocateSlab();
+        }
+        void* block = cursor_;
+        cursor_ += block_size_;
+        return block;
+    }
+
+    /// <summary>
+    /// Return one block to the free list.
+    /// </summary>
+    /// <param name="block">The block.</param>
+    void Deallocate(void* block) noexcept { free_list_ = ::new (block) FreeBlock{.Next = free_list_}; }
+
+    /// <summary>
+    /// Free all slabs at once. Every block handed out by this pool becomes invalid.
+    /// </summary>
+    void Release() noexcept
+    {
+        while (slabs_) {
+            Slab* next = slabs_->Next;
+            ::operator delete(slabs_, slabs_->Bytes, std::align_val_t{kSlabAlignment});
+            slabs_ = next;
+        }
+        free_list_ = nullptr;
+        cursor_ = slab_end_ = nullptr;
+        next_slab_blocks_ = kFirstSlabBlocks;
+        slab_count_ = 0;
+    }
+
+    /// <summary>
+    /// Get slab count of the pool.
+    /// </summary>
+    /// <returns>The slab count.</returns>
+    [[nodiscard]] auto SlabCount() const -> size_t { return slab_count_; }
+
+private:
+    static constexpr size_t kSlabAlignment = 64;
+
+    Slab* slabs_ = nullptr;
+    FreeBlock* free_list_ = nullptr;
+    std::byte* cursor_ = nullptr;
+    std::byte* slab_end_ = nullptr;
+    size_t requested_size_ = 0;
+    size_t block_size_ = 0;
+    size_t block_alignment_ = 0;
+    size_t next_slab_blocks_ = kFirstSlabBlocks;
+    size_t slab_count_ = 0;
+
+    static constexpr auto RoundUp(const size_t n, const size_t alignment) -> size_t { return (n + alignment - 1) / alignment * alignment; }
+
+    void AllocateSlab()
+    {
+        const size_t header = RoundUp(sizeof(Slab), block_alignment_);
+        const size_t bytes = header + next_slab_blocks_ * block_size_;
+        auto* slab = ::new (::operator new(bytes, std::align_val_t{kSlabAlignment})) Slab{.Next = slabs_, .Bytes = bytes};
+        slabs_ = slab;
+        slab_count_++;
+
+        cursor_ = reinterpret_cast<std::byte*>(slab) + header;
+        slab_end_ = reinterpret_cast<std::byte*>(slab) + bytes;
+        next_slab_blocks_ = std::max(next_slab_blocks_, std::min(next_slab_blocks_ * 2, kMaxSlabBytes / block_size_));
+    }
+};
+
+/**
+ * Allocator backed by a NodePool.
+ * Copies and rebinds share the same pool; single-object allocations of the pool's block layout are served
+ * from the pool and everything else falls back to the global operator new.
+ * A move hands the pool over, the moved-from allocator creates a pool of its own on its next allocation.
+ * Allocators sharing a pool must not be used on different threads at the same time.
+ */
+template <typename T> class NodePoolAllocator
+{
+    template <typename U> friend class NodePoolAllocator;
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    NodePoolAllocator() : pool_(std::make_shared<NodePool>()) {}
+
+    NodePoolAllocator(const NodePoolAllocator&) noexcept = default;
+
+    NodePoolAllocator(NodePoolAllocator&&) noexcept = default;
+
+    auto operator=(const NodePoolAllocator&) noexcept -> NodePoolAllocator& = default;
+
+    auto operator=(NodePoolAllocator&&) noexcept -> NodePoolAllocator& = default;
+
+    template <typename U> NodePoolAllocator(const NodePoolAllocator<U>& other) noexcept : pool_(other.pool_) {} // NOLINT
+
+    /// <summary>
+    /// A copied container gets its own pool.
+    /// </summary>
+    /// <returns>An allocator with a fresh pool.</returns>
+    [[nodiscard]] auto select_on_container_copy_construction() const -> NodePoolAllocator { return {}; } // NOLINT
+
+    auto allocate(const size_t n) -> T* // NOLINT
+    {
+        if (!pool_) [[unlikely]] {
+            pool_ = std::make_shared<NodePool>();
+        }
+        if (n == 1 && pool_->CanServe(sizeof(T), alignof(T))) [[likely]] {
+            return static_cast<T*>(pool_->Allocate(sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{alignof(T)}));
+    }
+
+    void deallocate(T* p, const size_t n) noexcept // NOLINT
+    {
+        if (n == 1 && pool_ && pool_->CanServe(sizeof(T), alignof(T))) [[likely]] {
+            pool_->Deallocate(p);
+            return;
+        }
+        ::operator delete(p, n * sizeof(T), std::align_val_t{alignof(T)});
+    }
+
+    /// <summary>
+    /// Free all slabs of the pool if this allocator is the only user of it.
+    /// Every pooled block becomes invalid, so the caller must not touch them afterwards.
+    /// </summary>
+    /// <returns>True for the slabs are released.</returns>
+    bool Release() noexcept
+    {
+        // A moved-from allocator holds no blocks.
+        if (!pool_) {
+            return true;
+        }
+        if (pool_.use_count() != 1) {
+            return false;
+        }
+        pool_->Release();
+        return true;
+    }
+
+    /// <summary>
+    /// Get the underlying pool, an empty one for a moved-from allocator.
+    /// </summary>
+    /// <returns>The pool.</returns>
+    [[nodiscard]] auto Pool() const -> const NodePool&
+    {
+        static const NodePool kEmptyPool;
+        return pool_ ? *pool_ : kEmptyPool;
+    }
+
+    template <typename U> bool operator==(const NodePoolAllocator<U>& other) const noexcept { return pool_ == other.pool_; }
+
+private:
+    std::shared_ptr<NodePool> pool_;
+};
+
+} // namespace rbt
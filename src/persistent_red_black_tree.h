@@ -0,0 +1,350 @@
+#pragma once
+
+/**
+ * Red-black tree whose copies are snapshots sharing their nodes, see PersistentRedBlackTree.
+ * Definitions live in persistent_red_black_tree.inl, which is included at the end of this file.
+ */
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "red_black_tree.h"
+
+namespace rbt
+{
+
+#define PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT template <typename KeyType, typename ValueType, class KeyComparator, class Allocator>
+#define PERSISTENT_RED_BLACK_TREE_TYPE PersistentRedBlackTree<KeyType, ValueType, KeyComparator, Allocator>
+#define PERSISTENT_RED_BLACK_TREE_REQUIRES requires IsComparator<KeyType, KeyComparator>
+
+/**
+ * Red-black tree with O(1) snapshots.
+ * Copying a tree copies the root handle only, both trees share every node, and every node counts the links and
+ * handles that reach it. An update runs the single top-down pass of RedBlackTree and copies the shared nodes it is
+ * about to change, which are the O(log n) nodes along its path. So Insert and Erase on a tree that has snapshots leave
+ * the snapshots untouched, while a tree without snapshots is updated in place like RedBlackTree. A node is freed as
+ * soon as the last version reaching it is updated or destroyed.
+ * Different versions may be read and updated from different threads at once, one version from several threads only
+ * for reading. The allocator is shared by all versions and must tolerate that.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>, class Allocator = std::allocator<std::pair<const KeyType, ValueType>>>
+PERSISTENT_RED_BLACK_TREE_REQUIRES class PersistentRedBlackTree
+{
+    enum class ColorType : bool
+    {
+        Red,
+        Black
+    };
+
+    struct Node
+    {
+        template <typename K, typename V> Node(K&& key, V&& value) : Key(std::forward<K>(key)), Value(std::forward<V>(value)) {}
+
+        KeyType Key;
+        ValueType Value;
+        Node* Left = nullptr;
+        Node* Right = nullptr;
+        // Parent links and tree handles that reach the node, one means the node belongs to a single version.
+        std::atomic<std::uint32_t> RefCount = 1;
+        ColorType Color = ColorType::Red;
+    };
+
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+    using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+    /**
+     * Upper bound of the tree height for as many nodes as fit into a 48-bit address space, see RedBlackTree::kMaxHeight.
+     */
+    static constexpr size_t kMaxHeight = 2 * static_cast<size_t>(std::bit_width((size_t{1} << 48) / sizeof(Node)));
+
+public:
+    /**
+     * Forward in-order iterator of one version, valid as long as the version is neither updated nor destroyed.
+     */
+    class ConstIterator
+    {
+        friend class PersistentRedBlackTree;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = std::pair<const KeyType&, const ValueType&>;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        /**
+         * Entries are returned by value as a pair of references, operator-> keeps that pair alive.
+         */
+        struct pointer
+        {
+            value_type Entry;
+
+            auto operator->() const -> const value_type* { return &Entry; }
+        };
+
+        ConstIterator() = default;
+
+        auto operator*() const -> reference { return {path_[depth_ - 1]->Key, path_[depth_ - 1]->Value}; }
+
+        auto operator->() const -> pointer { return {**this}; }
+
+        auto operator++() -> ConstIterator&
+        {
+            const Node* node = path_[depth_ - 1];
+            if (node->Right) {
+                PushLeftSpine(node->Right);
+                return *this;
+            }
+
+            // Climb until we leave a left subtree, its parent is the successor.
+            const Node* child = nullptr;
+            do {
+                child = path_[--depth_];
+            } while (depth_ && path_[depth_ - 1]->Right == child);
+            return *this;
+        }
+
+        auto operator++(int) -> ConstIterator
+        {
+            ConstIterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        friend bool operator==(const ConstIterator& lhs, const ConstIterator& rhs)
+        {
+            return (lhs.depth_ ? lhs.path_[lhs.depth_ - 1] : nullptr) == (rhs.depth_ ? rhs.path_[rhs.depth_ - 1] : nullptr);
+        }
+
+    private:
+        size_t depth_ = 0;
+        std::array<const Node*, kMaxHeight> path_{};
+
+        void PushLeftSpine(const Node* node)
+        {
+            for (; node; node = node->Left) {
+                path_[depth_++] = node;
+            }
+        }
+    };
+
+    using const_iterator = ConstIterator;
+
+    PersistentRedBlackTree() = default;
+
+    explicit PersistentRedBlackTree(const KeyComparator& key_comparator, const Allocator& allocator = Allocator())
+        : key_comparator_(key_comparator), node_allocator_(allocator)
+    {
+    }
+
+    /// <summary>
+    /// Take a snapshot of a tree in O(1). Updates of either tree are invisible to the other one.
+    /// </summary>
+    /// <param name="other">The tree.</param>
+    PersistentRedBlackTree(const PersistentRedBlackTree& other)
+        : root_(Retain(other.root_)), size_(other.size_), key_comparator_(other.key_comparator_), node_allocator_(other.node_allocator_)
+    {
+    }
+
+    PersistentRedBlackTree(PersistentRedBlackTree&& other) noexcept
+        : root_(std::exchange(other.root_, nullptr)), size_(std::exchange(other.size_, 0)), key_comparator_(std::move(other.key_comparator_)),
+          node_allocator_(other.node_allocator_)
+    {
+    }
+
+    auto operator=(const PersistentRedBlackTree& other) -> PersistentRedBlackTree&
+    {
+        if (this != &other) {
+            *this = PersistentRedBlackTree(other);
+        }
+        return *this;
+    }
+
+    auto operator=(PersistentRedBlackTree&& other) noexcept -> PersistentRedBlackTree&
+    {
+        if (this != &other) {
+            Release(std::exchange(root_, std::exchange(other.root_, nullptr)));
+            size_ = std::exchange(other.size_, 0);
+            key_comparator_ = std::move(other.key_comparator_);
+            node_allocator_ = other.node_allocator_;
+        }
+        return *this;
+    }
+
+    ~PersistentRedBlackTree() noexcept { Release(root_); }
+
+    /// <summary>
+    /// Insert a key-value pair into this version, unless the key is present.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <returns>True for the pair is inserted.</returns>
+    bool Insert(const KeyType& key, const ValueType& value) { return InsertNode<false>(key, value); }
+
+    /// <summary>
+    /// Insert a key-value pair into this version, or assign the value if the key is present.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <returns>True for the pair is inserted, false for the value is assigned.</returns>
+    bool InsertOrAssign(const KeyType& key, const ValueType& value) { return InsertNode<true>(key, value); }
+
+    /// <summary>
+    /// Erase a key-value pair from this version.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>True for erase successfully.</returns>
+    bool Erase(const KeyType& key);
+
+    /// <summary>
+    /// Get a new version with the pair inserted, this version stays as it is.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <returns>The new version.</returns>
+    [[nodiscard]] auto Inserted(const KeyType& key, const ValueType& value) const -> PersistentRedBlackTree
+    {
+        PersistentRedBlackTree tree(*this);
+        tree.Insert(key, value);
+        return tree;
+    }
+
+    /// <summary>
+    /// Get a new version without the key, this version stays as it is.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The new version.</returns>
+    [[nodiscard]] auto Erased(const KeyType& key) const -> PersistentRedBlackTree
+    {
+        PersistentRedBlackTree tree(*this);
+        tree.Erase(key);
+        return tree;
+    }
+
+    std::optional<ValueType> GetValue(const KeyType& key) const
+    {
+        const Node* node = FindNode(key);
+        return node ? std::make_optional(node->Value) : std::nullopt;
+    }
+
+    [[nodiscard]] bool Contains(const KeyType& key) const { return FindNode(key) != nullptr; }
+
+    [[nodiscard]] auto Size() const -> size_t { return size_; }
+
+    [[nodiscard]] bool IsEmpty() const { return root_ == nullptr; }
+
+    /// <summary>
+    /// Drop this version, nodes still shared with other versions survive.
+    /// </summary>
+    void Clear() noexcept
+    {
+        Release(std::exchange(root_, nullptr));
+        size_ = 0;
+    }
+
+    /**
+     * Iteration in key order.
+     */
+
+    auto begin() const -> const_iterator
+    {
+        const_iterator it;
+        it.PushLeftSpine(root_);
+        return it;
+    }
+
+    auto end() const -> const_iterator { return const_iterator(); }
+
+    /// <summary>
+    /// Check the red-black tree rules and the key order of this version.
+    /// </summary>
+    /// <returns>True for check success.</returns>
+    bool RedBlackTreeRulesCheck() const;
+
+private:
+    Node* root_ = nullptr;
+    size_t size_ = 0;
+    [[no_unique_address]] KeyComparator key_comparator_;
+    [[no_unique_address]] NodeAllocator node_allocator_;
+
+    template <bool Assign> bool InsertNode(const KeyType& key, const ValueType& value);
+
+    auto FindNode(const KeyType& key) const -> const Node*;
+
+    /// <summary>
+    /// Make a node exclusive to this version before it is changed, by copying it if other versions share it.
+    /// The copy shares the children, and replaces the node in the parent, which must be exclusive already.
+    /// </summary>
+    /// <param name="parent_node">The parent, nullptr for the root.</param>
+    /// <param name="node">The node or nullptr.</param>
+    /// <returns>The exclusive node.</returns>
+    auto Own(Node* parent_node, Node* node) -> Node*;
+
+    static auto Retain(Node* node) noexcept -> Node*
+    {
+        if (node) {
+            node->RefCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        return node;
+    }
+
+    /// <summary>
+    /// Drop one reference to a node, and free it with its subtree once nothing reaches it anymore.
+    /// </summary>
+    void Release(Node* node) noexcept;
+
+    template <typename K, typename V> auto CreateNode(K&& key, V&& value) -> Node*;
+
+    void DestroyNode(Node* node) noexcept;
+
+    /**
+     * Rebalance steps of RedBlackTree, on nodes exclusive to this version.
+     */
+
+    void HandleReorient(Node* grand_grand_parent_node, Node* grand_parent_node, Node* parent_node, Node* node);
+
+    void HandleRotation(Node* root, Node* sup);
+
+    void HandleReconnection(Node* new_parent, Node* node);
+
+    static bool IsRedNode(const Node* node) { return node && node->Color == ColorType::Red; }
+
+    /// <summary>
+    /// Get the black height of a subtree, checking the rules and that its keys lie in (lo, hi).
+    /// </summary>
+    /// <returns>The black height, or -1 for a violation.</returns>
+    auto CheckSubtree(const Node* node, const KeyType* lo, const KeyType* hi) const -> int;
+
+    template <typename L, typename R> bool Less(const L& lhs, const R& rhs) const
+    {
+        if constexpr (IsThreeWayComparator<KeyType, KeyComparator>) {
+            return key_comparator_(lhs, rhs) < 0;
+        } else {
+            return key_comparator_(lhs, rhs);
+        }
+    }
+
+    template <typename L, typename R> auto Compare(const L& lhs, const R& rhs) const -> std::weak_ordering
+    {
+        if constexpr (IsThreeWayComparator<KeyType, KeyComparator>) {
+            return key_comparator_(lhs, rhs);
+        } else if (key_comparator_(lhs, rhs)) {
+            return std::weak_ordering::less;
+        } else {
+            return key_comparator_(rhs, lhs) ? std::weak_ordering::greater : std::weak_ordering::equivalent;
+        }
+    }
+};
+
+} // namespace rbt
+
+#include "persistent_red_black_tree.inl"
@@ -0,0 +1,371 @@
+#pragma once
+
+/**
+ * Template definitions of PersistentRedBlackTree.
+ * This file is included at the end of persistent_red_black_tree.h, do not include it directly.
+ */
+
+#include "debug_log.h"
+
+namespace rbt
+{
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+template <bool Assign>
+bool PERSISTENT_RED_BLACK_TREE_TYPE::InsertNode(const KeyType& key, const ValueType& value)
+{
+    // A present key changes nothing, so the shared path is not copied for it.
+    if constexpr (!Assign) {
+        if (root_ && root_->RefCount.load(std::memory_order_relaxed) > 1 && Contains(key)) {
+            return false;
+        }
+    }
+
+    Node* node = Own(nullptr, root_);
+    Node* parent_node = nullptr;
+    Node* grand_parent_node = nullptr;
+    Node* grand_grand_parent_node = nullptr;
+    bool is_left = false;
+    while (node) {
+        const std::weak_ordering order = Compare(key, node->Key);
+        if (order == 0) {
+            if constexpr (Assign) {
+                node->Value = value;
+            }
+            return false;
+        }
+        is_left = order < 0;
+
+        // If node's left and right are red, need to reorient, which recolors both.
+        if (IsRedNode(node->Left) && IsRedNode(node->Right)) {
+            Own(node, node->Left);
+            Own(node, node->Right);
+            HandleReorient(grand_grand_parent_node, grand_parent_node, parent_node, node);
+        }
+
+        grand_grand_parent_node = grand_parent_node;
+        grand_parent_node = parent_node;
+        parent_node = node;
+        node = Own(node, is_left ? node->Left : node->Right);
+    }
+
+    node = CreateNode(key, value);
+    size_++;
+    if (!root_) {
+        node->Color = ColorType::Black;
+        root_ = node;
+        return true;
+    }
+
+    (is_left ? parent_node->Left : parent_node->Right) = node;
+    HandleReorient(grand_grand_parent_node, grand_parent_node, parent_node, node);
+    return true;
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+bool PERSISTENT_RED_BLACK_TREE_TYPE::Erase(const KeyType& key)
+{
+    const auto is_black_node = [](const Node* n) { return !IsRedNode(n); };
+
+    const auto get_sibling_node = [](Node* parent_node, Node* node) {
+        return parent_node ? (parent_node->Left == node ? parent_node->Right : parent_node->Left) : nullptr;
+    };
+
+    if (!root_ || (root_->RefCount.load(std::memory_order_relaxed) > 1 && !Contains(key))) {
+        return false;
+    }
+
+    /*
+     * The same pass as RedBlackTree::Erase. Nodes are made exclusive right before they are recolored or relinked,
+     * the ones only looked at stay shared.
+     */
+    Node* node = Own(nullptr, root_);
+    if (is_black_node(node->Left) && is_black_node(node->Right)) {
+        node->Color = ColorType::Red;
+    }
+
+    Node* parent_node = nullptr;
+    Node* grand_parent_node = nullptr;
+    const KeyType* deleted_key = &key;
+
+    while (node) {
+        /*
+         * Recolor current node to red first.
+         */
+        if (node->Color == ColorType::Black) {
+            Node* sibling_node = get_sibling_node(parent_node, node);
+
+            if (is_black_node(parent_node) && IsRedNode(sibling_node)) {
+                sibling_node = Own(parent_node, sibling_node);
+                HandleRotation(parent_node, sibling_node);
+                HandleReconnection(grand_parent_node, sibling_node);
+                parent_node->Color = ColorType::Red;
+                sibling_node->Color = ColorType::Black;
+
+                // The new sibling was a child of the old one.
+                grand_parent_node = sibling_node;
+                sibling_node = get_sibling_node(parent_node, node);
+            }
+
+            if (is_black_node(node->Left) && is_black_node(node->Right)) {
+                sibling_node = Own(parent_node, sibling_node);
+                if (sibling_node && (IsRedNode(sibling_node->Left) || IsRedNode(sibling_node->Right))) {
+                    Node* sibling_node_red_child = Own(sibling_node, is_black_node(sibling_node->Left) ? sibling_node->Right : sibling_node->Left);
+                    bool is_unique_rotate = true;
+
+                    // First rotation.
+                    if ((parent_node->Left == node) == (sibling_node->Left == sibling_node_red_child)) {
+                        HandleRotation(sibling_node, sibling_node_red_child);
+                        HandleReconnection(parent_node, sibling_node_red_child);
+                        is_unique_rotate = false;
+                    }
+
+                    // Second rotation.
+                    is_unique_rotate ? HandleRotation(parent_node, sibling_node) : HandleRotation(parent_node, sibling_node_red_child);
+                    is_unique_rotate ? HandleReconnection(grand_parent_node, sibling_node) : HandleReconnection(grand_parent_node, sibling_node_red_child);
+
+                    // Recolor.
+                    node->Color = ColorType::Red;
+                    parent_node->Color = ColorType::Black;
+                    if (is_unique_rotate) {
+                        sibling_node->Color = ColorType::Red;
+                        sibling_node_red_child->Color = ColorType::Black;
+                    }
+                } else {
+                    // Flip parent_node, node, sibling_node color.
+                    if (parent_node) {
+                        parent_node->Color = ColorType::Black;
+                    }
+                    node->Color = ColorType::Red;
+                    if (sibling_node) {
+                        sibling_node->Color = ColorType::Red;
+                    }
+                }
+            }
+        }
+
+        /*
+         * Handle delete, node is red.
+         */
+        const std::weak_ordering order = Compare(*deleted_key, node->Key);
+        if (order == 0) {
+            if (node->Left && node->Right) {
+                // Replace the entry by its predecessor, which is deleted instead.
+                const Node* replaced_node = node->Left;
+                while (replaced_node->Right) {
+                    replaced_node = replaced_node->Right;
+                }
+                node->Key = replaced_node->Key;
+                node->Value = replaced_node->Value;
+                // The predecessor may be copied on the way down, the key of this node stays put.
+                deleted_key = &node->Key;
+
+                grand_parent_node = parent_node;
+                parent_node = node;
+                node = Own(node, node->Left);
+                continue;
+            }
+
+            // Node has zero or one child, a single child is red.
+            Node* child_node = Own(node, node->Left ? node->Left : node->Right);
+            if (child_node) {
+                child_node->Color = ColorType::Black;
+            }
+            if (!parent_node) {
+                root_ = child_node;
+            } else {
+                (parent_node->Left == node ? parent_node->Left : parent_node->Right) = child_node;
+            }
+
+            // The link to the child moved to the parent, the node itself is exclusive and unreachable now.
+            size_--;
+            if (root_) {
+                root_->Color = ColorType::Black;
+            }
+            DestroyNode(node);
+            return true;
+        }
+
+        grand_parent_node = parent_node;
+        parent_node = node;
+        node = Own(node, order < 0 ? node->Left : node->Right);
+    }
+
+    if (root_) {
+        root_->Color = ColorType::Black;
+    }
+    return false;
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+auto PERSISTENT_RED_BLACK_TREE_TYPE::FindNode(const KeyType& key) const -> const Node*
+{
+    const Node* node = root_;
+    while (node) {
+        const std::weak_ordering order = Compare(key, node->Key);
+        if (order == 0) {
+            return node;
+        }
+        node = order < 0 ? node->Left : node->Right;
+    }
+    return nullptr;
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+auto PERSISTENT_RED_BLACK_TREE_TYPE::Own(Node* parent_node, Node* node) -> Node*
+{
+    // A single reference is the link from the exclusive parent, or this handle for the root.
+    if (!node || node->RefCount.load(std::memory_order_acquire) == 1) {
+        return node;
+    }
+
+    Node* copy = CreateNode(node->Key, node->Value);
+    copy->Color = node->Color;
+    copy->Left = Retain(node->Left);
+    copy->Right = Retain(node->Right);
+    if (!parent_node) {
+        root_ = copy;
+    } else {
+        (parent_node->Left == node ? parent_node->Left : parent_node->Right) = copy;
+    }
+    Release(node);
+    return copy;
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+void PERSISTENT_RED_BLACK_TREE_TYPE::Release(Node* node) noexcept
+{
+    // Only the left subtree recurses, the right one is walked in a loop, so the stack grows with the height only.
+    while (node && node->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        Release(node->Left);
+        Node* right_node = node->Right;
+        DestroyNode(node);
+        node = right_node;
+    }
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+template <typename K, typename V>
+auto PERSISTENT_RED_BLACK_TREE_TYPE::CreateNode(K&& key, V&& value) -> Node*
+{
+    Node* node = NodeAllocatorTraits::allocate(node_allocator_, 1);
+    try {
+        NodeAllocatorTraits::construct(node_allocator_, node, std::forward<K>(key), std::forward<V>(value));
+    } catch (...) {
+        NodeAllocatorTraits::deallocate(node_allocator_, node, 1);
+        throw;
+    }
+    return node;
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+void PERSISTENT_RED_BLACK_TREE_TYPE::DestroyNode(Node* node) noexcept
+{
+    NodeAllocatorTraits::destroy(node_allocator_, node);
+    NodeAllocatorTraits::deallocate(node_allocator_, node, 1);
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+void PERSISTENT_RED_BLACK_TREE_TYPE::HandleReorient(Node* grand_grand_parent_node, Node* grand_parent_node, Node* parent_node, Node* node)
+{
+    if (node->Left) {
+        node->Left->Color = ColorType::Black;
+    }
+    if (node->Right) {
+        node->Right->Color = ColorType::Black;
+    }
+    if (!parent_node) {
+        return;
+    }
+
+    node->Color = ColorType::Red;
+    if (parent_node->Color == ColorType::Red) {
+        grand_parent_node->Color = ColorType::Red;
+
+        // Double rotation when node and parent lean to different sides.
+        bool is_unique_rotate = true;
+        if ((grand_parent_node->Left == parent_node) != (parent_node->Left == node)) {
+            HandleRotation(parent_node, node);
+            HandleReconnection(grand_parent_node, node);
+            is_unique_rotate = false;
+        }
+
+        is_unique_rotate ? HandleRotation(grand_parent_node, parent_node) : HandleRotation(grand_parent_node, node);
+        is_unique_rotate ? HandleReconnection(grand_grand_parent_node, parent_node) : HandleReconnection(grand_grand_parent_node, node);
+
+        (is_unique_rotate ? parent_node : node)->Color = ColorType::Black;
+    }
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+void PERSISTENT_RED_BLACK_TREE_TYPE::HandleRotation(Node* root, Node* sup)
+{
+    // Links only move between exclusive nodes, so every reference count stays the same.
+    if (root->Left == sup) {
+        root->Left = sup->Right;
+        sup->Right = root;
+    } else {
+        root->Right = sup->Left;
+        sup->Left = root;
+    }
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+void PERSISTENT_RED_BLACK_TREE_TYPE::HandleReconnection(Node* new_parent, Node* node)
+{
+    if (!new_parent) {
+        root_ = node;
+    } else {
+        Less(node->Key, new_parent->Key) ? new_parent->Left = node : new_parent->Right = node;
+    }
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+bool PERSISTENT_RED_BLACK_TREE_TYPE::RedBlackTreeRulesCheck() const
+{
+    if (IsRedNode(root_)) {
+        ReportViolation("Violate rule 1: Root is not black.");
+        return false;
+    }
+    return CheckSubtree(root_, nullptr, nullptr) >= 0;
+}
+
+PERSISTENT_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+PERSISTENT_RED_BLACK_TREE_REQUIRES
+auto PERSISTENT_RED_BLACK_TREE_TYPE::CheckSubtree(const Node* node, const KeyType* lo, const KeyType* hi) const -> int
+{
+    if (!node) {
+        return 1;
+    }
+    if ((lo && !Less(*lo, node->Key)) || (hi && !Less(node->Key, *hi))) {
+        ReportViolation("Violate key order.");
+        return -1;
+    }
+    if (IsRedNode(node) && (IsRedNode(node->Left) || IsRedNode(node->Right))) {
+        ReportViolation("Violate rule 2: Red node must not have red child.");
+        return -1;
+    }
+    const int left_height = CheckSubtree(node->Left, lo, &node->Key);
+    const int right_height = CheckSubtree(node->Right, &node->Key, hi);
+    if (left_height < 0 || right_height < 0) {
+        return -1;
+    }
+    if (left_height != right_height) {
+        ReportViolation("Violate rule 3: Every path from root node to every null node must contain the same number of black nodes.");
+        return -1;
+    }
+    return left_height + (node->Color == ColorType::Black);
+}
+
+} // namespace rbt
@@ -1,16 +1,47 @@
 #pragma once
 
+/**
+ * Header-only red-black tree.
+ * All member definitions live in red_black_tree.inl, which is included at the end of this file,
+ * so the tree can be instantiated with any key/value type. The red-black-tree library only holds a
+ * precompiled RedBlackTree<int, int>; define RBT_EXTERN_TEMPLATE to reuse it instead of instantiating
+ * that specialization in every translation unit.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <compare>
 #include <concepts>
+#include <cstdint>
+#include <exception>
 #include <functional>
+#include <iosfwd>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
 #include <optional>
 #include <random>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "node_pool.h"
+#include "shared_latch.h"
+#include "thread_pool.h"
+#include "tree_policy.h"
+#include "tree_statistics.h"
 
 namespace rbt
 {
 
-#define RED_BLACK_TREE_TEMPLATE_ARGUMENT template <typename KeyType, typename ValueType, class KeyComparator>
-#define RED_BLACK_TREE_TYPE RedBlackTree<KeyType, ValueType, KeyComparator>
-#define RED_BLACK_TREE_REQUIRES requires std::default_initializable<KeyType> && std::equality_comparable<KeyType> && IsComparator<KeyType, KeyComparator>
+#define RED_BLACK_TREE_TEMPLATE_ARGUMENT template <typename KeyType, typename ValueType, class KeyComparator, class Allocator, class Policy>
+#define RED_BLACK_TREE_TYPE RedBlackTree<KeyType, ValueType, KeyComparator, Allocator, Policy>
+#define RED_BLACK_TREE_REQUIRES requires std::default_initializable<KeyType> && IsComparator<KeyType, KeyComparator>
 
 class IntRandomNumberGenerator
 {
@@ -24,12 +55,37 @@ private:
     std::mt19937 gen_;
 };
 
+/**
+ * Comparator returning an ordering, e.g. std::compare_three_way.
+ */
+template <typename KeyType, typename Comparator>
+concept IsThreeWayComparator = requires(Comparator comparator, KeyType lhs, KeyType rhs) {
+    { comparator(lhs, rhs) } -> std::convertible_to<std::weak_ordering>;
+};
+
+/**
+ * Strict weak ordering of keys, either a less-than predicate or a three-way comparator.
+ */
 template <typename KeyType, typename Comparator>
-concept IsComparator = requires(Comparator comparator, KeyType lhs, KeyType rhs) {
+concept IsComparator = IsThreeWayComparator<KeyType, Comparator> || requires(Comparator comparator, KeyType lhs, KeyType rhs) {
     { comparator(lhs, rhs) } -> std::convertible_to<bool>;
 };
 
-template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>> RED_BLACK_TREE_REQUIRES class RedBlackTree
+/**
+ * Comparator that accepts keys of type K in place of KeyType, e.g. std::less<> with std::string_view for std::string.
+ */
+template <typename Comparator, typename K, typename KeyType>
+concept IsTransparent = requires(const Comparator& comparator, const K& lhs, const KeyType& rhs) {
+    typename Comparator::is_transparent;
+    comparator(lhs, rhs);
+    comparator(rhs, lhs);
+};
+
+template <typename KeyType, typename ValueType, LockMode Mode, class KeyComparator, class Allocator, class Policy> class ConcurrentRedBlackTree;
+
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>, class Allocator = std::allocator<std::pair<const KeyType, ValueType>>,
+          class Policy = DefaultTreePolicy>
+RED_BLACK_TREE_REQUIRES class RedBlackTree
 {
     /**
      * Red black tree color type.
@@ -41,28 +97,359 @@ template <typename KeyType, typename ValueType, class KeyComparator = std::less<
         Black
     };
 
-    struct RedBlackTreeNode
+    using AggregatePolicyType = typename Policy::Aggregate;
+    using AggregateType = typename AggregatePolicyType::Type;
+
+    static constexpr bool kHasAggregate = !std::is_same_v<AggregatePolicyType, NoAggregate>;
+
+    static_assert(!kHasAggregate || IsAggregate<AggregatePolicyType, KeyType, ValueType>, "Policy::Aggregate must satisfy IsAggregate.");
+
+    using TracerType = typename Policy::Tracer;
+
+    static constexpr bool kTracing = !std::is_same_v<TracerType, NoTracer>;
+
+    using CountersType = typename Policy::Counters;
+
+    static constexpr bool kStatistics = !std::is_void_v<CountersType>;
+
+    template <int> struct EmptyMetadata
+    {};
+
+    struct SubtreeSizeMetadata
+    {
+        size_t Size = 1;
+    };
+
+    template <typename A> struct AggregateMetadata
+    {
+        typename A::Type Agg = A::Identity();
+    };
+
+    template <typename L> struct LatchMetadata
+    {
+        mutable L Latch;
+    };
+
+    static constexpr NodeLayout kNodeLayout = Policy::kNodeLayout;
+
+    struct RedBlackTreeNode;
+
+    struct PointerLinks
     {
-        KeyType Key = {};
-        ValueType Value = {};
         RedBlackTreeNode* Left = nullptr;
         RedBlackTreeNode* Right = nullptr;
-        ColorType Color = ColorType::red;
+        ColorType Color = ColorType::Red;
+    };
+
+    /**
+     * Nodes are at least pointer aligned, so bit 0 of the left pointer is free for the color.
+     */
+    struct PackedColorLinks
+    {
+        std::uintptr_t LeftAndColor = 0;
+        RedBlackTreeNode* Right = nullptr;
+    };
+
+    /**
+     * Index 0 is null, bit 31 of the left index is the color.
+     */
+    struct IndexLinks
+    {
+        std::uint32_t LeftAndColor = 0;
+        std::uint32_t Right = 0;
+    };
+
+    using NodeLinks = std::conditional_t<kNodeLayout == NodeLayout::Pointer, PointerLinks,
+                                         std::conditional_t<kNodeLayout == NodeLayout::PackedColor, PackedColorLinks, IndexLinks>>;
+
+    struct RedBlackTreeNode : std::conditional_t<Policy::kOrderStatistics, SubtreeSizeMetadata, EmptyMetadata<0>>,
+                              std::conditional_t<kHasAggregate, AggregateMetadata<AggregatePolicyType>, EmptyMetadata<1>>,
+                              std::conditional_t<!std::is_void_v<typename Policy::NodeLatch>, LatchMetadata<typename Policy::NodeLatch>, EmptyMetadata<3>>
+    {
+        template <typename K, typename... Args>
+        explicit RedBlackTreeNode(K&& key, Args&&... args) : Key(std::forward<K>(key)), Value(std::forward<Args>(args)...)
+        {}
+
+        KeyType Key = {};
+        ValueType Value = {};
+        NodeLinks Links;
+    };
+
+    static_assert(kNodeLayout != NodeLayout::PackedColor || alignof(RedBlackTreeNode) >= 2, "PackedColor needs bit 0 of node addresses.");
+
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<RedBlackTreeNode>;
+    using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+    /**
+     * Index32 nodes live in chunks aligned to their size, so the chunk of a node is found by masking its address
+     * and a node index is the chunk base plus the slot. Node addresses never change.
+     */
+    static constexpr size_t kIndexChunkBytes = size_t{1} << 16;
+    static constexpr size_t kIndexChunkNodes = (kIndexChunkBytes - std::max(sizeof(std::uint32_t), alignof(RedBlackTreeNode))) / sizeof(RedBlackTreeNode);
+    static constexpr size_t kIndexSlotBits = std::bit_width(kIndexChunkNodes - 1);
+    static constexpr std::uint32_t kIndexColorBit = std::uint32_t{1} << 31;
+
+    struct alignas(kIndexChunkBytes) IndexChunk
+    {
+        std::uint32_t Base = 0;
+        alignas(RedBlackTreeNode) std::byte Storage[kIndexChunkNodes * sizeof(RedBlackTreeNode)];
+    };
+
+    static_assert(kNodeLayout != NodeLayout::Index32 || kIndexChunkNodes >= 16, "Index32 is meant for small nodes.");
+
+    using IndexChunkAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<IndexChunk>;
+    using IndexChunkAllocatorTraits = std::allocator_traits<IndexChunkAllocator>;
+
+    struct IndexArena
+    {
+        // First node of every chunk, indexed by the chunk number.
+        std::vector<RedBlackTreeNode*> Chunks;
+        // Head of the freed slots, linked through their first 4 bytes.
+        std::uint32_t FreeList = 0;
+        // Next never used index, slot 0 of chunk 0 is reserved for null.
+        std::uint32_t Next = 1;
     };
 
+    /**
+     * Upper bound of the node count: 2^31 for Index32, whose top index bit holds the color, otherwise as many nodes as fit
+     * into a 48-bit address space.
+     */
+    static constexpr size_t kMaxSize = kNodeLayout == NodeLayout::Index32 ? size_t{1} << 31 : (size_t{1} << 48) / sizeof(RedBlackTreeNode);
+
+    /**
+     * Upper bound of the tree height, which is at most 2 * log2(n + 1).
+     * Iterators carry a path of this many nodes, 64 for Index32 and at most 90 otherwise.
+     */
+    static constexpr size_t kMaxHeight = 2 * static_cast<size_t>(std::bit_width(kMaxSize));
+
+    /**
+     * Default number of descents GetValues keeps in flight.
+     */
+    static constexpr size_t kLookupGroup = 16;
+
+    /**
+     * Black height from which the set operations hand their two recursive calls to the thread pool,
+     * the smaller operand then has at least 2^8 - 1 nodes.
+     */
+    static constexpr int kParallelBlackHeight = 8;
+
+    /**
+     * Whether nodes carry data that must be recomputed after structural changes.
+     */
+    static constexpr bool kAugmented = Policy::kOrderStatistics || kHasAggregate;
+
+    /**
+     * Whether one call of Compare decides both equality and direction at a node.
+     * A three-way comparator is used as is, and std::less over keys with operator<=> is evaluated as std::compare_three_way.
+     * Any other less-than predicate takes up to two calls.
+     */
+    static constexpr bool kThreeWayComparator = IsThreeWayComparator<KeyType, KeyComparator>;
+    static constexpr bool kThreeWay = kThreeWayComparator || ((std::same_as<KeyComparator, std::less<KeyType>> || std::same_as<KeyComparator, std::less<>>)
+                                                              && std::three_way_comparable<KeyType, std::weak_ordering>);
+
+    static constexpr bool kAtomicLinks = Policy::kAtomicLinks;
+
+    /**
+     * Values are read-only through iterators and visitors when they feed an aggregate.
+     */
+    using MappedReference = std::conditional_t<kHasAggregate, const ValueType&, ValueType&>;
+
 public:
+    /**
+     * Bidirectional in-order iterator.
+     * Nodes have no parent pointer, so the iterator carries the path from root to the current node in an inline stack
+     * and steps in amortized O(1) without touching the heap. Any insertion or deletion invalidates all iterators.
+     */
+    template <bool IsConst> class Iterator
+    {
+        friend class RedBlackTree;
+        template <bool> friend class Iterator;
+
+        using TreePointer = std::conditional_t<IsConst, const RedBlackTree*, RedBlackTree*>;
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using iterator_concept = std::bidirectional_iterator_tag;
+        using value_type = std::pair<const KeyType&, std::conditional_t<IsConst, const ValueType&, MappedReference>>;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        /**
+         * Entries are returned by value as a pair of references, operator-> keeps that pair alive.
+         */
+        struct pointer
+        {
+            value_type Entry;
+
+            auto operator->() const -> const value_type* { return &Entry; }
+        };
+
+        Iterator() = default;
+
+        Iterator(const Iterator& other) : tree_(other.tree_), depth_(other.depth_) { std::copy_n(other.path_.begin(), depth_, path_.begin()); }
+
+        template <bool OtherConst>
+            requires(IsConst && !OtherConst)
+        Iterator(const Iterator<OtherConst>& other) : tree_(other.tree_), depth_(other.depth_) // NOLINT
+        {
+            std::copy_n(other.path_.begin(), depth_, path_.begin());
+        }
+
+        auto operator=(const Iterator& other) -> Iterator&
+        {
+            tree_ = other.tree_;
+            depth_ = other.depth_;
+            std::copy_n(other.path_.begin(), depth_, path_.begin());
+            return *this;
+        }
+
+        ~Iterator() = default;
+
+        auto operator*() const -> reference { return {path_[depth_ - 1]->Key, path_[depth_ - 1]->Value}; }
+
+        auto operator->() const -> pointer { return {**this}; }
+
+        auto operator++() -> Iterator&
+        {
+            RedBlackTreeNode* node = path_[depth_ - 1];
+            if (tree_->Right(node)) {
+                PushLeftSpine(tree_->Right(node));
+                return *this;
+            }
+
+            // Climb until we leave a left subtree, its parent is the successor.
+            RedBlackTreeNode* child = nullptr;
+            do {
+                child = path_[--depth_];
+            } while (depth_ && tree_->Right(path_[depth_ - 1]) == child);
+            return *this;
+        }
+
+        auto operator++(int) -> Iterator
+        {
+            Iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        auto operator--() -> Iterator&
+        {
+            if (!depth_) {
+                // Step back from end.
+                PushRightSpine(tree_->root_);
+                return *this;
+            }
+
+            RedBlackTreeNode* node = path_[depth_ - 1];
+            if (tree_->Left(node)) {
+                PushRightSpine(tree_->Left(node));
+                return *this;
+            }
+
+            RedBlackTreeNode* child = nullptr;
+            do {
+                child = path_[--depth_];
+            } while (depth_ && tree_->Left(path_[depth_ - 1]) == child);
+            return *this;
+        }
+
+        auto operator--(int) -> Iterator
+        {
+            Iterator it = *this;
+            --*this;
+            return it;
+        }
+
+        friend bool operator==(const Iterator& lhs, const Iterator& rhs) { return lhs.Node() == rhs.Node(); }
+
+    private:
+        TreePointer tree_ = nullptr;
+        size_t depth_ = 0;
+        std::array<RedBlackTreeNode*, kMaxHeight> path_;
+
+        explicit Iterator(TreePointer tree) : tree_(tree) {}
+
+        [[nodiscard]] auto Node() const -> RedBlackTreeNode* { return depth_ ? path_[depth_ - 1] : nullptr; }
+
+        void Push(RedBlackTreeNode* node) { path_[depth_++] = node; }
+
+        void PushLeftSpine(RedBlackTreeNode* node)
+        {
+            for (; node; node = tree_->Left(node)) {
+                Push(node);
+            }
+        }
+
+        void PushRightSpine(RedBlackTreeNode* node)
+        {
+            for (; node; node = tree_->Right(node)) {
+                Push(node);
+            }
+        }
+    };
+
+    using AllocatorType = Allocator;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
     RedBlackTree() : key_comparator_() {}
 
+    explicit RedBlackTree(const Allocator& allocator) : key_comparator_(), node_allocator_(allocator) {}
+
+    explicit RedBlackTree(const KeyComparator& key_comparator, const Allocator& allocator = Allocator())
+        : key_comparator_(key_comparator), node_allocator_(allocator)
+    {}
+
+    /// <summary>
+    /// Construct red-black tree from a range of key-value pairs, see BuildFromSorted.
+    /// </summary>
+    /// <param name="first">The first element.</param>
+    /// <param name="last">The end of the range.</param>
+    /// <param name="key_comparator">The key comparator.</param>
+    /// <param name="allocator">The allocator.</param>
+    template <std::forward_iterator It>
+    RedBlackTree(It first, It last, const KeyComparator& key_comparator = KeyComparator(), const Allocator& allocator = Allocator())
+        : key_comparator_(key_comparator), node_allocator_(allocator)
+    {
+        BuildFromSorted(first, last);
+    }
+
     RedBlackTree(const RedBlackTree&) = delete;
 
-    RedBlackTree(RedBlackTree&&) noexcept = delete;
+    /// <summary>
+    /// Take over all nodes of another tree in O(1), the other tree is left empty.
+    /// Iterators into the other tree are invalidated.
+    /// </summary>
+    /// <param name="other">The other tree.</param>
+    RedBlackTree(RedBlackTree&& other) noexcept
+        : root_(std::exchange(other.root_, nullptr)), size_(std::exchange(other.size_, 0)), key_comparator_(std::move(other.key_comparator_)),
+          node_allocator_(std::move(other.node_allocator_)), index_arena_(std::exchange(other.index_arena_, {}))
+    {}
 
     auto operator=(const RedBlackTree&) -> RedBlackTree& = delete;
 
-    auto operator=(RedBlackTree&&) noexcept -> RedBlackTree& = delete;
+    /// <summary>
+    /// Take over all nodes of another tree in O(1) if the allocator propagates or both allocators are equal,
+    /// otherwise move the elements one by one into nodes of this allocator. The other tree is left empty.
+    /// </summary>
+    /// <param name="other">The other tree.</param>
+    /// <returns>This tree.</returns>
+    auto operator=(RedBlackTree&& other) noexcept(NodeAllocatorTraits::propagate_on_container_move_assignment::value || NodeAllocatorTraits::is_always_equal::value)
+        -> RedBlackTree&;
 
     ~RedBlackTree() noexcept { Clear(); }
 
+    /// <summary>
+    /// Exchange the contents of two trees in O(1).
+    /// Unless the allocator propagates on swap, both allocators must be equal.
+    /// </summary>
+    /// <param name="other">The other tree.</param>
+    void Swap(RedBlackTree& other) noexcept;
+
+    friend void swap(RedBlackTree& lhs, RedBlackTree& rhs) noexcept { lhs.Swap(rhs); }
+
     /// <summary>
     /// Insert a key-value pair into red-black tree.
     /// </summary>
@@ -71,6 +458,58 @@ public:
     /// <returns>True for insert successfully.</returns>
     bool Insert(const KeyType& key, const ValueType& value);
 
+    /// <summary>
+    /// Construct a node from the key and the value arguments, then insert it into red-black tree.
+    /// The node is destroyed again if the key is present, use TryEmplace to avoid that.
+    /// </summary>
+    /// <param name="key">The key or the argument to construct it from.</param>
+    /// <param name="args">The arguments to construct the value from.</param>
+    /// <returns>True for insert successfully.</returns>
+    template <typename K, typename... Args>
+        requires std::constructible_from<KeyType, K> && std::constructible_from<ValueType, Args...>
+    bool Emplace(K&& key, Args&&... args);
+
+    /// <summary>
+    /// Insert a key with a value constructed in place, only if the key is absent.
+    /// Neither the key nor the arguments are touched if the key is present.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="args">The arguments to construct the value from.</param>
+    /// <returns>True for insert successfully.</returns>
+    template <typename... Args>
+        requires std::constructible_from<ValueType, Args...>
+    bool TryEmplace(const KeyType& key, Args&&... args)
+    {
+        return InsertNode(key, [&] { return CreateNode(key, std::forward<Args>(args)...); }).second;
+    }
+
+    template <typename... Args>
+        requires std::constructible_from<ValueType, Args...>
+    bool TryEmplace(KeyType&& key, Args&&... args)
+    {
+        return InsertNode(key, [&] { return CreateNode(std::move(key), std::forward<Args>(args)...); }).second;
+    }
+
+    /// <summary>
+    /// Insert a key-value pair, or assign the value if the key is present, in a single descent.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <returns>True for insert, false for assign.</returns>
+    template <typename V>
+        requires std::constructible_from<ValueType, V> && std::assignable_from<ValueType&, V>
+    bool InsertOrAssign(const KeyType& key, V&& value)
+    {
+        return AssignNode(InsertNode(key, [&] { return CreateNode(key, std::forward<V>(value)); }), std::forward<V>(value));
+    }
+
+    template <typename V>
+        requires std::constructible_from<ValueType, V> && std::assignable_from<ValueType&, V>
+    bool InsertOrAssign(KeyType&& key, V&& value)
+    {
+        return AssignNode(InsertNode(key, [&] { return CreateNode(std::move(key), std::forward<V>(value)); }), std::forward<V>(value));
+    }
+
     /// <summary>
     /// Erase a key-value pair from red-black tree.
     /// </summary>
@@ -80,16 +519,144 @@ public:
 
     /// <summary>
     /// Get value by key from red-black tree.
+    /// The value is copied, prefer Find or Visit for values that are expensive to copy.
     /// </summary>
     /// <param name="key">The key.</param>
     /// <returns>The optional value.</returns>
     std::optional<ValueType> GetValue(const KeyType& key) const;
 
+    template <typename K>
+        requires IsTransparent<KeyComparator, K, KeyType>
+    std::optional<ValueType> GetValue(const K& key) const
+    {
+        const RedBlackTreeNode* node = FindNode(key);
+        return node ? std::make_optional(node->Value) : std::nullopt;
+    }
+
+    /**
+     * Lookup without copies.
+     * The overloads taking another key type are available when KeyComparator is transparent, e.g. std::less<>,
+     * so that a std::string_view can probe a tree of std::string without building a temporary key.
+     */
+
+    /// <summary>
+    /// Get the element with the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The iterator, or end() if there is no such element.</returns>
+    auto Find(const KeyType& key) -> iterator { return FindBound<iterator>(this, key); }
+
+    auto Find(const KeyType& key) const -> const_iterator { return FindBound<const_iterator>(this, key); }
+
+    template <typename K>
+        requires IsTransparent<KeyComparator, K, KeyType>
+    auto Find(const K& key) -> iterator
+    {
+        return FindBound<iterator>(this, key);
+    }
+
+    template <typename K>
+        requires IsTransparent<KeyComparator, K, KeyType>
+    auto Find(const K& key) const -> const_iterator
+    {
+        return FindBound<const_iterator>(this, key);
+    }
+
+    /// <summary>
+    /// Check whether red-black tree contains the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>True for the key is found.</returns>
+    [[nodiscard]] bool Contains(const KeyType& key) const { return FindNode(key) != nullptr; }
+
+    template <typename K>
+        requires IsTransparent<KeyComparator, K, KeyType>
+    [[nodiscard]] bool Contains(const K& key) const
+    {
+        return FindNode(key) != nullptr;
+    }
+
+    /// <summary>
+    /// Call the visitor with (key, value) of the element with the given key, the value is accessed in place.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="visitor">The visitor.</param>
+    /// <returns>True for the key is found.</returns>
+    template <typename Visitor>
+        requires std::invocable<Visitor&, const KeyType&, MappedReference>
+    bool Visit(const KeyType& key, Visitor&& visitor)
+    {
+        return VisitNode<MappedReference>(FindNode(key), visitor);
+    }
+
+    template <typename Visitor>
+        requires std::invocable<Visitor&, const KeyType&, const ValueType&>
+    bool Visit(const KeyType& key, Visitor&& visitor) const
+    {
+        return VisitNode<const ValueType&>(FindNode(key), visitor);
+    }
+
+    template <typename K, typename Visitor>
+        requires IsTransparent<KeyComparator, K, KeyType> && std::invocable<Visitor&, const KeyType&, MappedReference>
+    bool Visit(const K& key, Visitor&& visitor)
+    {
+        return VisitNode<MappedReference>(FindNode(key), visitor);
+    }
+
+    template <typename K, typename Visitor>
+        requires IsTransparent<KeyComparator, K, KeyType> && std::invocable<Visitor&, const KeyType&, const ValueType&>
+    bool Visit(const K& key, Visitor&& visitor) const
+    {
+        return VisitNode<const ValueType&>(FindNode(key), visitor);
+    }
+
+    /**
+     * Batch operations.
+     */
+
+    /// <summary>
+    /// Insert a batch of key-value pairs into red-black tree.
+    /// The batch is applied in key order. A batch that is large relative to the tree is merged with the existing nodes
+    /// and relinked in O(n + m). A small one is inserted by splitting the tree at the batch keys, in O(m log(n / m + 1)).
+    /// Keys already in the tree keep their value and take no allocation. Of equivalent keys in the batch the first one
+    /// is inserted, like repeated Insert calls.
+    /// </summary>
+    /// <param name="entries">The key-value pairs, in any order.</param>
+    /// <returns>The number of inserted pairs.</returns>
+    auto InsertBatch(std::span<const std::pair<KeyType, ValueType>> entries) -> size_t;
+
+    /// <summary>
+    /// Erase a batch of keys from red-black tree, see InsertBatch.
+    /// </summary>
+    /// <param name="keys">The keys, in any order.</param>
+    /// <returns>The number of erased pairs.</returns>
+    auto EraseBatch(std::span<const KeyType> keys) -> size_t;
+
+    /// <summary>
+    /// Get values of a batch of keys from red-black tree.
+    /// GroupSize independent descents advance one level at a time in turn, and each step prefetches the next node
+    /// before switching to the next descent, so that up to GroupSize cache misses overlap instead of one per lookup.
+    /// A finished descent immediately takes the next key.
+    /// </summary>
+    /// <typeparam name="GroupSize">The number of descents in flight, see bench/lookup.cpp for tuning.</typeparam>
+    /// <param name="keys">The keys.</param>
+    /// <param name="values">The optional values, values[i] belongs to keys[i]. Must be at least as long as keys.</param>
+    template <size_t GroupSize = kLookupGroup> void GetValues(std::span<const KeyType> keys, std::span<std::optional<ValueType>> values) const;
+
     /// <summary>
     /// Clear all elements from red-black tree.
     /// </summary>
     void Clear();
 
+    /// <summary>
+    /// Replace all elements of red-black tree with a range of key-value pairs.
+    /// A range sorted by key is linked bottom-up in O(n): nodes are allocated in key order, and only the last,
+    /// partial level is colored red. Of equivalent keys the first element is kept. An unsorted range falls back to Insert.
+    /// </summary>
+    /// <param name="first">The first element.</param>
+    /// <param name="last">The end of the range.</param>
+    template <std::forward_iterator It> void BuildFromSorted(It first, It last);
+
     /// <summary>
     /// Get empty status of red-black tree.
     /// </summary>
@@ -102,86 +669,983 @@ public:
     /// <returns>The size.</returns>
     [[nodiscard]] auto Size() const -> size_t { return size_; }
 
-    /**
-     * For Debug only.
-     */
-
     /// <summary>
-    /// Print red black tree.
+    /// Get a copy of the allocator of red-black tree.
     /// </summary>
-    void PrintTree();
+    /// <returns>The allocator.</returns>
+    [[nodiscard]] auto GetAllocator() const -> Allocator { return Allocator(node_allocator_); }
 
     /// <summary>
-    /// Check 3(actual and original 4) rules in red-black-tree.
+    /// Walk the tree and collect its shape and size, along with the counters of StatisticsPolicy. O(n).
     /// </summary>
-    /// <returns>True for check success.</returns>
-    bool RedBlackTreeRulesCheck();
+    /// <returns>The statistics.</returns>
+    [[nodiscard]] auto Stats() const -> TreeStats;
 
-private:
-    RedBlackTreeNode* root_ = nullptr;
-    size_t size_ = 0;
-    KeyComparator key_comparator_{};
+    /**
+     * Split, join and set operations.
+     * They relink the existing nodes along O(log n) paths and never copy or allocate an element, apart from the middle
+     * element of Join. The result takes the comparator and the allocator of the first operand. Elements of an operand
+     * with an unequal allocator are moved into new nodes first. Not available with NodeLayout::Index32, whose nodes
+     * belong to the index space of their tree.
+     */
 
     /// <summary>
-    /// Handle reorient for red-black tree.
+    /// Move all elements into two trees by key. The tree is left empty.
+    /// O(log n) with Policy::kOrderStatistics, otherwise O(log n + min(|L|, |R|)) since the smaller tree is counted for the sizes.
+    /// Both trees keep their nodes in the allocator of this tree, so with NodePoolAllocator they share one pool until joined again.
     /// </summary>
-    /// <param name="grand_grand_parent_node"></param>
-    /// <param name="grand_parent_node"></param>
-    /// <param name="parent_node"></param>
-    /// <param name="node"></param>
-    void HandleReorient(RedBlackTreeNode* grand_grand_parent_node, RedBlackTreeNode* grand_parent_node, RedBlackTreeNode* parent_node, RedBlackTreeNode* node);
+    /// <param name="key">The key.</param>
+    /// <returns>The tree of the keys less than key, and the tree of the other keys.</returns>
+    auto Split(const KeyType& key) -> std::pair<RedBlackTree, RedBlackTree>
+        requires(kNodeLayout != NodeLayout::Index32);
 
     /// <summary>
-    /// Handle rotation between root node and sup node,
-    /// which sup is one child of root.
+    /// Join two trees and a key-value pair between them into one tree in O(|log n - log m|).
     /// </summary>
-    /// <param name="root">The root.</param>
-    /// <param name="sup">The sup.</param>
-    /// <returns>The new root.</returns>
-    void HandleRotation(RedBlackTreeNode* root, RedBlackTreeNode* sup);
+    /// <param name="left">The tree of keys less than key, left empty.</param>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <param name="right">The tree of keys greater than key, left empty.</param>
+    /// <returns>The joined tree.</returns>
+    static auto Join(RedBlackTree&& left, const KeyType& key, const ValueType& value, RedBlackTree&& right) -> RedBlackTree
+        requires(kNodeLayout != NodeLayout::Index32);
 
     /// <summary>
-    /// Reconnect node and its new parent. If new_parent is nullptr, then node is the new root.
+    /// Concatenate two trees into one tree in O(log n + log m).
     /// </summary>
-    /// <param name="new_parent">The new parent.</param>
-    /// <param name="node">The node.</param>
-    void HandleReconnection(RedBlackTreeNode* new_parent, RedBlackTreeNode* node);
+    /// <param name="left">The tree of the smaller keys, left empty.</param>
+    /// <param name="right">The tree of the greater keys, left empty.</param>
+    /// <returns>The joined tree.</returns>
+    static auto Join(RedBlackTree&& left, RedBlackTree&& right) -> RedBlackTree
+        requires(kNodeLayout != NodeLayout::Index32);
 
     /// <summary>
-    /// Check if a node's color is black.
+    /// Merge two trees into the tree of the keys in either of them, in O(m log(n / m + 1)) for sizes m <= n.
+    /// Of keys in both trees the element of lhs is kept and the one of rhs is destroyed.
+    /// The root of one tree splits the other one, and both halves are merged independently. Given a pool, halves of
+    /// large trees are merged in parallel, then the allocator must tolerate being used from several threads at once.
     /// </summary>
-    /// <param name="node">The node.</param>
-    /// <param name="can_be_null">Whether this node can be a black null node</param>
-    /// <returns>True for node is black.</returns>
-    bool IsBlackNode(RedBlackTreeNode* node, bool can_be_null = true)
+    /// <param name="lhs">The first tree, left empty.</param>
+    /// <param name="rhs">The second tree, left empty.</param>
+    /// <param name="pool">The thread pool, or nullptr to run on the calling thread.</param>
+    /// <returns>The merged tree.</returns>
+    static auto Union(RedBlackTree&& lhs, RedBlackTree&& rhs, ThreadPool* pool = nullptr) -> RedBlackTree
+        requires(kNodeLayout != NodeLayout::Index32)
     {
-        return can_be_null ? !node || node->Color == ColorType::Black : node && node->Color == ColorType::Black;
+        return Merge<SetOperation::Union>(std::move(lhs), std::move(rhs), pool);
     }
 
     /// <summary>
-    /// Compute all black path height of the red-black-tree.
+    /// Merge two trees into the tree of the keys in both of them with the elements of lhs, see Union.
     /// </summary>
-    /// <param name="root">The root.</param>
-    /// <param name="current_black_height">The current black height.</param>
-    /// <param name="all_black_height">All black height array.</param>
-    void ComputeAllBlackPathHeight(RedBlackTreeNode* root, const int current_black_height, std::vector<int>& all_black_height)
+    /// <param name="lhs">The first tree, left empty.</param>
+    /// <param name="rhs">The second tree, left empty.</param>
+    /// <param name="pool">The thread pool, or nullptr to run on the calling thread.</param>
+    /// <returns>The merged tree.</returns>
+    static auto Intersection(RedBlackTree&& lhs, RedBlackTree&& rhs, ThreadPool* pool = nullptr) -> RedBlackTree
+        requires(kNodeLayout != NodeLayout::Index32)
+    {
+        return Merge<SetOperation::Intersection>(std::move(lhs), std::move(rhs), pool);
+    }
+
+    /// <summary>
+    /// Merge two trees into the tree of the keys of lhs that are not in rhs, see Union.
+    /// </summary>
+    /// <param name="lhs">The first tree, left empty.</param>
+    /// <param name="rhs">The second tree, left empty.</param>
+    /// <param name="pool">The thread pool, or nullptr to run on the calling thread.</param>
+    /// <returns>The merged tree.</returns>
+    static auto Difference(RedBlackTree&& lhs, RedBlackTree&& rhs, ThreadPool* pool = nullptr) -> RedBlackTree
+        requires(kNodeLayout != NodeLayout::Index32)
+    {
+        return Merge<SetOperation::Difference>(std::move(lhs), std::move(rhs), pool);
+    }
+
+    /**
+     * Iteration in key order.
+     */
+
+    auto begin() -> iterator { return First<iterator>(this); }
+
+    auto end() -> iterator { return iterator(this); }
+
+    auto begin() const -> const_iterator { return First<const_iterator>(this); }
+
+    auto end() const -> const_iterator { return const_iterator(this); }
+
+    auto cbegin() const -> const_iterator { return begin(); }
+
+    auto cend() const -> const_iterator { return end(); }
+
+    auto rbegin() -> reverse_iterator { return reverse_iterator(end()); }
+
+    auto rend() -> reverse_iterator { return reverse_iterator(begin()); }
+
+    auto rbegin() const -> const_reverse_iterator { return const_reverse_iterator(end()); }
+
+    auto rend() const -> const_reverse_iterator { return const_reverse_iterator(begin()); }
+
+    auto crbegin() const -> const_reverse_iterator { return rbegin(); }
+
+    auto crend() const -> const_reverse_iterator { return rend(); }
+
+    /**
+     * Ordered queries.
+     */
+
+    /// <summary>
+    /// Get the first element whose key is not less than the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The iterator, or end() if there is no such element.</returns>
+    auto LowerBound(const KeyType& key) -> iterator;
+
+    auto LowerBound(const KeyType& key) const -> const_iterator;
+
+    /// <summary>
+    /// Get the first element whose key is greater than the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The iterator, or end() if there is no such element.</returns>
+    auto UpperBound(const KeyType& key) -> iterator;
+
+    auto UpperBound(const KeyType& key) const -> const_iterator;
+
+    /// <summary>
+    /// Get the range of elements whose key is equivalent to the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The pair of LowerBound(key) and UpperBound(key).</returns>
+    auto EqualRange(const KeyType& key) -> std::pair<iterator, iterator> { return {LowerBound(key), UpperBound(key)}; }
+
+    auto EqualRange(const KeyType& key) const -> std::pair<const_iterator, const_iterator> { return {LowerBound(key), UpperBound(key)}; }
+
+    /// <summary>
+    /// Get the element with the greatest key not greater than the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The iterator, or end() if there is no such element.</returns>
+    auto Floor(const KeyType& key) -> iterator;
+
+    auto Floor(const KeyType& key) const -> const_iterator;
+
+    /// <summary>
+    /// Get the element with the smallest key not less than the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The iterator, or end() if there is no such element.</returns>
+    auto Ceiling(const KeyType& key) -> iterator { return LowerBound(key); }
+
+    auto Ceiling(const KeyType& key) const -> const_iterator { return LowerBound(key); }
+
+    /// <summary>
+    /// Visit every element with key in [lo, hi) in key order.
+    /// Subtrees outside the range are never entered and no memory is allocated.
+    /// The visitor is called with (key, value) and may return false to stop the scan early.
+    /// </summary>
+    /// <param name="lo">The inclusive lower key.</param>
+    /// <param name="hi">The exclusive upper key.</param>
+    /// <param name="visitor">The visitor.</param>
+    /// <returns>The number of visited elements.</returns>
+    template <typename Visitor>
+        requires std::invocable<Visitor&, const KeyType&, MappedReference>
+    auto RangeScan(const KeyType& lo, const KeyType& hi, Visitor&& visitor) -> size_t
+    {
+        return Scan<iterator>(this, lo, hi, visitor);
+    }
+
+    template <typename Visitor>
+        requires std::invocable<Visitor&, const KeyType&, const ValueType&>
+    auto RangeScan(const KeyType& lo, const KeyType& hi, Visitor&& visitor) const -> size_t
+    {
+        return Scan<const_iterator>(this, lo, hi, visitor);
+    }
+
+    /**
+     * Order statistics, available when Policy::kOrderStatistics is set.
+     */
+
+    /// <summary>
+    /// Get the number of elements whose key is less than the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The rank.</returns>
+    auto Rank(const KeyType& key) const -> size_t
+        requires Policy::kOrderStatistics;
+
+    /// <summary>
+    /// Get the element with the given zero-based position in key order.
+    /// </summary>
+    /// <param name="k">The position.</param>
+    /// <returns>The iterator, or end() if k is not less than Size().</returns>
+    auto Select(size_t k) -> iterator
+        requires Policy::kOrderStatistics
+    {
+        return SelectNode<iterator>(this, k);
+    }
+
+    auto Select(size_t k) const -> const_iterator
+        requires Policy::kOrderStatistics
+    {
+        return SelectNode<const_iterator>(this, k);
+    }
+
+    /// <summary>
+    /// Get the number of elements with key in [lo, hi).
+    /// </summary>
+    /// <param name="lo">The inclusive lower key.</param>
+    /// <param name="hi">The exclusive upper key.</param>
+    /// <returns>The count.</returns>
+    auto CountInRange(const KeyType& lo, const KeyType& hi) const -> size_t
+        requires Policy::kOrderStatistics
+    {
+        const size_t lo_rank = Rank(lo);
+        const size_t hi_rank = Rank(hi);
+        return hi_rank > lo_rank ? hi_rank - lo_rank : 0;
+    }
+
+    /**
+     * Subtree aggregates, available when Policy::Aggregate is set.
+     */
+
+    /// <summary>
+    /// Combine all elements with key in [lo, hi) in key order.
+    /// </summary>
+    /// <param name="lo">The inclusive lower key.</param>
+    /// <param name="hi">The exclusive upper key.</param>
+    /// <returns>The aggregate, or the identity if the range is empty.</returns>
+    auto Aggregate(const KeyType& lo, const KeyType& hi) const -> AggregateType
+        requires kHasAggregate;
+
+    /// <summary>
+    /// Combine all elements of red-black tree.
+    /// </summary>
+    /// <returns>The aggregate, or the identity if the tree is empty.</returns>
+    auto Aggregate() const -> AggregateType
+        requires kHasAggregate
+    {
+        return SubtreeAggregate(root_);
+    }
+
+    /**
+     * For Debug only.
+     */
+
+    /// <summary>
+    /// Print red black tree level by level, one line per level.
+    /// </summary>
+    /// <param name="os">The output stream.</param>
+    void PrintTree(std::ostream& os) const;
+
+    /// <summary>
+    /// Check 3(actual and original 4) rules in red-black-tree.
+    /// </summary>
+    /// <returns>True for check success.</returns>
+    bool RedBlackTreeRulesCheck();
+
+private:
+    // The lock coupling mode walks and restructures the nodes itself.
+    template <typename, typename, LockMode, class, class, class> friend class ConcurrentRedBlackTree;
+
+    RedBlackTreeNode* root_ = nullptr;
+    size_t size_ = 0;
+    KeyComparator key_comparator_{};
+    [[no_unique_address]] NodeAllocator node_allocator_{};
+    [[no_unique_address]] std::conditional_t<kNodeLayout == NodeLayout::Index32, IndexArena, EmptyMetadata<2>> index_arena_{};
+
+    /// <summary>
+    /// Get the iterator to the smallest key.
+    /// </summary>
+    /// <param name="tree">The tree.</param>
+    /// <returns>The iterator.</returns>
+    template <typename It, typename TreePointer> static auto First(TreePointer tree) -> It
+    {
+        It it(tree);
+        it.PushLeftSpine(tree->root_);
+        return it;
+    }
+
+    /// <summary>
+    /// Descend to the first element whose key is not less than (or greater than) the given key.
+    /// </summary>
+    /// <param name="tree">The tree.</param>
+    /// <param name="key">The key.</param>
+    /// <param name="is_upper">False for lower bound, true for upper bound.</param>
+    /// <returns>The iterator.</returns>
+    template <typename It, typename TreePointer, typename K> static auto Bound(TreePointer tree, const K& key, bool is_upper) -> It;
+
+    /// <summary>
+    /// Get the iterator to the element with the given key.
+    /// </summary>
+    /// <param name="tree">The tree.</param>
+    /// <param name="key">The key.</param>
+    /// <returns>The iterator, or the end iterator if there is no such element.</returns>
+    template <typename It, typename TreePointer, typename K> static auto FindBound(TreePointer tree, const K& key) -> It
+    {
+        It it = Bound<It>(tree, key, false);
+        if (it.depth_ && tree->Less(key, it.Node()->Key)) {
+            it.depth_ = 0;
+        }
+        return it;
+    }
+
+    /// <summary>
+    /// Get the node holding the given key, comparing with KeyComparator only.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The node, or nullptr if there is no such node.</returns>
+    template <typename K> auto FindNode(const K& key) const -> RedBlackTreeNode*;
+
+    /// <summary>
+    /// Call a visitor with (key, value) of a node.
+    /// </summary>
+    /// <param name="node">The node, may be null.</param>
+    /// <param name="visitor">The visitor.</param>
+    /// <returns>True for the node is not null.</returns>
+    template <typename Reference, typename Visitor> static bool VisitNode(RedBlackTreeNode* node, Visitor& visitor)
+    {
+        if (!node) {
+            return false;
+        }
+        std::invoke(visitor, std::as_const(node->Key), static_cast<Reference>(node->Value));
+        return true;
+    }
+
+    /// <summary>
+    /// Descend to the element with the greatest key not greater than the given key.
+    /// </summary>
+    /// <param name="tree">The tree.</param>
+    /// <param name="key">The key.</param>
+    /// <returns>The iterator.</returns>
+    template <typename It, typename TreePointer> static auto FloorBound(TreePointer tree, const KeyType& key) -> It;
+
+    /// <summary>
+    /// Scan [lo, hi) starting from the lower bound of lo.
+    /// </summary>
+    /// <param name="tree">The tree.</param>
+    /// <param name="lo">The inclusive lower key.</param>
+    /// <param name="hi">The exclusive upper key.</param>
+    /// <param name="visitor">The visitor.</param>
+    /// <returns>The number of visited elements.</returns>
+    template <typename It, typename TreePointer, typename Visitor> static auto Scan(TreePointer tree, const KeyType& lo, const KeyType& hi, Visitor& visitor) -> size_t;
+
+    /// <summary>
+    /// Descend to the element with the given zero-based position in key order.
+    /// </summary>
+    /// <param name="tree">The tree.</param>
+    /// <param name="k">The position.</param>
+    /// <returns>The iterator.</returns>
+    template <typename It, typename TreePointer> static auto SelectNode(TreePointer tree, size_t k) -> It;
+
+    /// <summary>
+    /// Get the subtree size of a node, null node has size 0.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <returns>The subtree size.</returns>
+    static auto SubtreeSize(const RedBlackTreeNode* node) -> size_t
+        requires Policy::kOrderStatistics
+    {
+        return node ? node->Size : 0;
+    }
+
+    /// <summary>
+    /// Recompute the augmented data of a node from its children.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    void UpdateNode(RedBlackTreeNode* node) const
+    {
+        if constexpr (Policy::kOrderStatistics) {
+            node->Size = 1 + SubtreeSize(Left(node)) + SubtreeSize(Right(node));
+        }
+        if constexpr (kHasAggregate) {
+            node->Agg = AggregatePolicyType::Combine(node->Key, node->Value, SubtreeAggregate(Left(node)), SubtreeAggregate(Right(node)));
+        }
+    }
+
+    /// <summary>
+    /// Get the aggregate of a subtree, null node has the identity.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <returns>The aggregate.</returns>
+    static auto SubtreeAggregate(const RedBlackTreeNode* node) -> AggregateType
+        requires kHasAggregate
+    {
+        return node ? node->Agg : AggregatePolicyType::Identity();
+    }
+
+    /// <summary>
+    /// Find the node holding the key, or create one with make_node and link it in.
+    /// The key must stay valid until the node is created, afterwards only the key of the new node is used.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="make_node">Called without arguments to create the node if the key is absent.</param>
+    /// <returns>The node holding the key, and true if it was created.</returns>
+    template <typename MakeNode> auto InsertNode(const KeyType& key, MakeNode&& make_node) -> std::pair<RedBlackTreeNode*, bool>;
+
+    /// <summary>
+    /// Assign the value of a node InsertNode found.
+    /// </summary>
+    /// <param name="result">The result of InsertNode.</param>
+    /// <param name="value">The value, untouched if the node was created.</param>
+    /// <returns>True for the node was created.</returns>
+    template <typename V> bool AssignNode(const std::pair<RedBlackTreeNode*, bool>& result, V&& value)
+    {
+        const auto [node, inserted] = result;
+        if (!inserted) {
+            node->Value = std::forward<V>(value);
+            if constexpr (kHasAggregate) {
+                UpdatePath(node->Key);
+            }
+        }
+        return inserted;
+    }
+
+    /// <summary>
+    /// Recompute the augmented data along the path to the node holding the key, or to the predecessor slot
+    /// below it, after a node was linked or unlinked there.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    void UpdatePath(const KeyType& key);
+
+    /// <summary>
+    /// Build a balanced subtree from the next count unique elements of a sorted range.
+    /// </summary>
+    /// <param name="it">The next element, advanced past the consumed elements.</param>
+    /// <param name="last">The end of the range.</param>
+    /// <param name="count">The number of unique elements.</param>
+    /// <param name="depth">The depth of the subtree root.</param>
+    /// <param name="red_depth">The depth of the last, partial level.</param>
+    /// <returns>The subtree root.</returns>
+    template <std::forward_iterator It> auto BuildSubtree(It& it, const It& last, size_t count, size_t depth, size_t red_depth) -> RedBlackTreeNode*;
+
+    /// <summary>
+    /// Link nodes given in key order into a balanced subtree, coloring only the last, partial level red.
+    /// </summary>
+    /// <param name="nodes">The nodes in key order.</param>
+    /// <param name="count">The number of nodes.</param>
+    /// <param name="depth">The depth of the subtree root.</param>
+    /// <param name="red_depth">The depth of the last, partial level.</param>
+    /// <returns>The subtree root.</returns>
+    auto LinkSubtree(RedBlackTreeNode* const* nodes, size_t count, size_t depth, size_t red_depth) -> RedBlackTreeNode*;
+
+    /// <summary>
+    /// Relink all nodes given in key order into a balanced tree.
+    /// </summary>
+    /// <param name="nodes">The nodes in key order.</param>
+    void Relink(const std::vector<RedBlackTreeNode*>& nodes);
+
+    /// <summary>
+    /// Get all nodes in key order.
+    /// </summary>
+    /// <returns>The nodes.</returns>
+    auto CollectNodes() const -> std::vector<RedBlackTreeNode*>;
+
+    /// <summary>
+    /// Check whether a batch is better merged with the whole tree than applied key by key,
+    /// i.e. whether m descents of O(log n) cost more than one O(n + m) pass.
+    /// </summary>
+    /// <param name="batch_size">The batch size.</param>
+    /// <returns>True for merging.</returns>
+    [[nodiscard]] bool IsBulkBatch(const size_t batch_size) const { return batch_size * static_cast<size_t>(std::bit_width(size_)) >= size_; }
+
+    /// <summary>
+    /// Move the elements of a tree with an unequal allocator into new nodes of this empty tree, the other tree is cleared.
+    /// If a node can not be created, the elements are moved back and the other tree is left as it was.
+    /// </summary>
+    /// <param name="other">The other tree.</param>
+    void MoveElements(RedBlackTree& other);
+
+    /**
+     * Split and join on detached subtrees, following Blelloch et al., "Just Join for Parallel Ordered Sets".
+     */
+
+    enum class SetOperation
+    {
+        Union,
+        Intersection,
+        Difference
+    };
+
+    /**
+     * Subtree detached from any tree, with the number of black nodes on every path from its root down to null.
+     * The root may be red.
+     */
+    struct Subtree
+    {
+        RedBlackTreeNode* Root = nullptr;
+        int BlackHeight = 0;
+    };
+
+    struct SplitResult
+    {
+        Subtree Left;
+        RedBlackTreeNode* Equal = nullptr;
+        Subtree Right;
+    };
+
+    /// <summary>
+    /// Get a tree holding the elements of another tree, with the comparator and in nodes of the allocator of this tree.
+    /// </summary>
+    /// <param name="other">The other tree, left empty.</param>
+    /// <returns>The tree.</returns>
+    auto Adopt(RedBlackTree&& other) -> RedBlackTree;
+
+    /// <summary>
+    /// Take all nodes out of the tree, which is left empty.
+    /// </summary>
+    /// <returns>The detached nodes.</returns>
+    auto DetachRoot() -> Subtree;
+
+    /// <summary>
+    /// Make a detached subtree the content of this empty tree, blackening its root.
+    /// </summary>
+    /// <param name="tree">The subtree.</param>
+    /// <param name="size">The number of nodes in it.</param>
+    void AttachRoot(Subtree tree, size_t size);
+
+    /// <summary>
+    /// Get the children of a subtree root as subtrees.
+    /// </summary>
+    /// <param name="tree">The subtree, not empty.</param>
+    /// <returns>The left and right subtrees.</returns>
+    auto Expose(Subtree tree) const -> std::pair<Subtree, Subtree>
+    {
+        const int child_height = tree.BlackHeight - (GetColor(tree.Root) == ColorType::Black ? 1 : 0);
+        return {{Left(tree.Root), child_height}, {Right(tree.Root), child_height}};
+    }
+
+    /// <summary>
+    /// Link two subtrees and a node whose key lies between them into one subtree.
+    /// The taller subtree is descended along its inner spine to a black node as high as the other subtree,
+    /// the middle node takes that place in red and red-red violations are rotated away on the way back.
+    /// </summary>
+    /// <param name="left">The subtree of the smaller keys.</param>
+    /// <param name="middle">The middle node, its links are overwritten.</param>
+    /// <param name="right">The subtree of the greater keys.</param>
+    /// <returns>The joined subtree.</returns>
+    auto JoinNodes(Subtree left, RedBlackTreeNode* middle, Subtree right) -> Subtree;
+
+    /// <summary>
+    /// Join the right subtree into the right spine of the taller left subtree.
+    /// </summary>
+    /// <param name="node">The current node of the left subtree, may be null.</param>
+    /// <param name="height">The black height of the current node.</param>
+    /// <param name="middle">The middle node.</param>
+    /// <param name="right">The right subtree, its root is black.</param>
+    /// <returns>The new current node, may be red with a red right child.</returns>
+    auto JoinRight(RedBlackTreeNode* node, int height, RedBlackTreeNode* middle, Subtree right) -> RedBlackTreeNode*;
+
+    /// <summary>
+    /// Join the left subtree into the left spine of the taller right subtree, see JoinRight.
+    /// </summary>
+    auto JoinLeft(Subtree left, RedBlackTreeNode* middle, RedBlackTreeNode* node, int height) -> RedBlackTreeNode*;
+
+    /// <summary>
+    /// Concatenate two subtrees, using the last node of the left one as the middle node.
+    /// </summary>
+    /// <param name="left">The subtree of the smaller keys.</param>
+    /// <param name="right">The subtree of the greater keys.</param>
+    /// <returns>The joined subtree.</returns>
+    auto JoinSubtrees(Subtree left, Subtree right) -> Subtree;
+
+    /// <summary>
+    /// Split a subtree by key.
+    /// </summary>
+    /// <param name="tree">The subtree.</param>
+    /// <param name="key">The key.</param>
+    /// <returns>The subtrees of the smaller and the greater keys, and the node with the key or nullptr.</returns>
+    auto SplitNodes(Subtree tree, const KeyType& key) -> SplitResult;
+
+    /// <summary>
+    /// Take the last node out of a subtree.
+    /// </summary>
+    /// <param name="tree">The subtree, not empty.</param>
+    /// <returns>The remaining subtree and the last node.</returns>
+    auto SplitLast(Subtree tree) -> std::pair<Subtree, RedBlackTreeNode*>;
+
+    /// <summary>
+    /// Merge two detached subtrees. Nodes dropped by the operation are destroyed.
+    /// </summary>
+    /// <param name="lhs">The first subtree.</param>
+    /// <param name="rhs">The second subtree.</param>
+    /// <param name="pool">The thread pool, may be null.</param>
+    /// <param name="matches">Increased by the number of keys in both subtrees.</param>
+    /// <returns>The merged subtree.</returns>
+    template <SetOperation Operation> auto MergeNodes(Subtree lhs, Subtree rhs, ThreadPool* pool, size_t& matches) -> Subtree;
+
+    /// <summary>
+    /// Insert a batch of entries into a detached subtree, splitting it at the middle key of the batch.
+    /// Nodes are only created for keys the subtree does not hold. After a throwing creation no further nodes are
+    /// created, the error is stored and the subtree is still returned whole.
+    /// </summary>
+    /// <param name="tree">The subtree.</param>
+    /// <param name="entries">The entries, sorted by key without equivalent keys.</param>
+    /// <param name="created">Appended with the created nodes.</param>
+    /// <param name="error">Set to the first exception of a node creation.</param>
+    /// <returns>The subtree with the new nodes.</returns>
+    auto InsertNodes(Subtree tree, std::span<const std::pair<KeyType, ValueType>* const> entries, std::vector<RedBlackTreeNode*>& created,
+                     std::exception_ptr& error) -> Subtree;
+
+    /// <summary>
+    /// Erase the nodes of a batch of keys from a detached subtree, splitting it at the middle key of the batch.
+    /// </summary>
+    /// <param name="tree">The subtree.</param>
+    /// <param name="keys">The keys, sorted.</param>
+    /// <param name="erased">Increased by the number of erased nodes.</param>
+    /// <returns>The remaining subtree.</returns>
+    auto EraseNodes(Subtree tree, std::span<const KeyType* const> keys, size_t& erased) -> Subtree;
+
+    /// <summary>
+    /// Merge two trees, see Union.
+    /// </summary>
+    template <SetOperation Operation> static auto Merge(RedBlackTree&& lhs, RedBlackTree&& rhs, ThreadPool* pool) -> RedBlackTree;
+
+    /// <summary>
+    /// Destroy all nodes of a subtree.
+    /// </summary>
+    /// <param name="root">The subtree root.</param>
+    void DestroySubtree(RedBlackTreeNode* root) noexcept;
+
+    /// <summary>
+    /// Allocate and construct a red node.
+    /// </summary>
+    /// <param name="key">The key or the argument to construct it from.</param>
+    /// <param name="args">The arguments to construct the value from.</param>
+    /// <returns>The new node.</returns>
+    template <typename K, typename... Args> auto CreateNode(K&& key, Args&&... args) -> RedBlackTreeNode*;
+
+    /// <summary>
+    /// Destroy and deallocate a node.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    void DestroyNode(RedBlackTreeNode* node) noexcept;
+
+    /// <summary>
+    /// Handle reorient for red-black tree.
+    /// </summary>
+    /// <param name="grand_grand_parent_node"></param>
+    /// <param name="grand_parent_node"></param>
+    /// <param name="parent_node"></param>
+    /// <param name="node"></param>
+    void HandleReorient(RedBlackTreeNode* grand_grand_parent_node, RedBlackTreeNode* grand_parent_node, RedBlackTreeNode* parent_node, RedBlackTreeNode* node);
+
+    /// <summary>
+    /// Handle rotation between root node and sup node,
+    /// which sup is one child of root.
+    /// </summary>
+    /// <param name="root">The root.</param>
+    /// <param name="sup">The sup.</param>
+    /// <returns>The new root.</returns>
+    void HandleRotation(RedBlackTreeNode* root, RedBlackTreeNode* sup);
+
+    /// <summary>
+    /// Reconnect node and its new parent. If new_parent is nullptr, then node is the new root.
+    /// </summary>
+    /// <param name="new_parent">The new parent.</param>
+    /// <param name="node">The node.</param>
+    void HandleReconnection(RedBlackTreeNode* new_parent, RedBlackTreeNode* node);
+
+    /// <summary>
+    /// Get the left child of a node.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <returns>The left child, may be null.</returns>
+    auto Left(const RedBlackTreeNode* node) const -> RedBlackTreeNode*
+    {
+        if constexpr (kNodeLayout == NodeLayout::Pointer) {
+            return LoadLink(node->Links.Left);
+        } else if constexpr (kNodeLayout == NodeLayout::PackedColor) {
+            return reinterpret_cast<RedBlackTreeNode*>(LoadLink(node->Links.LeftAndColor) & ~std::uintptr_t{1}); // NOLINT
+        } else {
+            return NodeAt(LoadLink(node->Links.LeftAndColor) & ~kIndexColorBit);
+        }
+    }
+
+    /// <summary>
+    /// Get the right child of a node.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <returns>The right child, may be null.</returns>
+    auto Right(const RedBlackTreeNode* node) const -> RedBlackTreeNode*
+    {
+        if constexpr (kNodeLayout == NodeLayout::Index32) {
+            return NodeAt(LoadLink(node->Links.Right));
+        } else {
+            return LoadLink(node->Links.Right);
+        }
+    }
+
+    /// <summary>
+    /// Set the left child of a node.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <param name="child">The child, may be null.</param>
+    void SetLeft(RedBlackTreeNode* node, RedBlackTreeNode* child)
+    {
+        if constexpr (kNodeLayout == NodeLayout::Pointer) {
+            StoreLink(node->Links.Left, child);
+        } else if constexpr (kNodeLayout == NodeLayout::PackedColor) {
+            StoreLink(node->Links.LeftAndColor, reinterpret_cast<std::uintptr_t>(child) | (node->Links.LeftAndColor & 1)); // NOLINT
+        } else {
+            StoreLink(node->Links.LeftAndColor, IndexOf(child) | (node->Links.LeftAndColor & kIndexColorBit));
+        }
+    }
+
+    /// <summary>
+    /// Set the right child of a node.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <param name="child">The child, may be null.</param>
+    void SetRight(RedBlackTreeNode* node, RedBlackTreeNode* child)
+    {
+        if constexpr (kNodeLayout == NodeLayout::Index32) {
+            StoreLink(node->Links.Right, IndexOf(child));
+        } else {
+            StoreLink(node->Links.Right, child);
+        }
+    }
+
+    /// <summary>
+    /// Get the color of a node.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <returns>The color.</returns>
+    static auto GetColor(const RedBlackTreeNode* node) -> ColorType
+    {
+        if constexpr (kNodeLayout == NodeLayout::Pointer) {
+            return node->Links.Color;
+        } else if constexpr (kNodeLayout == NodeLayout::PackedColor) {
+            return static_cast<ColorType>(node->Links.LeftAndColor & 1);
+        } else {
+            return static_cast<ColorType>(node->Links.LeftAndColor >> 31);
+        }
+    }
+
+    /// <summary>
+    /// Set the color of a node.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <param name="color">The color.</param>
+    static void SetColor(RedBlackTreeNode* node, const ColorType color)
+    {
+        if constexpr (kNodeLayout == NodeLayout::Pointer) {
+            node->Links.Color = color;
+        } else if constexpr (kNodeLayout == NodeLayout::PackedColor) {
+            StoreLink(node->Links.LeftAndColor, (node->Links.LeftAndColor & ~std::uintptr_t{1}) | static_cast<std::uintptr_t>(color));
+        } else {
+            StoreLink(node->Links.LeftAndColor, (node->Links.LeftAndColor & ~kIndexColorBit) | static_cast<std::uint32_t>(color) << 31);
+        }
+    }
+
+    /// <summary>
+    /// Read a link word or the root pointer, through a relaxed atomic load with Policy::kAtomicLinks.
+    /// The writer of a word holds its latch, so its own plain reads of the word never race.
+    /// </summary>
+    /// <param name="link">The link.</param>
+    /// <returns>The value of the link.</returns>
+    template <typename T> static auto LoadLink(const T& link) -> T
+    {
+        if constexpr (kAtomicLinks) {
+            return std::atomic_ref<T>(const_cast<T&>(link)).load(std::memory_order_relaxed); // NOLINT
+        } else {
+            return link;
+        }
+    }
+
+    /// <summary>
+    /// Write a link word or the root pointer, through a relaxed atomic store with Policy::kAtomicLinks.
+    /// </summary>
+    /// <param name="link">The link.</param>
+    /// <param name="value">The new value.</param>
+    template <typename T> static void StoreLink(T& link, const std::type_identity_t<T> value)
+    {
+        if constexpr (kAtomicLinks) {
+            std::atomic_ref<T>(link).store(value, std::memory_order_relaxed);
+        } else {
+            link = value;
+        }
+    }
+
+    /// <summary>
+    /// Get the Index32 node with the given index.
+    /// </summary>
+    /// <param name="index">The index, 0 for null.</param>
+    /// <returns>The node.</returns>
+    auto NodeAt(const std::uint32_t index) const -> RedBlackTreeNode*
+        requires(kNodeLayout == NodeLayout::Index32)
+    {
+        return index ? index_arena_.Chunks[index >> kIndexSlotBits] + (index & ((std::uint32_t{1} << kIndexSlotBits) - 1)) : nullptr;
+    }
+
+    /// <summary>
+    /// Get the index of an Index32 node.
+    /// </summary>
+    /// <param name="node">The node, may be null.</param>
+    /// <returns>The index, 0 for null.</returns>
+    static auto IndexOf(const RedBlackTreeNode* node) -> std::uint32_t
+        requires(kNodeLayout == NodeLayout::Index32)
+    {
+        if (!node) {
+            return 0;
+        }
+        const auto* chunk = reinterpret_cast<const IndexChunk*>(reinterpret_cast<std::uintptr_t>(node) & ~(kIndexChunkBytes - 1)); // NOLINT
+        return chunk->Base + static_cast<std::uint32_t>(node - reinterpret_cast<const RedBlackTreeNode*>(chunk->Storage));          // NOLINT
+    }
+
+    /// <summary>
+    /// Allocate storage for one node.
+    /// </summary>
+    /// <returns>The storage.</returns>
+    auto AllocateNode() -> RedBlackTreeNode*;
+
+    /// <summary>
+    /// Deallocate the storage of a destroyed node.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    void DeallocateNode(RedBlackTreeNode* node) noexcept;
+
+    /// <summary>
+    /// Free all Index32 chunks at once. Every node handed out by them becomes invalid.
+    /// </summary>
+    void ReleaseChunks() noexcept;
+
+    /// <summary>
+    /// Check if a node's color is black.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <param name="can_be_null">Whether this node can be a black null node</param>
+    /// <returns>True for node is black.</returns>
+    bool IsBlackNode(RedBlackTreeNode* node, bool can_be_null = true)
+    {
+        return can_be_null ? !node || GetColor(node) == ColorType::Black : node && GetColor(node) == ColorType::Black;
+    }
+
+    /// <summary>
+    /// Count an event into the counters of the policy. Without counters this is empty.
+    /// </summary>
+    /// <param name="counter">The event.</param>
+    /// <param name="count">The number of events.</param>
+    static void Count(const Counter counter, const std::uint64_t count = 1)
+    {
+        if constexpr (kStatistics) {
+            CountersType::Add(counter, count);
+        }
+    }
+
+    /// <summary>
+    /// Report a step of Insert or Erase to the tracer of the policy. Without a tracer this is empty.
+    /// </summary>
+    /// <param name="event">The step.</param>
+    /// <param name="key">The key of the step.</param>
+    void Trace(const TraceEvent event, const KeyType& key) const
+    {
+        if constexpr (kTracing) {
+            static_assert(IsTracer<TracerType, RedBlackTree, KeyType>, "Policy::Tracer must satisfy IsTracer.");
+            TracerType::Trace(*this, event, key);
+        }
+    }
+
+    /// <summary>
+    /// Compute all black path height of the red-black-tree.
+    /// </summary>
+    /// <param name="root">The root.</param>
+    /// <param name="current_black_height">The current black height.</param>
+    /// <param name="all_black_height">All black height array.</param>
+    void ComputeAllBlackPathHeight(RedBlackTreeNode* root, const int current_black_height, std::vector<int>& all_black_height)
     {
         if (!root) {
             all_black_height.push_back(current_black_height);
             return;
         }
-        ComputeAllBlackPathHeight(root->Left, IsBlackNode(root, false) ? current_black_height + 1 : current_black_height, all_black_height);
-        ComputeAllBlackPathHeight(root->Right, IsBlackNode(root, false) ? current_black_height + 1 : current_black_height, all_black_height);
+        ComputeAllBlackPathHeight(Left(root), IsBlackNode(root, false) ? current_black_height + 1 : current_black_height, all_black_height);
+        ComputeAllBlackPathHeight(Right(root), IsBlackNode(root, false) ? current_black_height + 1 : current_black_height, all_black_height);
     }
 
-    /**
-     * Get the next node in the red-black tree based on the given key.
-     * 
-     * @param node The current node.
-     * @param key The key to compare with.
-     * @return The next node in the red-black tree.
-     */
-    auto NextNode(RedBlackTreeNode* node, const KeyType& key) const -> RedBlackTreeNode* { return key_comparator_(key, node->Key) ? node->Left : node->Right; }
+    /// <summary>
+    /// Hint the CPU to start loading a node into cache.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    static void PrefetchNode([[maybe_unused]] const RedBlackTreeNode* node)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(node);
+#endif
+    }
+
+    /// <summary>
+    /// Check whether a key is ordered before another one.
+    /// </summary>
+    /// <param name="lhs">The left key.</param>
+    /// <param name="rhs">The right key.</param>
+    /// <returns>True for lhs is less than rhs.</returns>
+    template <typename L, typename R> bool Less(const L& lhs, const R& rhs) const
+    {
+        Count(Counter::Comparisons);
+        if constexpr (kThreeWayComparator) {
+            return key_comparator_(lhs, rhs) < 0;
+        } else {
+            return key_comparator_(lhs, rhs);
+        }
+    }
+
+    /// <summary>
+    /// Order a key against another one, see kThreeWay.
+    /// </summary>
+    /// <param name="lhs">The left key.</param>
+    /// <param name="rhs">The right key.</param>
+    /// <returns>The ordering of lhs relative to rhs.</returns>
+    template <typename L, typename R> auto Compare(const L& lhs, const R& rhs) const -> std::weak_ordering
+    {
+        Count(Counter::Comparisons);
+        if constexpr (kThreeWayComparator) {
+            return key_comparator_(lhs, rhs);
+        } else if constexpr (kThreeWay && requires { { std::compare_three_way()(lhs, rhs) } -> std::convertible_to<std::weak_ordering>; }) {
+            return std::compare_three_way()(lhs, rhs);
+        } else if (key_comparator_(lhs, rhs)) {
+            return std::weak_ordering::less;
+        } else {
+            Count(Counter::Comparisons);
+            return key_comparator_(rhs, lhs) ? std::weak_ordering::greater : std::weak_ordering::equivalent;
+        }
+    }
 };
 
-} // namespace rbt
\ No newline at end of file
+namespace pmr
+{
+
+/**
+ * RedBlackTree using a polymorphic allocator, e.g. on top of std::pmr::monotonic_buffer_resource.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>, class Policy = DefaultTreePolicy>
+using RedBlackTree = rbt::RedBlackTree<KeyType, ValueType, KeyComparator, std::pmr::polymorphic_allocator<std::pair<const KeyType, ValueType>>, Policy>;
+
+} // namespace pmr
+
+/**
+ * RedBlackTree allocating its nodes from a private NodePool.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>, class Policy = DefaultTreePolicy>
+using PooledRedBlackTree = RedBlackTree<KeyType, ValueType, KeyComparator, NodePoolAllocator<std::pair<const KeyType, ValueType>>, Policy>;
+
+/**
+ * RedBlackTree with Rank, Select and CountInRange.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>>
+using OrderStatisticsTree = RedBlackTree<KeyType, ValueType, KeyComparator, std::allocator<std::pair<const KeyType, ValueType>>, OrderStatisticsPolicy>;
+
+/**
+ * RedBlackTree with 32-bit child indices, for many small entries.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>>
+using CompactRedBlackTree = RedBlackTree<KeyType, ValueType, KeyComparator, std::allocator<std::pair<const KeyType, ValueType>>, LayoutPolicy<NodeLayout::Index32>>;
+
+} // namespace rbt
+
+#include "red_black_tree.inl"
+
+#ifdef RBT_EXTERN_TEMPLATE
+namespace rbt
+{
+extern template class RedBlackTree<int, int>;
+} // namespace rbt
+#endif
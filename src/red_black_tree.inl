@@ -0,0 +1,1713 @@
+#pragma once
+
+/**
+ * Template definitions of RedBlackTree.
+ * This file is included at the end of red_black_tree.h, do not include it directly.
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <queue>
+#include <stack>
+#include <string>
+#include <vector>
+
+#include "debug_log.h"
+
+namespace rbt
+{
+
+/**
+ * #########################################################################
+ * #########################################################################
+ * ####################  RedBlackTree implementations.  ####################
+ * #########################################################################
+ * #########################################################################
+ */
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+bool RED_BLACK_TREE_TYPE::Insert(const KeyType& key, const ValueType& value)
+{
+    return InsertNode(key, [&] { return CreateNode(key, value); }).second;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename K, typename... Args>
+    requires std::constructible_from<KeyType, K> && std::constructible_from<ValueType, Args...>
+bool RED_BLACK_TREE_TYPE::Emplace(K&& key, Args&&... args)
+{
+    RedBlackTreeNode* new_node = CreateNode(std::forward<K>(key), std::forward<Args>(args)...);
+    try {
+        if (InsertNode(new_node->Key, [new_node] { return new_node; }).second) {
+            return true;
+        }
+    } catch (...) {
+        DestroyNode(new_node);
+        throw;
+    }
+    DestroyNode(new_node);
+    return false;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename MakeNode>
+auto RED_BLACK_TREE_TYPE::InsertNode(const KeyType& key, MakeNode&& make_node) -> std::pair<RedBlackTreeNode*, bool>
+{
+    Count(Counter::Inserts);
+    Trace(TraceEvent::BeforeInsert, key);
+
+    /**
+     * Insert key-value pair into red black tree.
+     */
+    // Find insertion place.
+    RedBlackTreeNode* node = root_;
+    RedBlackTreeNode* parent_node = nullptr;
+    RedBlackTreeNode* grand_parent_node = nullptr;
+    RedBlackTreeNode* grand_grand_parent_node = nullptr;
+    RedBlackTreeNode* candidate_node = nullptr;
+    bool is_left = false;
+    while (node) {
+        if constexpr (kThreeWay) {
+            const std::weak_ordering order = Compare(key, node->Key);
+            if (order == 0) {
+                return {node, false};
+            }
+            is_left = order < 0;
+        } else {
+            // One comparison per level, equality is only checked at the bottom against the last node not less than the key.
+            is_left = !Less(node->Key, key);
+            if (is_left) {
+                candidate_node = node;
+            }
+        }
+
+        // If node's left and right are red, need to reorient.
+        if (Left(node) && Right(node) && GetColor(Left(node)) == ColorType::Red && GetColor(Right(node)) == ColorType::Red) {
+            Count(Counter::Reorients);
+            HandleReorient(grand_grand_parent_node, grand_parent_node, parent_node, node);
+        }
+
+        grand_grand_parent_node = grand_parent_node;
+        grand_parent_node = parent_node;
+        parent_node = node;
+        node = is_left ? Left(node) : Right(node);
+    }
+    if constexpr (!kThreeWay) {
+        if (candidate_node && !Less(key, candidate_node->Key)) {
+            return {candidate_node, false};
+        }
+    }
+
+    // Insertion. The key may be moved into the node, only the node key is used from here on.
+    node = make_node();
+    size_++;
+    if (!root_) [[unlikely]] {
+        SetColor(node, ColorType::Black);
+        root_ = node;
+        Trace(TraceEvent::AfterInsert, node->Key);
+        return {node, true};
+    }
+
+    is_left ? SetLeft(parent_node, node) : SetRight(parent_node, node);
+
+    // Check whether reorient is required.
+    HandleReorient(grand_grand_parent_node, grand_parent_node, parent_node, node);
+    if constexpr (kAugmented) {
+        UpdatePath(node->Key);
+    }
+
+    Trace(TraceEvent::AfterInsert, node->Key);
+
+    return {node, true};
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::operator=(RedBlackTree&& other) noexcept(NodeAllocatorTraits::propagate_on_container_move_assignment::value
+                                                                   || NodeAllocatorTraits::is_always_equal::value) -> RedBlackTree&
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    Clear();
+    key_comparator_ = std::move(other.key_comparator_);
+    if constexpr (NodeAllocatorTraits::propagate_on_container_move_assignment::value) {
+        node_allocator_ = std::move(other.node_allocator_);
+    } else if (!(node_allocator_ == other.node_allocator_)) {
+        // Nodes of the other allocator can not be adopted, move the elements into new nodes instead.
+        MoveElements(other);
+        return *this;
+    }
+
+    root_ = std::exchange(other.root_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    index_arena_ = std::exchange(other.index_arena_, {});
+    return *this;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::Swap(RedBlackTree& other) noexcept
+{
+    using std::swap;
+    swap(root_, other.root_);
+    swap(size_, other.size_);
+    swap(key_comparator_, other.key_comparator_);
+    swap(index_arena_, other.index_arena_);
+    if constexpr (NodeAllocatorTraits::propagate_on_container_swap::value) {
+        swap(node_allocator_, other.node_allocator_);
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+bool RED_BLACK_TREE_TYPE::Erase(const KeyType& key)
+{
+    Count(Counter::Erases);
+    Trace(TraceEvent::BeforeErase, key);
+
+    const auto is_red_node = [](RedBlackTreeNode* n) { return n && GetColor(n) == ColorType::Red; };
+
+    const auto find_max_leaf_node = [this](RedBlackTreeNode* root) -> RedBlackTreeNode* {
+        while (Right(root)) {
+            root = Right(root);
+        }
+        return root;
+    };
+
+    const auto get_sibling_node = [this](RedBlackTreeNode* parent_node, RedBlackTreeNode* node) {
+        return parent_node ? (Left(parent_node) == node ? Right(parent_node) : Left(parent_node)) : nullptr;
+    };
+
+    if (!root_) {
+        return false;
+    }
+
+    /*
+     * Consider whether to recolor the root node to red first.
+     * If both left and right child are black, recolor root to red.
+     */
+    if (IsBlackNode(Left(root_)) && IsBlackNode(Right(root_))) {
+        SetColor(root_, ColorType::Red);
+        Count(Counter::EraseRecolors);
+        Trace(TraceEvent::EraseRecolor, root_->Key);
+    }
+
+    RedBlackTreeNode* node = root_;
+    RedBlackTreeNode* parent_node = nullptr;
+    RedBlackTreeNode* grand_parent_node = nullptr;
+    const KeyType* deleted_key = &key;
+    // Node whose entry is replaced by its predecessor, which is deleted instead.
+    RedBlackTreeNode* target_node = nullptr;
+
+    while (node) {
+        /*
+         * Recolor current node to red first.
+         */
+        if (GetColor(node) == ColorType::Black) {
+            RedBlackTreeNode* sibling_node = get_sibling_node(parent_node, node);
+
+            if (IsBlackNode(parent_node) && is_red_node(sibling_node)) {
+                HandleRotation(parent_node, sibling_node);
+                HandleReconnection(grand_parent_node, sibling_node);
+                SetColor(parent_node, ColorType::Red);
+                SetColor(sibling_node, ColorType::Black);
+
+                // Update sibling node and grand parent node.
+                grand_parent_node = sibling_node;
+                sibling_node = get_sibling_node(parent_node, node);
+            }
+
+            if (IsBlackNode(Left(node)) && IsBlackNode(Right(node))) {
+                // Sibling_node is black, both node left child and right child are black.
+                if (sibling_node && (is_red_node(Left(sibling_node)) || is_red_node(Right(sibling_node)))) {
+                    // Sibling_node is not null and at least one child of sibling_node is red.
+                    RedBlackTreeNode* sibling_node_red_child = IsBlackNode(Left(sibling_node)) ? Right(sibling_node) : Left(sibling_node);
+                    bool is_unique_rotate = true;
+
+                    // First rotation.
+                    if (!Less(parent_node->Key, node->Key) == !Less(sibling_node->Key, sibling_node_red_child->Key)) {
+                        HandleRotation(sibling_node, sibling_node_red_child);
+                        HandleReconnection(parent_node, sibling_node_red_child); // NOLINT
+                        is_unique_rotate = false;
+                        Count(Counter::EraseDoubleRotations);
+                    }
+
+                    // Second rotation.
+                    is_unique_rotate ? HandleRotation(parent_node, sibling_node) : HandleRotation(parent_node, sibling_node_red_child);
+                    is_unique_rotate ? HandleReconnection(grand_parent_node, sibling_node) : HandleReconnection(grand_parent_node, sibling_node_red_child);
+
+                    // Recolor.
+                    Count(Counter::EraseRecolors);
+                    SetColor(node, ColorType::Red);
+                    SetColor(parent_node, ColorType::Black);
+                    if (is_unique_rotate) {
+                        SetColor(sibling_node, ColorType::Red);
+                        SetColor(sibling_node_red_child, ColorType::Black);
+                    }
+                } else {
+                    // The sibling_node is black or both child of sibling_node are black.
+                    // Flip parent_node, node, sibling_node color.
+                    Count(Counter::EraseRecolors);
+                    SetColor(parent_node, ColorType::Black);
+                    SetColor(node, ColorType::Red);
+                    if (sibling_node) {
+                        SetColor(sibling_node, ColorType::Red);
+                    }
+                }
+            }
+        }
+
+        Trace(TraceEvent::EraseRecolor, node->Key);
+
+        /*
+         * Handle delete.
+         * Precondition: node is red.
+         */
+        const std::weak_ordering order = Compare(*deleted_key, node->Key);
+        if (order == 0) {
+            if (Left(node) && Right(node)) {
+                // Node has two children.
+                // Delete the predecessor node instead, its entry is moved into this node once it is unlinked.
+                const auto replaced_node = find_max_leaf_node(Left(node));
+                target_node = node;
+                deleted_key = &replaced_node->Key;
+
+                grand_parent_node = parent_node;
+                parent_node = node;
+                node = Left(node);
+                continue;
+            }
+
+            // Node has zero or one child.
+            // 1. If node has one child, node must be a black node, child node must be a red node.
+            // 2. If node has zero child, we previously make sure node is red.
+            RedBlackTreeNode* child_node = nullptr;
+            if (Left(node) || Right(node)) {
+                child_node = Left(node) ? Left(node) : Right(node);
+                SetColor(child_node, ColorType::Black);
+            }
+
+            if (node == root_) [[unlikely]] {
+                root_ = child_node;
+            } else [[likely]] {
+                if (!Less(parent_node->Key, node->Key)) {
+                    SetLeft(parent_node, child_node);
+                } else {
+                    SetRight(parent_node, child_node);
+                }
+            }
+
+            if (target_node) {
+                target_node->Key = std::move(node->Key);
+                target_node->Value = std::move(node->Value);
+                deleted_key = &target_node->Key;
+            }
+
+            size_--;
+            if (root_) {
+                SetColor(root_, ColorType::Black);
+            }
+            if constexpr (kAugmented) {
+                UpdatePath(*deleted_key);
+            }
+            DestroyNode(node);
+
+            Trace(TraceEvent::AfterErase, key);
+
+            return true;
+        }
+
+        // Iteration.
+        grand_parent_node = parent_node;
+        parent_node = node;
+        node = order < 0 ? Left(node) : Right(node);
+    }
+
+    if (root_) {
+        SetColor(root_, ColorType::Black);
+    }
+    return false;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT RED_BLACK_TREE_REQUIRES std::optional<ValueType> RED_BLACK_TREE_TYPE::GetValue(const KeyType& key) const
+{
+    const RedBlackTreeNode* node = FindNode(key);
+    return node ? std::make_optional(node->Value) : std::nullopt;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::InsertBatch(std::span<const std::pair<KeyType, ValueType>> entries) -> size_t
+{
+    using Entry = std::pair<KeyType, ValueType>;
+    const auto entry_less = [this](const Entry* lhs, const Entry* rhs) { return Less(lhs->first, rhs->first); };
+
+    // Sort by key, equivalent keys keep their batch order.
+    std::vector<const Entry*> sorted_entries;
+    sorted_entries.reserve(entries.size());
+    for (const Entry& entry : entries) {
+        sorted_entries.push_back(&entry);
+    }
+    if (!std::ranges::is_sorted(sorted_entries, entry_less)) {
+        std::ranges::stable_sort(sorted_entries, entry_less);
+    }
+
+    Count(Counter::Inserts, entries.size());
+    if (!IsBulkBatch(entries.size())) {
+        // Split the tree at the batch keys instead of descending from the root for every key, which takes
+        // O(m log(n / m + 1)) comparisons. Of equivalent keys the first one stays.
+        const auto duplicates = std::ranges::unique(sorted_entries, [&](const Entry* lhs, const Entry* rhs) { return !entry_less(lhs, rhs); });
+        sorted_entries.erase(duplicates.begin(), duplicates.end());
+
+        std::vector<RedBlackTreeNode*> created;
+        created.reserve(sorted_entries.size());
+        std::exception_ptr error;
+        const size_t size = size_;
+        const Subtree merged = InsertNodes(DetachRoot(), sorted_entries, created, error);
+        if (error) {
+            // Take the created nodes out again, so that a throwing creation leaves the tree untouched.
+            std::vector<const KeyType*> created_keys;
+            created_keys.reserve(created.size());
+            for (const RedBlackTreeNode* node : created) {
+                created_keys.push_back(&node->Key);
+            }
+            std::ranges::sort(created_keys, [this](const KeyType* lhs, const KeyType* rhs) { return Less(*lhs, *rhs); });
+            size_t erased = 0;
+            AttachRoot(EraseNodes(merged, created_keys, erased), size);
+            std::rethrow_exception(error);
+        }
+        AttachRoot(merged, size + created.size());
+        return created.size();
+    }
+
+    std::vector<RedBlackTreeNode*> nodes = CollectNodes();
+    std::vector<RedBlackTreeNode*> merged_nodes;
+    std::vector<RedBlackTreeNode*> new_nodes;
+    merged_nodes.reserve(nodes.size() + entries.size());
+    new_nodes.reserve(entries.size());
+
+    // Create nodes for the new keys first, so that a throwing allocation leaves the tree untouched.
+    try {
+        auto node_it = nodes.begin();
+        const Entry* previous = nullptr;
+        for (const Entry* entry : sorted_entries) {
+            if (previous && !entry_less(previous, entry)) {
+                continue;
+            }
+            previous = entry;
+
+            while (node_it != nodes.end() && Less((*node_it)->Key, entry->first)) {
+                ++node_it;
+            }
+            if (node_it == nodes.end() || Less(entry->first, (*node_it)->Key)) {
+                new_nodes.push_back(CreateNode(entry->first, entry->second));
+            }
+        }
+    } catch (...) {
+        for (RedBlackTreeNode* node : new_nodes) {
+            DestroyNode(node);
+        }
+        throw;
+    }
+
+    std::ranges::merge(nodes, new_nodes, std::back_inserter(merged_nodes),
+                       [this](const RedBlackTreeNode* lhs, const RedBlackTreeNode* rhs) { return Less(lhs->Key, rhs->Key); });
+    Relink(merged_nodes);
+    return new_nodes.size();
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::EraseBatch(std::span<const KeyType> keys) -> size_t
+{
+    const auto key_less = [this](const KeyType* lhs, const KeyType* rhs) { return Less(*lhs, *rhs); };
+
+    std::vector<const KeyType*> sorted_keys;
+    sorted_keys.reserve(keys.size());
+    for (const KeyType& key : keys) {
+        sorted_keys.push_back(&key);
+    }
+    if (!std::ranges::is_sorted(sorted_keys, key_less)) {
+        std::ranges::sort(sorted_keys, key_less);
+    }
+
+    Count(Counter::Erases, keys.size());
+    if (!IsBulkBatch(keys.size())) {
+        // Split the tree at the batch keys, see InsertBatch.
+        const size_t size = size_;
+        size_t erased = 0;
+        const Subtree remaining = EraseNodes(DetachRoot(), sorted_keys, erased);
+        AttachRoot(remaining, size - erased);
+        return erased;
+    }
+
+    // Keep the nodes whose key is not in the batch, in key order.
+    std::vector<RedBlackTreeNode*> nodes = CollectNodes();
+    auto key_it = sorted_keys.begin();
+    size_t kept = 0;
+    for (RedBlackTreeNode* node : nodes) {
+        while (key_it != sorted_keys.end() && Less(**key_it, node->Key)) {
+            ++key_it;
+        }
+        if (key_it != sorted_keys.end() && !Less(node->Key, **key_it)) {
+            DestroyNode(node);
+        } else {
+            nodes[kept++] = node;
+        }
+    }
+
+    const size_t erased = nodes.size() - kept;
+    nodes.resize(kept);
+    Relink(nodes);
+    return erased;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <size_t GroupSize>
+void RED_BLACK_TREE_TYPE::GetValues(std::span<const KeyType> keys, std::span<std::optional<ValueType>> values) const
+{
+    static_assert(GroupSize > 0, "GetValues needs at least one descent in flight.");
+    assert(values.size() >= keys.size());
+    Count(Counter::Lookups, keys.size());
+
+    if (!root_) {
+        std::ranges::fill(values.first(keys.size()), std::nullopt);
+        return;
+    }
+
+    // Every slot runs one descent: the node it waits for and the index of its key.
+    std::array<RedBlackTreeNode*, GroupSize> nodes;
+    std::array<size_t, GroupSize> indices;
+    size_t next_index = 0;
+    size_t active = 0;
+    for (; active < GroupSize && next_index < keys.size(); active++) {
+        nodes[active] = root_;
+        indices[active] = next_index++;
+    }
+
+    while (active) {
+        for (size_t slot = 0; slot < active;) {
+            RedBlackTreeNode* node = nodes[slot];
+            const size_t index = indices[slot];
+            const KeyType& key = keys[index];
+            const std::weak_ordering order = Compare(key, node->Key);
+            if (order == 0) {
+                values[index] = node->Value;
+            } else if ((node = order < 0 ? Left(node) : Right(node))) {
+                // The load overlaps with the steps of the other slots.
+                PrefetchNode(node);
+                nodes[slot++] = node;
+                continue;
+            } else {
+                values[index].reset();
+            }
+
+            // The descent is done, start the next one in this slot or move the last slot here.
+            if (next_index < keys.size()) {
+                nodes[slot] = root_;
+                indices[slot++] = next_index++;
+            } else {
+                active--;
+                nodes[slot] = nodes[active];
+                indices[slot] = indices[active];
+            }
+        }
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::LowerBound(const KeyType& key) -> iterator
+{
+    return Bound<iterator>(this, key, false);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::LowerBound(const KeyType& key) const -> const_iterator
+{
+    return Bound<const_iterator>(this, key, false);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::UpperBound(const KeyType& key) -> iterator
+{
+    return Bound<iterator>(this, key, true);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::UpperBound(const KeyType& key) const -> const_iterator
+{
+    return Bound<const_iterator>(this, key, true);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::Floor(const KeyType& key) -> iterator
+{
+    return FloorBound<iterator>(this, key);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::Floor(const KeyType& key) const -> const_iterator
+{
+    return FloorBound<const_iterator>(this, key);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::Rank(const KeyType& key) const -> size_t
+    requires Policy::kOrderStatistics
+{
+    Count(Counter::Lookups);
+    size_t rank = 0;
+    for (const RedBlackTreeNode* node = root_; node;) {
+        if (Less(node->Key, key)) {
+            rank += SubtreeSize(Left(node)) + 1;
+            node = Right(node);
+        } else {
+            node = Left(node);
+        }
+    }
+    return rank;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::Aggregate(const KeyType& lo, const KeyType& hi) const -> AggregateType
+    requires kHasAggregate
+{
+    Count(Counter::Lookups);
+
+    // Find the topmost node inside [lo, hi), the range splits into its left and right subtrees there.
+    const RedBlackTreeNode* split_node = root_;
+    while (split_node) {
+        if (Less(split_node->Key, lo)) {
+            split_node = Right(split_node);
+        } else if (!Less(split_node->Key, hi)) {
+            split_node = Left(split_node);
+        } else {
+            break;
+        }
+    }
+    if (!split_node) {
+        return AggregatePolicyType::Identity();
+    }
+
+    std::array<const RedBlackTreeNode*, kMaxHeight> path;
+    size_t depth = 0;
+
+    // Keys not less than lo in the left subtree: every node kept on the way down contributes itself and its right subtree.
+    for (const RedBlackTreeNode* node = Left(split_node); node;) {
+        if (Less(node->Key, lo)) {
+            node = Right(node);
+        } else {
+            path[depth++] = node;
+            node = Left(node);
+        }
+    }
+    AggregateType left_aggregate = AggregatePolicyType::Identity();
+    while (depth) {
+        const RedBlackTreeNode* node = path[--depth];
+        left_aggregate = AggregatePolicyType::Combine(node->Key, node->Value, left_aggregate, SubtreeAggregate(Right(node)));
+    }
+
+    // Keys less than hi in the right subtree, symmetrically.
+    for (const RedBlackTreeNode* node = Right(split_node); node;) {
+        if (Less(node->Key, hi)) {
+            path[depth++] = node;
+            node = Right(node);
+        } else {
+            node = Left(node);
+        }
+    }
+    AggregateType right_aggregate = AggregatePolicyType::Identity();
+    while (depth) {
+        const RedBlackTreeNode* node = path[--depth];
+        right_aggregate = AggregatePolicyType::Combine(node->Key, node->Value, SubtreeAggregate(Left(node)), right_aggregate);
+    }
+
+    return AggregatePolicyType::Combine(split_node->Key, split_node->Value, left_aggregate, right_aggregate);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::Clear()
+{
+    // Index32 nodes are dropped together with their chunks, which outlive the last erased node.
+    if constexpr (kNodeLayout == NodeLayout::Index32) {
+        if constexpr (!std::is_trivially_destructible_v<RedBlackTreeNode>) {
+            DestroySubtree(root_);
+        } else {
+            Count(Counter::NodesFreed, size_);
+        }
+        ReleaseChunks();
+        root_ = nullptr;
+        size_ = 0;
+        return;
+    }
+
+    if (!root_) {
+        return;
+    }
+
+    // Pooled nodes without destructors are dropped together with their slabs.
+    if constexpr (std::is_trivially_destructible_v<RedBlackTreeNode> && requires(NodeAllocator& allocator) { allocator.Release(); }) {
+        if (node_allocator_.Release()) {
+            Count(Counter::NodesFreed, size_);
+            root_ = nullptr;
+            size_ = 0;
+            return;
+        }
+    }
+
+    DestroySubtree(root_);
+    root_ = nullptr;
+    size_ = 0;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <std::forward_iterator It>
+void RED_BLACK_TREE_TYPE::BuildFromSorted(It first, It last)
+{
+    Clear();
+
+    const auto entry_less = [this](const auto& lhs, const auto& rhs) {
+        const auto& [lhs_key, lhs_value] = lhs;
+        const auto& [rhs_key, rhs_value] = rhs;
+        return Less(lhs_key, rhs_key);
+    };
+
+    // Count unique keys and make sure the range is sorted.
+    size_t count = 0;
+    for (It it = first, previous = last; it != last; previous = it, ++it) {
+        if (previous == last || entry_less(*previous, *it)) {
+            count++;
+        } else if (entry_less(*it, *previous)) [[unlikely]] {
+            for (; first != last; ++first) {
+                const auto& [key, value] = *first;
+                Insert(key, value);
+            }
+            return;
+        }
+    }
+
+    // Levels above the last one are complete, the last one is partial unless count is 2^k - 1.
+    const auto red_depth = static_cast<size_t>(std::bit_width(count + 1) - 1);
+    root_ = BuildSubtree(first, last, count, 0, red_depth);
+    size_ = count;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::Split(const KeyType& key) -> std::pair<RedBlackTree, RedBlackTree>
+    requires(kNodeLayout != NodeLayout::Index32)
+{
+    const size_t size = size_;
+    SplitResult parts = SplitNodes(DetachRoot(), key);
+    if (parts.Equal) {
+        parts.Right = JoinNodes({}, parts.Equal, parts.Right);
+    }
+
+    std::pair<RedBlackTree, RedBlackTree> trees{RedBlackTree(key_comparator_, GetAllocator()), RedBlackTree(key_comparator_, GetAllocator())};
+    auto& [left, right] = trees;
+    if constexpr (NodeAllocatorTraits::propagate_on_container_move_assignment::value) {
+        // The emptied tree lets go of the allocator of the nodes, so that it does not keep sharing a pool with the halves.
+        right.node_allocator_ = std::move(node_allocator_);
+    }
+    left.AttachRoot(parts.Left, 0);
+    right.AttachRoot(parts.Right, 0);
+
+    size_t left_size = 0;
+    if constexpr (Policy::kOrderStatistics) {
+        left_size = SubtreeSize(left.root_);
+    } else {
+        // Walk both trees in lockstep until the smaller one ends, its size is the number of steps.
+        const_iterator left_it = std::as_const(left).begin();
+        const_iterator right_it = std::as_const(right).begin();
+        size_t steps = 0;
+        for (; left_it != left.cend() && right_it != right.cend(); ++left_it, ++right_it) {
+            steps++;
+        }
+        left_size = left_it == left.cend() ? steps : size - steps;
+    }
+    left.size_ = left_size;
+    right.size_ = size - left_size;
+    return trees;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::Join(RedBlackTree&& left, const KeyType& key, const ValueType& value, RedBlackTree&& right) -> RedBlackTree
+    requires(kNodeLayout != NodeLayout::Index32)
+{
+    assert(left.IsEmpty() || left.Less(std::prev(left.cend())->first, key));
+    assert(right.IsEmpty() || left.Less(key, right.cbegin()->first));
+
+    // Both operands stay untouched if the middle node or the moved elements can not be allocated.
+    RedBlackTreeNode* middle = left.CreateNode(key, value);
+    RedBlackTree other(left.key_comparator_, left.GetAllocator());
+    try {
+        other = left.Adopt(std::move(right));
+    } catch (...) {
+        left.DestroyNode(middle);
+        throw;
+    }
+
+    RedBlackTree tree(std::move(left));
+    const size_t size = tree.size_ + other.size_ + 1;
+    tree.AttachRoot(tree.JoinNodes(tree.DetachRoot(), middle, other.DetachRoot()), size);
+    return tree;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::Join(RedBlackTree&& left, RedBlackTree&& right) -> RedBlackTree
+    requires(kNodeLayout != NodeLayout::Index32)
+{
+    assert(left.IsEmpty() || right.IsEmpty() || left.Less(std::prev(left.cend())->first, right.cbegin()->first));
+
+    RedBlackTree other = left.Adopt(std::move(right));
+    RedBlackTree tree(std::move(left));
+    const size_t size = tree.size_ + other.size_;
+    tree.AttachRoot(tree.JoinSubtrees(tree.DetachRoot(), other.DetachRoot()), size);
+    return tree;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::Stats() const -> TreeStats
+{
+    TreeStats stats;
+    stats.Size = size_;
+    stats.MemoryBytes = sizeof(*this);
+    if constexpr (kNodeLayout == NodeLayout::Index32) {
+        stats.MemoryBytes += index_arena_.Chunks.size() * kIndexChunkBytes + index_arena_.Chunks.capacity() * sizeof(RedBlackTreeNode*);
+    } else {
+        stats.MemoryBytes += size_ * sizeof(RedBlackTreeNode);
+    }
+    if constexpr (kStatistics) {
+        stats.Counts = CountersType::Snapshot();
+    }
+
+    for (const RedBlackTreeNode* node = root_; node; node = Left(node)) {
+        stats.BlackHeight += GetColor(node) == ColorType::Black ? 1 : 0;
+    }
+
+    size_t depth_sum = 0;
+    std::vector<std::pair<const RedBlackTreeNode*, size_t>> node_stack;
+    if (root_) {
+        node_stack.emplace_back(root_, 0);
+    }
+    while (!node_stack.empty()) {
+        const auto [node, depth] = node_stack.back();
+        node_stack.pop_back();
+        if (depth == stats.DepthHistogram.size()) {
+            stats.DepthHistogram.push_back(0);
+        }
+        stats.DepthHistogram[depth]++;
+        depth_sum += depth;
+        if (Left(node)) {
+            node_stack.emplace_back(Left(node), depth + 1);
+        }
+        if (Right(node)) {
+            node_stack.emplace_back(Right(node), depth + 1);
+        }
+    }
+    stats.Height = static_cast<int>(stats.DepthHistogram.size());
+    stats.AverageDepth = size_ == 0 ? 0.0 : static_cast<double>(depth_sum) / static_cast<double>(size_);
+    return stats;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::PrintTree(std::ostream& os) const
+{
+    std::queue<RedBlackTreeNode*> print_queue;
+    print_queue.push(root_);
+
+    while (!print_queue.empty()) {
+        std::vector<RedBlackTreeNode*> line;
+        while (!print_queue.empty()) {
+            line.push_back(print_queue.front());
+            print_queue.pop();
+        }
+
+        if (std::all_of(line.begin(), line.end(), [](const auto& node) { return node == nullptr; })) {
+            break;
+        }
+
+        size_t count = 0;
+        for (const auto& node : line) {
+            if (node) {
+                print_queue.push(Left(node));
+                print_queue.push(Right(node));
+                os << '[' << node->Key << ' ' << (GetColor(node) == ColorType::Red ? "red" : "black") << ']';
+            } else {
+                print_queue.push(nullptr);
+                print_queue.push(nullptr);
+                os << "nil";
+            }
+            if (++count != line.size()) {
+                os << ", ";
+            }
+        }
+        os << '\n';
+    }
+
+    os << '\n';
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+bool RED_BLACK_TREE_TYPE::RedBlackTreeRulesCheck()
+{
+    // 1. Root is always black.
+    if (!root_) {
+        return true;
+    }
+
+    if (GetColor(root_) != ColorType::Black) {
+        ReportViolation("Violate rule 1: Root is not black.");
+        return false;
+    }
+
+    // 2. If a node is red, its child nodes must be black.
+    std::stack<RedBlackTreeNode*> node_stack;
+    node_stack.push(root_);
+
+    while (!node_stack.empty()) {
+        RedBlackTreeNode* ptr = node_stack.top();
+        node_stack.pop();
+
+        if (GetColor(ptr) == ColorType::Red && !(IsBlackNode(Left(ptr)) && IsBlackNode(Right(ptr)))) {
+            ReportViolation("Violate rule 2: Red node must not have red child.");
+            return false;
+        }
+
+        if (Left(ptr)) {
+            node_stack.push(Left(ptr));
+        }
+        if (Right(ptr)) {
+            node_stack.push(Right(ptr));
+        }
+    }
+
+    // 3. Every path from root node to every null node must contain the same number of black nodes.
+    std::vector<int> all_black_path_nodes_count;
+    all_black_path_nodes_count.reserve(size_);
+    ComputeAllBlackPathHeight(root_, 1, all_black_path_nodes_count);
+
+    if (const bool rule3 = std::ranges::adjacent_find(all_black_path_nodes_count, std::not_equal_to()) == all_black_path_nodes_count.end(); !rule3) {
+        ReportViolation("Violate rule 3: Every path from root node to every null node must contain the same number of black nodes.");
+        return false;
+    }
+
+    // Augmented data must describe the subtree below every node.
+    if constexpr (kAugmented) {
+        if constexpr (Policy::kOrderStatistics) {
+            if (root_->Size != size_) {
+                ReportViolation("Violate subtree size: Root size " + std::to_string(root_->Size) + " is not tree size " + std::to_string(size_) + ".");
+                return false;
+            }
+        }
+
+        node_stack.push(root_);
+        while (!node_stack.empty()) {
+            RedBlackTreeNode* ptr = node_stack.top();
+            node_stack.pop();
+
+            if constexpr (Policy::kOrderStatistics) {
+                if (ptr->Size != 1 + SubtreeSize(Left(ptr)) + SubtreeSize(Right(ptr))) {
+                    ReportViolation("Violate subtree size: Node size does not match its children.");
+                    return false;
+                }
+            }
+            if constexpr (kHasAggregate && std::equality_comparable<AggregateType>) {
+                if (!(ptr->Agg == AggregatePolicyType::Combine(ptr->Key, ptr->Value, SubtreeAggregate(Left(ptr)), SubtreeAggregate(Right(ptr))))) {
+                    ReportViolation("Violate subtree aggregate: Node aggregate does not match its children.");
+                    return false;
+                }
+            }
+
+            if (Left(ptr)) {
+                node_stack.push(Left(ptr));
+            }
+            if (Right(ptr)) {
+                node_stack.push(Right(ptr));
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Private methods.
+ */
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename It, typename TreePointer, typename K>
+auto RED_BLACK_TREE_TYPE::Bound(TreePointer tree, const K& key, const bool is_upper) -> It
+{
+    Count(Counter::Lookups);
+
+    // The answer is the last node where the descent turned left, its path is a prefix of the descent path.
+    It it(tree);
+    size_t bound_depth = 0;
+    for (RedBlackTreeNode* node = tree->root_; node;) {
+        it.Push(node);
+        if (is_upper ? tree->Less(key, node->Key) : !tree->Less(node->Key, key)) {
+            bound_depth = it.depth_;
+            node = tree->Left(node);
+        } else {
+            node = tree->Right(node);
+        }
+    }
+    it.depth_ = bound_depth;
+    return it;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename K>
+auto RED_BLACK_TREE_TYPE::FindNode(const K& key) const -> RedBlackTreeNode*
+{
+    Count(Counter::Lookups);
+    if constexpr (kThreeWay) {
+        for (RedBlackTreeNode* node = root_; node;) {
+            const std::weak_ordering order = Compare(key, node->Key);
+            if (order == 0) {
+                return node;
+            }
+            node = order < 0 ? Left(node) : Right(node);
+        }
+        return nullptr;
+    }
+
+    // Descend to the lower bound like Bound, one comparison per level and one more at the end.
+    RedBlackTreeNode* candidate = nullptr;
+    for (RedBlackTreeNode* node = root_; node;) {
+        if (Less(node->Key, key)) {
+            node = Right(node);
+        } else {
+            candidate = node;
+            node = Left(node);
+        }
+    }
+    return candidate && !Less(key, candidate->Key) ? candidate : nullptr;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename It, typename TreePointer>
+auto RED_BLACK_TREE_TYPE::FloorBound(TreePointer tree, const KeyType& key) -> It
+{
+    Count(Counter::Lookups);
+
+    // The answer is the last node where the descent turned right.
+    It it(tree);
+    size_t floor_depth = 0;
+    for (RedBlackTreeNode* node = tree->root_; node;) {
+        it.Push(node);
+        if (tree->Less(key, node->Key)) {
+            node = tree->Left(node);
+        } else {
+            floor_depth = it.depth_;
+            node = tree->Right(node);
+        }
+    }
+    it.depth_ = floor_depth;
+    return it;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename It, typename TreePointer>
+auto RED_BLACK_TREE_TYPE::SelectNode(TreePointer tree, size_t k) -> It
+{
+    It it(tree);
+    if (k >= tree->size_) {
+        return it;
+    }
+
+    for (RedBlackTreeNode* node = tree->root_; node;) {
+        it.Push(node);
+        const size_t left_size = SubtreeSize(tree->Left(node));
+        if (k == left_size) {
+            break;
+        }
+        if (k < left_size) {
+            node = tree->Left(node);
+        } else {
+            k -= left_size + 1;
+            node = tree->Right(node);
+        }
+    }
+    return it;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::UpdatePath(const KeyType& key)
+{
+    std::array<RedBlackTreeNode*, kMaxHeight> path;
+    size_t depth = 0;
+
+    // After the key is found, the slot of its predecessor is the rightmost one of the left subtree.
+    bool passed_key = false;
+    for (RedBlackTreeNode* node = root_; node;) {
+        path[depth++] = node;
+        if (passed_key) {
+            node = Right(node);
+        } else if (const std::weak_ordering order = Compare(key, node->Key); order == 0) {
+            passed_key = true;
+            node = Left(node);
+        } else {
+            node = order < 0 ? Left(node) : Right(node);
+        }
+    }
+
+    while (depth) {
+        UpdateNode(path[--depth]);
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename It, typename TreePointer, typename Visitor>
+auto RED_BLACK_TREE_TYPE::Scan(TreePointer tree, const KeyType& lo, const KeyType& hi, Visitor& visitor) -> size_t
+{
+    size_t count = 0;
+    for (It it = Bound<It>(tree, lo, false); it.depth_ && tree->Less(it.Node()->Key, hi); ++it) {
+        const auto entry = *it;
+        count++;
+        if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, const KeyType&, decltype(entry.second)>, bool>) {
+            if (!std::invoke(visitor, entry.first, entry.second)) {
+                break;
+            }
+        } else {
+            std::invoke(visitor, entry.first, entry.second);
+        }
+    }
+    return count;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <std::forward_iterator It>
+auto RED_BLACK_TREE_TYPE::BuildSubtree(It& it, const It& last, const size_t count, const size_t depth, const size_t red_depth) -> RedBlackTreeNode*
+{
+    if (!count) {
+        return nullptr;
+    }
+
+    // In-order construction, so nodes are allocated in key order.
+    const size_t left_count = count / 2;
+    RedBlackTreeNode* left = BuildSubtree(it, last, left_count, depth + 1, red_depth);
+    RedBlackTreeNode* node = nullptr;
+    try {
+        const auto& [key, value] = *it;
+        node = CreateNode(key, value);
+    } catch (...) {
+        DestroySubtree(left);
+        throw;
+    }
+
+    // Skip equivalent keys.
+    for (++it; it != last; ++it) {
+        if (const auto& [key, value] = *it; Less(node->Key, key)) {
+            break;
+        }
+    }
+
+    try {
+        SetRight(node, BuildSubtree(it, last, count - left_count - 1, depth + 1, red_depth));
+    } catch (...) {
+        DestroySubtree(left);
+        DestroyNode(node);
+        throw;
+    }
+    SetLeft(node, left);
+    SetColor(node, depth == red_depth ? ColorType::Red : ColorType::Black);
+    UpdateNode(node);
+    return node;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::LinkSubtree(RedBlackTreeNode* const* nodes, const size_t count, const size_t depth, const size_t red_depth) -> RedBlackTreeNode*
+{
+    if (!count) {
+        return nullptr;
+    }
+
+    // Same shape as BuildSubtree.
+    const size_t left_count = count / 2;
+    RedBlackTreeNode* node = nodes[left_count];
+    SetLeft(node, LinkSubtree(nodes, left_count, depth + 1, red_depth));
+    SetRight(node, LinkSubtree(nodes + left_count + 1, count - left_count - 1, depth + 1, red_depth));
+    SetColor(node, depth == red_depth ? ColorType::Red : ColorType::Black);
+    UpdateNode(node);
+    return node;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::Relink(const std::vector<RedBlackTreeNode*>& nodes)
+{
+    const auto red_depth = static_cast<size_t>(std::bit_width(nodes.size() + 1) - 1);
+    root_ = LinkSubtree(nodes.data(), nodes.size(), 0, red_depth);
+    size_ = nodes.size();
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::CollectNodes() const -> std::vector<RedBlackTreeNode*>
+{
+    std::vector<RedBlackTreeNode*> nodes;
+    nodes.reserve(size_);
+
+    std::array<RedBlackTreeNode*, kMaxHeight> path;
+    size_t depth = 0;
+    for (RedBlackTreeNode* node = root_; node || depth;) {
+        if (node) {
+            path[depth++] = node;
+            node = Left(node);
+        } else {
+            node = path[--depth];
+            nodes.push_back(node);
+            node = Right(node);
+        }
+    }
+    return nodes;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::MoveElements(RedBlackTree& other)
+{
+    const std::vector<RedBlackTreeNode*> other_nodes = other.CollectNodes();
+    std::vector<RedBlackTreeNode*> nodes;
+    nodes.reserve(other_nodes.size());
+    try {
+        for (RedBlackTreeNode* other_node : other_nodes) {
+            nodes.push_back(CreateNode(std::move(other_node->Key), std::move(other_node->Value)));
+        }
+    } catch (...) {
+        // Hand the moved elements back, so that the other tree stays ordered.
+        for (size_t i = 0; i < nodes.size(); i++) {
+            other_nodes[i]->Key = std::move(nodes[i]->Key);
+            other_nodes[i]->Value = std::move(nodes[i]->Value);
+            DestroyNode(nodes[i]);
+        }
+        throw;
+    }
+    Relink(nodes);
+    other.Clear();
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::Adopt(RedBlackTree&& other) -> RedBlackTree
+{
+    RedBlackTree tree(key_comparator_, GetAllocator());
+    if (tree.node_allocator_ == other.node_allocator_) {
+        tree.root_ = std::exchange(other.root_, nullptr);
+        tree.size_ = std::exchange(other.size_, 0);
+        if constexpr (NodeAllocatorTraits::propagate_on_container_move_assignment::value) {
+            // Take the allocator along with the nodes, the emptied tree no longer shares a pool with this one.
+            tree.node_allocator_ = std::move(other.node_allocator_);
+        }
+    } else {
+        tree.MoveElements(other);
+    }
+    return tree;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::DetachRoot() -> Subtree
+{
+    int black_height = 0;
+    for (const RedBlackTreeNode* node = root_; node; node = Left(node)) {
+        black_height += GetColor(node) == ColorType::Black ? 1 : 0;
+    }
+    size_ = 0;
+    return {std::exchange(root_, nullptr), black_height};
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::AttachRoot(const Subtree tree, const size_t size)
+{
+    root_ = tree.Root;
+    size_ = size;
+    if (root_) {
+        SetColor(root_, ColorType::Black);
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::JoinNodes(Subtree left, RedBlackTreeNode* middle, Subtree right) -> Subtree
+{
+    // A red root may be blackened, then a black middle node never meets a red child.
+    for (Subtree* tree : {&left, &right}) {
+        if (!IsBlackNode(tree->Root)) {
+            SetColor(tree->Root, ColorType::Black);
+            tree->BlackHeight++;
+        }
+    }
+
+    if (left.BlackHeight == right.BlackHeight) {
+        SetLeft(middle, left.Root);
+        SetRight(middle, right.Root);
+        SetColor(middle, ColorType::Red);
+        UpdateNode(middle);
+        return {middle, left.BlackHeight};
+    }
+
+    const bool is_left_taller = left.BlackHeight > right.BlackHeight;
+    Subtree tree = is_left_taller ? Subtree{JoinRight(left.Root, left.BlackHeight, middle, right), left.BlackHeight}
+                                  : Subtree{JoinLeft(left, middle, right.Root, right.BlackHeight), right.BlackHeight};
+    // A rotation at the root leaves it red, a red child below it is resolved by blackening it.
+    if (!IsBlackNode(tree.Root) && !(IsBlackNode(Left(tree.Root)) && IsBlackNode(Right(tree.Root)))) {
+        SetColor(tree.Root, ColorType::Black);
+        tree.BlackHeight++;
+    }
+    return tree;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::JoinRight(RedBlackTreeNode* node, const int height, RedBlackTreeNode* middle, const Subtree right) -> RedBlackTreeNode*
+{
+    if (IsBlackNode(node) && height == right.BlackHeight) {
+        SetLeft(middle, node);
+        SetRight(middle, right.Root);
+        SetColor(middle, ColorType::Red);
+        UpdateNode(middle);
+        return middle;
+    }
+
+    const bool is_black = GetColor(node) == ColorType::Black;
+    RedBlackTreeNode* child = JoinRight(Right(node), is_black ? height - 1 : height, middle, right);
+    SetRight(node, child);
+    if (is_black && !IsBlackNode(child) && !IsBlackNode(Right(child))) {
+        // Red child with red right grandchild below a black node, rotate left.
+        SetColor(Right(child), ColorType::Black);
+        SetRight(node, Left(child));
+        UpdateNode(node);
+        SetLeft(child, node);
+        UpdateNode(child);
+        return child;
+    }
+    UpdateNode(node);
+    return node;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::JoinLeft(const Subtree left, RedBlackTreeNode* middle, RedBlackTreeNode* node, const int height) -> RedBlackTreeNode*
+{
+    if (IsBlackNode(node) && height == left.BlackHeight) {
+        SetLeft(middle, left.Root);
+        SetRight(middle, node);
+        SetColor(middle, ColorType::Red);
+        UpdateNode(middle);
+        return middle;
+    }
+
+    const bool is_black = GetColor(node) == ColorType::Black;
+    RedBlackTreeNode* child = JoinLeft(left, middle, Left(node), is_black ? height - 1 : height);
+    SetLeft(node, child);
+    if (is_black && !IsBlackNode(child) && !IsBlackNode(Left(child))) {
+        SetColor(Left(child), ColorType::Black);
+        SetLeft(node, Right(child));
+        UpdateNode(node);
+        SetRight(child, node);
+        UpdateNode(child);
+        return child;
+    }
+    UpdateNode(node);
+    return node;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::JoinSubtrees(const Subtree left, const Subtree right) -> Subtree
+{
+    if (!left.Root) {
+        return right;
+    }
+    if (!right.Root) {
+        return left;
+    }
+    const auto [rest, last] = SplitLast(left);
+    return JoinNodes(rest, last, right);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::SplitNodes(const Subtree tree, const KeyType& key) -> SplitResult
+{
+    if (!tree.Root) {
+        return {};
+    }
+
+    // Every subtree hanging off the search path is joined back in, the joins cost O(log n) in total.
+    const auto [left, right] = Expose(tree);
+    const std::weak_ordering ordering = Compare(key, tree.Root->Key);
+    if (ordering == 0) {
+        return {left, tree.Root, right};
+    }
+    if (ordering < 0) {
+        SplitResult parts = SplitNodes(left, key);
+        parts.Right = JoinNodes(parts.Right, tree.Root, right);
+        return parts;
+    }
+    SplitResult parts = SplitNodes(right, key);
+    parts.Left = JoinNodes(left, tree.Root, parts.Left);
+    return parts;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::SplitLast(const Subtree tree) -> std::pair<Subtree, RedBlackTreeNode*>
+{
+    const auto [left, right] = Expose(tree);
+    if (!right.Root) {
+        return {left, tree.Root};
+    }
+    const auto [rest, last] = SplitLast(right);
+    return {JoinNodes(left, tree.Root, rest), last};
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename RED_BLACK_TREE_TYPE::SetOperation Operation>
+auto RED_BLACK_TREE_TYPE::MergeNodes(Subtree lhs, Subtree rhs, ThreadPool* pool, size_t& matches) -> Subtree
+{
+    if (!lhs.Root || !rhs.Root) {
+        if constexpr (Operation == SetOperation::Union) {
+            return lhs.Root ? lhs : rhs;
+        } else {
+            DestroySubtree(rhs.Root);
+            if constexpr (Operation == SetOperation::Intersection) {
+                DestroySubtree(lhs.Root);
+                return {};
+            }
+            return lhs;
+        }
+    }
+
+    // Split lhs by the root of rhs, then the two sides are independent.
+    RedBlackTreeNode* pivot = rhs.Root;
+    const auto [rhs_left, rhs_right] = Expose(rhs);
+    const SplitResult parts = SplitNodes(lhs, pivot->Key);
+
+    Subtree merged[2];
+    size_t side_matches[2] = {0, 0};
+    const auto merge_side = [&](const size_t side) {
+        merged[side] = side == 0 ? MergeNodes<Operation>(parts.Left, rhs_left, pool, side_matches[0])
+                                 : MergeNodes<Operation>(parts.Right, rhs_right, pool, side_matches[1]);
+    };
+    if (pool && std::min(lhs.BlackHeight, rhs.BlackHeight) >= kParallelBlackHeight) {
+        pool->ParallelFor(2, merge_side);
+    } else {
+        merge_side(0);
+        merge_side(1);
+    }
+    matches += side_matches[0] + side_matches[1] + (parts.Equal ? 1 : 0);
+
+    if constexpr (Operation == SetOperation::Union) {
+        if (parts.Equal) {
+            DestroyNode(pivot);
+            return JoinNodes(merged[0], parts.Equal, merged[1]);
+        }
+        return JoinNodes(merged[0], pivot, merged[1]);
+    } else if constexpr (Operation == SetOperation::Intersection) {
+        DestroyNode(pivot);
+        return parts.Equal ? JoinNodes(merged[0], parts.Equal, merged[1]) : JoinSubtrees(merged[0], merged[1]);
+    } else {
+        DestroyNode(pivot);
+        if (parts.Equal) {
+            DestroyNode(parts.Equal);
+        }
+        return JoinSubtrees(merged[0], merged[1]);
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::InsertNodes(const Subtree tree, const std::span<const std::pair<KeyType, ValueType>* const> entries,
+                                      std::vector<RedBlackTreeNode*>& created, std::exception_ptr& error) -> Subtree
+{
+    if (entries.empty() || error) {
+        return tree;
+    }
+
+    // The middle key splits the subtree and the batch alike, see EraseNodes. An existing node wins over the entry.
+    const size_t middle = entries.size() / 2;
+    const SplitResult parts = SplitNodes(tree, entries[middle]->first);
+    const Subtree left = InsertNodes(parts.Left, entries.first(middle), created, error);
+    const Subtree right = InsertNodes(parts.Right, entries.subspan(middle + 1), created, error);
+    RedBlackTreeNode* node = parts.Equal;
+    if (!node && !error) {
+        try {
+            node = CreateNode(entries[middle]->first, entries[middle]->second);
+            created.push_back(node);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    return node ? JoinNodes(left, node, right) : JoinSubtrees(left, right);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::EraseNodes(const Subtree tree, const std::span<const KeyType* const> keys, size_t& erased) -> Subtree
+{
+    if (!tree.Root || keys.empty()) {
+        return tree;
+    }
+
+    // The middle key splits the subtree and the batch alike, both sides are independent.
+    const size_t middle = keys.size() / 2;
+    const SplitResult parts = SplitNodes(tree, *keys[middle]);
+    const Subtree left = EraseNodes(parts.Left, keys.first(middle), erased);
+    const Subtree right = EraseNodes(parts.Right, keys.subspan(middle + 1), erased);
+    if (parts.Equal) {
+        DestroyNode(parts.Equal);
+        erased++;
+    }
+    return JoinSubtrees(left, right);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename RED_BLACK_TREE_TYPE::SetOperation Operation>
+auto RED_BLACK_TREE_TYPE::Merge(RedBlackTree&& lhs, RedBlackTree&& rhs, ThreadPool* pool) -> RedBlackTree
+{
+    RedBlackTree other = lhs.Adopt(std::move(rhs));
+    RedBlackTree tree(std::move(lhs));
+    const size_t lhs_size = tree.size_;
+    const size_t rhs_size = other.size_;
+
+    size_t matches = 0;
+    const Subtree merged = tree.template MergeNodes<Operation>(tree.DetachRoot(), other.DetachRoot(), pool, matches);
+    if constexpr (Operation == SetOperation::Union) {
+        tree.AttachRoot(merged, lhs_size + rhs_size - matches);
+    } else if constexpr (Operation == SetOperation::Intersection) {
+        tree.AttachRoot(merged, matches);
+    } else {
+        tree.AttachRoot(merged, lhs_size - matches);
+    }
+    return tree;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::DestroySubtree(RedBlackTreeNode* root) noexcept
+{
+    if (!root) {
+        return;
+    }
+
+    std::stack<RedBlackTreeNode*> node_stack;
+    node_stack.push(root);
+
+    while (!node_stack.empty()) {
+        RedBlackTreeNode* ptr = node_stack.top();
+        node_stack.pop();
+
+        if (Left(ptr)) {
+            node_stack.push(Left(ptr));
+        }
+        if (Right(ptr)) {
+            node_stack.push(Right(ptr));
+        }
+
+        DestroyNode(ptr);
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+template <typename K, typename... Args>
+auto RED_BLACK_TREE_TYPE::CreateNode(K&& key, Args&&... args) -> RedBlackTreeNode*
+{
+    RedBlackTreeNode* node = AllocateNode();
+    try {
+        NodeAllocatorTraits::construct(node_allocator_, node, std::forward<K>(key), std::forward<Args>(args)...);
+    } catch (...) {
+        DeallocateNode(node);
+        throw;
+    }
+    Count(Counter::NodesAllocated);
+    UpdateNode(node);
+    return node;
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::DestroyNode(RedBlackTreeNode* node) noexcept
+{
+    NodeAllocatorTraits::destroy(node_allocator_, node);
+    DeallocateNode(node);
+    Count(Counter::NodesFreed);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+auto RED_BLACK_TREE_TYPE::AllocateNode() -> RedBlackTreeNode*
+{
+    if constexpr (kNodeLayout != NodeLayout::Index32) {
+        return NodeAllocatorTraits::allocate(node_allocator_, 1);
+    } else {
+        IndexArena& arena = index_arena_;
+        if (arena.FreeList) {
+            RedBlackTreeNode* node = NodeAt(arena.FreeList);
+            arena.FreeList = *std::launder(reinterpret_cast<std::uint32_t*>(node)); // NOLINT
+            return node;
+        }
+
+        // Skip the unused tail slots of a full chunk.
+        if ((arena.Next & ((std::uint32_t{1} << kIndexSlotBits) - 1)) == kIndexChunkNodes) {
+            arena.Next = ((arena.Next >> kIndexSlotBits) + 1) << kIndexSlotBits;
+        }
+        if ((arena.Next >> kIndexSlotBits) == arena.Chunks.size()) {
+            if (arena.Chunks.size() == size_t{1} << (31 - kIndexSlotBits)) [[unlikely]] {
+                throw std::length_error("Index32 tree is out of node indices.");
+            }
+            arena.Chunks.reserve(arena.Chunks.size() + 1);
+            IndexChunkAllocator chunk_allocator(node_allocator_);
+            auto* chunk = ::new (static_cast<void*>(IndexChunkAllocatorTraits::allocate(chunk_allocator, 1))) IndexChunk;
+            chunk->Base = static_cast<std::uint32_t>(arena.Chunks.size() << kIndexSlotBits);
+            arena.Chunks.push_back(reinterpret_cast<RedBlackTreeNode*>(chunk->Storage)); // NOLINT
+        }
+        return NodeAt(arena.Next++);
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::DeallocateNode(RedBlackTreeNode* node) noexcept
+{
+    if constexpr (kNodeLayout != NodeLayout::Index32) {
+        NodeAllocatorTraits::deallocate(node_allocator_, node, 1);
+    } else {
+        const std::uint32_t index = IndexOf(node);
+        ::new (static_cast<void*>(node)) std::uint32_t(index_arena_.FreeList);
+        index_arena_.FreeList = index;
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::ReleaseChunks() noexcept
+{
+    if constexpr (kNodeLayout == NodeLayout::Index32) {
+        IndexChunkAllocator chunk_allocator(node_allocator_);
+        for (RedBlackTreeNode* first : index_arena_.Chunks) {
+            IndexChunkAllocatorTraits::deallocate(chunk_allocator, reinterpret_cast<IndexChunk*>(reinterpret_cast<std::uintptr_t>(first) & ~(kIndexChunkBytes - 1)), 1); // NOLINT
+        }
+        index_arena_ = {};
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::HandleReorient(RedBlackTreeNode* grand_grand_parent_node, RedBlackTreeNode* grand_parent_node, RedBlackTreeNode* parent_node,
+                                         RedBlackTreeNode* node)
+{
+    if (Left(node)) {
+        SetColor(Left(node), ColorType::Black);
+    }
+    if (Right(node)) {
+        SetColor(Right(node), ColorType::Black);
+    }
+    // Only the root has no parent, which saves reading root_ that a concurrent writer may be replacing.
+    if (!parent_node) {
+        return;
+    }
+
+    SetColor(node, ColorType::Red);
+    if (GetColor(parent_node) == ColorType::Red) {
+        // Need to rotate.
+        SetColor(grand_parent_node, ColorType::Red);
+
+        // Check if it needs double rotation.
+        bool is_unique_rotate = true;
+        // First rotation.
+        if (Less(parent_node->Key, grand_parent_node->Key) != Less(node->Key, parent_node->Key)) {
+            HandleRotation(parent_node, node);
+            HandleReconnection(grand_parent_node, node);
+            is_unique_rotate = false;
+        }
+
+        // Second rotation.
+        is_unique_rotate ? HandleRotation(grand_parent_node, parent_node) : HandleRotation(grand_parent_node, node);
+        is_unique_rotate ? HandleReconnection(grand_grand_parent_node, parent_node) : HandleReconnection(grand_grand_parent_node, node); // NOLINT
+
+        SetColor(is_unique_rotate ? parent_node : node, ColorType::Black);
+    }
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::HandleRotation(RedBlackTreeNode* root, RedBlackTreeNode* sup)
+{
+    if (!sup) {
+        return;
+    }
+    Count(Counter::Rotations);
+
+    auto rotate = [this](RedBlackTreeNode* r, bool is_left_rotation) {
+        RedBlackTreeNode* new_root = is_left_rotation ? Left(r) : Right(r);
+        if (is_left_rotation) {
+            SetLeft(r, Right(new_root));
+            SetRight(new_root, r);
+        } else {
+            SetRight(r, Left(new_root));
+            SetLeft(new_root, r);
+        }
+    };
+
+    Less(sup->Key, root->Key) ? rotate(root, true) : rotate(root, false);
+
+    // Root is now the child of sup.
+    UpdateNode(root);
+    UpdateNode(sup);
+}
+
+RED_BLACK_TREE_TEMPLATE_ARGUMENT
+RED_BLACK_TREE_REQUIRES
+void RED_BLACK_TREE_TYPE::HandleReconnection(RedBlackTreeNode* new_parent, RedBlackTreeNode* node)
+{
+    if (new_parent) {
+        // Just reconnect to parent.
+        Less(node->Key, new_parent->Key) ? SetLeft(new_parent, node) : SetRight(new_parent, node);
+    } else {
+        // Need to reconnect to root_.
+        StoreLink(root_, node);
+    }
+}
+
+} // namespace rbt
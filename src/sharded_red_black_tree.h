@@ -0,0 +1,259 @@
+#pragma once
+
+/**
+ * RedBlackTree split by key range into independent shards, with batch operations that run the shards in parallel.
+ * Definitions live in sharded_red_black_tree.inl, which is included at the end of this file.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "thread_pool.h"
+#include "tree_policy.h"
+
+namespace rbt
+{
+
+#define SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT template <typename KeyType, typename ValueType, class KeyComparator, class Allocator, class Policy>
+#define SHARDED_RED_BLACK_TREE_TYPE ShardedRedBlackTree<KeyType, ValueType, KeyComparator, Allocator, Policy>
+#define SHARDED_RED_BLACK_TREE_REQUIRES requires IsComparator<KeyType, KeyComparator>
+
+/**
+ * Key-ordered map made of one RedBlackTree per key range.
+ * Shard i holds the keys in [boundaries[i - 1], boundaries[i]), so the shards never overlap and iterating them one
+ * after another is iterating in key order. Batch operations route every key to its shard and let a ThreadPool run
+ * the shards at once, each shard with the batch algorithms of RedBlackTree. Single-key operations touch one shard.
+ * Like RedBlackTree it is not thread-safe itself, and the allocator must tolerate use from several threads at once.
+ * A pooled allocator like NodePoolAllocator gives every shard a pool of its own instead.
+ */
+template <typename KeyType, typename ValueType, class KeyComparator = std::less<KeyType>, class Allocator = std::allocator<std::pair<const KeyType, ValueType>>,
+          class Policy = DefaultTreePolicy>
+SHARDED_RED_BLACK_TREE_REQUIRES class ShardedRedBlackTree
+{
+public:
+    using TreeType = RedBlackTree<KeyType, ValueType, KeyComparator, Allocator, Policy>;
+
+    /**
+     * Forward iterator in key order over all shards, yields what RedBlackTree::const_iterator yields.
+     */
+    class ConstIterator
+    {
+        friend class ShardedRedBlackTree;
+
+        using TreeIterator = typename TreeType::const_iterator;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = typename TreeIterator::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = typename TreeIterator::reference;
+        using pointer = typename TreeIterator::pointer;
+
+        ConstIterator() = default;
+
+        auto operator*() const -> reference { return *it_; }
+
+        auto operator->() const -> pointer { return it_.operator->(); }
+
+        auto operator++() -> ConstIterator&
+        {
+            ++it_;
+            SkipEmpty();
+            return *this;
+        }
+
+        auto operator++(int) -> ConstIterator
+        {
+            ConstIterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        friend bool operator==(const ConstIterator& lhs, const ConstIterator& rhs) { return lhs.shard_ == rhs.shard_ && lhs.it_ == rhs.it_; }
+
+    private:
+        const std::vector<TreeType>* shards_ = nullptr;
+        size_t shard_ = 0;
+        TreeIterator it_;
+
+        ConstIterator(const std::vector<TreeType>* shards, const size_t shard) : shards_(shards), shard_(shard)
+        {
+            if (shard_ < shards_->size()) {
+                it_ = (*shards_)[shard_].begin();
+                SkipEmpty();
+            }
+        }
+
+        /// <summary>
+        /// Move on to the first element of the next non-empty shard once the current one is exhausted.
+        /// </summary>
+        void SkipEmpty()
+        {
+            while (shard_ < shards_->size() && it_ == (*shards_)[shard_].end()) {
+                it_ = ++shard_ < shards_->size() ? (*shards_)[shard_].begin() : TreeIterator();
+            }
+        }
+    };
+
+    using const_iterator = ConstIterator;
+
+    /// <summary>
+    /// Create an empty tree with boundaries.size() + 1 shards.
+    /// </summary>
+    /// <param name="boundaries">The first key of every shard but the first one, strictly increasing. See SampleBoundaries.</param>
+    /// <param name="thread_count">The number of threads running batch operations, including the calling one.</param>
+    /// <param name="key_comparator">The key comparator.</param>
+    /// <param name="allocator">The allocator, copied into every shard. Every shard of a pooled allocator gets a fresh pool.</param>
+    explicit ShardedRedBlackTree(std::vector<KeyType> boundaries, size_t thread_count = std::thread::hardware_concurrency(),
+                                 const KeyComparator& key_comparator = KeyComparator(), const Allocator& allocator = Allocator());
+
+    ShardedRedBlackTree(const ShardedRedBlackTree&) = delete;
+
+    auto operator=(const ShardedRedBlackTree&) -> ShardedRedBlackTree& = delete;
+
+    ~ShardedRedBlackTree() noexcept = default;
+
+    /// <summary>
+    /// Pick boundaries that split the given keys into shards of about the same size.
+    /// </summary>
+    /// <param name="keys">The keys, or a random sample of them, in any order.</param>
+    /// <param name="shard_count">The number of shards wanted.</param>
+    /// <param name="key_comparator">The key comparator.</param>
+    /// <returns>The boundaries, fewer than shard_count - 1 if the keys have too few distinct values.</returns>
+    static auto SampleBoundaries(std::span<const KeyType> keys, size_t shard_count, const KeyComparator& key_comparator = KeyComparator())
+        -> std::vector<KeyType>;
+
+    /**
+     * Single-key operations, see RedBlackTree.
+     */
+
+    bool Insert(const KeyType& key, const ValueType& value) { return ShardOf(key).Insert(key, value); }
+
+    bool InsertOrAssign(const KeyType& key, const ValueType& value) { return ShardOf(key).InsertOrAssign(key, value); }
+
+    bool Erase(const KeyType& key) { return ShardOf(key).Erase(key); }
+
+    std::optional<ValueType> GetValue(const KeyType& key) const { return ShardOf(key).GetValue(key); }
+
+    [[nodiscard]] bool Contains(const KeyType& key) const { return ShardOf(key).Contains(key); }
+
+    /**
+     * Batch operations, run on all shards in parallel.
+     */
+
+    /// <summary>
+    /// Insert a batch of key-value pairs, see RedBlackTree::InsertBatch.
+    /// </summary>
+    /// <param name="entries">The key-value pairs, in any order.</param>
+    /// <returns>The number of inserted pairs.</returns>
+    auto InsertBatch(std::span<const std::pair<KeyType, ValueType>> entries) -> size_t;
+
+    /// <summary>
+    /// Erase a batch of keys, see RedBlackTree::EraseBatch.
+    /// </summary>
+    /// <param name="keys">The keys, in any order.</param>
+    /// <returns>The number of erased pairs.</returns>
+    auto EraseBatch(std::span<const KeyType> keys) -> size_t;
+
+    /// <summary>
+    /// Get values of a batch of keys, see RedBlackTree::GetValues.
+    /// </summary>
+    /// <param name="keys">The keys.</param>
+    /// <param name="values">The optional values, values[i] belongs to keys[i]. Must be at least as long as keys.</param>
+    void GetValues(std::span<const KeyType> keys, std::span<std::optional<ValueType>> values) const;
+
+    /// <summary>
+    /// Clear all shards.
+    /// </summary>
+    void Clear();
+
+    [[nodiscard]] auto Size() const -> size_t;
+
+    [[nodiscard]] bool IsEmpty() const { return Size() == 0; }
+
+    [[nodiscard]] auto ShardCount() const -> size_t { return shards_.size(); }
+
+    /// <summary>
+    /// Get a shard, e.g. to run range queries inside one key range.
+    /// </summary>
+    /// <param name="index">The shard index, less than ShardCount().</param>
+    /// <returns>The shard.</returns>
+    [[nodiscard]] auto Shard(const size_t index) const -> const TreeType& { return shards_[index]; }
+
+    /**
+     * Iteration in key order.
+     */
+
+    auto begin() const -> const_iterator { return const_iterator(&shards_, 0); }
+
+    auto end() const -> const_iterator { return const_iterator(&shards_, shards_.size()); }
+
+    /// <summary>
+    /// Check the red-black tree rules of every shard, and that every key lies in the range of its shard.
+    /// </summary>
+    /// <returns>True for check success.</returns>
+    bool RedBlackTreeRulesCheck();
+
+private:
+    static constexpr bool kThreeWayComparator = IsThreeWayComparator<KeyType, KeyComparator>;
+
+    std::vector<KeyType> boundaries_;
+    std::vector<TreeType> shards_;
+    KeyComparator key_comparator_;
+    // Mutable as const lookups run on it as well, the pool itself is thread-safe.
+    mutable ThreadPool pool_;
+
+    /// <summary>
+    /// Get the index of the shard a key belongs to.
+    /// </summary>
+    [[nodiscard]] auto ShardIndex(const KeyType& key) const -> size_t
+    {
+        return std::ranges::upper_bound(boundaries_, key, [this](const KeyType& lhs, const KeyType& rhs) { return Less(key_comparator_, lhs, rhs); })
+               - boundaries_.begin();
+    }
+
+    auto ShardOf(const KeyType& key) -> TreeType& { return shards_[ShardIndex(key)]; }
+
+    auto ShardOf(const KeyType& key) const -> const TreeType& { return shards_[ShardIndex(key)]; }
+
+    /// <summary>
+    /// Split a batch into about one chunk per thread, and find the shard of every element of every chunk in parallel.
+    /// </summary>
+    /// <param name="batch">The batch.</param>
+    /// <param name="key_of">Gets the key of an element.</param>
+    /// <returns>routes[chunk][shard] lists the indices of the chunk's elements in that shard, in batch order.</returns>
+    template <typename T, typename KeyOf> auto Route(std::span<const T> batch, KeyOf key_of) const -> std::vector<std::vector<std::vector<size_t>>>;
+
+    /// <summary>
+    /// Check whether a key is ordered before another one.
+    /// </summary>
+    /// <param name="key_comparator">The key comparator.</param>
+    /// <param name="lhs">The left key.</param>
+    /// <param name="rhs">The right key.</param>
+    /// <returns>True for lhs is less than rhs.</returns>
+    static bool Less(const KeyComparator& key_comparator, const KeyType& lhs, const KeyType& rhs)
+    {
+        if constexpr (kThreeWayComparator) {
+            return key_comparator(lhs, rhs) < 0;
+        } else {
+            return key_comparator(lhs, rhs);
+        }
+    }
+};
+
+} // namespace rbt
+
+#include "sharded_red_black_tree.inl"
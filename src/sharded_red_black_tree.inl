@@ -0,0 +1,162 @@
+#pragma once
+
+namespace rbt
+{
+
+SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+SHARDED_RED_BLACK_TREE_REQUIRES
+SHARDED_RED_BLACK_TREE_TYPE::ShardedRedBlackTree(std::vector<KeyType> boundaries, const size_t thread_count, const KeyComparator& key_comparator,
+                                                 const Allocator& allocator)
+    : boundaries_(std::move(boundaries)), key_comparator_(key_comparator), pool_(thread_count)
+{
+    assert(std::ranges::adjacent_find(boundaries_, [this](const KeyType& lhs, const KeyType& rhs) { return !Less(key_comparator_, lhs, rhs); }) == boundaries_.end());
+    shards_.reserve(boundaries_.size() + 1);
+    for (size_t i = 0; i <= boundaries_.size(); i++) {
+        if constexpr (requires(Allocator& pooled_allocator) { pooled_allocator.Release(); }) {
+            // A pool is not thread-safe, every shard gets one of its own for the parallel batch operations.
+            shards_.emplace_back(key_comparator, std::allocator_traits<Allocator>::select_on_container_copy_construction(allocator));
+        } else {
+            shards_.emplace_back(key_comparator, allocator);
+        }
+    }
+}
+
+SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+SHARDED_RED_BLACK_TREE_REQUIRES
+auto SHARDED_RED_BLACK_TREE_TYPE::SampleBoundaries(std::span<const KeyType> keys, const size_t shard_count, const KeyComparator& key_comparator)
+    -> std::vector<KeyType>
+{
+    std::vector<KeyType> sorted_keys(keys.begin(), keys.end());
+    std::ranges::sort(sorted_keys, [&key_comparator](const KeyType& lhs, const KeyType& rhs) { return Less(key_comparator, lhs, rhs); });
+    std::vector<KeyType> boundaries;
+    for (size_t i = 1; i < shard_count && !sorted_keys.empty(); i++) {
+        const KeyType& key = sorted_keys[i * sorted_keys.size() / shard_count];
+        // Skip quantiles that fall on the same key, the boundaries must increase strictly.
+        if (Less(key_comparator, sorted_keys.front(), key) && (boundaries.empty() || Less(key_comparator, boundaries.back(), key))) {
+            boundaries.push_back(key);
+        }
+    }
+    return boundaries;
+}
+
+SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+SHARDED_RED_BLACK_TREE_REQUIRES
+auto SHARDED_RED_BLACK_TREE_TYPE::InsertBatch(std::span<const std::pair<KeyType, ValueType>> entries) -> size_t
+{
+    using Entry = std::pair<KeyType, ValueType>;
+    const auto routes = Route(entries, [](const Entry& entry) -> const KeyType& { return entry.first; });
+
+    std::vector<size_t> inserted(shards_.size());
+    pool_.ParallelFor(shards_.size(), [&](const size_t shard) {
+        // Chunks are taken in batch order, so the first of equivalent keys still wins.
+        std::vector<Entry> shard_entries;
+        for (const auto& route : routes) {
+            for (const size_t index : route[shard]) {
+                shard_entries.push_back(entries[index]);
+            }
+        }
+        inserted[shard] = shards_[shard].InsertBatch(shard_entries);
+    });
+    return std::reduce(inserted.begin(), inserted.end());
+}
+
+SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+SHARDED_RED_BLACK_TREE_REQUIRES
+auto SHARDED_RED_BLACK_TREE_TYPE::EraseBatch(std::span<const KeyType> keys) -> size_t
+{
+    const auto routes = Route(keys, [](const KeyType& key) -> const KeyType& { return key; });
+
+    std::vector<size_t> erased(shards_.size());
+    pool_.ParallelFor(shards_.size(), [&](const size_t shard) {
+        std::vector<KeyType> shard_keys;
+        for (const auto& route : routes) {
+            for (const size_t index : route[shard]) {
+                shard_keys.push_back(keys[index]);
+            }
+        }
+        erased[shard] = shards_[shard].EraseBatch(shard_keys);
+    });
+    return std::reduce(erased.begin(), erased.end());
+}
+
+SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+SHARDED_RED_BLACK_TREE_REQUIRES
+void SHARDED_RED_BLACK_TREE_TYPE::GetValues(std::span<const KeyType> keys, std::span<std::optional<ValueType>> values) const
+{
+    assert(values.size() >= keys.size());
+    const auto routes = Route(keys, [](const KeyType& key) -> const KeyType& { return key; });
+
+    pool_.ParallelFor(shards_.size(), [&](const size_t shard) {
+        std::vector<KeyType> shard_keys;
+        std::vector<size_t> indices;
+        for (const auto& route : routes) {
+            for (const size_t index : route[shard]) {
+                shard_keys.push_back(keys[index]);
+                indices.push_back(index);
+            }
+        }
+
+        // Every index belongs to one shard, so the shards write disjoint values.
+        std::vector<std::optional<ValueType>> shard_values(shard_keys.size());
+        shards_[shard].GetValues(std::span<const KeyType>(shard_keys), std::span(shard_values));
+        for (size_t i = 0; i < indices.size(); i++) {
+            values[indices[i]] = std::move(shard_values[i]);
+        }
+    });
+}
+
+SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+SHARDED_RED_BLACK_TREE_REQUIRES
+void SHARDED_RED_BLACK_TREE_TYPE::Clear()
+{
+    pool_.ParallelFor(shards_.size(), [this](const size_t shard) { shards_[shard].Clear(); });
+}
+
+SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+SHARDED_RED_BLACK_TREE_REQUIRES
+auto SHARDED_RED_BLACK_TREE_TYPE::Size() const -> size_t
+{
+    size_t size = 0;
+    for (const TreeType& shard : shards_) {
+        size += shard.Size();
+    }
+    return size;
+}
+
+SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+SHARDED_RED_BLACK_TREE_REQUIRES
+bool SHARDED_RED_BLACK_TREE_TYPE::RedBlackTreeRulesCheck()
+{
+    for (size_t shard = 0; shard < shards_.size(); shard++) {
+        if (!shards_[shard].RedBlackTreeRulesCheck()) {
+            return false;
+        }
+        for (const auto& [key, value] : shards_[shard]) {
+            if (ShardIndex(key) != shard) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+SHARDED_RED_BLACK_TREE_TEMPLATE_ARGUMENT
+SHARDED_RED_BLACK_TREE_REQUIRES
+template <typename T, typename KeyOf>
+auto SHARDED_RED_BLACK_TREE_TYPE::Route(std::span<const T> batch, KeyOf key_of) const -> std::vector<std::vector<std::vector<size_t>>>
+{
+    // Small batches are routed by the caller alone, splitting them costs more than it saves.
+    constexpr size_t kMinChunk = 4096;
+    const size_t chunk_count = std::clamp<size_t>(batch.size() / kMinChunk, 1, pool_.ThreadCount());
+    std::vector<std::vector<std::vector<size_t>>> routes(chunk_count, std::vector<std::vector<size_t>>(shards_.size()));
+    pool_.ParallelFor(chunk_count, [&](const size_t chunk) {
+        const size_t first = chunk * batch.size() / chunk_count;
+        const size_t last = (chunk + 1) * batch.size() / chunk_count;
+        for (size_t i = first; i < last; i++) {
+            routes[chunk][ShardIndex(key_of(batch[i]))].push_back(i);
+        }
+    });
+    return routes;
+}
+
+} // namespace rbt
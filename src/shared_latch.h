@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace rbt
+{
+
+/// <summary>
+/// Back off while a latch is held, yield the core after a while so that a preempted owner can run.
+/// </summary>
+/// <param name="spin">The number of failed attempts so far.</param>
+inline void SpinPause(const size_t spin) noexcept
+{
+    if (spin < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * Four-byte reader-writer spin latch, small enough to live in every tree node.
+ * A waiting writer blocks new readers, so a hot node cannot starve writers. Satisfies SharedLockable,
+ * so std::unique_lock and std::shared_lock work with it. Meant for short critical sections only.
+ */
+class SharedLatch
+{
+public:
+    SharedLatch() = default;
+
+    SharedLatch(const SharedLatch&) = delete;
+
+    auto operator=(const SharedLatch&) -> SharedLatch& = delete;
+
+    void lock() noexcept
+    {
+        for (size_t spin = 0;; spin++) {
+            std::uint32_t state = state_.load(std::memory_order_relaxed);
+            if ((state & ~kWriterWaiting) == 0 && state_.compare_exchange_weak(state, kWriter, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return;
+            }
+            if (!(state & kWriterWaiting)) {
+                state_.fetch_or(kWriterWaiting, std::memory_order_relaxed);
+            }
+            SpinPause(spin);
+        }
+    }
+
+    bool try_lock() noexcept
+    {
+        std::uint32_t state = state_.load(std::memory_order_relaxed);
+        return (state & ~kWriterWaiting) == 0 && state_.compare_exchange_strong(state, kWriter, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock() noexcept { state_.fetch_and(~kWriter, std::memory_order_release); }
+
+    void lock_shared() noexcept
+    {
+        for (size_t spin = 0; !try_lock_shared(); spin++) {
+            SpinPause(spin);
+        }
+    }
+
+    bool try_lock_shared() noexcept
+    {
+        std::uint32_t state = state_.load(std::memory_order_relaxed);
+        return !(state & (kWriter | kWriterWaiting)) && state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock_shared() noexcept { state_.fetch_sub(1, std::memory_order_release); }
+
+private:
+    static constexpr std::uint32_t kWriter = std::uint32_t{1} << 31;
+    static constexpr std::uint32_t kWriterWaiting = std::uint32_t{1} << 30;
+
+    // Bit 31 is the writer, bit 30 a waiting writer, the rest counts the readers.
+    std::atomic<std::uint32_t> state_ = 0;
+};
+
+/**
+ * Exclusive spin latch with a version, for optimistic readers that take no latch at all.
+ * A reader remembers the version, reads what it needs and validates that the version is unchanged, like a seqlock.
+ * Every unlock bumps the version, so a reader notices any update in between and retries. Satisfies Lockable.
+ */
+class VersionLatch
+{
+public:
+    VersionLatch() = default;
+
+    VersionLatch(const VersionLatch&) = delete;
+
+    auto operator=(const VersionLatch&) -> VersionLatch& = delete;
+
+    void lock() noexcept
+    {
+        for (size_t spin = 0; !try_lock(); spin++) {
+            SpinPause(spin);
+        }
+    }
+
+    bool try_lock() noexcept
+    {
+        std::uint64_t version = version_.load(std::memory_order_relaxed);
+        if ((version & kLocked) || !version_.compare_exchange_weak(version, version | kLocked, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+        }
+        // A reader that sees any write of the critical section sees the lock bit as well.
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+    }
+
+    void unlock() noexcept { version_.fetch_add(1, std::memory_order_release); }
+
+    /// <summary>
+    /// Wait until the latch is free and get its version.
+    /// </summary>
+    /// <returns>The version to validate against.</returns>
+    auto ReadVersion() const noexcept -> std::uint64_t
+    {
+        for (size_t spin = 0;; spin++) {
+            const std::uint64_t version = version_.load(std::memory_order_acquire);
+            if (!(version & kLocked)) {
+                return version;
+            }
+            SpinPause(spin);
+        }
+    }
+
+    /// <summary>
+    /// Check that nothing was changed under the latch since the version was read.
+    /// </summary>
+    /// <param name="version">The version from ReadVersion.</param>
+    /// <returns>True for the reads in between are consistent.</returns>
+    [[nodiscard]] bool Validate(const std::uint64_t version) const noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version_.load(std::memory_order_relaxed) == version;
+    }
+
+private:
+    static constexpr std::uint64_t kLocked = 1;
+
+    // Bit 0 is the writer, the rest counts the updates.
+    std::atomic<std::uint64_t> version_ = 0;
+};
+
+} // namespace rbt
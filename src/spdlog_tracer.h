@@ -0,0 +1,47 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include <sstream>
+#include <string_view>
+
+#include "tree_policy.h"
+
+namespace rbt
+{
+
+/**
+ * Tracer logging every rebalancing step with the whole tree at the spdlog debug level, see TracerPolicy.
+ * Printing the tree is O(n) per step, so this is for small trees under a debugger only.
+ */
+struct SpdlogTracer
+{
+    template <class Tree, typename KeyType> static void Trace(const Tree& tree, const TraceEvent event, const KeyType& key)
+    {
+        if (!spdlog::should_log(spdlog::level::debug)) {
+            return;
+        }
+        std::ostringstream os;
+        tree.PrintTree(os);
+        spdlog::debug("\n{} {}:\n{}", EventName(event), key, os.str());
+    }
+
+    static auto EventName(const TraceEvent event) -> std::string_view
+    {
+        switch (event) {
+        case TraceEvent::BeforeInsert:
+            return "Before insert";
+        case TraceEvent::AfterInsert:
+            return "After insert";
+        case TraceEvent::BeforeErase:
+            return "Before delete";
+        case TraceEvent::EraseRecolor:
+            return "After recolor";
+        case TraceEvent::AfterErase:
+            return "After delete";
+        }
+        return "";
+    }
+};
+
+} // namespace rbt
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "shared_latch.h"
+
+namespace rbt
+{
+
+/**
+ * Fixed set of worker threads with one task queue each. A worker runs its own queue from the back and steals from
+ * the front of the others once it runs dry, so uneven tasks still keep every core busy.
+ * The thread calling ParallelFor works on the tasks as well, so a pool of one thread has no worker at all.
+ */
+class ThreadPool
+{
+public:
+    /// <summary>
+    /// Start the workers.
+    /// </summary>
+    /// <param name="thread_count">The number of threads running tasks, including the caller of ParallelFor.</param>
+    explicit ThreadPool(const size_t thread_count = std::thread::hardware_concurrency()) : queues_(std::max<size_t>(thread_count, 1))
+    {
+        for (size_t i = 1; i < queues_.size(); i++) {
+            workers_.emplace_back([this, i] { WorkerLoop(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+    ~ThreadPool() noexcept
+    {
+        {
+            std::lock_guard lock(sleep_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    [[nodiscard]] auto ThreadCount() const -> size_t { return queues_.size(); }
+
+    /// <summary>
+    /// Call function(i) for every i in [0, count) on the pool and wait for all of them.
+    /// The first exception thrown by a call is rethrown here once every call has finished.
+    /// </summary>
+    /// <param name="count">The number of calls.</param>
+    /// <param name="function">The function.</param>
+    template <typename Function>
+        requires std::invocable<Function&, size_t>
+    void ParallelFor(size_t count, Function&& function);
+
+private:
+    struct Job
+    {
+        void (*Invoke)(void* function, size_t index) = nullptr;
+        void* Function = nullptr;
+        std::atomic<size_t> Pending = 0;
+        std::atomic<bool> Failed = false;
+        std::exception_ptr Error;
+    };
+
+    struct Task
+    {
+        Job* Owner;
+        size_t Index;
+    };
+
+    struct alignas(64) Queue
+    {
+        std::mutex Mutex;
+        std::deque<Task> Tasks;
+    };
+
+    // Queue 0 is shared by the callers of ParallelFor, queue i > 0 belongs to worker i.
+    std::vector<Queue> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> queued_ = 0;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+
+    /// <summary>
+    /// Run one task, from the own queue if possible, else stolen from another one.
+    /// </summary>
+    /// <param name="self">The index of the own queue.</param>
+    /// <returns>False for every queue is empty.</returns>
+    bool TryRun(size_t self);
+
+    void WorkerLoop(size_t self);
+
+    static void Run(const Task& task) noexcept;
+};
+
+template <typename Function>
+    requires std::invocable<Function&, size_t>
+void ThreadPool::ParallelFor(const size_t count, Function&& function)
+{
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || queues_.size() == 1) {
+        for (size_t i = 0; i < count; i++) {
+            function(i);
+        }
+        return;
+    }
+
+    using FunctionType = std::remove_reference_t<Function>;
+    Job job;
+    job.Invoke = [](void* f, const size_t index) { (*static_cast<FunctionType*>(f))(index); };
+    job.Function = const_cast<void*>(static_cast<const void*>(std::addressof(function))); // NOLINT
+    job.Pending.store(count, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        Queue& queue = queues_[i % queues_.size()];
+        std::lock_guard lock(queue.Mutex);
+        queue.Tasks.push_back({&job, i});
+    }
+    {
+        std::lock_guard lock(sleep_mutex_);
+        queued_.fetch_add(count, std::memory_order_relaxed);
+    }
+    wake_.notify_all();
+
+    // Help until the job is done, other jobs' tasks included, then wait for the calls still running elsewhere.
+    for (size_t spin = 0; job.Pending.load(std::memory_order_acquire) != 0;) {
+        if (TryRun(0)) {
+            spin = 0;
+        } else {
+            SpinPause(spin++);
+        }
+    }
+    if (job.Failed.load(std::memory_order_relaxed)) {
+        std::rethrow_exception(job.Error);
+    }
+}
+
+inline bool ThreadPool::TryRun(const size_t self)
+{
+    if (queued_.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < queues_.size(); i++) {
+        Queue& queue = queues_[(self + i) % queues_.size()];
+        std::unique_lock lock(queue.Mutex);
+        if (queue.Tasks.empty()) {
+            continue;
+        }
+        const Task task = i == 0 ? queue.Tasks.back() : queue.Tasks.front();
+        i == 0 ? queue.Tasks.pop_back() : queue.Tasks.pop_front();
+        lock.unlock();
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        Run(task);
+        return true;
+    }
+    return false;
+}
+
+inline void ThreadPool::WorkerLoop(const size_t self)
+{
+    while (true) {
+        if (TryRun(self)) {
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stop_ || queued_.load(std::memory_order_relaxed) != 0; });
+        if (stop_) {
+            return;
+        }
+    }
+}
+
+inline void ThreadPool::Run(const Task& task) noexcept
+{
+    Job& job = *task.Owner;
+    try {
+        job.Invoke(job.Function, task.Index);
+    } catch (...) {
+        if (!job.Failed.exchange(true, std::memory_order_relaxed)) {
+            job.Error = std::current_exception();
+        }
+    }
+    // The job lives on the stack of its caller, which may return as soon as this reaches zero.
+    job.Pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+} // namespace rbt
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <limits>
+
+#include "tree_statistics.h"
+
+namespace rbt
+{
+
+/**
+ * Subtree aggregate of a node, e.g. the sum of values or the max interval endpoint below it.
+ * Combine folds one node with the aggregates of its left and right subtrees, Identity stands for an empty subtree.
+ * Combine must be associative over the in-order sequence, so that any key range can be assembled from O(log n) pieces.
+ */
+template <typename Aggregate, typename KeyType, typename ValueType>
+concept IsAggregate = requires(const KeyType& key, const ValueType& value, const typename Aggregate::Type& left, const typename Aggregate::Type& right) {
+    { Aggregate::Identity() } -> std::convertible_to<typename Aggregate::Type>;
+    { Aggregate::Combine(key, value, left, right) } -> std::convertible_to<typename Aggregate::Type>;
+};
+
+/**
+ * No subtree aggregate.
+ */
+struct NoAggregate
+{
+    using Type = void;
+};
+
+/**
+ * Sum of values.
+ */
+template <typename T> struct SumAggregate
+{
+    using Type = T;
+
+    static auto Identity() -> T { return T{}; }
+
+    template <typename KeyType, typename ValueType> static auto Combine(const KeyType&, const ValueType& value, const T& left, const T& right) -> T
+    {
+        return left + static_cast<T>(value) + right;
+    }
+};
+
+/**
+ * Min of values, e.g. the earliest timestamp.
+ */
+template <typename T> struct MinAggregate
+{
+    using Type = T;
+
+    static auto Identity() -> T { return std::numeric_limits<T>::max(); }
+
+    template <typename KeyType, typename ValueType> static auto Combine(const KeyType&, const ValueType& value, const T& left, const T& right) -> T
+    {
+        return std::min({left, static_cast<T>(value), right});
+    }
+};
+
+/**
+ * Max of values, e.g. the max endpoint of an interval tree keyed by interval start.
+ */
+template <typename T> struct MaxAggregate
+{
+    using Type = T;
+
+    static auto Identity() -> T { return std::numeric_limits<T>::lowest(); }
+
+    template <typename KeyType, typename ValueType> static auto Combine(const KeyType&, const ValueType& value, const T& left, const T& right) -> T
+    {
+        return std::max({left, static_cast<T>(value), right});
+    }
+};
+
+/**
+ * Memory layout of the tree nodes.
+ */
+enum class NodeLayout
+{
+    /**
+     * Two child pointers and a color byte.
+     */
+    Pointer,
+
+    /**
+     * Two child pointers, the color lives in the low bit of the left one.
+     */
+    PackedColor,
+
+    /**
+     * Two 32-bit child indices into chunks owned by the tree, the color lives in the top bit of the left one.
+     * At most 2^31 nodes, an <int, int> node takes 16 bytes instead of 32.
+     */
+    Index32
+};
+
+/**
+ * Synchronization of ConcurrentRedBlackTree.
+ */
+enum class LockMode
+{
+    /**
+     * One std::shared_mutex for the whole tree, lookups run in parallel and updates one at a time.
+     */
+    SharedMutex,
+
+    /**
+     * A latch in every node, taken hand over hand along the search path. Updates lock a sliding window of a few
+     * levels instead of the whole tree, so updates in different subtrees run in parallel.
+     */
+    LockCoupling,
+
+    /**
+     * Updates as in LockCoupling, lookups take no latch at all. A lookup reads the version of every node on its path
+     * and starts over if an update changed one of them meanwhile. Erased nodes are freed once no lookup can still
+     * reach them, see EpochDomain. Keys and values must be trivially copyable, as they may be read while being written.
+     */
+    Optimistic
+};
+
+/**
+ * Steps of Insert and Erase reported to a tracer.
+ */
+enum class TraceEvent
+{
+    /**
+     * Insert starts, with the key to insert.
+     */
+    BeforeInsert,
+
+    /**
+     * Insert linked a new node and rebalanced, with its key.
+     */
+    AfterInsert,
+
+    /**
+     * Erase starts, with the key to erase.
+     */
+    BeforeErase,
+
+    /**
+     * The top-down pass of Erase recolored and rotated around the node with the given key to make it red.
+     */
+    EraseRecolor,
+
+    /**
+     * Erase unlinked a node, with the key to erase.
+     */
+    AfterErase
+};
+
+/**
+ * Observer of the steps of Insert and Erase, for debugging the rebalancing.
+ * Trace is called with the tree, which is in a valid binary search tree state but may break the color rules in between.
+ */
+template <typename Tracer, typename Tree, typename KeyType>
+concept IsTracer = requires(const Tree& tree, const KeyType& key) { Tracer::Trace(tree, TraceEvent::BeforeInsert, key); };
+
+/**
+ * No tracer, the hooks compile to nothing.
+ */
+struct NoTracer
+{
+};
+
+/**
+ * Compile-time options of RedBlackTree.
+ * Derive from it and shadow the members to customize a tree, every feature left untouched is compiled out.
+ */
+struct DefaultTreePolicy
+{
+    /**
+     * Keep the subtree size in every node, which enables Rank, Select and CountInRange.
+     */
+    static constexpr bool kOrderStatistics = false;
+
+    /**
+     * Subtree aggregate kept in every node, which enables Aggregate(lo, hi). See IsAggregate.
+     */
+    using Aggregate = NoAggregate;
+
+    /**
+     * Memory layout of the nodes. See NodeLayout.
+     */
+    static constexpr NodeLayout kNodeLayout = NodeLayout::Pointer;
+
+    /**
+     * Latch kept in every node, e.g. SharedLatch for LockMode::LockCoupling, void for none.
+     */
+    using NodeLatch = void;
+
+    /**
+     * Whether links and the root pointer are read and written through relaxed atomics, for lookups that follow them
+     * without latches while updates change them, e.g. LockMode::Optimistic.
+     */
+    static constexpr bool kAtomicLinks = false;
+
+    /**
+     * Observer of the rebalancing steps, see IsTracer. NoTracer for none.
+     */
+    using Tracer = NoTracer;
+
+    /**
+     * Event counters, e.g. OperationCounters<Tag>, void for none.
+     */
+    using Counters = void;
+};
+
+/**
+ * Policy of an order-statistic tree.
+ */
+struct OrderStatisticsPolicy : DefaultTreePolicy
+{
+    static constexpr bool kOrderStatistics = true;
+};
+
+/**
+ * Policy of a tree maintaining the given subtree aggregate.
+ */
+template <typename AggregateType> struct AggregatePolicy : DefaultTreePolicy
+{
+    using Aggregate = AggregateType;
+};
+
+/**
+ * Policy of a tree with the given node layout.
+ */
+template <NodeLayout Layout> struct LayoutPolicy : DefaultTreePolicy
+{
+    static constexpr NodeLayout kNodeLayout = Layout;
+};
+
+/**
+ * Policy of a tree reporting its rebalancing steps to the given tracer, on top of another policy.
+ */
+template <class TracerType, class BasePolicy = DefaultTreePolicy> struct TracerPolicy : BasePolicy
+{
+    using Tracer = TracerType;
+};
+
+/**
+ * Policy of a tree counting its comparisons, rotations, allocations and more into OperationCounters<Tag>, on top of another policy.
+ */
+template <class Tag = void, class BasePolicy = DefaultTreePolicy> struct StatisticsPolicy : BasePolicy
+{
+    using Counters = OperationCounters<Tag>;
+};
+
+/**
+ * Policy of a tree with the given latch in every node, on top of another policy.
+ * AtomicLinks is set when lookups read the links without taking the latches.
+ */
+template <class BasePolicy, class Latch, bool AtomicLinks = false> struct LatchPolicy : BasePolicy
+{
+    using NodeLatch = Latch;
+    static constexpr bool kAtomicLinks = AtomicLinks;
+};
+
+} // namespace rbt
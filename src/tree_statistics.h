@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace rbt
+{
+
+/**
+ * Events counted by OperationCounters.
+ */
+enum class Counter
+{
+    Inserts,
+    Erases,
+    /**
+     * Lookups of a single key, e.g. GetValue, Contains and Visit, one per key of GetValues, and one per descent of the
+     * ordered queries: a bound, Floor, Find, Rank, Aggregate and RangeScan count one, EqualRange counts two.
+     */
+    Lookups,
+    /**
+     * Key comparisons of updates, lookups and rebalancing alike, a three-way comparison counts one.
+     */
+    Comparisons,
+    /**
+     * Single rotations of HandleRotation, a double rotation counts two.
+     */
+    Rotations,
+    /**
+     * Color flips of HandleReorient on the way down of an insert.
+     */
+    Reorients,
+    /**
+     * Steps of the top-down pass of Erase that make the current node red.
+     */
+    EraseRecolors,
+    /**
+     * Double rotations of Erase.
+     */
+    EraseDoubleRotations,
+    NodesAllocated,
+    NodesFreed,
+};
+
+inline constexpr size_t kCounterCount = static_cast<size_t>(Counter::NodesFreed) + 1;
+
+/**
+ * Totals of OperationCounters.
+ */
+struct OperationCounts
+{
+    std::array<std::uint64_t, kCounterCount> Values{};
+
+    [[nodiscard]] auto operator[](const Counter counter) const -> std::uint64_t { return Values[static_cast<size_t>(counter)]; }
+
+    /// <summary>
+    /// Get the average number of comparisons per insert, erase and lookup.
+    /// </summary>
+    [[nodiscard]] auto ComparisonsPerOperation() const -> double
+    {
+        const std::uint64_t operations = (*this)[Counter::Inserts] + (*this)[Counter::Erases] + (*this)[Counter::Lookups];
+        return operations == 0 ? 0.0 : static_cast<double>((*this)[Counter::Comparisons]) / static_cast<double>(operations);
+    }
+
+    /// <summary>
+    /// Get the counts since an earlier snapshot.
+    /// </summary>
+    [[nodiscard]] auto operator-(const OperationCounts& earlier) const -> OperationCounts
+    {
+        OperationCounts difference;
+        for (size_t i = 0; i < kCounterCount; i++) {
+            difference.Values[i] = Values[i] - earlier.Values[i];
+        }
+        return difference;
+    }
+};
+
+/**
+ * Shape and size of a tree, see RedBlackTree::Stats.
+ */
+struct TreeStats
+{
+    size_t Size = 0;
+
+    /**
+     * Nodes on the longest path from the root down, 0 for an empty tree.
+     */
+    int Height = 0;
+
+    /**
+     * Black nodes on every path from the root down.
+     */
+    int BlackHeight = 0;
+
+    /**
+     * Average depth of the nodes, the root has depth 0.
+     */
+    double AverageDepth = 0;
+
+    /**
+     * Number of nodes at every depth, up to the max depth Height - 1.
+     */
+    std::vector<size_t> DepthHistogram;
+
+    /**
+     * Bytes of the tree object and its nodes, without the bookkeeping of the allocator.
+     */
+    size_t MemoryBytes = 0;
+
+    /**
+     * Totals of the counters of the tree policy, shared by every tree counting into them. Zero without StatisticsPolicy.
+     */
+    OperationCounts Counts;
+};
+
+/**
+ * Process-wide event counters of the trees whose policy names them, see StatisticsPolicy.
+ * Every thread counts into its own block with relaxed loads and stores, no read-modify-write and no shared cache line,
+ * so counting costs a few cycles. Snapshot sums the blocks of the running threads and the totals of the exited ones.
+ * Counters only grow, subtract two snapshots to measure an interval. Trees counting into different Tag types are
+ * counted apart.
+ */
+template <class Tag = void> class OperationCounters
+{
+public:
+    static void Add(const Counter counter, const std::uint64_t count = 1)
+    {
+        std::atomic<std::uint64_t>& value = LocalBlock().Values[static_cast<size_t>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Sum the counters of all threads. Counts added concurrently may or may not be included.
+    /// </summary>
+    static auto Snapshot() -> OperationCounts
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard lock(registry.Mutex);
+        OperationCounts counts = registry.Exited;
+        for (const Block* block : registry.Blocks) {
+            for (size_t i = 0; i < kCounterCount; i++) {
+                counts.Values[i] += block->Values[i].load(std::memory_order_relaxed);
+            }
+        }
+        return counts;
+    }
+
+private:
+    struct alignas(64) Block
+    {
+        std::array<std::atomic<std::uint64_t>, kCounterCount> Values{};
+
+        Block()
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard lock(registry.Mutex);
+            registry.Blocks.push_back(this);
+        }
+
+        Block(const Block&) = delete;
+
+        auto operator=(const Block&) -> Block& = delete;
+
+        ~Block() noexcept
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard lock(registry.Mutex);
+            for (size_t i = 0; i < kCounterCount; i++) {
+                registry.Exited.Values[i] += Values[i].load(std::memory_order_relaxed);
+            }
+            std::erase(registry.Blocks, this);
+        }
+    };
+
+    struct Registry
+    {
+        std::mutex Mutex;
+        std::vector<const Block*> Blocks;
+        OperationCounts Exited;
+    };
+
+    static auto GetRegistry() -> Registry&
+    {
+        // Never destroyed, the blocks of threads still running at exit unregister after static destructors.
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    static auto LocalBlock() -> Block&
+    {
+        thread_local Block block;
+        return block;
+    }
+};
+
+} // namespace rbt
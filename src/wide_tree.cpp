@@ -0,0 +1,11 @@
+#include "wide_tree.h"
+
+namespace rbt
+{
+
+/**
+ * Precompiled instantiation of the most common specialization, see red_black_tree.cpp.
+ */
+template class WideTree<int, int>;
+
+} // namespace rbt
@@ -0,0 +1,421 @@
+#pragma once
+
+/**
+ * Header-only B+ tree with the same interface as RedBlackTree.
+ * Nodes keep their keys in one sorted block of about two cache lines, so a lookup touches a few wide nodes
+ * instead of one binary node per level. Prefer it for read-heavy tables and RedBlackTree for write-heavy ones;
+ * switching is a matter of changing a type alias. All member definitions live in wide_tree.inl.
+ */
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "key_search.h"
+#include "red_black_tree.h"
+
+namespace rbt
+{
+
+#define WIDE_TREE_TEMPLATE_ARGUMENT template <typename KeyType, typename ValueType, size_t Fanout, class KeyComparator, class Allocator>
+#define WIDE_TREE_TYPE WideTree<KeyType, ValueType, Fanout, KeyComparator, Allocator>
+#define WIDE_TREE_REQUIRES requires std::default_initializable<KeyType> && std::default_initializable<ValueType> && IsComparator<KeyType, KeyComparator>
+
+/**
+ * Default fanout of WideTree, keys of one node fill two cache lines.
+ */
+template <typename KeyType> inline constexpr size_t kWideTreeFanout = std::max<size_t>(8, 128 / sizeof(KeyType));
+
+template <typename KeyType, typename ValueType, size_t Fanout = kWideTreeFanout<KeyType>, class KeyComparator = std::less<KeyType>,
+          class Allocator = std::allocator<std::pair<const KeyType, ValueType>>>
+WIDE_TREE_REQUIRES class WideTree
+{
+    static_assert(Fanout >= 4 && Fanout <= UINT16_MAX, "Fanout must be in [4, 65535].");
+
+    static constexpr size_t kCacheLine = 64;
+
+    /**
+     * Every node but the root holds at least half of Fanout keys.
+     */
+    static constexpr size_t kMinKeys = Fanout / 2;
+
+    /**
+     * Upper bound of the tree height, nodes have at least two children.
+     */
+    static constexpr size_t kMaxHeight = 64;
+
+    struct alignas(kCacheLine) LeafNode
+    {
+        std::array<KeyType, Fanout> Keys{};
+        std::array<ValueType, Fanout> Values{};
+        LeafNode* Next = nullptr;
+        std::uint16_t Count = 0;
+    };
+
+    /**
+     * Keys[i] separates Children[i] and Children[i + 1], it is not greater than any key of Children[i + 1].
+     */
+    struct alignas(kCacheLine) InnerNode
+    {
+        std::array<KeyType, Fanout> Keys{};
+        std::array<void*, Fanout + 1> Children{};
+        std::uint16_t Count = 0;
+    };
+
+    using LeafAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<LeafNode>;
+    using LeafAllocatorTraits = std::allocator_traits<LeafAllocator>;
+    using InnerAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<InnerNode>;
+    using InnerAllocatorTraits = std::allocator_traits<InnerAllocator>;
+
+    static constexpr bool kThreeWayComparator = IsThreeWayComparator<KeyType, KeyComparator>;
+
+public:
+    /**
+     * Integer keys in their natural order are searched with SIMD, see key_search.h.
+     */
+    static constexpr bool kSimdSearch = IsSimdKey<KeyType> && (std::is_same_v<KeyComparator, std::less<KeyType>> || std::is_same_v<KeyComparator, std::less<>>
+                                                               || std::is_same_v<KeyComparator, std::compare_three_way>);
+
+    /**
+     * Forward in-order iterator walking the leaf chain.
+     * Any insertion or deletion invalidates all iterators.
+     */
+    template <bool IsConst> class Iterator
+    {
+        friend class WideTree;
+        template <bool> friend class Iterator;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = std::pair<const KeyType&, std::conditional_t<IsConst, const ValueType&, ValueType&>>;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        /**
+         * Entries are returned by value as a pair of references, operator-> keeps that pair alive.
+         */
+        struct pointer
+        {
+            value_type Entry;
+
+            auto operator->() const -> const value_type* { return &Entry; }
+        };
+
+        Iterator() = default;
+
+        template <bool OtherConst>
+            requires(IsConst && !OtherConst)
+        Iterator(const Iterator<OtherConst>& other) : leaf_(other.leaf_), index_(other.index_) // NOLINT
+        {}
+
+        auto operator*() const -> reference { return {leaf_->Keys[index_], leaf_->Values[index_]}; }
+
+        auto operator->() const -> pointer { return {**this}; }
+
+        auto operator++() -> Iterator&
+        {
+            if (++index_ == leaf_->Count) {
+                leaf_ = leaf_->Next;
+                index_ = 0;
+            }
+            return *this;
+        }
+
+        auto operator++(int) -> Iterator
+        {
+            Iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        friend bool operator==(const Iterator& lhs, const Iterator& rhs) { return lhs.leaf_ == rhs.leaf_ && lhs.index_ == rhs.index_; }
+
+    private:
+        using LeafPointer = std::conditional_t<IsConst, const LeafNode*, LeafNode*>;
+
+        LeafPointer leaf_ = nullptr;
+        size_t index_ = 0;
+
+        Iterator(LeafPointer leaf, const size_t index) : leaf_(leaf), index_(index) {}
+    };
+
+    using AllocatorType = Allocator;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    WideTree() = default;
+
+    explicit WideTree(const Allocator& allocator) : leaf_allocator_(allocator), inner_allocator_(allocator) {}
+
+    explicit WideTree(const KeyComparator& key_comparator, const Allocator& allocator = Allocator())
+        : key_comparator_(key_comparator), leaf_allocator_(allocator), inner_allocator_(allocator)
+    {}
+
+    WideTree(const WideTree&) = delete;
+
+    /// <summary>
+    /// Take over all nodes of another tree in O(1), the other tree is left empty.
+    /// </summary>
+    /// <param name="other">The other tree.</param>
+    WideTree(WideTree&& other) noexcept
+        : root_(std::exchange(other.root_, nullptr)), size_(std::exchange(other.size_, 0)), height_(std::exchange(other.height_, 0)),
+          key_comparator_(std::move(other.key_comparator_)), leaf_allocator_(std::move(other.leaf_allocator_)),
+          inner_allocator_(std::move(other.inner_allocator_))
+    {}
+
+    auto operator=(const WideTree&) -> WideTree& = delete;
+
+    /// <summary>
+    /// Take over all nodes of another tree in O(1) if the allocator propagates or both allocators are equal,
+    /// otherwise copy the elements one by one into nodes of this allocator. The other tree is left empty.
+    /// </summary>
+    /// <param name="other">The other tree.</param>
+    /// <returns>This tree.</returns>
+    auto operator=(WideTree&& other) -> WideTree&;
+
+    ~WideTree() noexcept { Clear(); }
+
+    /// <summary>
+    /// Insert key-value pair into the tree.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    /// <returns>True for success, false for the key already exists.</returns>
+    bool Insert(const KeyType& key, const ValueType& value);
+
+    /// <summary>
+    /// Delete the element with the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>True for success, false for the key does not exist.</returns>
+    bool Erase(const KeyType& key);
+
+    /// <summary>
+    /// Get the value of the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The value, or std::nullopt if there is no such key.</returns>
+    [[nodiscard]] auto GetValue(const KeyType& key) const -> std::optional<ValueType>
+    {
+        const auto [leaf, index] = FindEntry(key);
+        return leaf ? std::optional<ValueType>(leaf->Values[index]) : std::nullopt;
+    }
+
+    /// <summary>
+    /// Check whether the given key exists.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>True for the key exists.</returns>
+    [[nodiscard]] bool Contains(const KeyType& key) const { return FindEntry(key).first != nullptr; }
+
+    /// <summary>
+    /// Get the iterator to the element with the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The iterator, or the end iterator if there is no such element.</returns>
+    auto Find(const KeyType& key) -> iterator
+    {
+        const auto [leaf, index] = FindEntry(key);
+        return leaf ? iterator(leaf, index) : end();
+    }
+
+    auto Find(const KeyType& key) const -> const_iterator
+    {
+        const auto [leaf, index] = FindEntry(key);
+        return leaf ? const_iterator(leaf, index) : end();
+    }
+
+    /// <summary>
+    /// Get size of the tree.
+    /// </summary>
+    /// <returns>The size.</returns>
+    [[nodiscard]] auto Size() const -> size_t { return size_; }
+
+    /// <summary>
+    /// Check whether the tree is empty.
+    /// </summary>
+    /// <returns>True for the tree is empty.</returns>
+    [[nodiscard]] bool IsEmpty() const { return size_ == 0; }
+
+    /// <summary>
+    /// Get the number of node levels, 0 for an empty tree.
+    /// </summary>
+    /// <returns>The height.</returns>
+    [[nodiscard]] auto Height() const -> size_t { return height_; }
+
+    /// <summary>
+    /// Delete all elements.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Exchange the contents of two trees in O(1).
+    /// Unless the allocator propagates on swap, both allocators must be equal.
+    /// </summary>
+    /// <param name="other">The other tree.</param>
+    void Swap(WideTree& other) noexcept;
+
+    friend void swap(WideTree& lhs, WideTree& rhs) noexcept { lhs.Swap(rhs); }
+
+    auto begin() -> iterator { return iterator(FirstLeaf(), 0); }
+
+    auto end() -> iterator { return {}; }
+
+    auto begin() const -> const_iterator { return const_iterator(FirstLeaf(), 0); }
+
+    auto end() const -> const_iterator { return {}; }
+
+    /// <summary>
+    /// Get a copy of the allocator.
+    /// </summary>
+    /// <returns>The allocator.</returns>
+    [[nodiscard]] auto GetAllocator() const -> Allocator { return Allocator(leaf_allocator_); }
+
+    /// <summary>
+    /// Check the B+ tree rules: sorted keys, separators bounding their subtrees, node fill and the leaf chain.
+    /// </summary>
+    /// <returns>True for all rules hold.</returns>
+    bool WideTreeRulesCheck() const;
+
+private:
+    void* root_ = nullptr;
+    size_t size_ = 0;
+    size_t height_ = 0;
+    KeyComparator key_comparator_{};
+    [[no_unique_address]] LeafAllocator leaf_allocator_{};
+    [[no_unique_address]] InnerAllocator inner_allocator_{};
+
+    /// <summary>
+    /// Get the leaf and the slot holding the given key.
+    /// </summary>
+    /// <param name="key">The key.</param>
+    /// <returns>The leaf and the slot, or a null leaf if there is no such key.</returns>
+    auto FindEntry(const KeyType& key) const -> std::pair<LeafNode*, size_t>;
+
+    /// <summary>
+    /// Get the leftmost leaf.
+    /// </summary>
+    /// <returns>The leaf, or nullptr for an empty tree.</returns>
+    auto FirstLeaf() const -> LeafNode*;
+
+    /// <summary>
+    /// Count the keys of a node that are less than the given key.
+    /// </summary>
+    /// <param name="keys">The sorted keys.</param>
+    /// <param name="count">The number of keys.</param>
+    /// <param name="key">The key.</param>
+    /// <returns>The slot of the first key not less than the given key.</returns>
+    auto LowerBound(const KeyType* keys, size_t count, const KeyType& key) const -> size_t;
+
+    /// <summary>
+    /// Count the keys of a node that are not greater than the given key.
+    /// </summary>
+    /// <param name="keys">The sorted keys.</param>
+    /// <param name="count">The number of keys.</param>
+    /// <param name="key">The key.</param>
+    /// <returns>The slot of the first key greater than the given key, i.e. the child to descend to.</returns>
+    auto UpperBound(const KeyType* keys, size_t count, const KeyType& key) const -> size_t;
+
+    /// <summary>
+    /// Split a full leaf while inserting an entry, the upper half moves to the new right leaf.
+    /// </summary>
+    /// <param name="leaf">The full leaf.</param>
+    /// <param name="right">The new empty leaf.</param>
+    /// <param name="slot">The slot of the new entry.</param>
+    /// <param name="key">The key.</param>
+    /// <param name="value">The value.</param>
+    void SplitLeaf(LeafNode* leaf, LeafNode* right, size_t slot, const KeyType& key, const ValueType& value);
+
+    /// <summary>
+    /// Split a full inner node while inserting a separator and the child right of it.
+    /// </summary>
+    /// <param name="node">The full node.</param>
+    /// <param name="right">The new empty node.</param>
+    /// <param name="slot">The slot of the new separator.</param>
+    /// <param name="separator">The new separator.</param>
+    /// <param name="child">The new child.</param>
+    /// <returns>The separator of node and right, which moves up to the parent.</returns>
+    auto SplitInner(InnerNode* node, InnerNode* right, size_t slot, KeyType separator, void* child) -> KeyType;
+
+    /// <summary>
+    /// Refill an underfull leaf from a sibling, or merge it with one.
+    /// </summary>
+    /// <param name="parent">The parent of the leaf.</param>
+    /// <param name="slot">The child slot of the leaf.</param>
+    /// <returns>True for a merge removed a separator from the parent.</returns>
+    bool RebalanceLeaf(InnerNode* parent, size_t slot);
+
+    /// <summary>
+    /// Refill an underfull inner node from a sibling, or merge it with one.
+    /// </summary>
+    /// <param name="parent">The parent of the node.</param>
+    /// <param name="slot">The child slot of the node.</param>
+    /// <returns>True for a merge removed a separator from the parent.</returns>
+    bool RebalanceInner(InnerNode* parent, size_t slot);
+
+    /// <summary>
+    /// Remove the separator at the given slot and the child right of it.
+    /// </summary>
+    /// <param name="node">The node.</param>
+    /// <param name="slot">The separator slot.</param>
+    static void RemoveSeparator(InnerNode* node, size_t slot);
+
+    /// <summary>
+    /// Check a subtree against the bounds given by the separators above it.
+    /// </summary>
+    /// <param name="node">The subtree root.</param>
+    /// <param name="level">The level of the node, 1 for leaves.</param>
+    /// <param name="lo">The inclusive lower bound, may be null.</param>
+    /// <param name="hi">The exclusive upper bound, may be null.</param>
+    /// <returns>The number of elements, or SIZE_MAX if a rule is broken.</returns>
+    auto CheckSubtree(const void* node, size_t level, const KeyType* lo, const KeyType* hi) const -> size_t;
+
+    /// <summary>
+    /// Destroy all nodes of a subtree.
+    /// </summary>
+    /// <param name="node">The subtree root.</param>
+    /// <param name="level">The level of the node, 1 for leaves.</param>
+    void DestroySubtree(void* node, size_t level) noexcept;
+
+    auto CreateLeaf() -> LeafNode*;
+
+    auto CreateInner() -> InnerNode*;
+
+    void DestroyLeaf(LeafNode* leaf) noexcept;
+
+    void DestroyInner(InnerNode* node) noexcept;
+
+    /// <summary>
+    /// Check whether a key is ordered before another one.
+    /// </summary>
+    /// <param name="lhs">The left key.</param>
+    /// <param name="rhs">The right key.</param>
+    /// <returns>True for lhs is less than rhs.</returns>
+    bool Less(const KeyType& lhs, const KeyType& rhs) const
+    {
+        if constexpr (kThreeWayComparator) {
+            return key_comparator_(lhs, rhs) < 0;
+        } else {
+            return key_comparator_(lhs, rhs);
+        }
+    }
+};
+
+} // namespace rbt
+
+#include "wide_tree.inl"
+
+#ifdef RBT_EXTERN_TEMPLATE
+namespace rbt
+{
+extern template class WideTree<int, int>;
+} // namespace rbt
+#endif
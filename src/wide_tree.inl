@@ -0,0 +1,591 @@
+#pragma once
+
+/**
+ * Template definitions of WideTree.
+ * This file is included at the end of wide_tree.h, do not include it directly.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace rbt
+{
+
+/**
+ * #########################################################################
+ * #########################################################################
+ * ######################  WideTree implementations.  ######################
+ * #########################################################################
+ * #########################################################################
+ */
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+auto WIDE_TREE_TYPE::operator=(WideTree&& other) -> WideTree&
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    Clear();
+    key_comparator_ = std::move(other.key_comparator_);
+    if constexpr (LeafAllocatorTraits::propagate_on_container_move_assignment::value) {
+        leaf_allocator_ = std::move(other.leaf_allocator_);
+        inner_allocator_ = std::move(other.inner_allocator_);
+    } else if (!(leaf_allocator_ == other.leaf_allocator_)) {
+        // Nodes of the other allocator can not be adopted, copy the elements into new nodes instead.
+        for (const auto [key, value] : other) {
+            Insert(key, value);
+        }
+        other.Clear();
+        return *this;
+    }
+
+    root_ = std::exchange(other.root_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    height_ = std::exchange(other.height_, 0);
+    return *this;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+bool WIDE_TREE_TYPE::Insert(const KeyType& key, const ValueType& value)
+{
+    if (!root_) {
+        LeafNode* leaf = CreateLeaf();
+        leaf->Keys[0] = key;
+        leaf->Values[0] = value;
+        leaf->Count = 1;
+        root_ = leaf;
+        height_ = 1;
+        size_ = 1;
+        return true;
+    }
+
+    // Descend and remember the path, splits propagate bottom-up.
+    std::array<InnerNode*, kMaxHeight> path;
+    std::array<size_t, kMaxHeight> slots;
+    size_t depth = 0;
+    void* node = root_;
+    for (size_t level = height_; level > 1; level--) {
+        auto* inner = static_cast<InnerNode*>(node);
+        const size_t slot = UpperBound(inner->Keys.data(), inner->Count, key);
+        path[depth] = inner;
+        slots[depth++] = slot;
+        node = inner->Children[slot];
+    }
+
+    auto* leaf = static_cast<LeafNode*>(node);
+    const size_t slot = LowerBound(leaf->Keys.data(), leaf->Count, key);
+    if (slot < leaf->Count && !Less(key, leaf->Keys[slot])) {
+        return false;
+    }
+
+    if (leaf->Count < Fanout) [[likely]] {
+        std::move_backward(leaf->Keys.begin() + slot, leaf->Keys.begin() + leaf->Count, leaf->Keys.begin() + leaf->Count + 1);
+        std::move_backward(leaf->Values.begin() + slot, leaf->Values.begin() + leaf->Count, leaf->Values.begin() + leaf->Count + 1);
+        leaf->Keys[slot] = key;
+        leaf->Values[slot] = value;
+        leaf->Count++;
+        size_++;
+        return true;
+    }
+
+    // Allocate every node the split needs before touching the tree, so that a failed allocation leaves it intact.
+    size_t split_count = 1;
+    while (split_count <= depth && path[depth - split_count]->Count == Fanout) {
+        split_count++;
+    }
+    const bool grows = split_count > depth;
+    LeafNode* right_leaf = CreateLeaf();
+    std::array<InnerNode*, kMaxHeight + 1> new_inners;
+    size_t new_inner_count = 0;
+    try {
+        for (; new_inner_count < split_count - 1 + grows; new_inner_count++) {
+            new_inners[new_inner_count] = CreateInner();
+        }
+    } catch (...) {
+        while (new_inner_count) {
+            DestroyInner(new_inners[--new_inner_count]);
+        }
+        DestroyLeaf(right_leaf);
+        throw;
+    }
+
+    SplitLeaf(leaf, right_leaf, slot, key, value);
+    KeyType separator = right_leaf->Keys[0];
+    void* child = right_leaf;
+    for (size_t i = 0; i < split_count - 1; i++) {
+        InnerNode* right = new_inners[i];
+        depth--;
+        separator = SplitInner(path[depth], right, slots[depth], std::move(separator), child);
+        child = right;
+    }
+
+    if (grows) {
+        InnerNode* new_root = new_inners[new_inner_count - 1];
+        new_root->Keys[0] = std::move(separator);
+        new_root->Children[0] = root_;
+        new_root->Children[1] = child;
+        new_root->Count = 1;
+        root_ = new_root;
+        height_++;
+    } else {
+        InnerNode* parent = path[--depth];
+        const size_t parent_slot = slots[depth];
+        std::move_backward(parent->Keys.begin() + parent_slot, parent->Keys.begin() + parent->Count, parent->Keys.begin() + parent->Count + 1);
+        std::move_backward(parent->Children.begin() + parent_slot + 1, parent->Children.begin() + parent->Count + 1,
+                           parent->Children.begin() + parent->Count + 2);
+        parent->Keys[parent_slot] = std::move(separator);
+        parent->Children[parent_slot + 1] = child;
+        parent->Count++;
+    }
+    size_++;
+    return true;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+bool WIDE_TREE_TYPE::Erase(const KeyType& key)
+{
+    if (!root_) {
+        return false;
+    }
+
+    std::array<InnerNode*, kMaxHeight> path;
+    std::array<size_t, kMaxHeight> slots;
+    size_t depth = 0;
+    void* node = root_;
+    for (size_t level = height_; level > 1; level--) {
+        auto* inner = static_cast<InnerNode*>(node);
+        const size_t slot = UpperBound(inner->Keys.data(), inner->Count, key);
+        path[depth] = inner;
+        slots[depth++] = slot;
+        node = inner->Children[slot];
+    }
+
+    auto* leaf = static_cast<LeafNode*>(node);
+    const size_t slot = LowerBound(leaf->Keys.data(), leaf->Count, key);
+    if (slot == leaf->Count || Less(key, leaf->Keys[slot])) {
+        return false;
+    }
+
+    std::move(leaf->Keys.begin() + slot + 1, leaf->Keys.begin() + leaf->Count, leaf->Keys.begin() + slot);
+    std::move(leaf->Values.begin() + slot + 1, leaf->Values.begin() + leaf->Count, leaf->Values.begin() + slot);
+    leaf->Count--;
+    size_--;
+
+    if (!depth) {
+        if (!leaf->Count) {
+            DestroyLeaf(leaf);
+            root_ = nullptr;
+            height_ = 0;
+        }
+        return true;
+    }
+    if (leaf->Count >= kMinKeys || !RebalanceLeaf(path[depth - 1], slots[depth - 1])) {
+        return true;
+    }
+
+    // A merge took a separator from the parent, which may underflow in turn.
+    for (size_t i = depth - 1; i > 0 && path[i]->Count < kMinKeys; i--) {
+        if (!RebalanceInner(path[i - 1], slots[i - 1])) {
+            break;
+        }
+    }
+
+    auto* root = static_cast<InnerNode*>(root_);
+    if (!root->Count) {
+        root_ = root->Children[0];
+        height_--;
+        DestroyInner(root);
+    }
+    return true;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+void WIDE_TREE_TYPE::Clear()
+{
+    if (!root_) {
+        return;
+    }
+
+    DestroySubtree(root_, height_);
+    root_ = nullptr;
+    size_ = 0;
+    height_ = 0;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+void WIDE_TREE_TYPE::Swap(WideTree& other) noexcept
+{
+    using std::swap;
+    swap(root_, other.root_);
+    swap(size_, other.size_);
+    swap(height_, other.height_);
+    swap(key_comparator_, other.key_comparator_);
+    if constexpr (LeafAllocatorTraits::propagate_on_container_swap::value) {
+        swap(leaf_allocator_, other.leaf_allocator_);
+        swap(inner_allocator_, other.inner_allocator_);
+    }
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+bool WIDE_TREE_TYPE::WideTreeRulesCheck() const
+{
+    if (!root_) {
+        return size_ == 0 && height_ == 0;
+    }
+    if (CheckSubtree(root_, height_, nullptr, nullptr) != size_) {
+        return false;
+    }
+
+    // The leaf chain visits every element in order.
+    size_t count = 0;
+    const KeyType* previous = nullptr;
+    for (const LeafNode* leaf = FirstLeaf(); leaf; leaf = leaf->Next) {
+        for (size_t i = 0; i < leaf->Count; i++) {
+            if (previous && !Less(*previous, leaf->Keys[i])) {
+                return false;
+            }
+            previous = &leaf->Keys[i];
+            count++;
+        }
+    }
+    return count == size_;
+}
+
+/**
+ * Private methods.
+ */
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+auto WIDE_TREE_TYPE::FindEntry(const KeyType& key) const -> std::pair<LeafNode*, size_t>
+{
+    if (!root_) {
+        return {nullptr, 0};
+    }
+
+    void* node = root_;
+    for (size_t level = height_; level > 1; level--) {
+        const auto* inner = static_cast<const InnerNode*>(node);
+        node = inner->Children[UpperBound(inner->Keys.data(), inner->Count, key)];
+    }
+
+    auto* leaf = static_cast<LeafNode*>(node);
+    const size_t slot = LowerBound(leaf->Keys.data(), leaf->Count, key);
+    if (slot == leaf->Count || Less(key, leaf->Keys[slot])) {
+        return {nullptr, 0};
+    }
+    return {leaf, slot};
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+auto WIDE_TREE_TYPE::FirstLeaf() const -> LeafNode*
+{
+    void* node = root_;
+    for (size_t level = height_; level > 1; level--) {
+        node = static_cast<InnerNode*>(node)->Children[0];
+    }
+    return static_cast<LeafNode*>(node);
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+auto WIDE_TREE_TYPE::LowerBound(const KeyType* keys, const size_t count, const KeyType& key) const -> size_t
+{
+    if constexpr (kSimdSearch) {
+        return SimdLowerBound(keys, count, key);
+    }
+    if (!count) {
+        return 0;
+    }
+
+    // Halve the range without branching on the comparison, the compiler turns the step into a conditional move.
+    const KeyType* base = keys;
+    for (size_t length = count; length > 1; length -= length / 2) {
+        base = Less(base[length / 2 - 1], key) ? base + length / 2 : base;
+    }
+    return static_cast<size_t>(base - keys) + Less(*base, key);
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+auto WIDE_TREE_TYPE::UpperBound(const KeyType* keys, const size_t count, const KeyType& key) const -> size_t
+{
+    if constexpr (kSimdSearch) {
+        return SimdUpperBound(keys, count, key);
+    }
+    if (!count) {
+        return 0;
+    }
+
+    const KeyType* base = keys;
+    for (size_t length = count; length > 1; length -= length / 2) {
+        base = !Less(key, base[length / 2 - 1]) ? base + length / 2 : base;
+    }
+    return static_cast<size_t>(base - keys) + !Less(key, *base);
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+void WIDE_TREE_TYPE::SplitLeaf(LeafNode* leaf, LeafNode* right, const size_t slot, const KeyType& key, const ValueType& value)
+{
+    // Fanout + 1 entries, the left leaf keeps the larger half.
+    constexpr size_t left_count = (Fanout + 2) / 2;
+    constexpr size_t right_count = Fanout + 1 - left_count;
+
+    auto& keys = leaf->Keys;
+    auto& values = leaf->Values;
+    if (slot < left_count) {
+        std::move(keys.begin() + left_count - 1, keys.end(), right->Keys.begin());
+        std::move(values.begin() + left_count - 1, values.end(), right->Values.begin());
+        std::move_backward(keys.begin() + slot, keys.begin() + left_count - 1, keys.begin() + left_count);
+        std::move_backward(values.begin() + slot, values.begin() + left_count - 1, values.begin() + left_count);
+        keys[slot] = key;
+        values[slot] = value;
+    } else {
+        const size_t right_slot = slot - left_count;
+        std::move(keys.begin() + left_count, keys.begin() + slot, right->Keys.begin());
+        std::move(values.begin() + left_count, values.begin() + slot, right->Values.begin());
+        right->Keys[right_slot] = key;
+        right->Values[right_slot] = value;
+        std::move(keys.begin() + slot, keys.end(), right->Keys.begin() + right_slot + 1);
+        std::move(values.begin() + slot, values.end(), right->Values.begin() + right_slot + 1);
+    }
+    leaf->Count = left_count;
+    right->Count = right_count;
+    right->Next = leaf->Next;
+    leaf->Next = right;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+auto WIDE_TREE_TYPE::SplitInner(InnerNode* node, InnerNode* right, const size_t slot, KeyType separator, void* child) -> KeyType
+{
+    // Lay out the Fanout + 1 separators and Fanout + 2 children in order, then deal them out around the middle separator.
+    std::array<KeyType, Fanout + 1> keys;
+    std::array<void*, Fanout + 2> children;
+    std::move(node->Keys.begin(), node->Keys.begin() + slot, keys.begin());
+    keys[slot] = std::move(separator);
+    std::move(node->Keys.begin() + slot, node->Keys.end(), keys.begin() + slot + 1);
+    std::copy(node->Children.begin(), node->Children.begin() + slot + 1, children.begin());
+    children[slot + 1] = child;
+    std::copy(node->Children.begin() + slot + 1, node->Children.end(), children.begin() + slot + 2);
+
+    constexpr size_t left_count = Fanout - Fanout / 2;
+    std::move(keys.begin(), keys.begin() + left_count, node->Keys.begin());
+    std::copy(children.begin(), children.begin() + left_count + 1, node->Children.begin());
+    node->Count = left_count;
+    std::move(keys.begin() + left_count + 1, keys.end(), right->Keys.begin());
+    std::copy(children.begin() + left_count + 1, children.end(), right->Children.begin());
+    right->Count = Fanout / 2;
+    return std::move(keys[left_count]);
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+bool WIDE_TREE_TYPE::RebalanceLeaf(InnerNode* parent, const size_t slot)
+{
+    auto* leaf = static_cast<LeafNode*>(parent->Children[slot]);
+    auto* left = slot > 0 ? static_cast<LeafNode*>(parent->Children[slot - 1]) : nullptr;
+    auto* right = slot < parent->Count ? static_cast<LeafNode*>(parent->Children[slot + 1]) : nullptr;
+
+    if (left && left->Count > kMinKeys) {
+        // Borrow the last entry of the left sibling.
+        std::move_backward(leaf->Keys.begin(), leaf->Keys.begin() + leaf->Count, leaf->Keys.begin() + leaf->Count + 1);
+        std::move_backward(leaf->Values.begin(), leaf->Values.begin() + leaf->Count, leaf->Values.begin() + leaf->Count + 1);
+        left->Count--;
+        leaf->Keys[0] = std::move(left->Keys[left->Count]);
+        leaf->Values[0] = std::move(left->Values[left->Count]);
+        leaf->Count++;
+        parent->Keys[slot - 1] = leaf->Keys[0];
+        return false;
+    }
+    if (right && right->Count > kMinKeys) {
+        // Borrow the first entry of the right sibling.
+        leaf->Keys[leaf->Count] = std::move(right->Keys[0]);
+        leaf->Values[leaf->Count] = std::move(right->Values[0]);
+        leaf->Count++;
+        std::move(right->Keys.begin() + 1, right->Keys.begin() + right->Count, right->Keys.begin());
+        std::move(right->Values.begin() + 1, right->Values.begin() + right->Count, right->Values.begin());
+        right->Count--;
+        parent->Keys[slot] = right->Keys[0];
+        return false;
+    }
+
+    // Both siblings are at the minimum, merge the right one of the pair into the left one.
+    const size_t separator_slot = left ? slot - 1 : slot;
+    LeafNode* into = left ? left : leaf;
+    LeafNode* from = left ? leaf : right;
+    std::move(from->Keys.begin(), from->Keys.begin() + from->Count, into->Keys.begin() + into->Count);
+    std::move(from->Values.begin(), from->Values.begin() + from->Count, into->Values.begin() + into->Count);
+    into->Count += from->Count;
+    into->Next = from->Next;
+    DestroyLeaf(from);
+    RemoveSeparator(parent, separator_slot);
+    return true;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+bool WIDE_TREE_TYPE::RebalanceInner(InnerNode* parent, const size_t slot)
+{
+    auto* node = static_cast<InnerNode*>(parent->Children[slot]);
+    auto* left = slot > 0 ? static_cast<InnerNode*>(parent->Children[slot - 1]) : nullptr;
+    auto* right = slot < parent->Count ? static_cast<InnerNode*>(parent->Children[slot + 1]) : nullptr;
+
+    if (left && left->Count > kMinKeys) {
+        // Rotate the last child of the left sibling through the parent separator.
+        std::move_backward(node->Keys.begin(), node->Keys.begin() + node->Count, node->Keys.begin() + node->Count + 1);
+        std::move_backward(node->Children.begin(), node->Children.begin() + node->Count + 1, node->Children.begin() + node->Count + 2);
+        node->Keys[0] = std::move(parent->Keys[slot - 1]);
+        node->Children[0] = left->Children[left->Count];
+        node->Count++;
+        parent->Keys[slot - 1] = std::move(left->Keys[left->Count - 1]);
+        left->Count--;
+        return false;
+    }
+    if (right && right->Count > kMinKeys) {
+        // Rotate the first child of the right sibling through the parent separator.
+        node->Keys[node->Count] = std::move(parent->Keys[slot]);
+        node->Children[node->Count + 1] = right->Children[0];
+        node->Count++;
+        parent->Keys[slot] = std::move(right->Keys[0]);
+        std::move(right->Keys.begin() + 1, right->Keys.begin() + right->Count, right->Keys.begin());
+        std::move(right->Children.begin() + 1, right->Children.begin() + right->Count + 1, right->Children.begin());
+        right->Count--;
+        return false;
+    }
+
+    // Merge the right node of the pair into the left one, the parent separator moves down between them.
+    const size_t separator_slot = left ? slot - 1 : slot;
+    InnerNode* into = left ? left : node;
+    InnerNode* from = left ? node : right;
+    into->Keys[into->Count] = std::move(parent->Keys[separator_slot]);
+    std::move(from->Keys.begin(), from->Keys.begin() + from->Count, into->Keys.begin() + into->Count + 1);
+    std::copy(from->Children.begin(), from->Children.begin() + from->Count + 1, into->Children.begin() + into->Count + 1);
+    into->Count += from->Count + 1;
+    DestroyInner(from);
+    RemoveSeparator(parent, separator_slot);
+    return true;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+void WIDE_TREE_TYPE::RemoveSeparator(InnerNode* node, const size_t slot)
+{
+    std::move(node->Keys.begin() + slot + 1, node->Keys.begin() + node->Count, node->Keys.begin() + slot);
+    std::copy(node->Children.begin() + slot + 2, node->Children.begin() + node->Count + 1, node->Children.begin() + slot + 1);
+    node->Count--;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+auto WIDE_TREE_TYPE::CheckSubtree(const void* node, const size_t level, const KeyType* lo, const KeyType* hi) const -> size_t
+{
+    constexpr size_t broken = SIZE_MAX;
+    const bool is_root = node == root_;
+
+    const auto in_bounds = [&](const KeyType* keys, const size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if ((i > 0 && !Less(keys[i - 1], keys[i])) || (lo && Less(keys[i], *lo)) || (hi && !Less(keys[i], *hi))) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if (level == 1) {
+        const auto* leaf = static_cast<const LeafNode*>(node);
+        if ((!is_root && leaf->Count < kMinKeys) || leaf->Count == 0 || !in_bounds(leaf->Keys.data(), leaf->Count)) {
+            return broken;
+        }
+        return leaf->Count;
+    }
+
+    const auto* inner = static_cast<const InnerNode*>(node);
+    if ((!is_root && inner->Count < kMinKeys) || inner->Count == 0 || !in_bounds(inner->Keys.data(), inner->Count)) {
+        return broken;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i <= inner->Count; i++) {
+        const size_t child_count =
+            CheckSubtree(inner->Children[i], level - 1, i > 0 ? &inner->Keys[i - 1] : lo, i < inner->Count ? &inner->Keys[i] : hi);
+        if (child_count == broken) {
+            return broken;
+        }
+        count += child_count;
+    }
+    return count;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+void WIDE_TREE_TYPE::DestroySubtree(void* node, const size_t level) noexcept
+{
+    if (level == 1) {
+        DestroyLeaf(static_cast<LeafNode*>(node));
+        return;
+    }
+
+    auto* inner = static_cast<InnerNode*>(node);
+    for (size_t i = 0; i <= inner->Count; i++) {
+        DestroySubtree(inner->Children[i], level - 1);
+    }
+    DestroyInner(inner);
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+auto WIDE_TREE_TYPE::CreateLeaf() -> LeafNode*
+{
+    LeafNode* leaf = LeafAllocatorTraits::allocate(leaf_allocator_, 1);
+    try {
+        LeafAllocatorTraits::construct(leaf_allocator_, leaf);
+    } catch (...) {
+        LeafAllocatorTraits::deallocate(leaf_allocator_, leaf, 1);
+        throw;
+    }
+    return leaf;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+auto WIDE_TREE_TYPE::CreateInner() -> InnerNode*
+{
+    InnerNode* node = InnerAllocatorTraits::allocate(inner_allocator_, 1);
+    try {
+        InnerAllocatorTraits::construct(inner_allocator_, node);
+    } catch (...) {
+        InnerAllocatorTraits::deallocate(inner_allocator_, node, 1);
+        throw;
+    }
+    return node;
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+void WIDE_TREE_TYPE::DestroyLeaf(LeafNode* leaf) noexcept
+{
+    LeafAllocatorTraits::destroy(leaf_allocator_, leaf);
+    LeafAllocatorTraits::deallocate(leaf_allocator_, leaf, 1);
+}
+
+WIDE_TREE_TEMPLATE_ARGUMENT
+WIDE_TREE_REQUIRES
+void WIDE_TREE_TYPE::DestroyInner(InnerNode* node) noexcept
+{
+    InnerAllocatorTraits::destroy(inner_allocator_, node);
+    InnerAllocatorTraits::deallocate(inner_allocator_, node, 1);
+}
+
+} // namespace rbt
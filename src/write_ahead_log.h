@@ -0,0 +1,268 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "mapped_red_black_tree.h"
+
+namespace rbt
+{
+
+/**
+ * Append-only log of opaque records, made durable with group commit: records are appended to a buffer in memory, and
+ * the first thread to commit writes everything buffered so far with one write and one fdatasync while the other
+ * committers wait for it. Every thread arriving during a sync is served by the next one, so the number of syncs
+ * stays near the number of sync durations, not the number of commits.
+ *
+ * Each record is a 16-byte header {payload size, zero, checksum of size and payload} followed by the payload.
+ * A crash may leave a torn record at the end of the file, Replay drops it and everything after it.
+ */
+class WriteAheadLog
+{
+public:
+    /// <summary>
+    /// Open the log, creating an empty one if the file is missing. Call Replay before the first Append.
+    /// </summary>
+    /// <param name="path">The log file.</param>
+    explicit WriteAheadLog(const std::filesystem::path& path) : file_(path, O_RDWR | O_CREAT), file_bytes_(file_.Size())
+    {
+        // Syncing the log does not sync its directory entry, a crash could lose a new log with every commit in it.
+        SyncParentDirectory(path);
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+
+    auto operator=(const WriteAheadLog&) -> WriteAheadLog& = delete;
+
+    /// <summary>
+    /// Call apply(payload) for every intact record in log order, then cut the log behind the last one.
+    /// </summary>
+    /// <param name="apply">The function applying a record.</param>
+    /// <returns>The number of records applied.</returns>
+    template <typename Apply>
+        requires std::invocable<Apply&, std::span<const std::byte>>
+    auto Replay(Apply&& apply) -> size_t;
+
+    /// <summary>
+    /// Append a record to the buffer, it is not durable before Commit returns.
+    /// The header stores the payload size in 32 bits, larger payloads throw std::length_error.
+    /// </summary>
+    /// <param name="payload">The record.</param>
+    /// <returns>The log sequence number to commit.</returns>
+    auto Append(std::span<const std::byte> payload) -> std::uint64_t;
+
+    /// <summary>
+    /// Wait until the record with the given sequence number and every record before it are durable.
+    /// Once a write or sync failed, the log is unusable and every commit rethrows the error until Reset.
+    /// </summary>
+    /// <param name="lsn">The sequence number returned by Append.</param>
+    void Commit(std::uint64_t lsn);
+
+    /// <summary>
+    /// Rethrow the error of a failed write or sync, if any, so that callers can refuse a change before making it.
+    /// </summary>
+    void ThrowIfFailed() const
+    {
+        std::lock_guard lock(mutex_);
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    /// <summary>
+    /// Check whether the record with the given sequence number is durable, by a commit or by a reset.
+    /// </summary>
+    /// <param name="lsn">The sequence number returned by Append.</param>
+    [[nodiscard]] bool IsDurable(const std::uint64_t lsn) const
+    {
+        std::lock_guard lock(mutex_);
+        return durable_lsn_ >= lsn;
+    }
+
+    /// <summary>
+    /// Drop every record, including the ones not committed yet, once their effects are durable elsewhere.
+    /// Waiting commits return, and a failed log is usable again.
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Get the size of the log, including the records not written yet.
+    /// </summary>
+    [[nodiscard]] auto Bytes() const -> size_t
+    {
+        std::lock_guard lock(mutex_);
+        return file_bytes_ + pending_.size();
+    }
+
+    /// <summary>
+    /// Get the number of syncs since the log was opened.
+    /// </summary>
+    [[nodiscard]] auto SyncCount() const -> size_t
+    {
+        std::lock_guard lock(mutex_);
+        return sync_count_;
+    }
+
+private:
+    struct RecordHeader
+    {
+        std::uint32_t Size = 0;
+        std::uint32_t Reserved = 0;
+        std::uint64_t Checksum = 0;
+    };
+
+    SnapshotFile file_;
+    mutable std::mutex mutex_;
+    std::condition_variable synced_;
+    // Records appended but not written, and the buffer the current leader is writing.
+    std::vector<std::byte> pending_;
+    std::vector<std::byte> writing_;
+    size_t file_bytes_;
+    // Sequence numbers count the bytes appended since the log was opened.
+    std::uint64_t appended_lsn_ = 0;
+    std::uint64_t durable_lsn_ = 0;
+    size_t sync_count_ = 0;
+    bool syncing_ = false;
+    std::exception_ptr error_;
+
+    static auto Checksum(std::span<const std::byte> payload) -> std::uint64_t
+    {
+        SnapshotChecksum checksum;
+        const std::uint64_t size = payload.size();
+        checksum.Update(std::as_bytes(std::span(&size, 1)));
+        checksum.Update(payload);
+        return checksum.Value();
+    }
+};
+
+template <typename Apply>
+    requires std::invocable<Apply&, std::span<const std::byte>>
+auto WriteAheadLog::Replay(Apply&& apply) -> size_t
+{
+    const size_t file_size = file_.Size();
+    if (file_size == 0) {
+        return 0;
+    }
+
+    struct Mapping
+    {
+        void* Address;
+        size_t Size;
+
+        ~Mapping() noexcept { ::munmap(Address, Size); }
+    };
+    void* address = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file_.Descriptor(), 0);
+    if (address == MAP_FAILED) {
+        file_.Fail("mmap");
+    }
+    const Mapping mapping{address, file_size};
+    const auto* bytes = static_cast<const std::byte*>(mapping.Address);
+
+    size_t offset = 0;
+    size_t count = 0;
+    while (file_size - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        std::memcpy(&header, bytes + offset, sizeof(header));
+        if (header.Size > file_size - offset - sizeof(RecordHeader)) {
+            break;
+        }
+        const std::span<const std::byte> payload(bytes + offset + sizeof(RecordHeader), header.Size);
+        if (header.Reserved != 0 || header.Checksum != Checksum(payload)) {
+            break;
+        }
+        std::invoke(apply, payload);
+        offset += sizeof(RecordHeader) + header.Size;
+        count++;
+    }
+
+    if (offset != file_size) {
+        file_.Truncate(static_cast<off_t>(offset));
+        file_.SyncData();
+    }
+    file_bytes_ = offset;
+    return count;
+}
+
+inline auto WriteAheadLog::Append(const std::span<const std::byte> payload) -> std::uint64_t
+{
+    if (payload.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("Log record is larger than 4 GiB.");
+    }
+    const RecordHeader header{static_cast<std::uint32_t>(payload.size()), 0, Checksum(payload)};
+    const auto header_bytes = std::as_bytes(std::span(&header, 1));
+    std::lock_guard lock(mutex_);
+    pending_.insert(pending_.end(), header_bytes.begin(), header_bytes.end());
+    pending_.insert(pending_.end(), payload.begin(), payload.end());
+    appended_lsn_ += header_bytes.size() + payload.size();
+    return appended_lsn_;
+}
+
+inline void WriteAheadLog::Commit(const std::uint64_t lsn)
+{
+    std::unique_lock lock(mutex_);
+    while (durable_lsn_ < lsn) {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        if (syncing_) {
+            synced_.wait(lock);
+            continue;
+        }
+
+        // Lead a group: take everything buffered so far and write it without holding the mutex.
+        syncing_ = true;
+        writing_.swap(pending_);
+        const std::uint64_t target = appended_lsn_;
+        const auto offset = static_cast<off_t>(file_bytes_);
+        file_bytes_ += writing_.size();
+        lock.unlock();
+        try {
+            file_.WriteAt(writing_, offset);
+            file_.SyncData();
+        } catch (...) {
+            lock.lock();
+            error_ = std::current_exception();
+            syncing_ = false;
+            synced_.notify_all();
+            throw;
+        }
+        writing_.clear();
+        lock.lock();
+        durable_lsn_ = std::max(durable_lsn_, target);
+        sync_count_++;
+        syncing_ = false;
+        synced_.notify_all();
+    }
+}
+
+inline void WriteAheadLog::Reset()
+{
+    std::unique_lock lock(mutex_);
+    // A leader writing meanwhile would put its records behind the cut.
+    synced_.wait(lock, [this] { return !syncing_; });
+    pending_.clear();
+    writing_.clear();
+    file_.Truncate(0);
+    file_.SyncData();
+    file_bytes_ = 0;
+    durable_lsn_ = appended_lsn_;
+    // The failed write is cut off with the rest.
+    error_ = nullptr;
+    synced_.notify_all();
+}
+
+} // namespace rbt
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <memory_resource>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "concurrent_red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+constexpr int thread_count = 4;
+
+template <rbt::LockMode Mode> using ConcurrentTree = rbt::ConcurrentRedBlackTree<int, int, Mode>;
+
+/// <summary>
+/// Insert and erase random keys from one thread, checking the tree against std::map.
+/// </summary>
+template <rbt::LockMode Mode> void SingleThreadInsertErase()
+{
+    ConcurrentTree<Mode> tree;
+    std::map<int, int> expected;
+    rbt::IntRandomNumberGenerator rng(0, test_size);
+    for (int i = 0; i < 8 * test_size; i++) {
+        const int key = rng();
+        if (i % 3 == 2) {
+            ASSERT_EQ(tree.Erase(key), expected.erase(key) == 1);
+        } else if (i % 3 == 1) {
+            ASSERT_EQ(tree.InsertOrAssign(key, i), !expected.contains(key));
+            expected[key] = i;
+        } else {
+            ASSERT_EQ(tree.Insert(key, i), expected.emplace(key, i).second);
+        }
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(tree.Size(), expected.size());
+    for (int key = 0; key <= test_size; key++) {
+        const auto it = expected.find(key);
+        ASSERT_EQ(tree.GetValue(key), it == expected.end() ? std::nullopt : std::optional<int>(it->second));
+    }
+
+    for (const int& e : classic_array) {
+        tree.Erase(e);
+    }
+    tree.Clear();
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_FALSE(tree.Contains(0));
+}
+
+/// <summary>
+/// Every writer inserts and erases keys of its own residue class, while readers look up keys that are never erased.
+/// </summary>
+template <rbt::LockMode Mode> void MultiThreadInsertErase()
+{
+    ConcurrentTree<Mode> tree;
+    // Negative keys stay in the tree the whole time.
+    for (int i = 1; i <= test_size; i++) {
+        ASSERT_TRUE(tree.Insert(-i, i));
+    }
+
+    std::vector<std::map<int, int>> expected(thread_count);
+    std::atomic<int> missed = 0;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < thread_count; t++) {
+        readers.emplace_back([&, t] {
+            rbt::IntRandomNumberGenerator rng(1, test_size);
+            for (int i = 0; i < 8 * test_size; i++) {
+                const int key = rng();
+                if (tree.GetValue(-key) != key) {
+                    missed++;
+                }
+                tree.Contains(key + t);
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < thread_count; t++) {
+        writers.emplace_back([&, t] {
+            rbt::IntRandomNumberGenerator rng(0, test_size);
+            for (int i = 0; i < 8 * test_size; i++) {
+                const int key = rng() / thread_count * thread_count + t;
+                if (i % 2) {
+                    tree.Erase(key);
+                    expected[t].erase(key);
+                } else {
+                    tree.InsertOrAssign(key, i);
+                    expected[t][key] = i;
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQ(missed.load(), 0);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    size_t expected_size = test_size;
+    for (const auto& entries : expected) {
+        expected_size += entries.size();
+        for (const auto& [key, value] : entries) {
+            ASSERT_EQ(tree.GetValue(key), value);
+        }
+    }
+    ASSERT_EQ(tree.Size(), expected_size);
+    for (int key = 0; key <= test_size; key++) {
+        ASSERT_EQ(tree.Contains(key), expected[key % thread_count].contains(key));
+    }
+}
+
+/// <summary>
+/// Clear while other threads insert, the size must match the nodes left behind.
+/// </summary>
+template <rbt::LockMode Mode> void ConcurrentClear()
+{
+    ConcurrentTree<Mode> tree;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < thread_count; t++) {
+        writers.emplace_back([&, t] {
+            for (int i = t; i < 4 * test_size; i += thread_count) {
+                tree.Insert(i, i);
+                if (i % 1000 == t) {
+                    tree.Clear();
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    size_t found = 0;
+    for (int i = 0; i < 4 * test_size; i++) {
+        found += tree.Contains(i);
+    }
+    ASSERT_EQ(tree.Size(), found);
+}
+
+} // namespace
+
+TEST(ConcurrentTests, SingleThreadTest)
+{
+    SingleThreadInsertErase<rbt::LockMode::SharedMutex>();
+    SingleThreadInsertErase<rbt::LockMode::LockCoupling>();
+    SingleThreadInsertErase<rbt::LockMode::Optimistic>();
+}
+
+TEST(ConcurrentTests, MultiThreadTest)
+{
+    MultiThreadInsertErase<rbt::LockMode::SharedMutex>();
+    MultiThreadInsertErase<rbt::LockMode::LockCoupling>();
+    MultiThreadInsertErase<rbt::LockMode::Optimistic>();
+}
+
+TEST(ConcurrentTests, ClearTest)
+{
+    ConcurrentClear<rbt::LockMode::SharedMutex>();
+    ConcurrentClear<rbt::LockMode::LockCoupling>();
+    ConcurrentClear<rbt::LockMode::Optimistic>();
+}
+
+TEST(ConcurrentTests, LockCouplingPolicyTest)
+{
+    // Latches and allocators that are not thread-safe work with other node layouts and allocators.
+    std::pmr::unsynchronized_pool_resource resource;
+    rbt::ConcurrentRedBlackTree<int, int, rbt::LockMode::LockCoupling, std::less<int>, std::pmr::polymorphic_allocator<std::pair<const int, int>>,
+                                rbt::LayoutPolicy<rbt::NodeLayout::PackedColor>>
+        tree(&resource);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < thread_count; t++) {
+        writers.emplace_back([&, t] {
+            for (int i = t; i < 2 * test_size; i += thread_count) {
+                ASSERT_TRUE(tree.Insert(i, i));
+            }
+            for (int i = t; i < 2 * test_size; i += 2 * thread_count) {
+                ASSERT_TRUE(tree.Erase(i));
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(tree.Size(), test_size);
+}
+
+TEST(ConcurrentTests, OptimisticReadTest)
+{
+    // Odd keys come and go between the even ones, so the even ones keep replacing erased entries.
+    rbt::OptimisticRedBlackTree<int, int> tree;
+    for (int i = 0; i < 2 * test_size; i += 2) {
+        ASSERT_TRUE(tree.Insert(i, -i));
+    }
+
+    std::atomic<bool> stop = false;
+    std::atomic<int> missed = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&] {
+            for (int round = 0; round < 4 || !stop; round++) {
+                for (int i = 0; i < 2 * test_size; i += 2) {
+                    if (tree.GetValue(i) != -i) {
+                        missed++;
+                    }
+                }
+            }
+        });
+    }
+    for (int round = 0; round < 8; round++) {
+        for (int i = 1; i < 2 * test_size; i += 2) {
+            tree.Insert(i, i);
+        }
+        for (int i = 1; i < 2 * test_size; i += 2) {
+            tree.Erase(i);
+        }
+    }
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(missed.load(), 0);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(tree.Size(), test_size);
+}
@@ -0,0 +1,277 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "durable_red_black_tree.h"
+#include "test_constant.h"
+#include "write_ahead_log.h"
+
+namespace
+{
+
+using DurableTree = rbt::DurableRedBlackTree<int, int>;
+
+/**
+ * Tree directory removed at the start and the end of the test.
+ */
+class TreeDirectory
+{
+public:
+    explicit TreeDirectory(const std::string& name) : path_(std::filesystem::temp_directory_path() / ("rbt-" + name + ".durable"))
+    {
+        std::filesystem::remove_all(path_);
+    }
+
+    ~TreeDirectory() { std::filesystem::remove_all(path_); }
+
+    [[nodiscard]] auto Path() const -> const std::filesystem::path& { return path_; }
+
+    [[nodiscard]] auto LogPath() const -> std::filesystem::path { return path_ / "log"; }
+
+private:
+    std::filesystem::path path_;
+};
+
+void ExpectSameContent(const DurableTree& tree, const std::map<int, int>& expected)
+{
+    tree.Read([&](const DurableTree::TreeType& content) { ::ExpectSameContent(content, expected); });
+}
+
+} // namespace
+
+TEST(DurableTests, ClassicRecoveryTest)
+{
+    const TreeDirectory directory("classic");
+    std::map<int, int> expected;
+    {
+        DurableTree tree(directory.Path());
+        ASSERT_TRUE(tree.IsEmpty());
+        for (const int& e : classic_array) {
+            ASSERT_TRUE(tree.Insert(e, e));
+            expected.emplace(e, e);
+        }
+        ASSERT_FALSE(tree.Insert(classic_array[0], -1));
+        ASSERT_FALSE(tree.InsertOrAssign(classic_array[1], -1));
+        expected[classic_array[1]] = -1;
+        ASSERT_TRUE(tree.Erase(classic_array[2]));
+        ASSERT_FALSE(tree.Erase(classic_array[2]));
+        expected.erase(classic_array[2]);
+        ASSERT_GT(tree.LogBytes(), 0);
+    }
+
+    // Replaying the log alone restores every update.
+    DurableTree tree(directory.Path());
+    ExpectSameContent(tree, expected);
+    ASSERT_EQ(tree.GetValue(classic_array[1]), -1);
+    ASSERT_FALSE(tree.Contains(classic_array[2]));
+}
+
+TEST(DurableTests, CheckpointTest)
+{
+    const TreeDirectory directory("checkpoint");
+    std::map<int, int> expected;
+    rbt::IntRandomNumberGenerator rng(0, test_size);
+    constexpr size_t kCheckpointBytes = 4096;
+    {
+        DurableTree tree(directory.Path(), kCheckpointBytes);
+        for (int i = 0; i < 5 * test_size; i++) {
+            const int key = rng();
+            if (i % 3 == 0) {
+                tree.Erase(key);
+                expected.erase(key);
+            } else {
+                tree.InsertOrAssign(key, i);
+                expected[key] = i;
+            }
+            ASSERT_LT(tree.LogBytes(), kCheckpointBytes);
+        }
+        ASSERT_TRUE(std::filesystem::exists(directory.Path() / "snapshot"));
+    }
+
+    // The snapshot plus the rest of the log.
+    {
+        DurableTree tree(directory.Path(), kCheckpointBytes);
+        ExpectSameContent(tree, expected);
+        tree.Checkpoint();
+        ASSERT_EQ(tree.LogBytes(), 0);
+        ASSERT_EQ(std::filesystem::file_size(directory.LogPath()), 0);
+    }
+
+    // The snapshot alone.
+    const DurableTree tree(directory.Path());
+    ExpectSameContent(tree, expected);
+}
+
+TEST(DurableTests, FailedCommitTest)
+{
+    if (!std::filesystem::exists("/dev/full")) {
+        GTEST_SKIP() << "Needs /dev/full to fail log writes.";
+    }
+    const TreeDirectory directory("failed");
+    {
+        DurableTree tree(directory.Path());
+        ASSERT_TRUE(tree.Insert(1, 1));
+        ASSERT_TRUE(tree.Insert(2, 2));
+        tree.Checkpoint();
+    }
+    // Every log write fails with ENOSPC.
+    std::filesystem::remove(directory.LogPath());
+    std::filesystem::create_symlink("/dev/full", directory.LogPath());
+
+    DurableTree tree(directory.Path());
+    const std::map<int, int> expected = {{1, 1}, {2, 2}};
+    // Each failed update is undone in memory, the first by rollback and the others before they start.
+    ASSERT_THROW(tree.Insert(3, 3), std::system_error);
+    ExpectSameContent(tree, expected);
+    ASSERT_THROW(tree.InsertOrAssign(1, -1), std::system_error);
+    ASSERT_THROW(tree.Erase(2), std::system_error);
+    ASSERT_THROW(tree.Insert(1, -1), std::system_error);
+    ExpectSameContent(tree, expected);
+}
+
+TEST(DurableTests, TornTailTest)
+{
+    const TreeDirectory directory("torn");
+    std::map<int, int> expected;
+    {
+        DurableTree tree(directory.Path());
+        for (int i = 0; i < test_size; i++) {
+            tree.Insert(i, i);
+            expected.emplace(i, i);
+        }
+    }
+    const size_t log_size = std::filesystem::file_size(directory.LogPath());
+
+    // Half a record header, as a crash in the middle of a write leaves it.
+    {
+        std::ofstream file(directory.LogPath(), std::ios::binary | std::ios::app);
+        file.write("\x09\x00\x00\x00\x00\x00", 6);
+    }
+    {
+        DurableTree tree(directory.Path());
+        ExpectSameContent(tree, expected);
+        ASSERT_EQ(std::filesystem::file_size(directory.LogPath()), log_size);
+        ASSERT_TRUE(tree.Insert(test_size, test_size));
+        expected.emplace(test_size, test_size);
+    }
+
+    // A complete record with a damaged payload is dropped, the records before it are kept.
+    {
+        std::fstream file(directory.LogPath(), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put(0x7f);
+    }
+    expected.erase(test_size);
+    const DurableTree tree(directory.Path());
+    ExpectSameContent(tree, expected);
+    ASSERT_EQ(std::filesystem::file_size(directory.LogPath()), log_size);
+}
+
+TEST(DurableTests, GroupCommitTest)
+{
+    const TreeDirectory directory("group");
+    constexpr int kThreadCount = 8;
+    constexpr int kPerThread = test_size / kThreadCount;
+    {
+        DurableTree tree(directory.Path());
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreadCount; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < kPerThread; i++) {
+                    EXPECT_TRUE(tree.Insert(i * kThreadCount + t, t));
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        ASSERT_LE(tree.SyncCount(), static_cast<size_t>(kThreadCount * kPerThread));
+        ASSERT_EQ(tree.Size(), static_cast<size_t>(kThreadCount * kPerThread));
+    }
+
+    const DurableTree tree(directory.Path());
+    ASSERT_EQ(tree.Size(), static_cast<size_t>(kThreadCount * kPerThread));
+    for (int i = 0; i < kThreadCount * kPerThread; i++) {
+        ASSERT_EQ(tree.GetValue(i), i % kThreadCount);
+    }
+}
+
+TEST(DurableTests, ConcurrentCheckpointTest)
+{
+    const TreeDirectory directory("concurrent-checkpoint");
+    constexpr int kThreadCount = 4;
+    constexpr int kPerThread = test_size / kThreadCount;
+    {
+        DurableTree tree(directory.Path(), 4096);
+        std::atomic<bool> done = false;
+        // Reads and explicit checkpoints run while updates cross the checkpoint size.
+        std::thread reader([&] {
+            while (!done.load()) {
+                for (int i = 0; i < kThreadCount * kPerThread; i += 97) {
+                    if (const auto value = tree.GetValue(i)) {
+                        EXPECT_EQ(*value, i % kThreadCount);
+                    }
+                }
+                tree.Checkpoint();
+            }
+        });
+        std::vector<std::thread> writers;
+        for (int t = 0; t < kThreadCount; t++) {
+            writers.emplace_back([&, t] {
+                for (int i = 0; i < kPerThread; i++) {
+                    EXPECT_TRUE(tree.Insert(i * kThreadCount + t, t));
+                }
+            });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        done = true;
+        reader.join();
+    }
+
+    const DurableTree tree(directory.Path());
+    ASSERT_EQ(tree.Size(), static_cast<size_t>(kThreadCount * kPerThread));
+    for (int i = 0; i < kThreadCount * kPerThread; i++) {
+        ASSERT_EQ(tree.GetValue(i), i % kThreadCount);
+    }
+}
+
+TEST(DurableTests, WriteAheadLogTest)
+{
+    const TreeDirectory directory("log");
+    std::filesystem::create_directories(directory.Path());
+    const std::vector<std::string> records = {"", "a", "twelve bytes", std::string(1000, 'x')};
+    {
+        rbt::WriteAheadLog log(directory.LogPath());
+        ASSERT_EQ(log.Replay([](std::span<const std::byte>) {}), 0);
+        std::uint64_t lsn = 0;
+        for (const std::string& record : records) {
+            lsn = log.Append(std::as_bytes(std::span(record)));
+        }
+        ASSERT_EQ(log.SyncCount(), 0);
+        // One sync for all of them.
+        log.Commit(lsn);
+        ASSERT_EQ(log.SyncCount(), 1);
+        log.Commit(lsn);
+        ASSERT_EQ(log.SyncCount(), 1);
+    }
+
+    rbt::WriteAheadLog log(directory.LogPath());
+    std::vector<std::string> replayed;
+    ASSERT_EQ(log.Replay([&](const std::span<const std::byte> payload) { replayed.emplace_back(reinterpret_cast<const char*>(payload.data()), payload.size()); }),
+              records.size());
+    ASSERT_EQ(replayed, records);
+    log.Append(std::as_bytes(std::span(records[2])));
+    log.Reset();
+    ASSERT_EQ(log.Bytes(), 0);
+    ASSERT_EQ(std::filesystem::file_size(directory.LogPath()), 0);
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "key_search.h"
+#include "test_constant.h"
+#include "wide_tree.h"
+
+namespace
+{
+
+/// <summary>
+/// Compare every instruction set this CPU supports with std::lower_bound and std::upper_bound on random sorted blocks.
+/// </summary>
+template <typename KeyType> void ExpectSameBounds()
+{
+    std::mt19937_64 rng(test_size);
+    std::uniform_int_distribution<KeyType> dist(std::numeric_limits<KeyType>::min(), std::numeric_limits<KeyType>::max());
+    const rbt::SimdLevel level = rbt::DetectSimdLevel();
+
+    for (size_t count = 0; count <= 67; count++) {
+        std::vector<KeyType> keys(count);
+        for (auto& key : keys) {
+            // Few distinct values near zero so that duplicates and probe hits are common, plus the full range.
+            key = rng() % 2 ? static_cast<KeyType>(rng() % 16) : dist(rng);
+        }
+        std::ranges::sort(keys);
+
+        std::vector<KeyType> probes = {std::numeric_limits<KeyType>::min(), std::numeric_limits<KeyType>::max(), 0, 1};
+        for (int i = 0; i < 16; i++) {
+            probes.push_back(count && i % 2 ? keys[rng() % count] : dist(rng));
+        }
+        for (const int& e : classic_array) {
+            probes.push_back(static_cast<KeyType>(e));
+        }
+        for (const KeyType probe : probes) {
+            const auto lower = static_cast<size_t>(std::ranges::lower_bound(keys, probe) - keys.begin());
+            const auto upper = static_cast<size_t>(std::ranges::upper_bound(keys, probe) - keys.begin());
+            ASSERT_EQ(rbt::SimdLowerBound(keys.data(), count, probe), lower);
+            ASSERT_EQ(rbt::SimdUpperBound(keys.data(), count, probe), upper);
+            ASSERT_EQ((rbt::simd::CountWith<rbt::SimdLevel::Scalar, false>(keys.data(), count, probe)), lower);
+            if (level >= rbt::SimdLevel::Sse42) {
+                ASSERT_EQ((rbt::simd::CountWith<rbt::SimdLevel::Sse42, false>(keys.data(), count, probe)), lower);
+                ASSERT_EQ((rbt::simd::CountWith<rbt::SimdLevel::Sse42, true>(keys.data(), count, probe)), count - upper);
+            }
+            if (level >= rbt::SimdLevel::Avx2) {
+                ASSERT_EQ((rbt::simd::CountWith<rbt::SimdLevel::Avx2, false>(keys.data(), count, probe)), lower);
+                ASSERT_EQ((rbt::simd::CountWith<rbt::SimdLevel::Avx2, true>(keys.data(), count, probe)), count - upper);
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(KeySearchTests, BoundsTest)
+{
+    ExpectSameBounds<int32_t>();
+    ExpectSameBounds<uint32_t>();
+    ExpectSameBounds<int64_t>();
+    ExpectSameBounds<uint64_t>();
+}
+
+TEST(KeySearchTests, WideTreeTest)
+{
+    static_assert(rbt::WideTree<int, int>::kSimdSearch);
+    static_assert(rbt::WideTree<uint64_t, int, 16, std::compare_three_way>::kSimdSearch);
+    static_assert(!rbt::WideTree<int, int, 16, std::greater<int>>::kSimdSearch);
+
+    // Unsigned keys above the signed range must keep their order.
+    rbt::WideTree<uint64_t, int, 16> tree;
+    const uint64_t high = uint64_t{1} << 63;
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Insert(high + static_cast<uint64_t>(i) * 2, i));
+        ASSERT_TRUE(tree.Insert(static_cast<uint64_t>(i), i));
+    }
+    ASSERT_TRUE(tree.WideTreeRulesCheck());
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_EQ(tree.GetValue(high + static_cast<uint64_t>(i) * 2), i);
+        ASSERT_FALSE(tree.Contains(high + static_cast<uint64_t>(i) * 2 + 1));
+    }
+    uint64_t previous = 0;
+    for (const auto& [key, value] : tree) {
+        ASSERT_LE(previous, key);
+        previous = key;
+    }
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "mapped_red_black_tree.h"
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+struct Point
+{
+    std::int16_t X = 0;
+    double Y = 0;
+};
+
+/**
+ * Snapshot file removed at the end of the test.
+ */
+class SnapshotPath
+{
+public:
+    explicit SnapshotPath(const std::string& name) : path_(std::filesystem::temp_directory_path() / ("rbt-" + name + ".snapshot")) {}
+
+    ~SnapshotPath() { std::filesystem::remove(path_); }
+
+    [[nodiscard]] auto Path() const -> const std::filesystem::path& { return path_; }
+
+private:
+    std::filesystem::path path_;
+};
+
+} // namespace
+
+TEST(SnapshotTests, ClassicRoundTripTest)
+{
+    const SnapshotPath path("classic");
+    rbt::RedBlackTree<int, int> tree;
+    for (const int& e : classic_array) {
+        tree.Insert(e, e * 3);
+    }
+    rbt::SaveSnapshot(tree, path.Path());
+    ASSERT_FALSE(std::filesystem::exists(path.Path().string() + ".tmp"));
+
+    rbt::RedBlackTree<int, int> loaded;
+    loaded.Insert(1000, 1);
+    rbt::LoadSnapshot(path.Path(), loaded);
+    ASSERT_TRUE(loaded.RedBlackTreeRulesCheck());
+    ASSERT_EQ(loaded.Size(), classic_array.size());
+    ASSERT_FALSE(loaded.Contains(1000));
+    for (const int& e : classic_array) {
+        ASSERT_EQ(loaded.GetValue(e), e * 3);
+    }
+
+    const rbt::MappedRedBlackTree<int, int> mapped(path.Path());
+    ASSERT_EQ(mapped.Size(), classic_array.size());
+    ASSERT_TRUE(mapped.VerifyChecksum());
+    for (const int& e : classic_array) {
+        ASSERT_EQ(mapped.GetValue(e), e * 3);
+        ASSERT_FALSE(mapped.Contains(e + 1));
+    }
+    ASSERT_FALSE(mapped.Contains(0));
+    ASSERT_FALSE(mapped.Contains(100));
+}
+
+TEST(SnapshotTests, MappedLookupTest)
+{
+    const SnapshotPath path("lookup");
+    std::map<int, int> expected;
+    rbt::RedBlackTree<int, int> tree;
+    rbt::IntRandomNumberGenerator rng(0, 10 * test_size);
+    for (int i = 0; i < test_size; i++) {
+        const int random_number = rng();
+        tree.Insert(random_number, i);
+        expected.emplace(random_number, i);
+    }
+    rbt::SaveSnapshot(tree, path.Path());
+
+    const rbt::MappedRedBlackTree<int, int> mapped(path.Path());
+    ASSERT_EQ(mapped.Size(), expected.size());
+    ASSERT_TRUE(std::ranges::equal(mapped, expected, [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first && lhs.second == rhs.second; }));
+    for (int key = -1; key <= 10 * test_size + 1; key++) {
+        const auto it = expected.find(key);
+        ASSERT_EQ(mapped.GetValue(key), it == expected.end() ? std::nullopt : std::make_optional(it->second));
+        ASSERT_EQ(mapped.LowerBound(key) - mapped.begin(), std::distance(expected.begin(), expected.lower_bound(key)));
+    }
+
+    size_t visited = 0;
+    const size_t scanned = mapped.RangeScan(test_size, 2 * test_size, [&](const int& key, const int& value) {
+        EXPECT_EQ(expected.at(key), value);
+        visited++;
+    });
+    ASSERT_EQ(scanned, visited);
+    ASSERT_EQ(scanned, static_cast<size_t>(std::distance(expected.lower_bound(test_size), expected.lower_bound(2 * test_size))));
+
+    // A mapped tree is a tree to save again.
+    const SnapshotPath copy("lookup-copy");
+    rbt::SaveSnapshot(mapped, copy.Path());
+    rbt::OrderStatisticsTree<int, int> loaded;
+    rbt::LoadSnapshot(copy.Path(), loaded);
+    ASSERT_TRUE(loaded.RedBlackTreeRulesCheck());
+    ASSERT_EQ(loaded.Size(), expected.size());
+}
+
+TEST(SnapshotTests, PaddedRecordTest)
+{
+    const SnapshotPath path("padded");
+    rbt::RedBlackTree<std::int16_t, Point> tree;
+    tree.Insert(3, {1, 0.5});
+    tree.Insert(-7, {2, 1.5});
+    rbt::SaveSnapshot(tree, path.Path());
+    // The value starts at offset 8 behind the 2-byte key, and records stay 8-byte aligned.
+    ASSERT_EQ(std::filesystem::file_size(path.Path()), sizeof(rbt::SnapshotHeader) + 2 * 24);
+
+    const rbt::MappedRedBlackTree<std::int16_t, Point> mapped(path.Path());
+    ASSERT_EQ(mapped.GetValue(-7)->X, 2);
+    ASSERT_EQ(mapped.GetValue(3)->Y, 0.5);
+    ASSERT_FALSE(mapped.Contains(0));
+
+    const SnapshotPath empty("empty");
+    rbt::SaveSnapshot(rbt::RedBlackTree<std::int16_t, Point>(), empty.Path());
+    const rbt::MappedRedBlackTree<std::int16_t, Point> mapped_empty(empty.Path());
+    ASSERT_TRUE(mapped_empty.IsEmpty());
+    ASSERT_EQ(mapped_empty.begin(), mapped_empty.end());
+    ASSERT_FALSE(mapped_empty.GetValue(0).has_value());
+}
+
+TEST(SnapshotTests, CorruptionTest)
+{
+    const SnapshotPath path("corrupt");
+    rbt::RedBlackTree<int, int> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+    }
+    rbt::SaveSnapshot(tree, path.Path());
+
+    // Other value type.
+    using MappedTree = rbt::MappedRedBlackTree<int, int>;
+    using WideValueTree = rbt::MappedRedBlackTree<int, std::int64_t>;
+    ASSERT_THROW(WideValueTree{path.Path()}, std::runtime_error);
+
+    // Overwrite one byte of a record, opening still succeeds but the checksum does not match.
+    {
+        std::fstream file(path.Path(), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(sizeof(rbt::SnapshotHeader) + 100));
+        file.put(1);
+    }
+    ASSERT_FALSE(MappedTree(path.Path()).VerifyChecksum());
+    rbt::RedBlackTree<int, int> loaded;
+    ASSERT_THROW(rbt::LoadSnapshot(path.Path(), loaded), std::runtime_error);
+
+    // Truncated file.
+    std::filesystem::resize_file(path.Path(), std::filesystem::file_size(path.Path()) - 4);
+    ASSERT_THROW(MappedTree{path.Path()}, std::runtime_error);
+
+    ASSERT_THROW(MappedTree{path.Path().string() + ".missing"}, std::system_error);
+}
+
+TEST(SnapshotTests, FailedSaveTest)
+{
+    const SnapshotPath path("failed");
+    const std::filesystem::path temporary_path = path.Path().string() + ".tmp";
+    rbt::RedBlackTree<int, int> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+    }
+
+    // A failed write leaves no temporary file behind.
+    if (std::filesystem::exists("/dev/full")) {
+        std::filesystem::create_symlink("/dev/full", temporary_path);
+        ASSERT_THROW(rbt::SaveSnapshot(tree, path.Path()), std::system_error);
+        ASSERT_FALSE(std::filesystem::exists(std::filesystem::symlink_status(temporary_path)));
+        ASSERT_FALSE(std::filesystem::exists(path.Path()));
+    }
+
+    // Neither does a failed rename, onto a directory here.
+    std::filesystem::create_directory(path.Path());
+    ASSERT_THROW(rbt::SaveSnapshot(tree, path.Path()), std::system_error);
+    ASSERT_FALSE(std::filesystem::exists(temporary_path));
+    ASSERT_TRUE(std::filesystem::is_directory(path.Path()));
+}
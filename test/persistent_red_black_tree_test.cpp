@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#include "persistent_red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+using PersistentTree = rbt::PersistentRedBlackTree<int, int>;
+
+class CountingResource final : public std::pmr::memory_resource
+{
+public:
+    size_t Allocated = 0;
+    size_t Deallocated = 0;
+
+private:
+    void* do_allocate(const size_t bytes, const size_t alignment) override
+    {
+        Allocated++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, const size_t bytes, const size_t alignment) override
+    {
+        Deallocated++;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
+
+bool Equals(const PersistentTree& tree, const std::map<int, int>& expected)
+{
+    return tree.Size() == expected.size()
+           && std::ranges::equal(tree, expected, [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first && lhs.second == rhs.second; });
+}
+
+} // namespace
+
+TEST(PersistentTests, SnapshotTest)
+{
+    // Every tenth version is kept, and all of them must still hold what they held when they were taken.
+    PersistentTree tree;
+    std::map<int, int> expected;
+    std::vector<std::pair<PersistentTree, std::map<int, int>>> versions;
+    rbt::IntRandomNumberGenerator rng(0, test_size);
+    for (int i = 0; i < 8 * test_size; i++) {
+        const int key = rng();
+        if (i % 3 == 2) {
+            ASSERT_EQ(tree.Erase(key), expected.erase(key) == 1);
+        } else if (i % 3 == 1) {
+            ASSERT_EQ(tree.InsertOrAssign(key, i), !expected.contains(key));
+            expected[key] = i;
+        } else {
+            ASSERT_EQ(tree.Insert(key, i), expected.emplace(key, i).second);
+        }
+        if (i % 10 == 0) {
+            versions.emplace_back(tree, expected);
+        }
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_TRUE(Equals(tree, expected));
+    for (const auto& [version, entries] : versions) {
+        ASSERT_TRUE(version.RedBlackTreeRulesCheck());
+        ASSERT_TRUE(Equals(version, entries));
+    }
+
+    for (const int& e : classic_array) {
+        const PersistentTree inserted = tree.Inserted(e + test_size, e);
+        ASSERT_TRUE(inserted.Contains(e + test_size));
+        ASSERT_FALSE(tree.Contains(e + test_size));
+        ASSERT_FALSE(inserted.Erased(e + test_size).Contains(e + test_size));
+    }
+    ASSERT_TRUE(Equals(tree, expected));
+}
+
+TEST(PersistentTests, PathCopyTest)
+{
+    CountingResource resource;
+    {
+        rbt::PersistentRedBlackTree<int, int, std::less<int>, std::pmr::polymorphic_allocator<std::pair<const int, int>>> tree(std::less<int>(), &resource);
+        for (int i = 0; i < test_size; i++) {
+            ASSERT_TRUE(tree.Insert(i, i));
+        }
+        // Without snapshots the tree is updated in place.
+        ASSERT_EQ(resource.Allocated, test_size);
+
+        // With a snapshot an update copies a few nodes per level only, and frees only the erased copy.
+        auto snapshot = tree;
+        ASSERT_TRUE(tree.Erase(test_size / 2));
+        ASSERT_TRUE(tree.Insert(test_size, test_size));
+        ASSERT_LT(resource.Allocated - test_size, 64);
+        ASSERT_EQ(resource.Deallocated, 1);
+        ASSERT_EQ(snapshot.Size(), test_size);
+        ASSERT_TRUE(snapshot.Contains(test_size / 2));
+        ASSERT_FALSE(snapshot.Contains(test_size));
+        ASSERT_TRUE(snapshot.RedBlackTreeRulesCheck());
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+        // Dropping the snapshot frees exactly the nodes only it reached.
+        const size_t allocated = resource.Allocated;
+        snapshot.Clear();
+        ASSERT_EQ(allocated - resource.Deallocated, tree.Size());
+    }
+    ASSERT_EQ(resource.Allocated, resource.Deallocated);
+}
+
+TEST(PersistentTests, ConcurrentSnapshotTest)
+{
+    // Readers scan their own snapshots while the writer keeps updating, then drop them on their own threads.
+    PersistentTree tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+    }
+
+    constexpr int reader_count = 4;
+    std::vector<std::thread> readers;
+    std::vector<int> consistent(reader_count);
+    for (int t = 0; t < reader_count; t++) {
+        readers.emplace_back([&consistent, t, snapshot = tree] {
+            size_t count = 0;
+            for (const auto& [key, value] : snapshot) {
+                count += key == value;
+            }
+            consistent[t] = count == test_size && snapshot.Size() == test_size;
+        });
+    }
+    for (int i = 0; i < test_size; i++) {
+        tree.InsertOrAssign(i, -i);
+    }
+    for (int i = 1; i < test_size; i++) {
+        tree.Erase(i);
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQ(std::ranges::count(consistent, 1), reader_count);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(tree.Size(), 1);
+}
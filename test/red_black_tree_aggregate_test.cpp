@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+/**
+ * Concatenation of keys, which is order sensitive.
+ */
+struct KeyListAggregate
+{
+    using Type = std::string;
+
+    static auto Identity() -> std::string { return {}; }
+
+    static auto Combine(const int& key, const int&, const std::string& left, const std::string& right) -> std::string
+    {
+        return left + std::to_string(key) + ',' + right;
+    }
+};
+
+struct SumAndRankPolicy : rbt::DefaultTreePolicy
+{
+    static constexpr bool kOrderStatistics = true;
+    using Aggregate = rbt::SumAggregate<long long>;
+};
+
+auto ExpectedSum(const std::map<int, int>& expected, const int lo, const int hi) -> long long
+{
+    long long sum = 0;
+    for (auto it = expected.lower_bound(lo); it != expected.end() && it->first < hi; ++it) {
+        sum += it->second;
+    }
+    return sum;
+}
+
+} // namespace
+
+TEST(AggregateTests, ClassicSumTest)
+{
+    rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, rbt::AggregatePolicy<rbt::SumAggregate<long long>>> tree;
+    ASSERT_EQ(tree.Aggregate(), 0);
+    ASSERT_EQ(tree.Aggregate(0, 100), 0);
+
+    for (const int& e : classic_array) {
+        tree.Insert(e, e);
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+
+    ASSERT_EQ(tree.Aggregate(), 720);
+    ASSERT_EQ(tree.Aggregate(20, 60), 20 + 30 + 40 + 45 + 50 + 55);
+    ASSERT_EQ(tree.Aggregate(21, 61), 30 + 40 + 45 + 50 + 55 + 60);
+    ASSERT_EQ(tree.Aggregate(60, 20), 0);
+    ASSERT_EQ(tree.Aggregate(91, 100), 0);
+}
+
+TEST(AggregateTests, OrderSensitiveTest)
+{
+    rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, rbt::AggregatePolicy<KeyListAggregate>> tree;
+    for (int i = test_size - 1; i >= 0; i--) {
+        tree.Insert(i, i);
+    }
+    for (int i = 0; i < test_size; i += 3) {
+        tree.Erase(i);
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    for (int lo = 0; lo < test_size; lo += 97) {
+        const int hi = lo + 20;
+        std::string expected;
+        for (int i = lo; i < hi && i < test_size; i++) {
+            if (i % 3 != 0) {
+                expected += std::to_string(i) + ',';
+            }
+        }
+        ASSERT_EQ(tree.Aggregate(lo, hi), expected);
+    }
+}
+
+TEST(AggregateTests, RandomSumWithRankTest)
+{
+    using Tree = rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, SumAndRankPolicy>;
+    Tree tree;
+    rbt::IntRandomNumberGenerator rng(0, 999);
+    std::map<int, int> expected;
+
+    for (int i = 0; i < test_size; ++i) {
+        const int random_number = rng();
+        tree.Insert(random_number, random_number * 3);
+        expected.emplace(random_number, random_number * 3);
+    }
+    for (int i = 0; i < test_size / 2; ++i) {
+        const int random_number = rng();
+        tree.Erase(random_number);
+        expected.erase(random_number);
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+
+    for (int lo = -10; lo < 1010; lo += 31) {
+        for (int hi = lo; hi < 1010; hi += 113) {
+            ASSERT_EQ(tree.Aggregate(lo, hi), ExpectedSum(expected, lo, hi));
+            ASSERT_EQ(tree.CountInRange(lo, hi), std::distance(expected.lower_bound(lo), expected.lower_bound(hi)));
+        }
+    }
+}
+
+TEST(AggregateTests, IntervalOverlapTest)
+{
+    // Intervals [start, end) keyed by start, the aggregate is the max end.
+    rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, rbt::AggregatePolicy<rbt::MaxAggregate<int>>> tree;
+    tree.Insert(0, 5);
+    tree.Insert(10, 40);
+    tree.Insert(20, 25);
+    tree.Insert(50, 55);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    // An interval overlaps [lo, hi) if it starts before hi and ends after lo.
+    const auto overlaps = [&tree](const int lo, const int hi) { return tree.Aggregate(std::numeric_limits<int>::min(), hi) > lo; };
+    ASSERT_TRUE(overlaps(30, 35));
+    ASSERT_TRUE(overlaps(3, 4));
+    ASSERT_FALSE(overlaps(41, 50));
+    ASSERT_TRUE(overlaps(41, 51));
+    ASSERT_FALSE(overlaps(55, 60));
+
+    ASSERT_TRUE(tree.Erase(10));
+    ASSERT_FALSE(overlaps(30, 35));
+    ASSERT_EQ(tree.Aggregate(), 55);
+}
+
+TEST(AggregateTests, MinTimestampTest)
+{
+    rbt::RedBlackTree<int, long long, std::less<int>, std::allocator<std::pair<const int, long long>>, rbt::AggregatePolicy<rbt::MinAggregate<long long>>> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, 1000000 - i);
+    }
+    ASSERT_EQ(tree.Aggregate(), 1000000 - test_size + 1);
+    ASSERT_EQ(tree.Aggregate(100, 200), 1000000 - 199);
+    ASSERT_EQ(tree.Aggregate(2000, 3000), std::numeric_limits<long long>::max());
+}
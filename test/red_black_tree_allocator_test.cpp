@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <memory_resource>
+#include <string>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+class CountingResource final : public std::pmr::memory_resource
+{
+public:
+    size_t Allocated = 0;
+    size_t Deallocated = 0;
+
+private:
+    void* do_allocate(const size_t bytes, const size_t alignment) override
+    {
+        Allocated++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, const size_t bytes, const size_t alignment) override
+    {
+        Deallocated++;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
+
+} // namespace
+
+TEST(AllocatorTests, PooledInsertDeleteTest)
+{
+    rbt::PooledRedBlackTree<int, int> tree;
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Insert(i, i * i));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    const size_t slab_count = tree.GetAllocator().Pool().SlabCount();
+    ASSERT_GT(slab_count, 0);
+    ASSERT_LT(slab_count, test_size / rbt::NodePool::kFirstSlabBlocks);
+
+    // Freed nodes are reused before new slabs are allocated.
+    for (int i = 0; i < test_size; i += 2) {
+        ASSERT_TRUE(tree.Erase(i));
+    }
+    for (int i = 0; i < test_size; i += 2) {
+        ASSERT_TRUE(tree.Insert(i, i));
+    }
+    ASSERT_EQ(tree.GetAllocator().Pool().SlabCount(), slab_count);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    for (int i = 0; i < test_size; i++) {
+        auto value = tree.GetValue(i);
+        ASSERT_TRUE(value.has_value());
+        ASSERT_EQ(*value, i % 2 == 0 ? i : i * i);
+    }
+}
+
+TEST(AllocatorTests, PooledClearTest)
+{
+    rbt::PooledRedBlackTree<int, int> tree;
+    for (const int& e : classic_array) {
+        tree.Insert(e, e);
+    }
+
+    // Trivially destructible nodes are released slab by slab.
+    tree.Clear();
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_EQ(tree.GetAllocator().Pool().SlabCount(), 0);
+
+    // The tree is still usable afterwards.
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Insert(e, e + 1));
+    }
+    ASSERT_EQ(tree.Size(), classic_array.size());
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+}
+
+TEST(AllocatorTests, PooledMoveClearTest)
+{
+    rbt::PooledRedBlackTree<int, int> source;
+    for (int i = 0; i < test_size; i++) {
+        source.Insert(i, i);
+    }
+
+    // The moved-into tree owns the pool alone and drops it slab by slab.
+    rbt::PooledRedBlackTree<int, int> tree(std::move(source));
+    ASSERT_GT(tree.GetAllocator().Pool().SlabCount(), 0);
+    tree.Clear();
+    ASSERT_EQ(tree.GetAllocator().Pool().SlabCount(), 0);
+
+    // The moved-from tree starts over with a pool of its own.
+    ASSERT_EQ(source.GetAllocator().Pool().SlabCount(), 0);
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(source.Insert(e, e));
+    }
+    ASSERT_TRUE(source.RedBlackTreeRulesCheck());
+    ASSERT_FALSE(source.GetAllocator() == tree.GetAllocator());
+
+    // So do the halves of a split once they are joined again.
+    auto [left, right] = source.Split(classic_array[0]);
+    rbt::PooledRedBlackTree<int, int> joined = rbt::PooledRedBlackTree<int, int>::Join(std::move(left), std::move(right));
+    ASSERT_EQ(joined.Size(), classic_array.size());
+    ASSERT_GT(joined.GetAllocator().Pool().SlabCount(), 0);
+    joined.Clear();
+    ASSERT_EQ(joined.GetAllocator().Pool().SlabCount(), 0);
+}
+
+TEST(AllocatorTests, PooledStringKeyTest)
+{
+    rbt::PooledRedBlackTree<std::string, std::string> tree;
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Insert(std::to_string(i), std::string(64, 'x')));
+    }
+    for (int i = 0; i < test_size; i += 3) {
+        ASSERT_TRUE(tree.Erase(std::to_string(i)));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    // Nodes with destructors are destroyed one by one.
+    tree.Clear();
+    ASSERT_TRUE(tree.IsEmpty());
+}
+
+TEST(AllocatorTests, PolymorphicAllocatorTest)
+{
+    CountingResource resource;
+    {
+        rbt::pmr::RedBlackTree<int, int> tree(&resource);
+        for (const int& e : classic_array) {
+            ASSERT_TRUE(tree.Insert(e, e));
+        }
+        ASSERT_EQ(resource.Allocated, classic_array.size());
+
+        ASSERT_TRUE(tree.Erase(classic_array[0]));
+        ASSERT_EQ(resource.Deallocated, 1);
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+        ASSERT_EQ(tree.GetAllocator().resource(), &resource);
+    }
+    ASSERT_EQ(resource.Allocated, resource.Deallocated);
+}
@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+struct BatchTag;
+struct SeparateTag;
+
+// Value whose copy throws once the given number of copies is used up.
+struct ThrowingValue
+{
+    inline static int CopiesLeft = -1;
+
+    int Id = 0;
+
+    explicit ThrowingValue(const int id) : Id(id) {}
+
+    ThrowingValue(const ThrowingValue& other) : Id(other.Id)
+    {
+        if (CopiesLeft == 0) {
+            throw std::runtime_error("copy failed");
+        }
+        CopiesLeft--;
+    }
+};
+
+template <class Tag> using CountedTree = rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, rbt::StatisticsPolicy<Tag>>;
+
+} // namespace
+
+TEST(BatchTests, InsertBatchTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    std::map<int, int> expected;
+    rbt::IntRandomNumberGenerator rng(0, 4 * test_size);
+
+    // The first batches are merged into the tree, the later ones are small relative to it and inserted key by key.
+    for (const size_t batch_size : {1000, 500, 100, 10, 1, 0}) {
+        std::vector<std::pair<int, int>> entries;
+        for (size_t i = 0; i < batch_size; i++) {
+            const int random_number = rng();
+            entries.emplace_back(random_number, static_cast<int>(i));
+            expected.emplace(random_number, static_cast<int>(i));
+        }
+        const size_t old_size = tree.Size();
+        const size_t inserted = tree.InsertBatch(entries);
+        ASSERT_EQ(inserted, tree.Size() - old_size);
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+        ExpectSameContent(tree, expected);
+    }
+}
+
+TEST(BatchTests, EraseBatchTest)
+{
+    rbt::OrderStatisticsTree<int, int> tree;
+    std::map<int, int> expected;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+        expected.emplace(i, i);
+    }
+
+    // Unsorted keys with duplicates and misses.
+    for (const int step : {7, 3, 2}) {
+        std::vector<int> keys;
+        for (int i = test_size + 10; i >= 0; i -= step) {
+            keys.push_back(i);
+            keys.push_back(i);
+        }
+        size_t erased = 0;
+        for (const int key : keys) {
+            erased += expected.erase(key);
+        }
+        ASSERT_EQ(tree.EraseBatch(keys), erased);
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+        ExpectSameContent(tree, expected);
+    }
+
+    const std::vector<int> few_keys{1, 13, 19};
+    ASSERT_EQ(tree.EraseBatch(few_keys), 3);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    std::vector<int> all_keys;
+    for (int i = 0; i < test_size; i++) {
+        all_keys.push_back(i);
+    }
+    tree.EraseBatch(all_keys);
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_EQ(tree.EraseBatch(few_keys), 0);
+}
+
+TEST(BatchTests, SmallBatchComparisonsTest)
+{
+    // A batch small relative to the tree splits it at the batch keys instead of descending from the root for every key.
+    constexpr int kTreeSize = 16 * test_size;
+    CountedTree<BatchTag> batch_tree;
+    CountedTree<SeparateTag> separate_tree;
+    std::map<int, int> expected;
+    for (int i = 0; i < kTreeSize; i += 2) {
+        batch_tree.Insert(i, i);
+        separate_tree.Insert(i, i);
+        expected.emplace(i, i);
+    }
+
+    std::vector<std::pair<int, int>> entries;
+    std::vector<int> keys;
+    for (int i = 1; i < kTreeSize; i += 98) {
+        entries.emplace_back(i, -i);
+        keys.push_back(i - 1);
+        expected.emplace(i, -i);
+    }
+    const rbt::OperationCounts batch_before = rbt::OperationCounters<BatchTag>::Snapshot();
+    const rbt::OperationCounts separate_before = rbt::OperationCounters<SeparateTag>::Snapshot();
+    ASSERT_EQ(batch_tree.InsertBatch(entries), entries.size());
+    for (const auto& [key, value] : entries) {
+        separate_tree.Insert(key, value);
+    }
+    const rbt::OperationCounts batch_inserts = rbt::OperationCounters<BatchTag>::Snapshot() - batch_before;
+    const rbt::OperationCounts separate_inserts = rbt::OperationCounters<SeparateTag>::Snapshot() - separate_before;
+    ASSERT_EQ(batch_inserts[rbt::Counter::Inserts], separate_inserts[rbt::Counter::Inserts]);
+    ASSERT_EQ(batch_inserts[rbt::Counter::NodesAllocated], entries.size());
+    ASSERT_LT(batch_inserts[rbt::Counter::Comparisons], separate_inserts[rbt::Counter::Comparisons]);
+    ASSERT_TRUE(batch_tree.RedBlackTreeRulesCheck());
+    ExpectSameContent(batch_tree, expected);
+
+    // Keys already in the tree take no allocation.
+    const rbt::OperationCounts batch_before_repeat = rbt::OperationCounters<BatchTag>::Snapshot();
+    ASSERT_EQ(batch_tree.InsertBatch(entries), 0);
+    const rbt::OperationCounts batch_repeat = rbt::OperationCounters<BatchTag>::Snapshot() - batch_before_repeat;
+    ASSERT_EQ(batch_repeat[rbt::Counter::NodesAllocated], 0);
+    ASSERT_EQ(batch_repeat[rbt::Counter::NodesFreed], 0);
+
+    for (const int key : keys) {
+        expected.erase(key);
+    }
+    const rbt::OperationCounts erase_before = rbt::OperationCounters<BatchTag>::Snapshot();
+    ASSERT_EQ(batch_tree.EraseBatch(keys), keys.size());
+    for (const int key : keys) {
+        separate_tree.Erase(key);
+    }
+    const rbt::OperationCounts batch_erases = rbt::OperationCounters<BatchTag>::Snapshot() - erase_before;
+    const rbt::OperationCounts separate_erases = rbt::OperationCounters<SeparateTag>::Snapshot() - separate_before - separate_inserts;
+    ASSERT_LT(batch_erases[rbt::Counter::Comparisons], separate_erases[rbt::Counter::Comparisons]);
+    ASSERT_TRUE(batch_tree.RedBlackTreeRulesCheck());
+    ExpectSameContent(batch_tree, expected);
+}
+
+TEST(BatchTests, DuplicateKeysTest)
+{
+    rbt::RedBlackTree<std::string, int> tree;
+    tree.Insert("b", 0);
+    const std::vector<std::pair<std::string, int>> entries{{"c", 1}, {"a", 2}, {"c", 3}, {"b", 4}, {"a", 5}};
+    ASSERT_EQ(tree.InsertBatch(entries), 2);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(*tree.GetValue("a"), 2);
+    ASSERT_EQ(*tree.GetValue("b"), 0);
+    ASSERT_EQ(*tree.GetValue("c"), 1);
+}
+
+TEST(BatchTests, InsertBatchThrowTest)
+{
+    // A copy failing in the middle of a small batch leaves the tree as it was.
+    rbt::RedBlackTree<int, ThrowingValue> tree;
+    for (int i = 0; i < test_size; i += 2) {
+        tree.Insert(i, ThrowingValue(i));
+    }
+    std::vector<std::pair<int, ThrowingValue>> entries;
+    for (int i = 1; i < 20; i += 2) {
+        entries.emplace_back(i, ThrowingValue(i));
+    }
+    entries.emplace_back(0, ThrowingValue(-1));
+
+    ThrowingValue::CopiesLeft = 5;
+    ASSERT_THROW(tree.InsertBatch(entries), std::runtime_error);
+    ThrowingValue::CopiesLeft = -1;
+    ASSERT_EQ(tree.Size(), test_size / 2);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_EQ(tree.Contains(i), i % 2 == 0);
+    }
+    ASSERT_EQ(tree.GetValue(0)->Id, 0);
+}
+
+TEST(BatchTests, GetValuesTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    std::vector<int> keys;
+    std::vector<std::optional<int>> values;
+    ASSERT_NO_THROW(tree.GetValues(keys, values));
+
+    // An empty tree resets every value.
+    keys = {1, 2, 3};
+    values.assign(keys.size(), 42);
+    tree.GetValues(keys, values);
+    for (const auto& value : values) {
+        ASSERT_FALSE(value.has_value());
+    }
+
+    for (const int& e : classic_array) {
+        tree.Insert(e, e * 2);
+    }
+    keys.clear();
+    for (int i = -3; i < 103; i++) {
+        keys.push_back(i);
+    }
+    values.assign(keys.size(), std::nullopt);
+    tree.GetValues(keys, values);
+    for (size_t i = 0; i < keys.size(); i++) {
+        ASSERT_EQ(values[i], tree.GetValue(keys[i]));
+    }
+}
+
+TEST(BatchTests, GetValuesGroupSizeTest)
+{
+    rbt::PooledRedBlackTree<int, int> tree;
+    rbt::IntRandomNumberGenerator rng(0, 4 * test_size);
+    for (int i = 0; i < test_size; ++i) {
+        const int random_number = rng();
+        tree.Insert(random_number, -random_number);
+    }
+
+    std::vector<int> keys;
+    for (int i = 0; i < test_size; ++i) {
+        keys.push_back(rng());
+    }
+    std::vector<std::optional<int>> expected;
+    for (const int key : keys) {
+        expected.push_back(tree.GetValue(key));
+    }
+
+    // Group sizes below, at and above the batch size.
+    std::vector<std::optional<int>> values(keys.size());
+    const auto check = [&]<size_t GroupSize>(const size_t batch_size) {
+        std::ranges::fill(values, 1);
+        tree.GetValues<GroupSize>(std::span(keys).first(batch_size), values);
+        for (size_t i = 0; i < batch_size; i++) {
+            ASSERT_EQ(values[i], expected[i]);
+        }
+    };
+    for (const size_t batch_size : {size_t{0}, size_t{1}, size_t{7}, keys.size()}) {
+        check.operator()<1>(batch_size);
+        check.operator()<3>(batch_size);
+        check.operator()<32>(batch_size);
+    }
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+auto MakeSortedPairs(const int size) -> std::vector<std::pair<int, int>>
+{
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < size; i++) {
+        pairs.emplace_back(i * 2, i);
+    }
+    return pairs;
+}
+
+} // namespace
+
+TEST(BulkLoadTests, AllSizesTest)
+{
+    for (int size = 0; size < test_size; size++) {
+        const auto pairs = MakeSortedPairs(size);
+        rbt::RedBlackTree<int, int> tree(pairs.begin(), pairs.end());
+        ASSERT_EQ(tree.Size(), size);
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+        ASSERT_TRUE(std::ranges::equal(tree | std::views::keys, pairs | std::views::keys));
+    }
+}
+
+TEST(BulkLoadTests, MutationAfterBuildTest)
+{
+    const auto pairs = MakeSortedPairs(test_size);
+    rbt::OrderStatisticsTree<int, int> tree;
+    tree.BuildFromSorted(pairs.begin(), pairs.end());
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(tree.Select(test_size / 2)->first, test_size);
+
+    // Fill the gaps and remove the original keys.
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Insert(i * 2 + 1, i));
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Erase(i * 2));
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+    ASSERT_EQ(tree.Size(), test_size);
+    ASSERT_EQ(tree.Rank(101), 50);
+}
+
+TEST(BulkLoadTests, DuplicateKeysTest)
+{
+    const std::vector<std::pair<int, int>> pairs{{1, 1}, {1, 2}, {2, 3}, {3, 4}, {3, 5}, {3, 6}, {4, 7}};
+    rbt::PooledRedBlackTree<int, int> tree;
+    tree.Insert(100, 100);
+    tree.BuildFromSorted(pairs.begin(), pairs.end());
+    ASSERT_EQ(tree.Size(), 4);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_FALSE(tree.GetValue(100).has_value());
+    ASSERT_EQ(*tree.GetValue(1), 1);
+    ASSERT_EQ(*tree.GetValue(3), 4);
+    ASSERT_EQ(*tree.GetValue(4), 7);
+}
+
+TEST(BulkLoadTests, UnsortedFallbackTest)
+{
+    std::map<int, int> expected;
+    std::vector<std::pair<int, int>> pairs;
+    for (const int& e : classic_array) {
+        pairs.emplace_back(e, e + 1);
+        expected.emplace(e, e + 1);
+    }
+    pairs.emplace_back(classic_array[0], 0);
+
+    rbt::RedBlackTree<int, int> tree(pairs.begin(), pairs.end());
+    ASSERT_EQ(tree.Size(), expected.size());
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    for (const auto& [key, value] : expected) {
+        ASSERT_EQ(*tree.GetValue(key), value);
+    }
+}
+
+TEST(BulkLoadTests, FromTreeTest)
+{
+    rbt::RedBlackTree<int, int> source;
+    rbt::IntRandomNumberGenerator rng(0, 999);
+    for (int i = 0; i < test_size; ++i) {
+        const int random_number = rng();
+        source.Insert(random_number, random_number);
+    }
+
+    // Iterators of another tree yield a sorted range of pairs.
+    rbt::RedBlackTree<int, int> tree(source.begin(), source.end());
+    ASSERT_EQ(tree.Size(), source.Size());
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_TRUE(std::ranges::equal(tree | std::views::keys, source | std::views::keys));
+}
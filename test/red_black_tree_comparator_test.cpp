@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <bit>
+#include <compare>
+#include <functional>
+#include <ostream>
+#include <ranges>
+#include <string>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+/**
+ * Key with operator< only, neither operator== nor operator<=>.
+ */
+struct LessOnlyKey
+{
+    int Id = 0;
+
+    bool operator<(const LessOnlyKey& other) const { return Id < other.Id; }
+
+    friend auto operator<<(std::ostream& os, const LessOnlyKey& key) -> std::ostream& { return os << key.Id; }
+};
+
+struct CountingThreeWay
+{
+    inline static size_t Calls = 0;
+
+    auto operator()(const int lhs, const int rhs) const -> std::strong_ordering
+    {
+        Calls++;
+        return lhs <=> rhs;
+    }
+};
+
+struct CountingLess
+{
+    inline static size_t Calls = 0;
+
+    bool operator()(const int lhs, const int rhs) const
+    {
+        Calls++;
+        return lhs < rhs;
+    }
+};
+
+struct DescendingThreeWay
+{
+    auto operator()(const std::string& lhs, const std::string& rhs) const -> std::strong_ordering { return rhs <=> lhs; }
+};
+
+/// <summary>
+/// Get the height of a tree of the given size, which bounds the comparisons of one descent.
+/// </summary>
+/// <param name="size">The size.</param>
+/// <returns>The height bound.</returns>
+auto MaxHeight(const size_t size) -> size_t
+{
+    return 2 * static_cast<size_t>(std::bit_width(size + 1));
+}
+
+} // namespace
+
+TEST(ComparatorTests, LessOnlyKeyTest)
+{
+    rbt::RedBlackTree<LessOnlyKey, int> tree;
+    ASSERT_FALSE(tree.Erase({1}));
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Insert({e}, e));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    tree.Clear();
+
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Insert({i}, i));
+        ASSERT_FALSE(tree.Insert({i}, -i));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    for (int i = 0; i < test_size; i += 2) {
+        ASSERT_TRUE(tree.Erase({i}));
+        ASSERT_FALSE(tree.Erase({i}));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_EQ(tree.Contains({i}), i % 2 == 1);
+        ASSERT_EQ(tree.GetValue({i}).value_or(-1), i % 2 == 1 ? i : -1);
+    }
+}
+
+TEST(ComparatorTests, ThreeWayComparisonCountTest)
+{
+    rbt::RedBlackTree<int, int, CountingThreeWay> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    // One three-way comparison per level.
+    for (int i = 0; i < test_size; i++) {
+        CountingThreeWay::Calls = 0;
+        ASSERT_TRUE(tree.GetValue(i).has_value());
+        ASSERT_LE(CountingThreeWay::Calls, MaxHeight(tree.Size()));
+
+        CountingThreeWay::Calls = 0;
+        ASSERT_FALSE(tree.Insert(i, i));
+        ASSERT_LE(CountingThreeWay::Calls, MaxHeight(tree.Size()));
+    }
+
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Erase(i));
+    }
+    ASSERT_TRUE(tree.IsEmpty());
+}
+
+TEST(ComparatorTests, LessComparisonCountTest)
+{
+    rbt::RedBlackTree<int, int, CountingLess> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+    }
+
+    // One less-than test per level, and one more to check equivalence.
+    for (int i = 0; i < test_size; i++) {
+        CountingLess::Calls = 0;
+        ASSERT_TRUE(tree.GetValue(i).has_value());
+        ASSERT_LE(CountingLess::Calls, MaxHeight(tree.Size()) + 1);
+
+        CountingLess::Calls = 0;
+        ASSERT_FALSE(tree.Insert(i, i));
+        ASSERT_LE(CountingLess::Calls, MaxHeight(tree.Size()) + 1);
+    }
+}
+
+TEST(ComparatorTests, ThreeWayComparatorTest)
+{
+    rbt::RedBlackTree<std::string, int, DescendingThreeWay> tree;
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(tree.Insert(std::to_string(i), i));
+    }
+    for (int i = 0; i < 100; i += 3) {
+        ASSERT_TRUE(tree.Erase(std::to_string(i)));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(tree.begin()->first, "98");
+    ASSERT_EQ(tree.LowerBound("50")->first, "50");
+    ASSERT_EQ(tree.UpperBound("50")->first, "5");
+    ASSERT_TRUE(std::ranges::is_sorted(tree | std::views::keys, std::greater<>()));
+
+    rbt::RedBlackTree<std::string, int, std::compare_three_way> ascending_tree;
+    ascending_tree.Insert("b", 1);
+    ascending_tree.Insert("a", 0);
+    ASSERT_EQ(ascending_tree.begin()->first, "a");
+    ASSERT_EQ(*ascending_tree.GetValue("b"), 1);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <ranges>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+static_assert(std::bidirectional_iterator<rbt::RedBlackTree<int, int>::iterator>);
+static_assert(std::bidirectional_iterator<rbt::RedBlackTree<int, int>::const_iterator>);
+static_assert(std::ranges::bidirectional_range<rbt::RedBlackTree<int, int>>);
+static_assert(std::ranges::bidirectional_range<const rbt::RedBlackTree<int, int>>);
+// The path is sized by the height bound of the node count, 2 * 32 levels for 32-bit indices.
+static_assert(sizeof(rbt::CompactRedBlackTree<int, int>::iterator) == sizeof(void*) + sizeof(size_t) + 64 * sizeof(void*));
+
+TEST(IteratorTests, EmptyTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    ASSERT_EQ(tree.begin(), tree.end());
+    ASSERT_EQ(tree.rbegin(), tree.rend());
+    ASSERT_EQ(std::ranges::distance(tree), 0);
+}
+
+TEST(IteratorTests, OrderedTraversalTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    std::map<int, int> expected;
+    for (const int& e : classic_array) {
+        tree.Insert(e, e + 1);
+        expected.emplace(e, e + 1);
+    }
+
+    auto it = expected.begin();
+    for (const auto [key, value] : tree) {
+        ASSERT_EQ(key, it->first);
+        ASSERT_EQ(value, it->second);
+        ++it;
+    }
+    ASSERT_EQ(it, expected.end());
+
+    // Reverse traversal.
+    auto rit = expected.rbegin();
+    for (auto tree_it = tree.rbegin(); tree_it != tree.rend(); ++tree_it) {
+        ASSERT_EQ(tree_it->first, rit->first);
+        ++rit;
+    }
+    ASSERT_EQ(rit, expected.rend());
+}
+
+TEST(IteratorTests, BidirectionalStepTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+    }
+
+    auto it = tree.end();
+    for (int i = test_size - 1; i >= 0; i--) {
+        --it;
+        ASSERT_EQ((*it).first, i);
+    }
+    ASSERT_EQ(it, tree.begin());
+
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_EQ(it->first, i);
+        auto previous = it++;
+        ASSERT_EQ(++previous, it);
+    }
+    ASSERT_EQ(it, tree.end());
+}
+
+TEST(IteratorTests, RandomElementsRangesTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    rbt::IntRandomNumberGenerator rng(0, 999);
+    std::map<int, int> expected;
+    for (int i = 0; i < test_size; ++i) {
+        const int random_number = rng();
+        tree.Insert(random_number, random_number);
+        expected.emplace(random_number, random_number);
+    }
+
+    ASSERT_EQ(static_cast<size_t>(std::ranges::distance(tree)), tree.Size());
+    ASSERT_TRUE(std::ranges::is_sorted(tree | std::views::keys));
+    ASSERT_TRUE(std::ranges::equal(tree | std::views::keys, expected | std::views::keys));
+    ASSERT_TRUE(std::ranges::equal(tree | std::views::reverse | std::views::keys, expected | std::views::reverse | std::views::keys));
+}
+
+TEST(IteratorTests, ModifyValueTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    for (const int& e : classic_array) {
+        tree.Insert(e, e);
+    }
+
+    for (auto [key, value] : tree) {
+        value = key * 2;
+    }
+
+    const auto& const_tree = tree;
+    std::vector<int> values;
+    for (auto it = const_tree.cbegin(); it != const_tree.cend(); ++it) {
+        values.push_back(it->second);
+    }
+    ASSERT_EQ(values.size(), classic_array.size());
+    for (const int& e : classic_array) {
+        ASSERT_EQ(*tree.GetValue(e), e * 2);
+    }
+
+    rbt::RedBlackTree<int, int>::const_iterator it = tree.begin();
+    ASSERT_EQ(it, const_tree.begin());
+}
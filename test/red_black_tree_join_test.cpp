@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+#include "thread_pool.h"
+
+namespace
+{
+
+struct SumAndRankPolicy : rbt::DefaultTreePolicy
+{
+    static constexpr bool kOrderStatistics = true;
+    using Aggregate = rbt::SumAggregate<long long>;
+};
+
+using AugmentedTree = rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, SumAndRankPolicy>;
+
+template <typename Tree> void ExpectValidContent(Tree& tree, const std::map<int, int>& expected)
+{
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ExpectSameContent(std::as_const(tree), expected);
+}
+
+template <typename Tree> auto MakeTree(const std::map<int, int>& entries) -> Tree
+{
+    Tree tree;
+    for (const auto& [key, value] : entries) {
+        tree.Insert(key, value);
+    }
+    return tree;
+}
+
+auto RandomEntries(const size_t count, const int max_key, const int value) -> std::map<int, int>
+{
+    rbt::IntRandomNumberGenerator rng(0, max_key);
+    std::map<int, int> entries;
+    while (entries.size() < count) {
+        entries.emplace(rng(), value);
+    }
+    return entries;
+}
+
+} // namespace
+
+TEST(JoinTests, ClassicSplitTest)
+{
+    std::map<int, int> expected;
+    for (const int& e : classic_array) {
+        expected.emplace(e, e * 2);
+    }
+
+    // Present keys, absent keys and keys outside the range.
+    for (const int key : {50, 10, 90, 51, 0, 100}) {
+        auto tree = MakeTree<rbt::RedBlackTree<int, int>>(expected);
+        auto [left, right] = tree.Split(key);
+        ASSERT_TRUE(tree.IsEmpty());
+        ExpectValidContent(left, {expected.begin(), expected.lower_bound(key)});
+        ExpectValidContent(right, {expected.lower_bound(key), expected.end()});
+    }
+}
+
+TEST(JoinTests, SplitJoinTest)
+{
+    std::map<int, int> expected;
+    for (int i = 0; i < test_size; i++) {
+        expected.emplace(i * 2, i);
+    }
+
+    AugmentedTree tree = MakeTree<AugmentedTree>(expected);
+    for (const int key : {1, 2, test_size / 3, test_size, 2 * test_size - 2}) {
+        auto [left, right] = tree.Split(key);
+        ExpectValidContent(left, {expected.begin(), expected.lower_bound(key)});
+        ExpectValidContent(right, {expected.lower_bound(key), expected.end()});
+        ASSERT_TRUE(tree.IsEmpty());
+        ASSERT_EQ(left.Aggregate() + right.Aggregate(), (test_size - 1) * test_size / 2);
+
+        // Joining the halves with a new middle key restores the tree, whatever their heights are.
+        if (key % 2 != 0) {
+            tree = AugmentedTree::Join(std::move(left), key, -1, std::move(right));
+            expected.emplace(key, -1);
+            ExpectValidContent(tree, expected);
+            ASSERT_EQ(tree.Rank(key), static_cast<size_t>(std::distance(expected.begin(), expected.find(key))));
+            tree.Erase(key);
+            expected.erase(key);
+        } else {
+            tree = AugmentedTree::Join(std::move(left), std::move(right));
+        }
+        ExpectValidContent(tree, expected);
+    }
+}
+
+TEST(JoinTests, UnevenJoinTest)
+{
+    // Every size pair up to 64, so the taller side varies and red roots and red spines appear on both sides.
+    for (int left_size = 0; left_size < 64; left_size += 3) {
+        for (int right_size = 0; right_size < 64; right_size += 5) {
+            std::map<int, int> left_entries;
+            std::map<int, int> right_entries;
+            for (int i = 0; i < left_size; i++) {
+                left_entries.emplace(i, i);
+            }
+            for (int i = 0; i < right_size; i++) {
+                right_entries.emplace(left_size + 1 + i, i);
+            }
+            auto left = MakeTree<AugmentedTree>(left_entries);
+            auto right = MakeTree<AugmentedTree>(right_entries);
+
+            AugmentedTree tree = AugmentedTree::Join(std::move(left), left_size, 0, std::move(right));
+            ASSERT_TRUE(left.IsEmpty());
+            ASSERT_TRUE(right.IsEmpty());
+            left_entries.merge(right_entries);
+            left_entries.emplace(left_size, 0);
+            ExpectValidContent(tree, left_entries);
+        }
+    }
+}
+
+TEST(JoinTests, SetOperationTest)
+{
+    for (const auto& [lhs_size, rhs_size] : {std::pair<size_t, size_t>{0, 100}, {100, 0}, {test_size, 10}, {10, test_size}, {test_size, test_size}}) {
+        const auto lhs_entries = RandomEntries(lhs_size, 2 * test_size, 1);
+        const auto rhs_entries = RandomEntries(rhs_size, 2 * test_size, 2);
+
+        std::map<int, int> union_entries = lhs_entries;
+        std::map<int, int> intersection_entries;
+        std::map<int, int> difference_entries = lhs_entries;
+        for (const auto& [key, value] : rhs_entries) {
+            union_entries.emplace(key, value);
+            if (lhs_entries.contains(key)) {
+                intersection_entries.emplace(key, 1);
+            }
+            difference_entries.erase(key);
+        }
+
+        auto tree = AugmentedTree::Union(MakeTree<AugmentedTree>(lhs_entries), MakeTree<AugmentedTree>(rhs_entries));
+        ExpectValidContent(tree, union_entries);
+        tree = AugmentedTree::Intersection(MakeTree<AugmentedTree>(lhs_entries), MakeTree<AugmentedTree>(rhs_entries));
+        ExpectValidContent(tree, intersection_entries);
+        tree = AugmentedTree::Difference(MakeTree<AugmentedTree>(lhs_entries), MakeTree<AugmentedTree>(rhs_entries));
+        ExpectValidContent(tree, difference_entries);
+    }
+}
+
+TEST(JoinTests, ParallelSetOperationTest)
+{
+    // Large enough that the recursion is handed to the pool for several levels.
+    constexpr size_t kSize = 50 * test_size;
+    const auto lhs_entries = RandomEntries(kSize, 4 * kSize, 1);
+    const auto rhs_entries = RandomEntries(kSize, 4 * kSize, 2);
+    std::map<int, int> union_entries = lhs_entries;
+    std::map<int, int> difference_entries = lhs_entries;
+    for (const auto& [key, value] : rhs_entries) {
+        union_entries.emplace(key, value);
+        difference_entries.erase(key);
+    }
+
+    rbt::ThreadPool pool(4);
+    using Tree = rbt::RedBlackTree<int, int>;
+    auto tree = Tree::Union(MakeTree<Tree>(lhs_entries), MakeTree<Tree>(rhs_entries), &pool);
+    ExpectValidContent(tree, union_entries);
+    tree = Tree::Difference(std::move(tree), MakeTree<Tree>(rhs_entries), &pool);
+    ExpectValidContent(tree, difference_entries);
+    tree = Tree::Intersection(std::move(tree), MakeTree<Tree>(lhs_entries), &pool);
+    ExpectValidContent(tree, difference_entries);
+}
+
+TEST(JoinTests, UnequalAllocatorTest)
+{
+    // Every pooled tree has its own pool, the nodes of rhs are moved into the pool of lhs.
+    using Tree = rbt::PooledRedBlackTree<int, int>;
+    std::map<int, int> lhs_entries;
+    std::map<int, int> rhs_entries;
+    for (int i = 0; i < test_size; i++) {
+        (i % 2 == 0 ? lhs_entries : rhs_entries).emplace(i, i);
+    }
+
+    Tree lhs = MakeTree<Tree>(lhs_entries);
+    Tree rhs = MakeTree<Tree>(rhs_entries);
+    Tree tree = Tree::Union(std::move(lhs), std::move(rhs));
+    ASSERT_TRUE(rhs.IsEmpty());
+    lhs_entries.merge(rhs_entries);
+    ExpectValidContent(tree, lhs_entries);
+
+    auto [left, right] = tree.Split(test_size / 2);
+    tree = Tree::Join(std::move(left), std::move(right));
+    ExpectValidContent(tree, lhs_entries);
+}
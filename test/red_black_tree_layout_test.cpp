@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+class CountingResource final : public std::pmr::memory_resource
+{
+public:
+    size_t Allocated = 0;
+    size_t Deallocated = 0;
+    size_t LastBytes = 0;
+
+private:
+    void* do_allocate(const size_t bytes, const size_t alignment) override
+    {
+        Allocated++;
+        LastBytes = bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, const size_t bytes, const size_t alignment) override
+    {
+        Deallocated++;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
+
+struct OrderStatisticsIndexPolicy : rbt::OrderStatisticsPolicy
+{
+    static constexpr rbt::NodeLayout kNodeLayout = rbt::NodeLayout::Index32;
+};
+
+template <rbt::NodeLayout Layout> using LayoutTree = rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, rbt::LayoutPolicy<Layout>>;
+
+template <typename Tree> void RandomInsertErase()
+{
+    Tree tree;
+    std::map<int, int> expected;
+    rbt::IntRandomNumberGenerator rng(0, test_size);
+    for (int i = 0; i < 4 * test_size; i++) {
+        const int key = rng();
+        if (i % 3 == 2) {
+            ASSERT_EQ(tree.Erase(key), expected.erase(key) == 1);
+        } else {
+            ASSERT_EQ(tree.Insert(key, i), expected.emplace(key, i).second);
+        }
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ExpectSameContent(tree, expected);
+
+    tree.Clear();
+    ASSERT_TRUE(tree.IsEmpty());
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Insert(e, e));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+}
+
+} // namespace
+
+TEST(LayoutTests, RandomInsertEraseTest)
+{
+    RandomInsertErase<LayoutTree<rbt::NodeLayout::Pointer>>();
+    RandomInsertErase<LayoutTree<rbt::NodeLayout::PackedColor>>();
+    RandomInsertErase<LayoutTree<rbt::NodeLayout::Index32>>();
+}
+
+TEST(LayoutTests, NodeSizeTest)
+{
+    CountingResource resource;
+    {
+        rbt::pmr::RedBlackTree<int, int, std::less<int>, rbt::LayoutPolicy<rbt::NodeLayout::PackedColor>> tree(&resource);
+        ASSERT_TRUE(tree.Insert(1, 1));
+        ASSERT_EQ(resource.LastBytes, 2 * sizeof(void*) + 2 * sizeof(int));
+    }
+
+    // Index32 nodes of 16 bytes are carved out of 64 KiB chunks.
+    {
+        rbt::pmr::RedBlackTree<int, int, std::less<int>, rbt::LayoutPolicy<rbt::NodeLayout::Index32>> tree(&resource);
+        const size_t allocated = resource.Allocated;
+        for (int i = 0; i < 4000; i++) {
+            ASSERT_TRUE(tree.Insert(i, i));
+        }
+        ASSERT_EQ(resource.Allocated, allocated + 1);
+        ASSERT_EQ(resource.LastBytes, size_t{1} << 16);
+
+        for (int i = 4000; i < 9000; i++) {
+            ASSERT_TRUE(tree.Insert(i, i));
+        }
+        ASSERT_EQ(resource.Allocated, allocated + 3);
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+    ASSERT_EQ(resource.Allocated, resource.Deallocated);
+}
+
+TEST(LayoutTests, IndexFreeListTest)
+{
+    CountingResource resource;
+    rbt::pmr::RedBlackTree<int, int, std::less<int>, rbt::LayoutPolicy<rbt::NodeLayout::Index32>> tree(&resource);
+    for (int i = 0; i < 2 * test_size; i++) {
+        ASSERT_TRUE(tree.Insert(i, i));
+    }
+    const size_t chunk_count = resource.Allocated;
+
+    // Erased slots are reused before the last chunk is extended.
+    for (int i = 0; i < 2 * test_size; i += 2) {
+        ASSERT_TRUE(tree.Erase(i));
+    }
+    for (int i = 0; i < 2 * test_size; i += 2) {
+        ASSERT_TRUE(tree.Insert(i, -i));
+    }
+    ASSERT_EQ(resource.Allocated, chunk_count);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    for (int i = 0; i < 2 * test_size; i++) {
+        ASSERT_EQ(tree.GetValue(i), i % 2 == 0 ? -i : i);
+    }
+
+    // Erasing every node keeps the chunks, Clear drops them.
+    for (int i = 0; i < 2 * test_size; i++) {
+        ASSERT_TRUE(tree.Erase(i));
+    }
+    ASSERT_EQ(resource.Deallocated, 0);
+    tree.Clear();
+    ASSERT_EQ(resource.Allocated, resource.Deallocated);
+}
+
+TEST(LayoutTests, IndexStringKeyTest)
+{
+    rbt::RedBlackTree<std::string, std::string, std::less<>, std::allocator<std::pair<const std::string, std::string>>, rbt::LayoutPolicy<rbt::NodeLayout::Index32>>
+        tree;
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Insert(std::to_string(i), std::string(32, 'x')));
+    }
+    for (int i = 0; i < test_size; i += 3) {
+        ASSERT_TRUE(tree.Erase(std::to_string(i)));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_TRUE(tree.Contains("1"));
+    ASSERT_FALSE(tree.Contains("3"));
+}
+
+TEST(LayoutTests, IndexOrderStatisticsTest)
+{
+    rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, OrderStatisticsIndexPolicy> tree;
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Insert(2 * i, i));
+    }
+    for (int i = 0; i < test_size; i += 2) {
+        ASSERT_TRUE(tree.Erase(2 * i));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(tree.Rank(4 * test_size), test_size / 2);
+    ASSERT_EQ(tree.Select(0)->first, 2);
+    ASSERT_EQ(tree.CountInRange(0, 2 * test_size), test_size / 2);
+}
+
+TEST(LayoutTests, IndexMoveSwapBatchTest)
+{
+    std::vector<std::pair<int, int>> entries;
+    for (int i = 0; i < test_size; i++) {
+        entries.emplace_back(i, i);
+    }
+    rbt::CompactRedBlackTree<int, int> tree(entries.begin(), entries.end());
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    rbt::CompactRedBlackTree<int, int> moved(std::move(tree));
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_EQ(moved.Size(), test_size);
+    ASSERT_TRUE(tree.Insert(-1, -1));
+
+    tree.Swap(moved);
+    ASSERT_EQ(tree.Size(), test_size);
+    ASSERT_EQ(moved.Size(), 1);
+
+    moved = std::move(tree);
+    ASSERT_EQ(moved.Size(), test_size);
+    ASSERT_EQ(moved.EraseBatch(std::vector<int>{1, 2, 3}), 3);
+    ASSERT_EQ(moved.InsertBatch(std::vector<std::pair<int, int>>{{1, 1}, {test_size, 0}}), 2);
+    ASSERT_TRUE(moved.RedBlackTreeRulesCheck());
+    ASSERT_EQ(moved.Size(), test_size - 1);
+
+    std::vector<int> keys = {0, 2, test_size};
+    std::vector<std::optional<int>> values(keys.size());
+    moved.GetValues(keys, values);
+    ASSERT_EQ(values, (std::vector<std::optional<int>>{0, std::nullopt, 0}));
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+/**
+ * Transparent comparator counting the comparisons made against a std::string_view probe.
+ */
+struct CountingLess
+{
+    using is_transparent = void;
+
+    inline static size_t ViewComparisons = 0;
+
+    bool operator()(const std::string& lhs, const std::string& rhs) const { return lhs < rhs; }
+
+    bool operator()(const std::string& lhs, const std::string_view rhs) const
+    {
+        ViewComparisons++;
+        return lhs < rhs;
+    }
+
+    bool operator()(const std::string_view lhs, const std::string& rhs) const
+    {
+        ViewComparisons++;
+        return lhs < rhs;
+    }
+};
+
+} // namespace
+
+TEST(LookupTests, FindContainsTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    ASSERT_EQ(tree.Find(1), tree.end());
+    ASSERT_FALSE(tree.Contains(1));
+
+    for (const int& e : classic_array) {
+        tree.Insert(e, e * 2);
+    }
+    for (int i = 0; i <= 100; i++) {
+        const bool expected = tree.GetValue(i).has_value();
+        ASSERT_EQ(tree.Contains(i), expected);
+        const auto it = std::as_const(tree).Find(i);
+        ASSERT_EQ(it != tree.cend(), expected);
+        if (expected) {
+            ASSERT_EQ(it->first, i);
+            ASSERT_EQ(it->second, i * 2);
+        }
+    }
+
+    // The iterator continues in key order and writes in place.
+    auto it = tree.Find(50);
+    it->second = -1;
+    ASSERT_EQ((++it)->first, 55);
+    ASSERT_EQ(*tree.GetValue(50), -1);
+}
+
+TEST(LookupTests, VisitTest)
+{
+    rbt::RedBlackTree<int, std::vector<int>> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, std::vector<int>(8, i));
+    }
+
+    // The value is modified in place.
+    ASSERT_TRUE(tree.Visit(7, [](const int key, std::vector<int>& value) { value.push_back(key); }));
+    ASSERT_FALSE(tree.Visit(test_size, [](const int, std::vector<int>&) { FAIL(); }));
+    ASSERT_EQ(tree.GetValue(7)->size(), 9);
+
+    size_t total = 0;
+    const auto& const_tree = tree;
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(const_tree.Visit(i, [&](const int, const std::vector<int>& value) { total += value.size(); }));
+    }
+    ASSERT_EQ(total, test_size * 8 + 1);
+}
+
+TEST(LookupTests, HeterogeneousLookupTest)
+{
+    rbt::RedBlackTree<std::string, int, std::less<>> tree;
+    for (int i = 0; i < 100; i++) {
+        tree.Insert(std::to_string(i), i);
+    }
+
+    const std::string_view key = "42";
+    ASSERT_TRUE(tree.Contains(key));
+    ASSERT_TRUE(tree.Contains("7"));
+    ASSERT_FALSE(tree.Contains(std::string_view("420")));
+    ASSERT_EQ(tree.Find(key)->second, 42);
+    ASSERT_EQ(*tree.GetValue(key), 42);
+    ASSERT_TRUE(tree.Visit(key, [](const std::string& k, int& value) { value = static_cast<int>(k.size()); }));
+    ASSERT_EQ(*tree.GetValue("42"), 2);
+}
+
+TEST(LookupTests, TransparentComparatorTest)
+{
+    rbt::RedBlackTree<std::string, int, CountingLess> tree;
+    for (int i = 0; i < 100; i++) {
+        tree.Insert(std::to_string(i), i);
+    }
+
+    // The string_view overloads of the comparator are used, no std::string is built for the probe.
+    CountingLess::ViewComparisons = 0;
+    ASSERT_TRUE(tree.Contains(std::string_view("99")));
+    ASSERT_NE(tree.Find(std::string_view("10")), tree.end());
+    ASSERT_GT(CountingLess::ViewComparisons, 0);
+}
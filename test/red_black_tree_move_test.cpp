@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+/**
+ * Value counting its constructions and copies.
+ */
+struct CountingValue
+{
+    inline static size_t Constructions = 0;
+    inline static size_t Copies = 0;
+
+    std::string Payload;
+
+    CountingValue() { Constructions++; }
+
+    explicit CountingValue(std::string payload) : Payload(std::move(payload)) { Constructions++; }
+
+    CountingValue(const CountingValue& other) : Payload(other.Payload)
+    {
+        Constructions++;
+        Copies++;
+    }
+
+    CountingValue(CountingValue&& other) noexcept : Payload(std::move(other.Payload)) { Constructions++; }
+
+    auto operator=(const CountingValue& other) -> CountingValue&
+    {
+        Payload = other.Payload;
+        Copies++;
+        return *this;
+    }
+
+    auto operator=(CountingValue&& other) noexcept -> CountingValue&
+    {
+        Payload = std::move(other.Payload);
+        return *this;
+    }
+
+    ~CountingValue() = default;
+};
+
+auto MakeTree(const int size) -> rbt::RedBlackTree<int, int>
+{
+    rbt::RedBlackTree<int, int> tree;
+    for (int i = 0; i < size; i++) {
+        tree.Insert(i, i);
+    }
+    return tree;
+}
+
+} // namespace
+
+TEST(MoveTests, TryEmplaceTest)
+{
+    rbt::RedBlackTree<int, CountingValue> tree;
+    CountingValue::Constructions = CountingValue::Copies = 0;
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.TryEmplace(i, std::string(100, 'x')));
+    }
+    ASSERT_EQ(CountingValue::Constructions, test_size);
+
+    // Present keys construct nothing.
+    std::string payload(100, 'y');
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_FALSE(tree.TryEmplace(i, std::move(payload)));
+    }
+    ASSERT_EQ(CountingValue::Constructions, test_size);
+    ASSERT_EQ(payload.size(), 100);
+    ASSERT_EQ(CountingValue::Copies, 0);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+}
+
+TEST(MoveTests, EmplaceTest)
+{
+    rbt::RedBlackTree<std::string, std::unique_ptr<int>> tree;
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(tree.Emplace(std::to_string(i), std::make_unique<int>(i)));
+    }
+    ASSERT_FALSE(tree.Emplace("42", std::make_unique<int>(-1)));
+    ASSERT_TRUE(tree.Emplace("abc", nullptr));
+
+    std::string key = "100";
+    ASSERT_TRUE(tree.TryEmplace(std::move(key), std::make_unique<int>(100)));
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(tree.Size(), 102);
+    ASSERT_TRUE(tree.Visit("42", [](const std::string&, const std::unique_ptr<int>& value) { ASSERT_EQ(*value, 42); }));
+    ASSERT_TRUE(tree.Visit("100", [](const std::string&, const std::unique_ptr<int>& value) { ASSERT_EQ(*value, 100); }));
+
+    // Erasing inner nodes moves the entries of their predecessors into them.
+    for (int i = 0; i < 100; i += 2) {
+        ASSERT_TRUE(tree.Erase(std::to_string(i)));
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+    ASSERT_EQ(tree.Size(), 52);
+    for (int i = 1; i < 100; i += 2) {
+        ASSERT_TRUE(tree.Visit(std::to_string(i), [i](const std::string&, const std::unique_ptr<int>& value) { ASSERT_EQ(*value, i); }));
+    }
+}
+
+TEST(MoveTests, InsertOrAssignTest)
+{
+    rbt::RedBlackTree<int, CountingValue> tree;
+    CountingValue::Copies = 0;
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.InsertOrAssign(e, CountingValue(std::to_string(e))));
+    }
+    for (const int& e : classic_array) {
+        ASSERT_FALSE(tree.InsertOrAssign(e, CountingValue("updated")));
+    }
+    ASSERT_EQ(tree.Size(), classic_array.size());
+    ASSERT_EQ(CountingValue::Copies, 0);
+    for (const int& e : classic_array) {
+        ASSERT_EQ(tree.GetValue(e)->Payload, "updated");
+    }
+
+    // Erases move the entries of predecessors instead of copying them.
+    CountingValue::Copies = 0;
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Erase(e));
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_EQ(CountingValue::Copies, 0);
+
+    // Aggregates follow the assigned value.
+    rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, rbt::AggregatePolicy<rbt::SumAggregate<long long>>> sum_tree;
+    for (int i = 0; i < test_size; i++) {
+        sum_tree.InsertOrAssign(i, 1);
+    }
+    for (int i = 0; i < test_size; i += 2) {
+        sum_tree.InsertOrAssign(i, 3);
+    }
+    ASSERT_EQ(sum_tree.Aggregate(), 2 * test_size);
+    ASSERT_TRUE(sum_tree.RedBlackTreeRulesCheck());
+}
+
+TEST(MoveTests, MoveConstructTest)
+{
+    rbt::RedBlackTree<int, int> tree = MakeTree(test_size);
+    ASSERT_EQ(tree.Size(), test_size);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    rbt::RedBlackTree<int, int> moved(std::move(tree));
+    ASSERT_EQ(moved.Size(), test_size);
+    ASSERT_TRUE(tree.IsEmpty()); // NOLINT
+    ASSERT_EQ(tree.Size(), 0);   // NOLINT
+    ASSERT_TRUE(tree.Insert(1, 1));
+
+    std::vector<rbt::RedBlackTree<int, int>> trees;
+    for (int i = 0; i < 10; i++) {
+        trees.push_back(MakeTree(i * 10));
+    }
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(trees[i].Size(), i * 10);
+        ASSERT_TRUE(trees[i].RedBlackTreeRulesCheck());
+    }
+}
+
+TEST(MoveTests, MoveAssignTest)
+{
+    rbt::PooledRedBlackTree<int, int> pooled_tree;
+    rbt::PooledRedBlackTree<int, int> other_pooled_tree;
+    for (int i = 0; i < test_size; i++) {
+        other_pooled_tree.Insert(i, i);
+    }
+    pooled_tree.Insert(-1, -1);
+    pooled_tree = std::move(other_pooled_tree);
+    ASSERT_EQ(pooled_tree.Size(), test_size);
+    ASSERT_FALSE(pooled_tree.Contains(-1));
+    ASSERT_TRUE(pooled_tree.RedBlackTreeRulesCheck());
+
+    // Unequal polymorphic allocators do not propagate, the elements are moved into new nodes.
+    std::pmr::unsynchronized_pool_resource resource;
+    std::pmr::unsynchronized_pool_resource other_resource;
+    rbt::pmr::RedBlackTree<std::string, std::string> pmr_tree(&resource);
+    rbt::pmr::RedBlackTree<std::string, std::string> other_pmr_tree(&other_resource);
+    for (int i = 0; i < 100; i++) {
+        other_pmr_tree.Insert(std::to_string(i), std::string(64, 'x'));
+    }
+    pmr_tree = std::move(other_pmr_tree);
+    ASSERT_EQ(pmr_tree.Size(), 100);
+    ASSERT_TRUE(other_pmr_tree.IsEmpty()); // NOLINT
+    ASSERT_EQ(pmr_tree.GetAllocator().resource(), &resource);
+    ASSERT_EQ(*pmr_tree.GetValue("42"), std::string(64, 'x'));
+    ASSERT_TRUE(pmr_tree.RedBlackTreeRulesCheck());
+}
+
+TEST(MoveTests, SwapTest)
+{
+    rbt::RedBlackTree<int, int> tree = MakeTree(10);
+    rbt::RedBlackTree<int, int> other_tree = MakeTree(100);
+    swap(tree, other_tree);
+    ASSERT_EQ(tree.Size(), 100);
+    ASSERT_EQ(other_tree.Size(), 10);
+
+    tree.Swap(other_tree);
+    ASSERT_EQ(tree.Size(), 10);
+    ASSERT_EQ(other_tree.Size(), 100);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_TRUE(other_tree.RedBlackTreeRulesCheck());
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+TEST(OrderStatisticsTests, ClassicTest)
+{
+    rbt::OrderStatisticsTree<int, int> tree;
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Insert(e, e));
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+
+    std::vector<int> sorted(classic_array.begin(), classic_array.end());
+    std::ranges::sort(sorted);
+    for (size_t i = 0; i < sorted.size(); i++) {
+        ASSERT_EQ(tree.Rank(sorted[i]), i);
+        ASSERT_EQ(tree.Select(i)->first, sorted[i]);
+    }
+    ASSERT_EQ(tree.Select(sorted.size()), tree.end());
+    ASSERT_EQ(tree.Rank(0), 0);
+    ASSERT_EQ(tree.Rank(100), sorted.size());
+
+    ASSERT_EQ(tree.CountInRange(20, 60), 6);
+    ASSERT_EQ(tree.CountInRange(21, 60), 5);
+    ASSERT_EQ(tree.CountInRange(60, 20), 0);
+    ASSERT_EQ(tree.CountInRange(0, 100), sorted.size());
+}
+
+TEST(OrderStatisticsTests, OrderedInsertDeleteTest)
+{
+    rbt::OrderStatisticsTree<int, int> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    for (int i = 0; i < test_size; i += 2) {
+        ASSERT_TRUE(tree.Erase(i));
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+
+    // Only odd keys are left.
+    for (int i = 0; i < test_size / 2; i++) {
+        ASSERT_EQ(tree.Select(i)->first, 2 * i + 1);
+        ASSERT_EQ(tree.Rank(2 * i + 1), i);
+    }
+}
+
+TEST(OrderStatisticsTests, RandomInsertDeleteTest)
+{
+    rbt::OrderStatisticsTree<int, int> tree;
+    rbt::IntRandomNumberGenerator rng(0, 999);
+    std::set<int> expected;
+
+    for (int i = 0; i < test_size; ++i) {
+        const int random_number = rng();
+        ASSERT_EQ(tree.Insert(random_number, random_number), expected.insert(random_number).second);
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+    for (int i = 0; i < test_size; ++i) {
+        const int random_number = rng();
+        ASSERT_EQ(tree.Erase(random_number), expected.erase(random_number) == 1);
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+
+    const std::vector<int> sorted(expected.begin(), expected.end());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        ASSERT_EQ(tree.Select(i)->first, sorted[i]);
+        ASSERT_EQ(tree.Rank(sorted[i]), i);
+    }
+    for (int lo = 0; lo < 1000; lo += 37) {
+        const int hi = lo + 123;
+        const auto count = std::distance(expected.lower_bound(lo), expected.lower_bound(hi));
+        ASSERT_EQ(tree.CountInRange(lo, hi), count);
+    }
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+TEST(RangeTests, EmptyTest)
+{
+    const rbt::RedBlackTree<int, int> tree;
+    ASSERT_EQ(tree.LowerBound(1), tree.end());
+    ASSERT_EQ(tree.UpperBound(1), tree.end());
+    ASSERT_EQ(tree.Floor(1), tree.end());
+    ASSERT_EQ(tree.Ceiling(1), tree.end());
+    ASSERT_EQ(tree.RangeScan(0, 100, [](const int&, const int&) {}), 0);
+}
+
+TEST(RangeTests, ClassicBoundTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    for (const int& e : classic_array) {
+        tree.Insert(e, e + 1);
+    }
+
+    ASSERT_EQ(tree.LowerBound(50)->first, 50);
+    ASSERT_EQ(tree.UpperBound(50)->first, 55);
+    ASSERT_EQ(tree.LowerBound(51)->first, 55);
+    ASSERT_EQ(tree.Floor(51)->first, 50);
+    ASSERT_EQ(tree.Floor(50)->first, 50);
+    ASSERT_EQ(tree.Ceiling(51)->first, 55);
+
+    // Out of range.
+    ASSERT_EQ(tree.Floor(4), tree.end());
+    ASSERT_EQ(tree.LowerBound(91), tree.end());
+    ASSERT_EQ(tree.UpperBound(90), tree.end());
+    ASSERT_EQ(tree.LowerBound(0), tree.begin());
+
+    // Equal range.
+    auto [first, last] = tree.EqualRange(60);
+    ASSERT_EQ(first->first, 60);
+    ASSERT_EQ(first->second, 61);
+    ASSERT_EQ(++first, last);
+    auto [missing_first, missing_last] = tree.EqualRange(61);
+    ASSERT_EQ(missing_first, missing_last);
+
+    // Bounds are ordinary iterators.
+    auto it = tree.Floor(51);
+    ASSERT_EQ((--it)->first, 45);
+}
+
+TEST(RangeTests, RandomBoundTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    rbt::IntRandomNumberGenerator rng(0, test_size * 4);
+    std::map<int, int> expected;
+    for (int i = 0; i < test_size; ++i) {
+        const int random_number = rng();
+        tree.Insert(random_number, random_number);
+        expected.emplace(random_number, random_number);
+    }
+
+    for (int key = -1; key <= test_size * 4 + 1; ++key) {
+        const auto lower = expected.lower_bound(key);
+        const auto upper = expected.upper_bound(key);
+        ASSERT_EQ(tree.LowerBound(key) == tree.end(), lower == expected.end());
+        ASSERT_EQ(tree.UpperBound(key) == tree.end(), upper == expected.end());
+        if (lower != expected.end()) {
+            ASSERT_EQ(tree.LowerBound(key)->first, lower->first);
+        }
+        if (upper != expected.end()) {
+            ASSERT_EQ(tree.UpperBound(key)->first, upper->first);
+        }
+        if (upper == expected.begin()) {
+            ASSERT_EQ(tree.Floor(key), tree.end());
+        } else {
+            ASSERT_EQ(tree.Floor(key)->first, std::prev(upper)->first);
+        }
+    }
+}
+
+TEST(RangeTests, RangeScanTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    for (int i = 0; i < test_size; i += 2) {
+        tree.Insert(i, i * 10);
+    }
+
+    std::vector<int> keys;
+    const size_t count = tree.RangeScan(101, 121, [&keys](const int& key, const int& value) {
+        ASSERT_EQ(value, key * 10);
+        keys.push_back(key);
+    });
+    ASSERT_EQ(count, 10);
+    ASSERT_EQ(keys, std::vector<int>({102, 104, 106, 108, 110, 112, 114, 116, 118, 120}));
+
+    // Half-open range and empty range.
+    ASSERT_EQ(tree.RangeScan(100, 102, [](const int&, const int&) {}), 1);
+    ASSERT_EQ(tree.RangeScan(102, 102, [](const int&, const int&) {}), 0);
+    ASSERT_EQ(tree.RangeScan(-100, test_size * 2, [](const int&, const int&) {}), tree.Size());
+
+    // Early stop.
+    keys.clear();
+    tree.RangeScan(0, test_size, [&keys](const int& key, const int&) {
+        keys.push_back(key);
+        return keys.size() < 3;
+    });
+    ASSERT_EQ(keys, std::vector<int>({0, 2, 4}));
+
+    // Values can be updated in place.
+    tree.RangeScan(0, 10, [](const int&, int& value) { value = -1; });
+    ASSERT_EQ(*tree.GetValue(8), -1);
+    ASSERT_EQ(*tree.GetValue(10), 100);
+}
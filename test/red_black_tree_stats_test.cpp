@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+
+#include <bit>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+struct ClassicTag;
+struct ReorientTag;
+struct SequentialTag;
+struct BatchLookupTag;
+struct BatchUpdateTag;
+struct ThreadTag;
+struct LessOnlyTag;
+struct PooledTag;
+struct CompactTag;
+
+// A less-than comparator that the tree cannot replace with a three-way comparison, counting its calls.
+struct CountingLess
+{
+    static inline size_t calls = 0;
+
+    bool operator()(const int lhs, const int rhs) const
+    {
+        calls++;
+        return lhs < rhs;
+    }
+};
+
+template <class Tag> using CountedTree = rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, rbt::StatisticsPolicy<Tag>>;
+
+template <class Tree> void ExpectConsistentShape(const Tree& tree)
+{
+    const rbt::TreeStats stats = tree.Stats();
+    ASSERT_EQ(stats.Size, tree.Size());
+    ASSERT_EQ(std::accumulate(stats.DepthHistogram.begin(), stats.DepthHistogram.end(), size_t{0}), tree.Size());
+    ASSERT_EQ(stats.Height, static_cast<int>(stats.DepthHistogram.size()));
+    // Every level above the black height is full, and no path is longer than twice the black height.
+    for (int depth = 0; depth < stats.BlackHeight; depth++) {
+        ASSERT_EQ(stats.DepthHistogram[depth], size_t{1} << depth);
+    }
+    ASSERT_LE(stats.Height, 2 * stats.BlackHeight);
+    ASSERT_LE(stats.Height, 2 * std::bit_width(tree.Size()));
+    ASSERT_LE(stats.AverageDepth, stats.Height);
+    ASSERT_GE(stats.MemoryBytes, sizeof(tree) + tree.Size() * 2 * sizeof(void*));
+}
+
+} // namespace
+
+TEST(StatsTests, EmptyStatsTest)
+{
+    const rbt::RedBlackTree<int, int> tree;
+    const rbt::TreeStats stats = tree.Stats();
+    ASSERT_EQ(stats.Size, 0);
+    ASSERT_EQ(stats.Height, 0);
+    ASSERT_EQ(stats.BlackHeight, 0);
+    ASSERT_EQ(stats.AverageDepth, 0);
+    ASSERT_TRUE(stats.DepthHistogram.empty());
+    ASSERT_EQ(stats.MemoryBytes, sizeof(tree));
+    ASSERT_EQ(stats.Counts.ComparisonsPerOperation(), 0);
+}
+
+TEST(StatsTests, ClassicStatsTest)
+{
+    CountedTree<ClassicTag> tree;
+    for (const int& e : classic_array) {
+        tree.Insert(e, e);
+        ExpectConsistentShape(tree);
+    }
+
+    const rbt::TreeStats stats = tree.Stats();
+    const rbt::OperationCounts& counts = stats.Counts;
+    ASSERT_EQ(counts[rbt::Counter::Inserts], classic_array.size());
+    ASSERT_EQ(counts[rbt::Counter::NodesAllocated], classic_array.size());
+    ASSERT_GT(counts[rbt::Counter::Rotations], 0);
+    ASSERT_GE(counts.ComparisonsPerOperation(), 1);
+
+    // Lookups count once each, and compare about as often as the tree is deep.
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Contains(e));
+    }
+    const rbt::OperationCounts lookups = rbt::OperationCounters<ClassicTag>::Snapshot() - counts;
+    ASSERT_EQ(lookups[rbt::Counter::Lookups], classic_array.size());
+    ASSERT_EQ(lookups[rbt::Counter::Inserts], 0);
+    ASSERT_LE(lookups.ComparisonsPerOperation(), stats.Height);
+
+    for (const int& e : classic_array) {
+        tree.Erase(e);
+    }
+    const rbt::OperationCounts total = rbt::OperationCounters<ClassicTag>::Snapshot();
+    ASSERT_EQ(total[rbt::Counter::Erases], classic_array.size());
+    ASSERT_EQ(total[rbt::Counter::NodesFreed], classic_array.size());
+    ASSERT_GT(total[rbt::Counter::EraseRecolors], 0);
+    ASSERT_EQ(tree.Stats().Size, 0);
+}
+
+TEST(StatsTests, ReorientStatsTest)
+{
+    // Only the inserts of 4 and 6 meet a node with two red children on the way down, at the root 2 and then at 4.
+    CountedTree<ReorientTag> tree;
+    for (int i = 1; i <= 6; i++) {
+        tree.Insert(i, i);
+    }
+    ASSERT_EQ(rbt::OperationCounters<ReorientTag>::Snapshot()[rbt::Counter::Reorients], 2);
+}
+
+TEST(StatsTests, BatchLookupStatsTest)
+{
+    CountedTree<BatchLookupTag> tree;
+    for (int i = 0; i < test_size; i += 2) {
+        tree.Insert(i, i);
+    }
+    const int height = tree.Stats().Height;
+
+    // GetValues counts a lookup per key, hits and misses alike, so its comparisons per operation stay within the height.
+    std::vector<int> keys(test_size);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::vector<std::optional<int>> values(keys.size());
+    const rbt::OperationCounts before = rbt::OperationCounters<BatchLookupTag>::Snapshot();
+    tree.GetValues(keys, values);
+    const rbt::OperationCounts batch = rbt::OperationCounters<BatchLookupTag>::Snapshot() - before;
+    ASSERT_EQ(batch[rbt::Counter::Lookups], keys.size());
+    ASSERT_GE(batch.ComparisonsPerOperation(), 1);
+    ASSERT_LE(batch.ComparisonsPerOperation(), height);
+
+    // Every bound and range query counts one operation per descent.
+    const rbt::OperationCounts before_queries = rbt::OperationCounters<BatchLookupTag>::Snapshot();
+    std::ignore = tree.LowerBound(1);
+    std::ignore = tree.UpperBound(1);
+    std::ignore = tree.Floor(1);
+    std::ignore = tree.EqualRange(2);
+    tree.RangeScan(10, 20, [](const int&, const int&) {});
+    const rbt::OperationCounts queries = rbt::OperationCounters<BatchLookupTag>::Snapshot() - before_queries;
+    ASSERT_EQ(queries[rbt::Counter::Lookups], 6);
+    ASSERT_GE(queries.ComparisonsPerOperation(), 1);
+}
+
+TEST(StatsTests, BatchUpdateStatsTest)
+{
+    CountedTree<BatchUpdateTag> tree;
+    for (int i = 0; i < test_size; i += 2) {
+        tree.Insert(i, i);
+    }
+
+    // Both the split-based and the bulk batch paths count one operation per batch key.
+    const std::vector<std::pair<int, int>> small_entries = {{1, 1}, {3, 3}, {5, 5}, {7, 7}};
+    const std::vector<int> small_keys = {1, 3, 5, 7};
+    rbt::OperationCounts before = rbt::OperationCounters<BatchUpdateTag>::Snapshot();
+    ASSERT_EQ(tree.InsertBatch(small_entries), small_entries.size());
+    ASSERT_EQ(tree.EraseBatch(small_keys), small_keys.size());
+    const rbt::OperationCounts small = rbt::OperationCounters<BatchUpdateTag>::Snapshot() - before;
+    ASSERT_EQ(small[rbt::Counter::Inserts], small_entries.size());
+    ASSERT_EQ(small[rbt::Counter::Erases], small_keys.size());
+
+    std::vector<std::pair<int, int>> entries;
+    std::vector<int> keys;
+    for (int i = 0; i < test_size; i++) {
+        entries.emplace_back(i, i);
+        keys.push_back(i);
+    }
+    before = rbt::OperationCounters<BatchUpdateTag>::Snapshot();
+    ASSERT_EQ(tree.InsertBatch(entries), test_size / 2);
+    ASSERT_EQ(tree.EraseBatch(keys), test_size);
+    const rbt::OperationCounts bulk = rbt::OperationCounters<BatchUpdateTag>::Snapshot() - before;
+    ASSERT_EQ(bulk[rbt::Counter::Inserts], entries.size());
+    ASSERT_EQ(bulk[rbt::Counter::Erases], keys.size());
+    // The bulk paths merge with the tree instead of descending it, a few comparisons per key.
+    ASSERT_LE(bulk.ComparisonsPerOperation(), std::bit_width(static_cast<size_t>(test_size)));
+    ASSERT_EQ(tree.Size(), 0);
+}
+
+TEST(StatsTests, SequentialStatsTest)
+{
+    CountedTree<SequentialTag> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+    }
+    ExpectConsistentShape(tree);
+    for (int i = 0; i < test_size; i += 2) {
+        tree.Erase(i);
+    }
+    ExpectConsistentShape(tree);
+
+    const rbt::OperationCounts counts = rbt::OperationCounters<SequentialTag>::Snapshot();
+    ASSERT_EQ(counts[rbt::Counter::NodesAllocated] - counts[rbt::Counter::NodesFreed], tree.Size());
+    ASSERT_LE(counts[rbt::Counter::EraseDoubleRotations], counts[rbt::Counter::Rotations] / 2);
+
+    // The counters do not take space in the tree.
+    static_assert(sizeof(tree) == sizeof(rbt::RedBlackTree<int, int>));
+}
+
+TEST(StatsTests, ClearStatsTest)
+{
+    // Pooled and Index32 trees free their nodes all at once on Clear, they are counted all the same.
+    const auto expect_balanced = []<class Tree, class Tag>(Tree& tree, std::type_identity<Tag>) {
+        for (int i = 0; i < test_size; i++) {
+            tree.Insert(i, i);
+        }
+        for (int i = 0; i < test_size; i += 2) {
+            tree.Erase(i);
+        }
+        tree.Clear();
+        const rbt::OperationCounts counts = rbt::OperationCounters<Tag>::Snapshot();
+        ASSERT_EQ(counts[rbt::Counter::NodesAllocated], test_size);
+        ASSERT_EQ(counts[rbt::Counter::NodesFreed], test_size);
+    };
+
+    rbt::PooledRedBlackTree<int, int, std::less<int>, rbt::StatisticsPolicy<PooledTag>> pooled_tree;
+    expect_balanced(pooled_tree, std::type_identity<PooledTag>());
+    rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+                      rbt::StatisticsPolicy<CompactTag, rbt::LayoutPolicy<rbt::NodeLayout::Index32>>>
+        compact_tree;
+    expect_balanced(compact_tree, std::type_identity<CompactTag>());
+}
+
+TEST(StatsTests, LessOnlyComparisonsTest)
+{
+    // Ordering with a less-than comparator takes up to two calls, each of them is counted.
+    rbt::RedBlackTree<int, int, CountingLess, std::allocator<std::pair<const int, int>>, rbt::StatisticsPolicy<LessOnlyTag>> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert((i * 7919) % test_size, i);
+    }
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Contains(i));
+    }
+    for (int i = 0; i < test_size; i += 2) {
+        ASSERT_TRUE(tree.Erase(i));
+    }
+    ASSERT_EQ(rbt::OperationCounters<LessOnlyTag>::Snapshot()[rbt::Counter::Comparisons], CountingLess::calls);
+}
+
+TEST(StatsTests, ThreadStatsTest)
+{
+    constexpr int kThreadCount = 4;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreadCount; t++) {
+        threads.emplace_back([] {
+            CountedTree<ThreadTag> tree;
+            for (int i = 0; i < test_size; i++) {
+                tree.Insert(i, i);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // The counts of exited threads are kept.
+    const rbt::OperationCounts counts = rbt::OperationCounters<ThreadTag>::Snapshot();
+    ASSERT_EQ(counts[rbt::Counter::Inserts], kThreadCount * test_size);
+    ASSERT_EQ(counts[rbt::Counter::NodesAllocated], counts[rbt::Counter::NodesFreed]);
+}
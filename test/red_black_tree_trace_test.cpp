@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#ifdef RBT_USE_SPDLOG
+#include <spdlog/spdlog.h>
+#endif
+
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "red_black_tree.h"
+#ifdef RBT_USE_SPDLOG
+#include "spdlog_tracer.h"
+#endif
+#include "test_constant.h"
+
+namespace
+{
+
+/**
+ * Tracer keeping every step, and the tree size seen at it.
+ */
+struct RecordingTracer
+{
+    struct Step
+    {
+        rbt::TraceEvent Event;
+        int Key;
+        size_t Size;
+    };
+
+    static inline std::vector<Step> steps;
+
+    template <class Tree> static void Trace(const Tree& tree, const rbt::TraceEvent event, const int& key) { steps.push_back({event, key, tree.Size()}); }
+};
+
+template <class Tracer> using TracedTree = rbt::RedBlackTree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, rbt::TracerPolicy<Tracer>>;
+
+} // namespace
+
+TEST(TraceTests, ClassicTraceTest)
+{
+    TracedTree<RecordingTracer> tree;
+    for (const int& e : classic_array) {
+        RecordingTracer::steps.clear();
+        ASSERT_TRUE(tree.Insert(e, e));
+        ASSERT_EQ(RecordingTracer::steps.size(), 2);
+        ASSERT_EQ(RecordingTracer::steps[0].Event, rbt::TraceEvent::BeforeInsert);
+        ASSERT_EQ(RecordingTracer::steps[0].Key, e);
+        ASSERT_EQ(RecordingTracer::steps[1].Event, rbt::TraceEvent::AfterInsert);
+        ASSERT_EQ(RecordingTracer::steps[1].Key, e);
+        ASSERT_EQ(RecordingTracer::steps[1].Size, RecordingTracer::steps[0].Size + 1);
+    }
+
+    // A present key ends the insert before anything changes.
+    RecordingTracer::steps.clear();
+    ASSERT_FALSE(tree.Insert(classic_array[0], 0));
+    ASSERT_EQ(RecordingTracer::steps.size(), 1);
+
+    for (const int& e : classic_array) {
+        RecordingTracer::steps.clear();
+        ASSERT_TRUE(tree.Erase(e));
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+        ASSERT_GE(RecordingTracer::steps.size(), 2);
+        ASSERT_EQ(RecordingTracer::steps.front().Event, rbt::TraceEvent::BeforeErase);
+        ASSERT_EQ(RecordingTracer::steps.back().Event, rbt::TraceEvent::AfterErase);
+        ASSERT_EQ(RecordingTracer::steps.back().Key, e);
+        ASSERT_EQ(RecordingTracer::steps.back().Size, RecordingTracer::steps.front().Size - 1);
+        for (size_t i = 1; i + 1 < RecordingTracer::steps.size(); i++) {
+            ASSERT_EQ(RecordingTracer::steps[i].Event, rbt::TraceEvent::EraseRecolor);
+        }
+    }
+
+    // A missing key walks down the tree, but nothing is erased.
+    RecordingTracer::steps.clear();
+    ASSERT_FALSE(tree.Erase(classic_array[0]));
+    ASSERT_EQ(RecordingTracer::steps.size(), 1);
+}
+
+#ifdef RBT_USE_SPDLOG
+TEST(TraceTests, SpdlogTracerTest)
+{
+    const auto level = spdlog::get_level();
+    spdlog::set_level(spdlog::level::debug);
+    TracedTree<rbt::SpdlogTracer> tree;
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Insert(e, e));
+    }
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Erase(e));
+    }
+    spdlog::set_level(level);
+    ASSERT_TRUE(tree.IsEmpty());
+}
+#endif
+
+TEST(TraceTests, PrintTreeTest)
+{
+    rbt::RedBlackTree<int, int> tree;
+    std::ostringstream empty;
+    tree.PrintTree(empty);
+    ASSERT_EQ(empty.str(), "\n");
+
+    for (const int key : {1, 2, 3, 4}) {
+        tree.Insert(key, key);
+    }
+    std::ostringstream os;
+    tree.PrintTree(os);
+    ASSERT_EQ(os.str(), "[2 black]\n[1 black], [3 black]\nnil, nil, nil, [4 red]\n\n");
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+#include "red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+struct Payload
+{
+    int64_t Id = 0;
+    std::string Name;
+};
+
+} // namespace
+
+TEST(TypeTests, Int64KeyTest)
+{
+    rbt::RedBlackTree<int64_t, int64_t> tree;
+    constexpr int64_t base = 1LL << 40;
+    for (int64_t i = 0; i < test_size; ++i) {
+        ASSERT_TRUE(tree.Insert(base + i, i));
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_EQ(tree.Size(), test_size);
+
+    for (int64_t i = 0; i < test_size; ++i) {
+        auto value = tree.GetValue(base + i);
+        ASSERT_TRUE(value.has_value());
+        ASSERT_EQ(*value, i);
+    }
+    ASSERT_FALSE(tree.GetValue(0).has_value());
+}
+
+TEST(TypeTests, StringKeyStructValueTest)
+{
+    rbt::RedBlackTree<std::string, Payload> tree;
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Insert(std::to_string(e), Payload{.Id = e, .Name = "node" + std::to_string(e)}));
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+    ASSERT_EQ(tree.Size(), classic_array.size());
+
+    for (const int& e : classic_array) {
+        auto value = tree.GetValue(std::to_string(e));
+        ASSERT_TRUE(value.has_value());
+        ASSERT_EQ(value->Id, e);
+        ASSERT_EQ(value->Name, "node" + std::to_string(e));
+    }
+
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Erase(std::to_string(e)));
+        ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    }
+    ASSERT_TRUE(tree.IsEmpty());
+}
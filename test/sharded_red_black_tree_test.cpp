@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <compare>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "sharded_red_black_tree.h"
+#include "test_constant.h"
+
+namespace
+{
+
+using ShardedTree = rbt::ShardedRedBlackTree<int, int>;
+
+std::vector<int> RandomKeys(const int count)
+{
+    rbt::IntRandomNumberGenerator rng(0, test_size);
+    std::vector<int> keys;
+    for (int i = 0; i < count; i++) {
+        keys.push_back(rng());
+    }
+    return keys;
+}
+
+} // namespace
+
+TEST(ShardedTests, BoundaryTest)
+{
+    const std::vector<int> keys(classic_array.begin(), classic_array.end());
+    const std::vector<int> boundaries = ShardedTree::SampleBoundaries(keys, 4);
+    ASSERT_EQ(boundaries.size(), 3);
+    ASSERT_TRUE(std::ranges::is_sorted(boundaries));
+
+    // Too few distinct keys leave fewer shards.
+    ASSERT_EQ(ShardedTree::SampleBoundaries(std::vector<int>(100, 7), 8).size(), 0);
+    ASSERT_EQ(ShardedTree::SampleBoundaries({}, 8).size(), 0);
+
+    ShardedTree tree(boundaries, 2);
+    ASSERT_EQ(tree.ShardCount(), 4);
+    for (const int& e : classic_array) {
+        tree.Insert(e, -e);
+    }
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    for (const int& e : classic_array) {
+        ASSERT_EQ(tree.GetValue(e), -e);
+    }
+    for (size_t i = 0; i < tree.ShardCount(); i++) {
+        ASSERT_FALSE(tree.Shard(i).IsEmpty());
+    }
+}
+
+TEST(ShardedTests, BatchTest)
+{
+    const std::vector<int> keys = RandomKeys(8 * test_size);
+    ShardedTree tree(ShardedTree::SampleBoundaries(keys, 8), 4);
+    std::map<int, int> expected;
+
+    std::vector<std::pair<int, int>> entries;
+    for (size_t i = 0; i < keys.size(); i++) {
+        entries.emplace_back(keys[i], static_cast<int>(i));
+        expected.emplace(keys[i], static_cast<int>(i));
+    }
+    ASSERT_EQ(tree.InsertBatch(entries), expected.size());
+    ASSERT_EQ(tree.Size(), expected.size());
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_TRUE(std::ranges::equal(tree, expected, [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first && lhs.second == rhs.second; }));
+
+    std::vector<int> erased_keys(keys.begin(), keys.begin() + static_cast<std::ptrdiff_t>(keys.size() / 2));
+    size_t erased = 0;
+    for (const int key : erased_keys) {
+        erased += expected.erase(key);
+    }
+    ASSERT_EQ(tree.EraseBatch(erased_keys), erased);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+
+    std::vector<int> probes;
+    for (int key = -1; key <= test_size + 1; key++) {
+        probes.push_back(key);
+    }
+    std::vector<std::optional<int>> values(probes.size());
+    tree.GetValues(probes, values);
+    for (size_t i = 0; i < probes.size(); i++) {
+        const auto it = expected.find(probes[i]);
+        ASSERT_EQ(values[i], it == expected.end() ? std::nullopt : std::optional<int>(it->second));
+    }
+
+    tree.Clear();
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_EQ(tree.begin(), tree.end());
+}
+
+TEST(ShardedTests, PooledBatchTest)
+{
+    using PooledShardedTree = rbt::ShardedRedBlackTree<int, int, std::less<int>, rbt::NodePoolAllocator<std::pair<const int, int>>>;
+    const std::vector<int> keys = RandomKeys(8 * test_size);
+    PooledShardedTree tree(PooledShardedTree::SampleBoundaries(keys, 8), 4);
+
+    // The shards allocate in parallel, each from a pool of its own.
+    for (size_t i = 1; i < tree.ShardCount(); i++) {
+        ASSERT_FALSE(tree.Shard(i).GetAllocator() == tree.Shard(0).GetAllocator());
+    }
+
+    std::map<int, int> expected;
+    std::vector<std::pair<int, int>> entries;
+    for (size_t i = 0; i < keys.size(); i++) {
+        entries.emplace_back(keys[i], static_cast<int>(i));
+        expected.emplace(keys[i], static_cast<int>(i));
+    }
+    ASSERT_EQ(tree.InsertBatch(entries), expected.size());
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    for (size_t i = 0; i < tree.ShardCount(); i++) {
+        ASSERT_GT(tree.Shard(i).GetAllocator().Pool().SlabCount(), 0);
+    }
+
+    ASSERT_EQ(tree.EraseBatch(keys), expected.size());
+    ASSERT_TRUE(tree.IsEmpty());
+}
+
+TEST(ShardedTests, ThreeWayComparatorTest)
+{
+    using ThreeWayTree = rbt::ShardedRedBlackTree<int, int, std::compare_three_way>;
+    const std::vector<int> keys = RandomKeys(test_size);
+    const std::vector<int> boundaries = ThreeWayTree::SampleBoundaries(keys, 4);
+    ASSERT_EQ(boundaries.size(), 3);
+    ASSERT_TRUE(std::ranges::is_sorted(boundaries));
+
+    ThreeWayTree tree(boundaries, 2);
+    std::vector<std::pair<int, int>> entries;
+    for (const int key : keys) {
+        entries.emplace_back(key, -key);
+    }
+    tree.InsertBatch(entries);
+    ASSERT_TRUE(tree.RedBlackTreeRulesCheck());
+    ASSERT_TRUE(std::ranges::is_sorted(tree, {}, [](const auto& entry) { return entry.first; }));
+    for (const int key : keys) {
+        ASSERT_EQ(tree.GetValue(key), -key);
+    }
+    const size_t size = tree.Size();
+    ASSERT_EQ(tree.EraseBatch(keys), size);
+    ASSERT_TRUE(tree.IsEmpty());
+}
+
+TEST(ShardedTests, ThreadPoolTest)
+{
+    rbt::ThreadPool pool(4);
+    std::vector<int> hits(test_size);
+    pool.ParallelFor(hits.size(), [&](const size_t i) { hits[i]++; });
+    ASSERT_TRUE(std::ranges::all_of(hits, [](const int hit) { return hit == 1; }));
+
+    // Jobs submitted from inside a job are helped along by the waiting caller.
+    std::vector<int> nested(16 * 16);
+    pool.ParallelFor(16, [&](const size_t i) { pool.ParallelFor(16, [&](const size_t j) { nested[i * 16 + j]++; }); });
+    ASSERT_TRUE(std::ranges::all_of(nested, [](const int hit) { return hit == 1; }));
+
+    ASSERT_THROW(pool.ParallelFor(8, [](const size_t i) {
+        if (i == 5) {
+            throw std::runtime_error("task failed");
+        }
+    }),
+                 std::runtime_error);
+}
@@ -1,7 +1,24 @@
 #pragma once
 
+#include <gtest/gtest.h>
+
 #include <array>
+#include <map>
 
 constexpr int test_size = 1000;
 // Array from Data Structures and Algorithm Analysis in C++ (Fourth Edition) by Mark Allen Weiss.
-constexpr std::array classic_array{10, 85, 15, 70, 20, 60, 30, 50, 65, 80, 90, 40, 5, 55, 45};
\ No newline at end of file
+constexpr std::array classic_array{10, 85, 15, 70, 20, 60, 30, 50, 65, 80, 90, 40, 5, 55, 45};
+
+// Check that a tree holds exactly the expected entries, in key order.
+template <typename Tree> void ExpectSameContent(const Tree& tree, const std::map<int, int>& expected)
+{
+    ASSERT_EQ(tree.Size(), expected.size());
+    auto it = tree.begin();
+    for (const auto& [key, value] : expected) {
+        ASSERT_NE(it, tree.end());
+        ASSERT_EQ(it->first, key);
+        ASSERT_EQ(it->second, value);
+        ++it;
+    }
+    ASSERT_EQ(it, tree.end());
+}
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
+#ifdef RBT_USE_SPDLOG
 #include <spdlog/spdlog.h>
+#endif
 
+#ifdef RBT_USE_SPDLOG
 class MyTestEnvironment final : public testing::Environment
 {
 public:
@@ -13,10 +16,13 @@ public:
 #endif
     }
 };
+#endif
 
 int main(int argc, char** argv)
 {
     testing::InitGoogleTest(&argc, argv);
+#ifdef RBT_USE_SPDLOG
     AddGlobalTestEnvironment(new MyTestEnvironment);
+#endif
     return RUN_ALL_TESTS();
 }
\ No newline at end of file
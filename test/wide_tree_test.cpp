@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <compare>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "test_constant.h"
+#include "wide_tree.h"
+
+namespace
+{
+
+/// <summary>
+/// Insert and erase random keys, checking the tree against std::map after every step.
+/// </summary>
+template <typename Tree> void RandomInsertErase(const int key_range, const int steps)
+{
+    Tree tree;
+    std::map<int, int> expected;
+    rbt::IntRandomNumberGenerator rng(0, key_range);
+    for (int i = 0; i < steps; i++) {
+        const int key = rng();
+        if (rng() % 2) {
+            ASSERT_EQ(tree.Erase(key), expected.erase(key) == 1);
+        } else {
+            ASSERT_EQ(tree.Insert(key, i), expected.emplace(key, i).second);
+        }
+        ASSERT_TRUE(tree.WideTreeRulesCheck());
+    }
+    ExpectSameContent(tree, expected);
+    for (const auto& [key, value] : expected) {
+        ASSERT_EQ(tree.GetValue(key), value);
+    }
+}
+
+} // namespace
+
+TEST(WideTreeTests, EmptyTest)
+{
+    rbt::WideTree<int, int> tree;
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_EQ(tree.Height(), 0);
+    ASSERT_FALSE(tree.GetValue(0).has_value());
+    ASSERT_FALSE(tree.Erase(0));
+    ASSERT_EQ(tree.begin(), tree.end());
+    ASSERT_TRUE(tree.WideTreeRulesCheck());
+}
+
+TEST(WideTreeTests, ClassicTest)
+{
+    rbt::WideTree<int, int, 4> tree;
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Insert(e, e * 2));
+        ASSERT_FALSE(tree.Insert(e, e));
+    }
+    ASSERT_EQ(tree.Size(), classic_array.size());
+    ASSERT_GT(tree.Height(), 1);
+    ASSERT_TRUE(tree.WideTreeRulesCheck());
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Contains(e));
+        ASSERT_EQ(tree.Find(e)->second, e * 2);
+    }
+
+    for (const int& e : classic_array) {
+        ASSERT_TRUE(tree.Erase(e));
+        ASSERT_FALSE(tree.Erase(e));
+        ASSERT_TRUE(tree.WideTreeRulesCheck());
+    }
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_EQ(tree.Height(), 0);
+}
+
+TEST(WideTreeTests, OrderedInsertDeleteTest)
+{
+    rbt::WideTree<int, int, 5> tree;
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Insert(i, i));
+    }
+    ASSERT_TRUE(tree.WideTreeRulesCheck());
+    for (int i = test_size - 1; i >= 0; i -= 2) {
+        ASSERT_TRUE(tree.Erase(i));
+    }
+    ASSERT_TRUE(tree.WideTreeRulesCheck());
+    ASSERT_EQ(tree.Size(), test_size / 2);
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_EQ(tree.Contains(i), i % 2 == 0);
+    }
+
+    tree.Clear();
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_TRUE(tree.Insert(1, 1));
+}
+
+TEST(WideTreeTests, RandomInsertDeleteTest)
+{
+    // Small fanouts exercise splits, borrows and merges on every level.
+    RandomInsertErase<rbt::WideTree<int, int, 4>>(test_size / 4, 4 * test_size);
+    RandomInsertErase<rbt::WideTree<int, int, 5>>(test_size / 4, 4 * test_size);
+    RandomInsertErase<rbt::WideTree<int, int>>(4 * test_size, 8 * test_size);
+}
+
+TEST(WideTreeTests, IteratorTest)
+{
+    rbt::WideTree<int, int, 6> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, 0);
+    }
+    for (auto [key, value] : tree) {
+        value = key + 1;
+    }
+    int expected_key = 0;
+    for (auto it = std::as_const(tree).begin(); it != tree.end(); it++) {
+        ASSERT_EQ(it->first, expected_key);
+        ASSERT_EQ(it->second, expected_key + 1);
+        expected_key++;
+    }
+    ASSERT_EQ(expected_key, test_size);
+}
+
+TEST(WideTreeTests, StringKeyTest)
+{
+    rbt::WideTree<std::string, std::string, 8, std::compare_three_way> tree;
+    for (int i = 0; i < test_size; i++) {
+        ASSERT_TRUE(tree.Insert(std::to_string(i), std::string(32, 'x')));
+    }
+    for (int i = 0; i < test_size; i += 3) {
+        ASSERT_TRUE(tree.Erase(std::to_string(i)));
+    }
+    ASSERT_TRUE(tree.WideTreeRulesCheck());
+    ASSERT_TRUE(tree.Contains("1"));
+    ASSERT_FALSE(tree.Contains("3"));
+}
+
+TEST(WideTreeTests, MoveTest)
+{
+    rbt::WideTree<int, int> tree;
+    for (int i = 0; i < test_size; i++) {
+        tree.Insert(i, i);
+    }
+
+    rbt::WideTree<int, int> moved(std::move(tree));
+    ASSERT_TRUE(tree.IsEmpty());
+    ASSERT_EQ(moved.Size(), test_size);
+
+    tree.Insert(-1, -1);
+    swap(tree, moved);
+    ASSERT_EQ(tree.Size(), test_size);
+    ASSERT_EQ(moved.Size(), 1);
+
+    moved = std::move(tree);
+    ASSERT_EQ(moved.Size(), test_size);
+    ASSERT_TRUE(moved.WideTreeRulesCheck());
+
+    // Nodes of a different memory resource are not adopted.
+    std::pmr::monotonic_buffer_resource resource;
+    std::pmr::polymorphic_allocator<std::pair<const int, int>> allocator(&resource);
+    rbt::WideTree<int, int, 16, std::less<int>, decltype(allocator)> pmr_tree(allocator);
+    rbt::WideTree<int, int, 16, std::less<int>, decltype(allocator)> other;
+    for (const int& e : classic_array) {
+        other.Insert(e, e);
+    }
+    pmr_tree = std::move(other);
+    ASSERT_EQ(pmr_tree.Size(), classic_array.size());
+    ASSERT_TRUE(other.IsEmpty());
+    ASSERT_EQ(pmr_tree.GetAllocator().resource(), &resource);
+    ASSERT_TRUE(pmr_tree.WideTreeRulesCheck());
+}
@@ -6,8 +6,26 @@ set_languages("c++latest")
 set_toolchains("llvm")
 set_runtimes("c++_shared")
 
-add_requires("spdlog")
+option("spdlog")
+  set_default(false)
+  set_showmenu(true)
+  set_description("Report rules check violations through spdlog instead of stderr, and test SpdlogTracer.")
+option_end()
+
+option("bench")
+  set_default(false)
+  set_showmenu(true)
+  set_description("Build bench-suite, which needs Google Benchmark and Abseil.")
+option_end()
+
+if has_config("spdlog") then
+  add_requires("spdlog")
+end
 add_requires("gtest")
+if has_config("bench") then
+  add_requires("benchmark")
+  add_requires("abseil")
+end
 
 target("red-black-tree")
   if is_mode("release") then
@@ -17,13 +35,18 @@ target("red-black-tree")
   if is_mode("debug") then
     set_symbols("debug")
     set_optimize("none")
-    add_defines("SPDLOG_ACTIVE_LEVEL=SPDLOG_LEVEL_DEBUG")
   end
 
+  -- Optional precompiled RedBlackTree<int, int> and WideTree<int, int>, the trees themselves are header-only.
   set_kind("static")
   add_includedirs("src", {public = true})
+  add_headerfiles("src/(*.h)", "src/(*.inl)")
   add_files("src/red_black_tree.cpp")
-  add_packages("spdlog")
+  add_files("src/wide_tree.cpp")
+  if has_config("spdlog") then
+    add_defines("RBT_USE_SPDLOG", {public = true})
+    add_packages("spdlog", {public = true})
+  end
 target_end()
 
 target("insert-test")
@@ -37,7 +60,6 @@ target("insert-test")
   add_files("test/red_black_tree_insert_test.cpp")
   add_deps("red-black-tree")
   add_packages("gtest")
-  add_packages("spdlog")
 target_end()
 
 target("delete-test")
@@ -51,7 +73,292 @@ target("delete-test")
   add_files("test/red_black_tree_delete_test.cpp")
   add_deps("red-black-tree")
   add_packages("gtest")
-  add_packages("spdlog")
+target_end()
+
+target("type-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_type_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("allocator-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_allocator_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("iterator-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_iterator_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("range-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_range_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("order-statistics-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_order_statistics_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("aggregate-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_aggregate_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("bulk-load-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_bulk_load_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("batch-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_batch_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("lookup-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_lookup_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("move-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_move_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("comparator-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_comparator_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("layout-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_layout_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("wide-tree-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/wide_tree_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("key-search-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/key_search_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("concurrent-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/concurrent_red_black_tree_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("sharded-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/sharded_red_black_tree_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("persistent-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/persistent_red_black_tree_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("join-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_join_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("mapped-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/mapped_red_black_tree_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("durable-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/durable_red_black_tree_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("trace-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_trace_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
+target_end()
+
+target("stats-test")
+  if is_mode("debug") then
+    set_symbols("debug")
+    set_optimize("none")
+  end
+
+  set_kind("binary")
+  add_files("test/test_main.cpp")
+  add_files("test/red_black_tree_stats_test.cpp")
+  add_deps("red-black-tree")
+  add_packages("gtest")
 target_end()
 
 target("bench-mark")
@@ -60,5 +367,43 @@ target("bench-mark")
   set_kind("binary")
   add_files("bench/performance.cpp")
   add_deps("red-black-tree")
-  add_packages("spdlog")
+  add_syslinks("pthread")
 target_end()
+
+target("bench-lookup")
+  set_symbols("hidden")
+  set_optimize("fastest")
+  set_kind("binary")
+  add_files("bench/lookup.cpp")
+  add_deps("red-black-tree")
+target_end()
+
+target("bench-concurrent")
+  set_symbols("hidden")
+  set_optimize("fastest")
+  set_kind("binary")
+  add_files("bench/concurrent.cpp")
+  add_deps("red-black-tree")
+  add_syslinks("pthread")
+target_end()
+
+target("bench-durable")
+  set_symbols("hidden")
+  set_optimize("fastest")
+  set_kind("binary")
+  add_files("bench/durable.cpp")
+  add_deps("red-black-tree")
+  add_syslinks("pthread")
+target_end()
+
+if has_config("bench") then
+  target("bench-suite")
+    set_symbols("hidden")
+    set_optimize("fastest")
+    set_kind("binary")
+    add_files("bench/suite.cpp")
+    add_deps("red-black-tree")
+    add_packages("benchmark", "abseil")
+    add_syslinks("pthread")
+  target_end()
+end